@@ -0,0 +1,93 @@
+//
+// Modelos de chegada dos fluxos do escalonador
+//
+
+#ifndef ARRIVAL_H
+#define ARRIVAL_H
+
+#include <stdint.h>
+
+#define ARRIVAL_BATCH   256         // intervalos sorteados de uma vez
+
+typedef enum {
+    ARRIVAL_CONSTANT = 0,           // intervalo fixo burst / rate
+    ARRIVAL_POISSON,                // intervalos exponenciais com a mesma média
+    ARRIVAL_ONOFF,                  // períodos ON à taxa do fluxo separados por silêncios OFF
+    ARRIVAL_MICROBURST              // trens de pacotes à taxa de linha, média = taxa do fluxo
+} arrival_model_t;
+
+/* Distribuição da duração dos períodos ON/OFF */
+typedef enum {
+    ARRIVAL_DIST_CONSTANT = 0,
+    ARRIVAL_DIST_EXPONENTIAL,
+    ARRIVAL_DIST_PARETO             // cauda pesada, forma pareto_shape (> 1)
+} arrival_dist_t;
+
+/* Configuração do template ("arrival" no JSON) */
+typedef struct {
+    arrival_model_t model;
+    arrival_dist_t  on_dist;
+    arrival_dist_t  off_dist;
+    uint64_t        on_ns;          // duração média de um período ON
+    uint64_t        off_ns;         // duração média de um período OFF
+    double          pareto_shape;
+    uint32_t        train;          // microburst: rodadas por trem
+    uint32_t        line_mbps;      // microburst: taxa de linha
+    uint64_t        seed;
+} arrival_cfg_t;
+
+/*
+ * Estado de um fluxo. Os intervalos são sorteados em lotes de ARRIVAL_BATCH
+ * (xorshift64*), longe do TX: ele só lê os prazos já gravados nos pacotes.
+ */
+typedef struct {
+    arrival_cfg_t cfg;
+    double        gap_ns;           // intervalo médio entre rodadas (ON, no modelo on/off)
+    uint64_t      line_gap_ns;      // microburst: intervalo entre rodadas de um trem
+    uint64_t      rng;
+    double        on_left_ns;       // on/off: resto do período ON corrente
+    uint32_t      in_train;         // microburst: rodadas já emitidas do trem corrente
+    double        carry_ns;         // fração de ns ainda não atribuída a um intervalo
+    uint32_t      pos, n;
+    uint64_t      gap[ARRIVAL_BATCH];
+} arrival_t;
+
+/**
+ * Prepara o estado de um fluxo.
+ *
+ * @param gap_ns      intervalo médio entre rodadas (burst * 1e9 / rate)
+ * @param wire_bytes  bytes de uma rodada no fio (quadros + preâmbulo + IFG), para o microburst
+ */
+void arrival_init(arrival_t *a, const arrival_cfg_t *cfg, double gap_ns, uint64_t wire_bytes);
+
+/**
+ * Sorteia o próximo lote de intervalos.
+ */
+void arrival_refill(arrival_t *a);
+
+/**
+ * Intervalo até a próxima rodada, em ns.
+ */
+static inline uint64_t arrival_next_gap(arrival_t *a) {
+    if (a->pos == a->n) arrival_refill(a);
+    return a->gap[a->pos++];
+}
+
+/**
+ * Menor intervalo que o modelo produz com frequência (para o tick da roda).
+ */
+uint64_t arrival_min_gap(const arrival_t *a);
+
+/**
+ * Nome do modelo ("constant", "poisson", "onoff" ou "microburst") -> modelo.
+ * @return 0 em sucesso, -1 se desconhecido
+ */
+int arrival_model_parse(const char *name, arrival_model_t *out);
+
+/**
+ * Nome da distribuição ("constant", "exponential" ou "pareto") -> distribuição.
+ * @return 0 em sucesso, -1 se desconhecida
+ */
+int arrival_dist_parse(const char *name, arrival_dist_t *out);
+
+#endif // ARRIVAL_H
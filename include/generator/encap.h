@@ -0,0 +1,102 @@
+//
+// Pilha de encapsulamento dos templates: 802.1Q/QinQ, MPLS, GRE e VXLAN
+//
+
+#ifndef ENCAP_H
+#define ENCAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <netinet/in.h>
+#include "ip.h"
+#include "packet.h"
+
+#define ENCAP_MAX_LAYERS    8
+#define ENCAP_MAX_HDR       512     // do Ethernet externo até o IP interno
+#define ENCAP_VXLAN_PORT    4789    // única porta de destino que o RX desencapsula
+
+#define ETHERTYPE_VLAN      0x8100  // C-tag (802.1Q)
+#define ETHERTYPE_QINQ      0x88A8  // S-tag (802.1ad)
+#define ETHERTYPE_MPLS      0x8847
+
+typedef enum {
+    ENCAP_VLAN,
+    ENCAP_MPLS,
+    ENCAP_GRE,
+    ENCAP_VXLAN
+} encap_type_t;
+
+/* Uma camada da pilha, como descrita no JSON (da mais externa para a mais interna) */
+typedef struct {
+    encap_type_t type;
+    uint16_t     tpid;                      // VLAN: ETHERTYPE_VLAN ou ETHERTYPE_QINQ
+    uint16_t     vid;
+    uint8_t      pcp;                       // VLAN: prioridade; MPLS: TC
+    uint8_t      ttl;                       // MPLS e IP externo dos túneis
+    uint32_t     label;                     // MPLS
+    char         src_ip[INET6_ADDRSTRLEN];  // GRE/VXLAN: IP externo (a família sai do endereço; VXLAN só IPv4)
+    char         dst_ip[INET6_ADDRSTRLEN];
+    uint32_t     key;                       // GRE: chave (com has_key); VXLAN: VNI
+    uint8_t      has_key;
+    uint16_t     src_port;                  // VXLAN: 0 = derivada do fluxo interno
+    uint8_t      inner_dst_mac[6];          // VXLAN: Ethernet interno (zeros = MACs externos)
+    uint8_t      inner_src_mac[6];
+} encap_layer_t;
+
+/* IP externo de um túnel: comprimento (e checksum, no IPv4) acertados por pacote */
+typedef struct {
+    uint16_t off;
+    uint8_t  v4;
+    uint32_t sum;                           // IPv4: soma do cabeçalho com comprimento e checksum zerados
+} encap_ip_t;
+
+/*
+ * Cabeçalhos externos de um template, montados uma vez na carga: Ethernet
+ * externo, tags, rótulos e túneis, até o EtherType/BoS do IP interno. Por
+ * pacote só os comprimentos dos IPs e UDPs externos mudam.
+ */
+typedef struct encap {
+    uint8_t    hdr[ENCAP_MAX_HDR];
+    uint16_t   len;
+    uint8_t    n_layers;                    // 0 = só os MACs do template
+    uint8_t    n_ip;
+    uint8_t    n_udp;
+    encap_ip_t ip[ENCAP_MAX_LAYERS];
+    uint16_t   udp_off[ENCAP_MAX_LAYERS];   // VXLAN: checksum UDP externo 0
+} encap_t;
+
+/**
+ * Lê um MAC "aa:bb:cc:dd:ee:ff".
+ * @return 0 em sucesso, -1 se inválido
+ */
+int encap_parse_mac(const char *s, uint8_t mac[6]);
+
+/**
+ * Monta os cabeçalhos externos de um template.
+ *
+ * @param layers   Camadas, da mais externa para a mais interna
+ * @param dst_mac  MACs do Ethernet externo (NULL = os padrão do NetWagon)
+ * @param inner    Família do IP interno
+ * @param entropy  Hash do fluxo interno (porta de origem VXLAN)
+ * O UDP externo do VXLAN vai com checksum 0, o que o IPv6 não admite
+ * (RFC 8200): VXLAN com IP externo IPv6 é recusado.
+ *
+ * @return 0 em sucesso, -1 se a pilha for inválida (mensagem em stderr)
+ */
+int encap_compile(const encap_layer_t *layers, size_t n, const uint8_t *dst_mac,
+                  const uint8_t *src_mac, ip_version_t inner, uint32_t entropy, encap_t *out);
+
+/**
+ * Escreve os cabeçalhos externos no início de um quadro de len bytes (o IP
+ * interno começa em frame + e->len) e acerta comprimentos e checksums.
+ */
+void encap_write(const encap_t *e, uint8_t *frame, size_t len);
+
+/**
+ * Acrescenta os cabeçalhos externos a um pacote sem Ethernet. Sem pilha
+ * (e == NULL), equivale a add_ethernet_header().
+ * @return 0 em sucesso, -1 sem memória
+ */
+int encap_packet(const encap_t *e, packet_t *pkt);
+
+#endif // ENCAP_H
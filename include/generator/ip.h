@@ -69,6 +69,8 @@ struct pseudo_header_v6 {
 #define IP_PROTO_UDP  17
 #define IP_PROTO_ICMP 1
 #define IP_PROTO_ICMPV6 58
+#define IP_PROTO_FRAGMENT 44   // cabeçalho de extensão Fragment do IPv6
+#define IP_PROTO_GRE  47
 
 
 
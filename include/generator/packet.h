@@ -7,12 +7,22 @@
 
 #include "ip.h"
 
+struct tcp_flow_table;
+
 /* Definição de pacote genérico */
 typedef struct packet {
     void *data;               // Ponteiro para dados do pacote
     size_t length;            // Tamanho total do pacote
     ip_version_t ip_version;  // IPv4 ou IPv6
     protocol_type_t protocol; // TCP, UDP, ICMP, etc.
+    uint32_t id;              // ID de correlação no payload (0 = sem ID)
+    uint32_t flow;            // fluxo TCP do cliente (índice + 1 na tabela da lista, 0 = nenhum)
+    uint32_t tcp_ack;         // fluxo TCP: ACK montado com o ISN emulado (base das correções)
+    uint16_t tmpl;            // índice do template de origem
+    uint16_t probe_off;       // offset do tag de sonda no quadro (0 = payload com "ID|")
+    uint16_t gso_size;        // super-quadro: payload de cada segmento TSO/GSO (0 = quadro final)
+    uint8_t  csum_partial;    // checksum TCP/UDP parcial: o kernel/NIC completa (PACKET_VNET_HDR)
+    uint64_t tx_offset_ns;    // lista escalonada: prazo de envio contado do início do TX
     struct packet *next;      // Próximo pacote na lista
 } packet_t;
 
@@ -21,6 +31,8 @@ typedef struct {
     packet_t *head;
     packet_t *tail;
     int count;
+    struct tcp_flow_table *flows;   // sessões TCP dos pacotes (NULL = nenhuma)
+    uint64_t lap_ns;                // > 0: lista escalonada (prazo por pacote); duração de uma passagem
 } packet_list_t;
 
 uint16_t calculate_checksum(uint16_t *data, size_t length);
@@ -32,6 +44,9 @@ void free_packet_list(packet_list_t *list);
 /* Adicionar pacote à lista */
 void add_packet_to_list(packet_list_t *list, packet_t *packet);
 
+/* Adicionar quadro que já tem Ethernet (ou pilha de encapsulamento) */
+void append_packet_to_list(packet_list_t *list, packet_t *packet);
+
 void add_ethernet_header(packet_t *packet);
 
 #endif //PACKET_H
@@ -2,6 +2,7 @@
 #define READER_H
 
 #include "packet.h"
+#include "template.h"
 
 /**
  * Carrega um arquivo JSON contendo uma lista de templates de pacotes e
@@ -0,0 +1,70 @@
+//
+// Escalonador de fluxos por roda de tempo (timing wheel)
+//
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include "arrival.h"
+
+#define SCHED_SLOTS     4096        // fatias da roda (potência de 2)
+#define SCHED_NONE      UINT32_MAX
+
+/* Um fluxo: count rodadas de burst pacotes cada, a partir de start_ns, a rate pacotes/s */
+typedef struct {
+    uint64_t start_ns;
+    uint64_t rate;              // pacotes por segundo (na intercalação por peso, o próprio peso)
+    uint32_t burst;             // pacotes por rodada (>= 1)
+    uint32_t count;             // rodadas a emitir
+    uint32_t done;              // rodadas já emitidas
+    uint64_t due_ns;            // prazo da próxima rodada
+    uint32_t link;              // próximo fluxo na mesma fatia (ou no transbordo)
+    arrival_t *arrival;         // intervalos do modelo de chegada (NULL = constantes)
+} sched_stream_t;
+
+/*
+ * Roda de SCHED_SLOTS fatias de tick_ns. Cada fatia é uma fila FIFO de
+ * fluxos; prazos além do horizonte (SCHED_SLOTS * tick_ns) ficam numa lista
+ * de transbordo, revista a cada volta da roda. Custo amortizado O(1) por
+ * rodada; dentro de uma fatia a ordem é a de chegada (erro <= tick_ns).
+ */
+typedef struct {
+    sched_stream_t *streams;
+    uint32_t       n_streams;
+    uint32_t       head[SCHED_SLOTS];
+    uint32_t       tail[SCHED_SLOTS];
+    uint32_t       overflow;        // lista de transbordo
+    uint32_t       in_wheel;        // fluxos nas fatias
+    uint32_t       pending;         // fluxos com rodadas restantes
+    uint64_t       tick_ns;
+    uint64_t       cursor;          // tick da fatia corrente
+} sched_wheel_t;
+
+/**
+ * Prepara a roda para n_streams fluxos (os campos start_ns, rate e count de
+ * streams já preenchidos; count == 0 fica de fora). O tick é metade do menor
+ * intervalo entre rodadas (o do modelo de chegada, se houver), limitado a
+ * [1 ns, 1 ms].
+ *
+ * @return 0 em sucesso, -1 em erro (rate == 0 com count > 0)
+ */
+int sched_init(sched_wheel_t *w, sched_stream_t *streams, uint32_t n_streams);
+
+/**
+ * Próxima rodada em ordem de prazo.
+ *
+ * @param stream  índice do fluxo
+ * @param due_ns  prazo da rodada (start_ns + k * burst / rate, ou a soma dos
+ *                intervalos sorteados pelo modelo de chegada)
+ * @return 0 em sucesso, -1 quando todos os fluxos terminaram
+ */
+int sched_next(sched_wheel_t *w, uint32_t *stream, uint64_t *due_ns);
+
+/**
+ * Fim do último envio de um fluxo: prazo que a rodada seguinte teria.
+ * Com modelo de chegada, só vale depois que o fluxo terminou.
+ */
+uint64_t sched_stream_end(const sched_stream_t *s);
+
+#endif // SCHEDULER_H
@@ -0,0 +1,117 @@
+//
+// Sessões TCP com estado e tabela de fluxos
+//
+
+#ifndef TCP_FLOW_H
+#define TCP_FLOW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "template.h"
+
+/* Estados de um fluxo, vistos pelo RX */
+#define TCP_FLOW_SYN_SENT     0
+#define TCP_FLOW_ESTABLISHED  1     // SYN-ACK recebido, ISN do servidor conhecido
+#define TCP_FLOW_RESET        2     // RST recebido
+
+/*
+ * Entrada da tabela (24 bytes). A chave é um hash de 64 bits do 5-tupla
+ * canônico, igual nos dois sentidos; 0 marca posição vazia.
+ */
+typedef struct {
+    uint64_t          key;
+    uint32_t          client_isn;
+    uint32_t          emulated_isn;     // ISN do servidor usado na pré-montagem
+    _Atomic uint32_t  server_isn;       // ISN real, escrito pelo RX
+    _Atomic uint8_t   state;            // TCP_FLOW_*
+    uint8_t           pad;
+    uint16_t          client_port;      // distingue o sentido dos pacotes capturados
+} tcp_flow_t;
+
+/* Tabela de endereçamento aberto (sondagem linear, capacidade potência de 2) */
+typedef struct tcp_flow_table {
+    tcp_flow_t  *slots;
+    uint32_t    mask;
+    uint32_t    count;
+
+    /* contadores do RX (uma única thread escreve) */
+    uint32_t    synack_seen;
+    uint32_t    rst_seen;
+    uint64_t    first_synack;
+    uint64_t    last_synack;
+} tcp_flow_table_t;
+
+/**
+ * Cria uma tabela para até max_flows fluxos (ocupação máxima de 50%).
+ */
+tcp_flow_table_t *tcp_flow_table_create(uint32_t max_flows);
+
+void tcp_flow_table_free(tcp_flow_table_t *table);
+
+/**
+ * Hash canônico do 5-tupla (addr com 4 ou 16 bytes, portas em ordem de host).
+ */
+uint64_t tcp_flow_key(const uint8_t *addr_a, uint16_t port_a,
+                      const uint8_t *addr_b, uint16_t port_b, size_t addr_len);
+
+/**
+ * Insere um fluxo; devolve seu índice + 1, ou 0 se a chave já existe ou a tabela encheu.
+ */
+uint32_t tcp_flow_insert(tcp_flow_table_t *table, uint64_t key,
+                         uint32_t client_isn, uint32_t emulated_isn, uint16_t client_port);
+
+/**
+ * Procura um fluxo pela chave; devolve NULL se não existir.
+ */
+tcp_flow_t *tcp_flow_lookup(tcp_flow_table_t *table, uint64_t key);
+
+/**
+ * Pacotes que um template com tcp_flows > 0 gera.
+ */
+uint32_t tcp_session_packet_count(const packet_template_t *t);
+
+/**
+ * Gera as sessões TCP de um template: SYN, (SYN-ACK emulado), ACK,
+ * segmentos de dados com seq/ack corretos e encerramento FIN ou RST.
+ * Fluxos usam portas de origem sequenciais a partir de src_port e, esgotadas
+ * as portas, endereços de origem sequenciais. Só os segmentos de dados
+ * recebem ID de correlação.
+ *
+ * @param next_id     Próximo ID a atribuir (atualizado)
+ * @param frame_size  Tamanho de quadro com FCS dos segmentos de dados (0 = natural)
+ * @param probe_tag   Segmentos levam o tag de sonda binário em vez de "ID|"
+ * @return 0 em sucesso, !=0 em erro
+ */
+int tcp_sessions_build(const packet_template_t *t, packet_list_t *list,
+                       uint32_t *next_id, size_t frame_size, int probe_tag);
+
+/**
+ * Chamado pelo RX para cada quadro TCP: registra SYN-ACK (ISN do servidor)
+ * e RST dos fluxos da tabela.
+ *
+ * @param frame      Quadro a partir do cabeçalho Ethernet
+ * @param l3_offset  Início do cabeçalho IP
+ * @param l4_offset  Início do cabeçalho TCP
+ * @param ip_version 4 ou 6
+ * @param now        Instante da recepção (na unidade do relógio do RX)
+ */
+void tcp_flow_observe(tcp_flow_table_t *table, const uint8_t *frame, size_t caplen,
+                      size_t l3_offset, size_t l4_offset, int ip_version, uint64_t now);
+
+/**
+ * Volta todos os fluxos a SYN_SENT com o ISN emulado e zera os contadores
+ * do RX. Chamado no início de cada execução sobre a mesma lista.
+ */
+void tcp_flow_table_reset(tcp_flow_table_t *table);
+
+/**
+ * Chamado pelo TX antes de enviar um pacote de cliente: acerta o número de
+ * ACK (e o checksum, de forma incremental) para o ISN real do servidor, se
+ * já conhecido, ou para o ACK montado (orig_ack). O quadro pode ter sido
+ * corrigido numa execução anterior: o valor é sempre recalculado de orig_ack.
+ */
+void tcp_flow_patch_ack(tcp_flow_table_t *table, uint32_t flow, uint8_t *frame,
+                        size_t len, ip_version_t ip_version, uint32_t orig_ack);
+
+#endif // TCP_FLOW_H
@@ -0,0 +1,166 @@
+//
+// Templates de pacotes carregados do JSON
+//
+
+#ifndef TEMPLATE_H
+#define TEMPLATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <netinet/in.h>
+#include "ip.h"
+#include "packet.h"
+#include "arrival.h"
+#include "encap.h"
+
+/* Encerramento das sessões TCP */
+#define TCP_CLOSE_FIN   0
+#define TCP_CLOSE_RST   1
+#define TCP_CLOSE_NONE  2
+
+/* Um template (uma entrada do array JSON) já validado */
+typedef struct {
+    ip_version_t ip_version;            // IPv4 ou IPv6
+    int          transport;             // IPPROTO_TCP, IPPROTO_UDP ou IPPROTO_ICMP
+    char         src_ip[INET6_ADDRSTRLEN];
+    char         dst_ip[INET6_ADDRSTRLEN];
+    uint16_t     src_port;
+    uint16_t     dst_port;
+    uint32_t     tcp_seq;
+    uint32_t     tcp_ack;
+    uint8_t      tcp_flags;
+    uint8_t      icmp_type;
+    uint8_t      icmp_code;
+    char        *payload;               // payload original (sem ID)
+    size_t       payload_size;
+    uint32_t     packet_count;          // cópias a gerar
+    uint32_t     mtu;                   // MTU IP (0 = sem limite): TCP é segmentado em MSS, UDP/ICMP fragmentado
+    uint32_t     frame_size;            // quadro com FCS antes da segmentação (0 = natural; --frame-sizes tem prioridade)
+
+    /* Fluxo no escalonador (os templates são intercalados, não enviados em bloco) */
+    uint64_t     rate_pps;              // taxa própria (0 = parte de --rate pelo peso)
+    uint64_t     start_ns;              // início do fluxo, contado do início do TX
+    uint32_t     weight;                // peso na divisão de --rate ou na intercalação sem taxas
+    uint32_t     burst;                 // pacotes seguidos por vez (default 1)
+    arrival_cfg_t arrival;              // modelo de chegada das rodadas (default: constante)
+
+    /* Sessões TCP com estado (tcp_flows > 0 substitui packet_count) */
+    uint32_t     tcp_flows;             // sessões completas a gerar
+    uint32_t     tcp_segments;          // segmentos de dados por sessão
+    uint32_t     tcp_concurrency;       // sessões abertas ao mesmo tempo (0 = todas)
+    uint8_t      tcp_close;             // TCP_CLOSE_*
+    uint8_t      tcp_emulate_server;    // também gera SYN-ACK/ACK/FIN do servidor
+
+    /* MACs e pilha de encapsulamento ("src_mac", "dst_mac", "encap") */
+    encap_t     *encap;                 // NULL = Ethernet com os MACs padrão
+} packet_template_t;
+
+/* Conjunto de templates, carregado uma única vez e reutilizado */
+typedef struct {
+    packet_template_t *items;
+    size_t             count;
+    int                probe_tag;       // payload começa com o tag de sonda binário em vez de "ID|"
+    int                csum_offload;    // TCP/UDP com checksum parcial e super-quadros TSO/GSO (TX com PACKET_VNET_HDR)
+    uint64_t           rate_pps;        // --rate, dividido pelo peso entre os templates sem rate_pps (0 = sem taxa)
+} template_set_t;
+
+/**
+ * Carrega e valida os templates de um arquivo JSON, sem gerar pacotes.
+ *
+ * @param filename  Caminho para o arquivo .json
+ * @param set       Conjunto a preencher (liberar com free_template_set)
+ * @return 0 em sucesso, !=0 em erro
+ */
+int load_template_set(const char *filename, template_set_t *set);
+
+/**
+ * Como load_template_set(), a partir do texto JSON em memória.
+ */
+int load_template_set_buffer(const char *text, size_t len, template_set_t *set);
+
+/**
+ * Reduz o conjunto à parte shard de n_shards (execução em várias instâncias).
+ * Com ao menos n_shards templates, cada um vai inteiro para uma parte,
+ * equilibrando os pacotes; com menos, packet_count e rate_pps de cada
+ * template são divididos entre todas as partes (sessões TCP vão inteiras).
+ * A divisão é determinística: todas as instâncias chegam à mesma.
+ *
+ * @param orig_idx  recebe, para cada template mantido, o seu índice original
+ *                  (capacidade: set->count antes da divisão)
+ * @return 0 em sucesso, !=0 em erro (inclusive mais de UINT16_MAX + 1 templates)
+ */
+int template_set_shard(template_set_t *set, uint32_t shard, uint32_t n_shards, uint16_t *orig_idx);
+
+/**
+ * Libera a memória de um conjunto de templates.
+ */
+void free_template_set(template_set_t *set);
+
+/**
+ * Gera os pacotes de todos os templates e os adiciona à lista. Cada pacote
+ * recebe um ID sequencial (a partir de 1) prefixado ao payload ("ID|..."),
+ * ou, com set->probe_tag, um tag de sonda com seq = ID (ver NW_PROBE_MAGIC).
+ * Templates com tcp_flows > 0 geram sessões TCP completas (ver tcp_flow.h);
+ * nelas só os segmentos de dados recebem ID. Datagramas maiores que o mtu do
+ * template viram segmentos TCP ou fragmentos IP; só o primeiro leva o ID.
+ *
+ * Os demais templates são fluxos independentes, intercalados por uma roda de
+ * tempo (scheduler.h) na ordem dos prazos; os IDs seguem a ordem de envio.
+ * Sem rate_pps/start_ms, a intercalação é por peso e o TX segue --rate; com
+ * eles, cada pacote recebe o seu prazo (tx_offset_ns) e list->lap_ns > 0.
+ *
+ * @param set         Templates carregados
+ * @param list        Lista onde os pacotes serão inseridos
+ * @param frame_size  Tamanho do quadro Ethernet em bytes, incluindo FCS
+ *                    (convenção da RFC 2544). O payload é completado com
+ *                    zeros até atingir esse tamanho. 0 = tamanho natural.
+ * @return 0 em sucesso, !=0 em erro
+ */
+int build_packets_from_templates(const template_set_t *set,
+                                 packet_list_t *list,
+                                 size_t frame_size);
+
+/**
+ * Recebe um pacote gerado em fluxo (quadro completo, com Ethernet) e fica
+ * com ele, mesmo em erro. last = último pacote do datagrama (segmentos e
+ * fragmentos de um mesmo ID chegam seguidos).
+ * @return 0 para continuar, !=0 interrompe a geração
+ */
+typedef int (*packet_sink_fn)(void *arg, packet_t *pkt, int last);
+
+/* Geração em fluxo: os pacotes vão para um sink em vez de uma lista */
+typedef struct {
+    size_t          frame_size;     // como em build_packets_from_templates()
+    uint32_t        part;           // gera só os datagramas com (ID - 1) % n_parts == part
+    uint32_t        n_parts;        // 0 ou 1 = todos
+    packet_sink_fn  sink;
+    void            *arg;
+    uint64_t        lap_ns;         // saída: duração de uma passagem (0 = lista sem prazos)
+    size_t          short_frames;   // saída: pacotes acima de frame_size, mantidos no tamanho natural
+} packet_stream_t;
+
+/**
+ * Como build_packets_from_templates(), entregando cada pacote ao sink na
+ * ordem de envio. Com n_parts > 1, várias threads dividem a geração: todas
+ * percorrem o mesmo escalonamento (determinístico) e cada uma só monta a sua
+ * parte dos IDs; o consumidor intercala as partes pela ordem dos IDs.
+ * Sessões TCP (tcp_flows) não são geradas em fluxo.
+ *
+ * @return 0 em sucesso, !=0 em erro ou se o sink interrompeu
+ */
+int build_packets_stream(const template_set_t *set, packet_stream_t *st);
+
+/**
+ * Total de datagramas que build_packets_from_templates() vai gerar, antes
+ * da segmentação/fragmentação por MTU.
+ */
+uint32_t template_set_packet_count(const template_set_t *set);
+
+/**
+ * 1 se algum template tem taxa, início ou modelo de chegada próprios
+ * (rate_pps/start_ms/arrival): a lista gerada tem prazo por pacote e
+ * dispensa a taxa global do TX.
+ */
+int template_set_scheduled(const template_set_t *set);
+
+#endif // TEMPLATE_H
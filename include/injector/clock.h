@@ -0,0 +1,83 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+/* Fontes de relógio para os timestamps do caminho quente */
+#define CLOCK_SOURCE_MONOTONIC  0   // clock_gettime(CLOCK_MONOTONIC), unidade = ns
+#define CLOCK_SOURCE_TSC        1   // rdtscp (TSC invariante), unidade = ciclos do TSC
+
+/*
+ * Relógio do TX/RX. Os timestamps ficam na unidade da fonte e só são
+ * convertidos para ns fora do caminho quente (ao gravar as métricas).
+ * Conversão: ns = ticks * mult >> 32 e ticks = ns * inv_mult >> 32.
+ */
+typedef struct {
+    int      source;        // CLOCK_SOURCE_*
+    uint64_t hz;            // ticks por segundo
+    uint64_t mult;
+    uint64_t inv_mult;
+    uint64_t base_ticks;    // referência da calibração...
+    uint64_t base_ns;       // ...e o CLOCK_MONOTONIC correspondente
+} clock_src_t;
+
+/**
+ * Inicializa o relógio. Com CLOCK_SOURCE_TSC, verifica TSC invariante
+ * (constant_tsc + nonstop_tsc) e calibra contra CLOCK_MONOTONIC (uma vez por
+ * processo); sem suporte, avisa e usa CLOCK_MONOTONIC.
+ *
+ * @param want  fonte pedida
+ * @return fonte efetivamente usada
+ */
+int clock_src_init(clock_src_t *c, int want);
+
+/**
+ * Nome da fonte ("monotonic" ou "tsc").
+ */
+const char *clock_src_name(int source);
+
+static inline uint64_t clock_src_now(const clock_src_t *c) {
+#if defined(__x86_64__)
+    if (c->source == CLOCK_SOURCE_TSC) {
+        unsigned aux;
+        return __rdtscp(&aux);
+    }
+#else
+    (void)c;
+#endif
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* duração em ticks -> ns */
+static inline uint64_t clock_src_to_ns(const clock_src_t *c, uint64_t ticks) {
+    if (c->source == CLOCK_SOURCE_MONOTONIC) return ticks;
+    return (uint64_t)(((unsigned __int128)ticks * c->mult) >> 32);
+}
+
+/* duração em ns -> ticks */
+static inline uint64_t clock_src_from_ns(const clock_src_t *c, uint64_t ns) {
+    if (c->source == CLOCK_SOURCE_MONOTONIC) return ns;
+    return (uint64_t)(((unsigned __int128)ns * c->inv_mult) >> 32);
+}
+
+/* instante em ticks -> CLOCK_MONOTONIC em ns */
+static inline uint64_t clock_src_mono_ns(const clock_src_t *c, uint64_t ticks) {
+    if (c->source == CLOCK_SOURCE_MONOTONIC) return ticks;
+    return ticks >= c->base_ticks ? c->base_ns + clock_src_to_ns(c, ticks - c->base_ticks)
+                                  : c->base_ns - clock_src_to_ns(c, c->base_ticks - ticks);
+}
+
+/* CLOCK_MONOTONIC em ns -> instante em ticks */
+static inline uint64_t clock_src_from_mono_ns(const clock_src_t *c, uint64_t ns) {
+    if (c->source == CLOCK_SOURCE_MONOTONIC) return ns;
+    return ns >= c->base_ns ? c->base_ticks + clock_src_from_ns(c, ns - c->base_ns)
+                            : c->base_ticks - clock_src_from_ns(c, c->base_ns - ns);
+}
+
+#endif // CLOCK_H
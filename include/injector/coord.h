@@ -0,0 +1,100 @@
+#ifndef COORD_H
+#define COORD_H
+
+#include <stdint.h>
+#include "txrx.h"
+
+/*
+ * Execução coordenada em várias instâncias (processos ou hosts).
+ *
+ * O coordenador divide os templates entre os workers (template_set_shard),
+ * reparte o orçamento de --rate na proporção dos pacotes de cada parte,
+ * dispara todos no mesmo instante de CLOCK_REALTIME e junta contadores,
+ * histogramas e fluxos num único relatório.
+ *
+ * Protocolo de controle (Unix ou TCP): mensagens com coord_hdr_t seguido de
+ * len bytes. A conexão abre com HELLO (o token compartilhado), segue na ordem
+ * JOB -> READY -> START -> RESULT, repetível, e BYE encerra o worker. As
+ * estruturas vão em binário: coordenador e workers precisam da mesma versão
+ * e arquitetura (conferido por magic e tamanhos).
+ *
+ * Um JOB pode ler e gravar arquivos (specs file:) no host do worker, com os
+ * privilégios dele: em TCP, o worker só escuta com o token em COORD_TOKEN_ENV,
+ * e o coordenador envia o mesmo token da sua variável de ambiente. Sem token,
+ * só em socket Unix (criado com permissão 0600).
+ */
+#define COORD_MAGIC         0x4E57434FU     // "NWCO"
+#define COORD_SPEC_SIZE     256
+#define COORD_TOKEN_ENV     "NETWAGON_COORD_TOKEN"
+#define COORD_START_LEAD_MS 500             // folga entre o START e o instante de partida
+
+enum {
+    COORD_MSG_JOB = 1,      // coord_job_t + texto JSON dos templates
+    COORD_MSG_READY,        // coord_ready_t: lista montada
+    COORD_MSG_START,        // coord_start_t
+    COORD_MSG_RESULT,       // coord_result_t + n_flows flow_stat_t
+    COORD_MSG_ERROR,        // texto
+    COORD_MSG_BYE,
+    COORD_MSG_HELLO         // token (pode ser vazio)
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t type;
+    uint64_t len;
+} coord_hdr_t;
+
+typedef struct {
+    uint32_t    shard;
+    uint32_t    n_shards;
+    uint64_t    rate_pps;       // orçamento desta parte (semântica de txrx_opts_t.rate_pps)
+    uint32_t    timeout_ms;
+    uint32_t    warmup_ms;
+    uint32_t    late_ms;
+    int32_t     engine;
+    int32_t     sqpoll;
+    int32_t     stamp;
+    int32_t     clock;
+    io_impair_t impair;
+    char        tx[COORD_SPEC_SIZE];
+    char        rx[COORD_SPEC_SIZE];
+} coord_job_t;
+
+typedef struct {
+    uint32_t packets;
+} coord_ready_t;
+
+typedef struct {
+    uint64_t start_ns;      // CLOCK_REALTIME
+} coord_start_t;
+
+typedef struct {
+    int32_t       rc;
+    uint32_t      n_flows;
+    uint32_t      flow_size;        // sizeof(flow_stat_t) do worker
+    uint32_t      reserved;
+    uint64_t      start_late_ns;    // quanto o worker partiu depois de start_ns
+    txrx_result_t result;           // result.flows não vale do outro lado
+} coord_result_t;
+
+/**
+ * Modo worker: escuta em addr ("unix:/caminho", "tcp:host:porta" ou
+ * "host:porta") e atende coordenadores, uma conexão por vez, até um BYE.
+ * Host vazio escuta só no loopback e "*" em todas as interfaces; em TCP, o
+ * token em COORD_TOKEN_ENV é obrigatório.
+ *
+ * @return 0 em sucesso, !=0 em erro
+ */
+int coord_worker_serve(const char *addr);
+
+/**
+ * Modo coordenador. cluster_file é um array JSON de workers:
+ *   {"connect": "tcp:10.0.0.2:7070", "tx": "eth1", "rx": "eth2"}
+ * ou, sem "connect", um processo local lançado e encerrado pelo coordenador.
+ *
+ * @param opts  opções da execução (--rate é o orçamento total)
+ * @return 0 em sucesso, !=0 em erro
+ */
+int coord_run(const char *cluster_file, const char *templates_file, const txrx_opts_t *opts);
+
+#endif // COORD_H
@@ -0,0 +1,169 @@
+#ifndef FLOW_STATS_H
+#define FLOW_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "../generator/packet.h"
+#include "clock.h"
+#include "seq_stats.h"
+
+/*
+ * Histograma log-linear de latência: valores < 2^SUB_BITS são exatos; acima
+ * disso, cada potência de 2 é dividida em 2^SUB_BITS faixas (erro <= 12,5%).
+ * Os valores estão na unidade do relógio do RX (ns ou ticks do TSC). Cobre
+ * até 2^40 unidades (~18 min em ns); valores maiores caem na última faixa.
+ */
+#define FLOW_HIST_SUB_BITS  3
+#define FLOW_HIST_BUCKETS   ((40 - FLOW_HIST_SUB_BITS + 1) << FLOW_HIST_SUB_BITS)
+
+/* Estatísticas de um fluxo (template + 5-tupla) */
+typedef struct {
+    uint64_t key;               // hash da 5-tupla no sentido do envio
+    uint16_t tmpl;              // índice do template de origem
+    uint8_t  ip_version;        // 4 ou 6
+    uint8_t  proto;             // IPPROTO_*
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint8_t  src_addr[16];
+    uint8_t  dst_addr[16];
+
+    /* escritos só pela thread RX, na unidade do relógio (ver flow_stats_t.clock) */
+    uint32_t received;          // IDs distintos recebidos (fora do warm-up)
+    uint32_t samples;           // recebidos com latência registrada
+    uint64_t sum_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint32_t hist[FLOW_HIST_BUCKETS];
+    seq_stats_t seq;            // reordenação, duplicatas e jitter do fluxo
+
+    /* preenchidos por flow_stats_finish() */
+    uint32_t sent;
+} flow_stat_t;
+
+/* Posição da tabela de fluxos (endereçamento aberto, sondagem linear) */
+typedef struct {
+    uint64_t key;               // 0 = vazia
+    uint32_t flow;              // índice em flows
+} flow_slot_t;
+
+typedef struct {
+    flow_stat_t *flows;
+    uint32_t    count;
+    flow_slot_t *slots;
+    uint32_t    mask;
+    uint32_t    *id_flow;       // ID - 1 -> índice em flows (UINT32_MAX = sem fluxo)
+    uint32_t    n_ids;          // IDs por passagem da lista (em loop, seq - 1 é tomado módulo n_ids)
+    const clock_src_t *clock;   // converte as latências para ns na saída (NULL = já em ns)
+    uint64_t    late_after;     // prazo de perda, na unidade do relógio (0 = sem tardios)
+} flow_stats_t;
+
+/**
+ * Cria a tabela de fluxos dos pacotes com ID da lista. A tabela é dimensionada
+ * pelos templates carregados (um fluxo por template, mais os fluxos das
+ * sessões TCP) e toda a memória é alocada aqui, antes do início do TX.
+ *
+ * @param list   lista de pacotes já montados
+ * @param n_ids  maior ID da lista
+ * @return tabela ou NULL em erro
+ */
+flow_stats_t *flow_stats_create(const packet_list_t *list, uint32_t n_ids);
+
+void flow_stats_free(flow_stats_t *fs);
+
+/* faixa do histograma de um valor */
+static inline uint32_t flow_hist_bucket(uint64_t v) {
+    if (v < (1u << FLOW_HIST_SUB_BITS)) return (uint32_t)v;
+    const unsigned msb = 63u - (unsigned)__builtin_clzll(v);
+    const unsigned shift = msb - FLOW_HIST_SUB_BITS;
+    uint32_t b = ((shift + 1) << FLOW_HIST_SUB_BITS) +
+                 (uint32_t)((v >> shift) & ((1u << FLOW_HIST_SUB_BITS) - 1));
+    return b < FLOW_HIST_BUCKETS ? b : FLOW_HIST_BUCKETS - 1;
+}
+
+/**
+ * Atribui a primeira chegada de um ID ao seu fluxo. Chamada pela thread RX
+ * ou, com --rx-workers, por vários analisadores ao mesmo tempo, sem travas:
+ * isso só é seguro porque rx_flow_hash(), simétrico na 5-tupla, entrega
+ * cada fluxo sempre ao mesmo analisador (um escritor por flow_stat_t), e
+ * porque sessões TCP, que também tocam a tabela tcp_flow compartilhada,
+ * são recusadas com mais de um analisador. Quem mudar essa partição
+ * precisa trocar os contadores por atômicos ou travas.
+ *
+ * @param send_ts      timestamp de envio do ID (0 = ainda não registrado)
+ * @param recv_ts      timestamp de recepção
+ * @param min_send_ts  fim da janela de warm-up (0 = sem warm-up)
+ */
+static inline void flow_stats_record(flow_stats_t *fs, uint32_t id,
+                                     uint64_t send_ts, uint64_t recv_ts,
+                                     uint64_t min_send_ts) {
+    if (!fs || id < 1) return;
+    uint32_t i = id - 1;
+    if (i >= fs->n_ids) i %= fs->n_ids;
+    const uint32_t idx = fs->id_flow[i];
+    if (idx == UINT32_MAX) return;
+    if (send_ts && send_ts < min_send_ts) return;
+
+    flow_stat_t *f = &fs->flows[idx];
+    f->received++;
+    seq_stats_arrival(&f->seq, id, send_ts, recv_ts, fs->late_after);
+    if (!send_ts || recv_ts < send_ts) return;
+    const uint64_t lat = recv_ts - send_ts;
+    f->samples++;
+    f->sum_ns += lat;
+    if (lat < f->min_ns) f->min_ns = lat;
+    if (lat > f->max_ns) f->max_ns = lat;
+    f->hist[flow_hist_bucket(lat)]++;
+}
+
+/**
+ * Atribui uma chegada repetida de um ID ao seu fluxo (mesmo invariante de
+ * um escritor por fluxo de flow_stats_record()).
+ */
+static inline void flow_stats_duplicate(flow_stats_t *fs, uint32_t id) {
+    if (!fs || id < 1) return;
+    uint32_t i = id - 1;
+    if (i >= fs->n_ids) i %= fs->n_ids;
+    const uint32_t idx = fs->id_flow[i];
+    if (idx != UINT32_MAX) seq_stats_duplicate(&fs->flows[idx].seq);
+}
+
+/**
+ * Conta os pacotes enviados de cada fluxo (fora do warm-up) a partir dos
+ * timestamps de envio e fecha as rajadas de perda de cada um.
+ *
+ * @param total_ids  tamanho de send_timestamp (maior que n_ids em loop)
+ */
+void flow_stats_finish(flow_stats_t *fs, const uint64_t *send_timestamp,
+                       const uint64_t *recv_timestamp, uint32_t total_ids,
+                       uint64_t min_send_ts);
+
+/**
+ * Percentil q (0..1) da latência do fluxo, estimado pelo histograma, na
+ * unidade do relógio do RX.
+ */
+uint64_t flow_stats_percentile(const flow_stat_t *f, double q);
+
+/**
+ * Passa latências, histogramas e jitter de todos os fluxos para ns e
+ * desliga a conversão na saída (clock = NULL). Com TSC, cada faixa do
+ * histograma é redistribuída pelo seu ponto médio.
+ */
+void flow_stats_to_ns(flow_stats_t *fs);
+
+/**
+ * Soma o fluxo src em dst (mesma unidade; execuções em várias instâncias).
+ */
+void flow_stat_merge(flow_stat_t *dst, const flow_stat_t *src);
+
+/**
+ * Imprime os n piores fluxos, ordenados por perda e depois por p99.
+ */
+void flow_stats_print_top(flow_stats_t *fs, uint32_t n, FILE *out);
+
+/**
+ * Exporta todos os fluxos em CSV.
+ * @return 0 em sucesso, -1 em erro
+ */
+int flow_stats_save_csv(const flow_stats_t *fs, const char *filename);
+
+#endif // FLOW_STATS_H
@@ -0,0 +1,106 @@
+#ifndef INSTR_H
+#define INSTR_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "clock.h"
+
+/*
+ * Instrumentação do caminho quente: contadores por thread e histogramas do
+ * custo de cada estágio, para separar gargalos da ferramenta do
+ * comportamento do DUT. Os contadores são incrementos simples, sempre
+ * ligados; os estágios custam leituras extras do relógio e só são medidos
+ * com instr_t.enabled.
+ *
+ * Os estágios ficam em ticks do relógio da execução (ns ou ciclos do TSC),
+ * em faixas de potências de 2: a faixa b conta valores em [2^b, 2^(b+1)).
+ */
+#define INSTR_HIST_BUCKETS  40
+
+typedef enum {
+    INSTR_TX_WAIT = 0,      // espera pelo prazo do envio (ritmo)
+    INSTR_TX_PREPARE,       // carimbo do tag de sonda / montagem do lote
+    INSTR_TX_SEND,          // chamada de envio do backend
+    INSTR_RX_RECV,          // entrega de um quadro pelo backend (inclui a espera por ele)
+    INSTR_RX_QUEUE,         // espera na fila até um analisador (--rx-workers)
+    INSTR_RX_PARSE,         // cabeçalhos e ID
+    INSTR_RX_CORRELATE,     // correlação, sequência e fluxos
+    INSTR_RX_RECORD,        // cópia para a gravação (--rx-record)
+    INSTR_STAGES
+} instr_stage_t;
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint32_t hist[INSTR_HIST_BUCKETS];
+} __attribute__((aligned(64))) instr_hist_t;
+
+/* Escritos só pela thread TX */
+typedef struct {
+    uint64_t attempts;      // chamadas de envio (sendmmsg conta uma por lote)
+    uint64_t sent;          // quadros aceitos pelo backend
+    uint64_t failed;        // envios com erro
+    uint64_t eagain;        // envios adiados ou perdidos por EAGAIN
+    uint64_t enobufs;       // envios adiados ou perdidos por ENOBUFS
+} __attribute__((aligned(64))) instr_tx_t;
+
+/* Escritos só pela thread RX */
+typedef struct {
+    uint64_t frames;        // quadros entregues pelo backend
+    uint64_t matched;       // primeiras chegadas de IDs da lista
+    uint64_t duplicate;     // chegadas repetidas
+    uint64_t unparsed;      // sem cabeçalhos reconhecíveis ou sem ID do NetWagon
+    uint64_t foreign;       // com ID fora da lista (outra execução, outro gerador)
+    uint64_t idle;          // chamadas de recepção sem quadro
+    uint64_t queue_full;    // --rx-workers: quadros que acharam a fila do analisador cheia
+    uint64_t queue_wait;    // ticks da captura parada esperando espaço na fila
+    int      kernel_valid;  // contadores do kernel disponíveis
+    uint64_t kernel_recv;   // vistos pelo kernel (pcap_stats / PACKET_STATISTICS)
+    uint64_t kernel_drop;   // descartados pelo kernel por falta de buffer
+    uint64_t if_drop;       // descartados pela interface/driver
+} __attribute__((aligned(64))) instr_rx_t;
+
+typedef struct {
+    int          enabled;   // mede os estágios
+    instr_tx_t   tx;
+    instr_rx_t   rx;
+    instr_hist_t stage[INSTR_STAGES];
+} instr_t;
+
+static inline void instr_stage_add(instr_t *in, instr_stage_t stage, uint64_t ticks) {
+    instr_hist_t *h = &in->stage[stage];
+    uint32_t b = 63u - (uint32_t)__builtin_clzll(ticks | 1);
+    if (b >= INSTR_HIST_BUCKETS) b = INSTR_HIST_BUCKETS - 1;
+    h->count++;
+    h->sum += ticks;
+    if (ticks > h->max) h->max = ticks;
+    h->hist[b]++;
+}
+
+/**
+ * Soma em dst os contadores de RX e os estágios de src (analisadores do RX).
+ */
+void instr_merge(instr_t *dst, const instr_t *src);
+
+/**
+ * Nome do estágio ("tx.wait", "rx.parse", ...).
+ */
+const char *instr_stage_name(instr_stage_t stage);
+
+/**
+ * Quantil q de um estágio, em ticks (limite superior da faixa).
+ */
+uint64_t instr_stage_percentile(const instr_hist_t *h, double q);
+
+/**
+ * Imprime contadores e, se medidos, os estágios em ns.
+ */
+void instr_print(const instr_t *in, const clock_src_t *clk, FILE *out);
+
+/**
+ * Escreve os contadores e estágios como objeto JSON (sem quebra de linha final).
+ */
+void instr_write_json(const instr_t *in, const clock_src_t *clk, FILE *out);
+
+#endif // INSTR_H
@@ -0,0 +1,113 @@
+#ifndef IO_BACKEND_H
+#define IO_BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Backends de E/S do TX/RX, escolhidos pela especificação da interface:
+ *   "eth0" ou "pcap:eth0"  captura/injeção ao vivo (pcap_open_live)
+ *   "file:saida.pcap"      TX grava em arquivo pcap; RX lê de arquivo pcap
+ *   "mem" ou "mem:nome"    anel em memória: o TX de um lado é o RX do outro
+ *   "vnet:eth0"            TX por AF_PACKET com PACKET_VNET_HDR (checksum e
+ *                          TSO/GSO pelo kernel/NIC); no RX equivale a "pcap:eth0"
+ */
+
+#define IO_ERRBUF_SIZE 256
+
+/* Propriedades do backend */
+#define IO_FLAG_OFFLINE       0x01  // RX offline: começa a ler após o fim do TX
+#define IO_FLAG_SYNTHETIC_TS  0x02  // RX sem relógio real: chegada = envio + atraso injetado
+#define IO_FLAG_VNET_HDR      0x04  // TX aceita virtio_net_hdr (send_vnet): quadros com checksum parcial
+
+/* Retornos de recv() */
+#define IO_RECV_FRAME    1
+#define IO_RECV_TIMEOUT  0
+#define IO_RECV_ERROR   -1
+#define IO_RECV_EOF     -2
+
+/* Quadro recebido; os dados valem até a próxima chamada de recv() */
+typedef struct {
+    const uint8_t *data;
+    size_t         caplen;
+    size_t         len;
+    uint64_t       kernel_ts_ns;    // timestamp do kernel (CLOCK_REALTIME), 0 = indisponível
+    uint64_t       extra_delay_ns;  // atraso injetado a somar ao timestamp de chegada
+} io_frame_t;
+
+/* Degradações injetadas no RX (determinísticas para uma mesma semente) */
+typedef struct {
+    double   loss;          // probabilidade de descarte [0, 1]
+    uint32_t delay_us;      // atraso fixo
+    uint32_t jitter_us;     // atraso aleatório adicional em [0, jitter_us]
+    double   reorder;       // probabilidade de um quadro ser entregue depois do seguinte
+    uint32_t seed;
+} io_impair_t;
+
+/* Contadores da captura mantidos pelo kernel */
+typedef struct {
+    uint64_t recv;          // quadros vistos pelo filtro
+    uint64_t drop;          // descartados por falta de buffer
+    uint64_t if_drop;       // descartados pela interface/driver
+} io_kernel_stats_t;
+
+typedef struct io_backend io_backend_t;
+
+struct io_backend {
+    const char *kind;       // "pcap", "file" ou "mem"
+    int         flags;      // IO_FLAG_*
+    int         (*send)(io_backend_t *b, const uint8_t *frame, size_t len);
+    int         (*send_vnet)(io_backend_t *b, const void *vnet_hdr, const uint8_t *frame, size_t len);  // NULL = sem PACKET_VNET_HDR
+    int         (*recv)(io_backend_t *b, io_frame_t *out);
+    void        (*close)(io_backend_t *b);
+    int         (*kernel_stats)(io_backend_t *b, io_kernel_stats_t *out);  // NULL = indisponível
+    uint64_t    tx_eagain;  // envios adiados ou recusados por EAGAIN
+    uint64_t    tx_enobufs; // envios adiados ou recusados por ENOBUFS
+    char        errbuf[IO_ERRBUF_SIZE];
+    void        *priv;
+};
+
+/**
+ * Abre o backend de envio descrito por spec.
+ * @return backend ou NULL (mensagem em errbuf)
+ */
+io_backend_t *io_open_tx(const char *spec, char *errbuf, size_t errlen);
+
+/**
+ * Abre o backend de captura descrito por spec.
+ * @param impair  opcional: perda/atraso/reordenação aplicados aos quadros lidos
+ * @return backend ou NULL (mensagem em errbuf)
+ */
+io_backend_t *io_open_rx(const char *spec, const io_impair_t *impair,
+                         char *errbuf, size_t errlen);
+
+/**
+ * Flags (IO_FLAG_*) que io_open_rx() teria para spec, sem abrir nada.
+ * Permite adiar a abertura de um RX offline até o fim do TX.
+ */
+int io_rx_spec_flags(const char *spec);
+
+/**
+ * Flags (IO_FLAG_*) que io_open_tx() teria para spec, sem abrir nada.
+ * Permite montar os quadros com checksum parcial antes de abrir o TX.
+ */
+int io_tx_spec_flags(const char *spec);
+
+/**
+ * Nome da interface ao vivo de spec (sem prefixo pcap: ou vnet:), para os
+ * motores que abrem sockets próprios.
+ * @return nome da interface, ou NULL para file: e mem
+ */
+const char *io_live_device(const char *spec);
+
+/**
+ * Fecha e libera o backend.
+ */
+void io_close(io_backend_t *b);
+
+/**
+ * Indica se as degradações estão todas desligadas.
+ */
+int io_impair_is_zero(const io_impair_t *impair);
+
+#endif // IO_BACKEND_H
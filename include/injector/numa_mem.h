@@ -0,0 +1,81 @@
+#ifndef NUMA_MEM_H
+#define NUMA_MEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Memória do caminho quente no nó NUMA de quem a usa. As regiões são
+ * mapeadas com mmap e recebem uma política de preferência pelo nó (mbind)
+ * antes do primeiro acesso, então as páginas ficam no nó certo mesmo quando
+ * a thread principal as preenche. Sem libnuma: o nó de uma CPU e de uma
+ * interface vem do sysfs.
+ *
+ * Com hugepages, tenta páginas de 2 MB reservadas (MAP_HUGETLB); sem reserva,
+ * pede páginas transparentes (THP, madvise) e, por fim, páginas comuns.
+ */
+#define NUMA_MEM_AUTO   -1      // nó da CPU fixada ou da interface
+#define NUMA_MEM_OFF    -2      // sem política: primeiro toque decide
+
+#define NUMA_HUGE_SIZE  (2UL * 1024 * 1024)
+
+/* Páginas que de fato sustentam uma região */
+#define NUMA_PAGES_SMALL    0   // páginas comuns
+#define NUMA_PAGES_THP      1   // páginas comuns com madvise(MADV_HUGEPAGE)
+#define NUMA_PAGES_HUGETLB  2   // páginas de 2 MB reservadas (hugetlbfs)
+
+typedef struct {
+    void   *addr;
+    size_t  len;            // bytes mapeados (múltiplo da página usada)
+    int     node;           // nó preferido aplicado (-1 = nenhum)
+    int     pages;          // NUMA_PAGES_*
+} numa_region_t;
+
+/**
+ * Número de nós NUMA com memória (1 quando o sysfs não informa).
+ */
+int numa_node_count(void);
+
+/**
+ * Nó NUMA de uma CPU.
+ * @return nó ou -1 se desconhecido
+ */
+int numa_cpu_node(int cpu);
+
+/**
+ * Nó NUMA do dispositivo de uma interface ("eth0", "pcap:eth0" ou "vnet:eth0").
+ * @return nó ou -1 (interface virtual, arquivo, "mem" ou sysfs sem a informação)
+ */
+int numa_iface_node(const char *spec);
+
+/**
+ * Escolhe o nó de um lado (TX ou RX) da execução.
+ *
+ * @param want   nó pedido, NUMA_MEM_AUTO ou NUMA_MEM_OFF
+ * @param cpu    CPU fixada do lado (-1 = nenhuma); tem prioridade sobre a interface
+ * @param spec   interface do lado
+ * @param why    opcional: recebe a origem da escolha ("CPU", "interface", "pedido")
+ * @return nó ou -1 (sem política)
+ */
+int numa_pick_node(int want, int cpu, const char *spec, const char **why);
+
+/**
+ * Mapeia uma região zerada de len bytes com preferência pelo nó.
+ *
+ * @param node       nó preferido (-1 = sem política)
+ * @param hugepages  tenta páginas de 2 MB
+ * @return 0 em sucesso, -1 se o mmap falhar (mensagem em stderr)
+ */
+int numa_region_alloc(numa_region_t *r, size_t len, int node, int hugepages);
+
+/**
+ * Desfaz o mapeamento (região zerada ou já liberada é ignorada).
+ */
+void numa_region_free(numa_region_t *r);
+
+/**
+ * Nome das páginas de uma região ("comuns", "THP", "2 MB").
+ */
+const char *numa_pages_name(int pages);
+
+#endif // NUMA_MEM_H
@@ -0,0 +1,89 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdint.h>
+#include "../generator/template.h"
+#include "flow_stats.h"
+
+/*
+ * Início em fluxo (--pipeline): threads construtoras geram os quadros
+ * enquanto o TX já envia, em vez de montar a lista inteira antes do
+ * primeiro envio. Cada construtora monta a sua parte dos IDs (ver
+ * build_packets_stream()) e a põe numa fila limitada de um produtor e um
+ * consumidor; o TX lê as filas alternadamente, na ordem dos IDs. Quadros
+ * enviados vão para uma thread de descarte, que os grava no pcap (se
+ * pedido), na ordem de envio, e libera a memória.
+ *
+ * A memória fica limitada às filas: uma construtora com a fila cheia espera.
+ * Fila vazia quando o TX precisa do próximo quadro significa construtoras
+ * abaixo da taxa pedida: o TX espera e a espera é contada.
+ */
+#define PIPELINE_RING_DEFAULT   4096    // quadros prontos por construtora
+#define PIPELINE_MAX_BUILDERS   64
+
+typedef struct {
+    const template_set_t *set;  // templates gerados em fluxo (NULL = usa a lista)
+    uint32_t   builders;        // threads construtoras (0 = 1)
+    uint32_t   ring;            // quadros prontos por construtora (0 = PIPELINE_RING_DEFAULT)
+    const char *pcap;           // grava os quadros enviados (NULL = não grava)
+} pipeline_cfg_t;
+
+typedef struct {
+    uint64_t frames;            // quadros gerados
+    uint64_t written;           // quadros gravados no pcap
+    uint64_t underruns;         // vezes em que o TX achou a fila vazia
+    uint64_t wait_ns;           // tempo do TX esperando as construtoras
+    uint64_t first_ns;          // do início ao primeiro quadro pronto
+    uint64_t first_tx_ns;       // do início ao primeiro quadro entregue ao TX
+    uint64_t build_ns;          // do início ao fim da geração
+    uint64_t lap_ns;            // duração de uma passagem (lista escalonada; 0 = sem prazos)
+    uint64_t retire_waits;      // vezes em que o TX esperou a thread de descarte
+    int      error;             // alguma construtora falhou
+} pipeline_stats_t;
+
+typedef struct pipeline pipeline_t;
+
+/**
+ * Prepara as filas e um quadro de amostra por template (para a tabela de
+ * fluxos), sem iniciar as threads.
+ *
+ * @param n_ids  recebe o total de IDs que a geração vai produzir
+ * @return pipeline ou NULL em erro (mensagem em stderr)
+ */
+pipeline_t *pipeline_create(const pipeline_cfg_t *cfg, uint32_t *n_ids);
+
+/**
+ * Quadros de amostra, um por template, com IDs próprios (só para criar a
+ * tabela de fluxos com flow_stats_create()).
+ */
+const packet_list_t *pipeline_samples(const pipeline_t *p);
+
+/**
+ * Inicia as construtoras e a thread de descarte.
+ *
+ * @param fs  opcional: tabela criada a partir de pipeline_samples(); cada ID
+ *            gerado é associado ao fluxo do seu template
+ * @return 0 em sucesso, -1 em erro
+ */
+int pipeline_start(pipeline_t *p, flow_stats_t *fs);
+
+/**
+ * Próximo quadro na ordem de envio. Chamada só pelo TX; espera se a
+ * construtora da vez está atrasada.
+ * @return quadro ou NULL no fim da geração
+ */
+packet_t *pipeline_next(pipeline_t *p);
+
+/**
+ * Devolve um quadro já enviado (vai para o pcap e é liberado). Só pelo TX.
+ */
+void pipeline_retire(pipeline_t *p, packet_t *pkt);
+
+/**
+ * Encerra as threads (o TX já deve ter parado), fecha o pcap e libera tudo.
+ *
+ * @param stats  opcional: contadores da geração
+ */
+void pipeline_stop(pipeline_t *p, pipeline_stats_t *stats);
+
+#endif // PIPELINE_H
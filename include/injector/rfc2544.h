@@ -0,0 +1,57 @@
+#ifndef RFC2544_H
+#define RFC2544_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../generator/template.h"
+#include "txrx.h"
+
+/* Configuração da busca de vazão (RFC 2544, seção 26.1) */
+typedef struct {
+    const size_t *frame_sizes;      // tamanhos de quadro com FCS (0 = tamanho natural)
+    size_t        n_frame_sizes;
+    uint64_t      link_mbps;        // velocidade do enlace, define a taxa de linha
+    double        loss_threshold;   // perda aceita por tentativa, em % (padrão 0)
+    double        resolution;       // para quando o intervalo < resolução, em % da taxa de linha
+    uint32_t      max_trials;       // limite de tentativas por tamanho de quadro
+    uint32_t      cooldown_ms;      // espera após o último envio de cada tentativa
+    uint32_t      trial_s;          // duração de cada tentativa (0 = uma passagem da lista; >0 exige base.stamp)
+    const char   *report_csv;       // opcional: grava todas as tentativas em CSV
+    txrx_opts_t   base;             // opções de cada tentativa; a busca define rate_pps,
+                                    // timeout_ms, quiet e (com trial_s) loop_count
+} rfc2544_cfg_t;
+
+/* Resultado final de um tamanho de quadro */
+typedef struct {
+    size_t            frame_size;
+    uint64_t          line_rate_pps;
+    uint64_t          throughput_pps;   // maior taxa aprovada (0 = nenhuma)
+    uint32_t          trials;
+    txrx_result_t     at_throughput;    // tentativa de latência na taxa encontrada
+} rfc2544_result_t;
+
+/**
+ * Taxa de linha em quadros/s para um enlace e tamanho de quadro
+ * (considera preâmbulo + SFD de 8 bytes e IFG de 12 bytes).
+ */
+uint64_t rfc2544_line_rate_pps(uint64_t link_mbps, size_t frame_size);
+
+/**
+ * Executa a busca binária de vazão para cada tamanho de quadro, usando o
+ * mesmo conjunto de templates em todas as tentativas, e mede a latência na
+ * taxa encontrada.
+ *
+ * @param set         Templates carregados uma única vez
+ * @param iface_send  Interface de envio
+ * @param iface_recv  Interface de captura
+ * @param cfg         Parâmetros da busca
+ * @param results     Opcional: array com cfg->n_frame_sizes posições
+ * @return 0 em sucesso, !=0 em erro
+ */
+int rfc2544_run(const template_set_t *set,
+                const char *iface_send,
+                const char *iface_recv,
+                const rfc2544_cfg_t *cfg,
+                rfc2544_result_t *results);
+
+#endif // RFC2544_H
@@ -0,0 +1,52 @@
+#ifndef RT_H
+#define RT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../generator/packet.h"
+#include "numa_mem.h"
+
+/* Modo de baixa variação (jitter) para as threads de TX/RX */
+typedef struct {
+    int lock_memory;    // mlockall + pré-fault de pacotes e timestamps
+    int cpu_tx;         // CPU da thread TX (-1 = qualquer)
+    int cpu_rx;         // CPU da thread RX (-1 = qualquer)
+    int fifo_prio;      // prioridade SCHED_FIFO (0 = escalonamento padrão)
+    int numa_node;      // nó da memória do TX/RX (NUMA_MEM_AUTO, NUMA_MEM_OFF ou o nó)
+    int hugepages;      // pacotes e timestamps em páginas de 2 MB (com fallback)
+} rt_opts_t;
+
+/**
+ * Inicializa as opções com os valores padrão (tudo desligado).
+ */
+void rt_opts_init(rt_opts_t *rt);
+
+/**
+ * Trava as páginas atuais do processo (inclui os pacotes já gerados) e
+ * toca cada página dos dados dos pacotes para evitar page faults no envio.
+ * @return 0 em sucesso, -1 se o mlockall falhar (execução continua sem lock)
+ */
+int rt_lock_packets(packet_list_t *list);
+
+/**
+ * Trava e pré-aloca (escreve em cada página) uma região já alocada.
+ * @return 0 em sucesso, -1 se o mlock falhar (região é pré-alocada mesmo assim)
+ */
+int rt_lock_region(void *addr, size_t len);
+
+/**
+ * Aplica afinidade de CPU e SCHED_FIFO à thread atual.
+ * @param cpu        CPU alvo (-1 = não fixa)
+ * @param fifo_prio  prioridade SCHED_FIFO (0 = mantém o escalonamento)
+ * @param name       nome da thread, usado nas mensagens
+ * @return 0 em sucesso, -1 se alguma configuração falhar
+ */
+int rt_apply_thread(int cpu, int fifo_prio, const char *name);
+
+/**
+ * Indica se a CPU consta em /sys/devices/system/cpu/isolated (isolcpus).
+ * @return 1 isolada, 0 não isolada, -1 desconhecido
+ */
+int rt_cpu_isolated(int cpu);
+
+#endif // RT_H
@@ -0,0 +1,71 @@
+#ifndef RX_PARSE_H
+#define RX_PARSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Informações extraídas de um quadro recebido */
+typedef struct {
+    uint32_t id;              // ID de correlação lido do payload ("ID|..." ou seq do tag de sonda)
+    uint64_t tx_ns;           // instante de envio gravado no tag de sonda (0 = sem tag ou não carimbado)
+    uint8_t  ip_version;      // 4 ou 6
+    uint8_t  l4_proto;        // IPPROTO_TCP, IPPROTO_UDP, IPPROTO_ICMP ou IPPROTO_ICMPV6
+    size_t   l3_offset;       // início do cabeçalho IP
+    size_t   l4_offset;       // início do cabeçalho de transporte
+    size_t   payload_offset;  // início do payload
+    size_t   payload_len;
+} rx_frame_info_t;
+
+/* Correlação de IDs recebidos com os enviados (uma única thread escreve) */
+typedef struct {
+    uint64_t *recv_timestamp; // indexado por ID - 1
+    uint32_t  total_pkts;
+    uint32_t  received;       // IDs distintos recebidos
+} rx_correlator_t;
+
+/**
+ * Analisa um quadro Ethernet com IPv4/IPv6 e TCP/UDP/ICMP e extrai o ID
+ * de correlação do payload: o seq de um tag de sonda binário (NW_PROBE_MAGIC)
+ * ou o prefixo "ID|". Tags VLAN/QinQ, rótulos MPLS e túneis GRE/VXLAN são
+ * atravessados (nw_stack_parse()); offsets e ID são os do pacote interno.
+ *
+ * @param frame   Quadro a partir do cabeçalho Ethernet
+ * @param caplen  Bytes capturados
+ * @param info    Informações extraídas
+ * @return 0 se o quadro carrega um ID do NetWagon, -1 caso contrário
+ */
+int rx_parse_frame(const uint8_t *frame, size_t caplen, rx_frame_info_t *info);
+
+/**
+ * Distância entre tags de sonda consecutivos de um super-datagrama UDP GSO
+ * que chegou sem ser segmentado (veth e loopback entregam o skb inteiro à
+ * captura): cada segmento começa com seu próprio tag.
+ *
+ * @param payload  Payload a partir do primeiro tag
+ * @return tamanho do segmento, ou 0 se o payload tem um único datagrama
+ */
+size_t rx_probe_stride(const uint8_t *payload, size_t len);
+
+/**
+ * Hash do fluxo interno de um quadro (endereços, protocolo e portas), igual
+ * nos dois sentidos. Fragmentos seguintes ao primeiro não têm portas e caem em outro
+ * valor; eles também não têm ID.
+ *
+ * @return hash, ou 0 se o quadro não é IPv4/IPv6
+ */
+uint32_t rx_flow_hash(const uint8_t *frame, size_t caplen);
+
+/**
+ * Registra a chegada de um ID.
+ *
+ * @return 1 na primeira chegada do ID, 0 em duplicata, -1 se fora do intervalo
+ */
+static inline int rx_correlate(rx_correlator_t *c, uint32_t id, uint64_t ts) {
+    if (id < 1 || id > c->total_pkts) return -1;
+    if (c->recv_timestamp[id - 1]) return 0;
+    c->recv_timestamp[id - 1] = ts;
+    c->received++;
+    return 1;
+}
+
+#endif // RX_PARSE_H
@@ -0,0 +1,74 @@
+#ifndef RX_QUEUE_H
+#define RX_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "io_backend.h"
+#include "numa_mem.h"
+
+/*
+ * Fila entre a captura e um analisador do RX (--rx-workers): um produtor,
+ * um consumidor, sem locks. O backend só garante os dados de um quadro até
+ * a próxima recepção, então a captura copia o quadro com o seu timestamp
+ * para a fila e segue para o próximo; parse, correlação e estatísticas
+ * ficam com o analisador.
+ *
+ * Registros de tamanho variável; head e tail só crescem e um registro nunca
+ * dá a volta (o resto do fim do buffer é pulado).
+ */
+#define RX_QUEUE_MB     16      // por analisador
+
+/* Quadro na fila */
+typedef struct {
+    uint32_t size;              // registro inteiro, alinhado a 8 bytes
+    uint32_t caplen;
+    uint32_t len;
+    uint32_t pad;               // 1 = resto da volta, sem quadro
+    uint64_t ts;                // chegada, em ticks do relógio
+    uint64_t wall_ns;           // CLOCK_REALTIME da chegada (só com kernel_ts_ns)
+    uint64_t kernel_ts_ns;
+    uint64_t extra_delay_ns;
+    uint8_t  data[];
+} rx_queued_t;
+
+typedef struct {
+    numa_region_t    mem;
+    uint8_t          *buf;
+    uint64_t         size;      // múltiplo de 8
+    _Atomic uint64_t head __attribute__((aligned(64)));    // escrito só pela captura
+    _Atomic uint64_t tail __attribute__((aligned(64)));    // escrito só pelo analisador
+} rx_queue_t;
+
+/**
+ * Aloca a fila no nó NUMA do RX e pré-aloca as páginas.
+ *
+ * @param node       nó preferido (-1 = sem política)
+ * @param hugepages  tenta páginas de 2 MB
+ * @return 0 em sucesso, -1 em erro (mensagem em stderr)
+ */
+int rx_queue_init(rx_queue_t *q, size_t bytes, int node, int hugepages);
+
+void rx_queue_free(rx_queue_t *q);
+
+/**
+ * Copia um quadro para a fila. Só a captura chama; não bloqueia.
+ *
+ * @param ts       chegada, em ticks do relógio
+ * @param wall_ns  CLOCK_REALTIME da chegada (0 = sem timestamp do kernel)
+ * @return 0 em sucesso, -1 com a fila cheia
+ */
+int rx_queue_push(rx_queue_t *q, const io_frame_t *frame, uint64_t ts, uint64_t wall_ns);
+
+/**
+ * Quadro mais antigo, sem retirá-lo. Só o analisador chama.
+ * @return quadro ou NULL com a fila vazia
+ */
+const rx_queued_t *rx_queue_peek(rx_queue_t *q);
+
+/**
+ * Libera o quadro devolvido por rx_queue_peek().
+ */
+void rx_queue_release(rx_queue_t *q, const rx_queued_t *r);
+
+#endif // RX_QUEUE_H
@@ -0,0 +1,76 @@
+#ifndef RX_RECORD_H
+#define RX_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "clock.h"
+
+/*
+ * Gravação dos quadros recebidos durante a execução. O RX só copia o quadro
+ * (até snaplen bytes) para uma fila em memória sem locks (um produtor, um
+ * consumidor); uma thread própria grava em disco. Fila cheia descarta a
+ * cópia e conta, sem nunca bloquear o RX.
+ *
+ * Modos:
+ *   - contínuo: tudo em disco, com rotação opcional por tamanho e/ou tempo
+ *     (arquivos <nome>.1.pcap, <nome>.2.pcap, ...);
+ *   - anel (ring_mb): só os últimos ring_mb MB ficam em memória e vão para o
+ *     arquivo no fim da execução; com gatilhos (trigger_us/trigger_gap), cada
+ *     anomalia grava o anel (o que a antecedeu) e os RX_RECORD_TRIGGER_POST
+ *     quadros seguintes num arquivo numerado.
+ *
+ * A extensão .pcapng escolhe pcapng; qualquer outra, pcap com timestamps em ns.
+ */
+#define RX_RECORD_QUEUE_MB      64      // fila entre o RX e a thread de gravação
+#define RX_RECORD_TRIGGER_POST  1000    // quadros gravados após um gatilho
+#define RX_RECORD_MAX_DUMPS     16      // arquivos de gatilho por execução
+
+typedef struct {
+    const char *path;           // arquivo de saída (NULL = gravação desligada)
+    uint32_t   snaplen;         // bytes gravados por quadro (0 = 65535)
+    uint32_t   rotate_mb;       // contínuo: novo arquivo a cada N MB (0 = não roda)
+    uint32_t   rotate_s;        // contínuo: novo arquivo a cada N s (0 = não roda)
+    uint32_t   ring_mb;         // modo anel: mantém só os últimos N MB (0 = contínuo)
+    uint32_t   trigger_us;      // anel: gatilho por latência acima de N us (0 = desligado)
+    uint32_t   trigger_gap;     // anel: gatilho por N ou mais IDs seguidos faltando (0 = desligado)
+} rx_record_cfg_t;
+
+typedef struct {
+    uint64_t frames;            // quadros entregues pelo RX
+    uint64_t written;           // quadros gravados em disco
+    uint64_t dropped;           // descartados com a fila cheia
+    uint32_t files;             // arquivos criados
+    uint32_t triggers;          // gatilhos disparados (inclusive os sem arquivo)
+} rx_record_stats_t;
+
+typedef struct rx_record rx_record_t;
+
+/**
+ * Aloca a fila e inicia a thread de gravação.
+ *
+ * @param clock            relógio dos timestamps passados a rx_record_push()
+ * @param realtime_offset  CLOCK_REALTIME - CLOCK_MONOTONIC, em ns
+ * @return gravador ou NULL em erro (mensagem em stderr)
+ */
+rx_record_t *rx_record_start(const rx_record_cfg_t *cfg, const clock_src_t *clock,
+                             uint64_t realtime_offset);
+
+/**
+ * Enfileira um quadro recebido. Chamada apenas pela thread RX; não bloqueia.
+ *
+ * @param ts       chegada, em ticks do relógio
+ * @param latency  latência medida, em ticks (0 = desconhecida)
+ * @param id       ID de correlação (0 = sem ID)
+ */
+void rx_record_push(rx_record_t *r, const uint8_t *data, size_t caplen, size_t len,
+                    uint64_t ts, uint64_t latency, uint32_t id);
+
+/**
+ * Esvazia a fila, fecha os arquivos e libera o gravador. O RX já deve ter parado.
+ *
+ * @param stats  opcional: contadores da gravação
+ * @return 0 em sucesso, -1 se alguma escrita falhou
+ */
+int rx_record_stop(rx_record_t *r, rx_record_stats_t *stats);
+
+#endif // RX_RECORD_H
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <time.h>
+#include "seq_stats.h"
 
 /**
  * Salva as métricas de latência em um arquivo CSV com nome gerado automaticamente
@@ -17,4 +18,50 @@ int save_metrics_to_csv(const uint64_t *send_timestamp,
                         const uint64_t *recv_timestamp,
                         uint32_t total_pkts, const struct tm *timeinfo);
 
+/**
+ * Salva a análise de sequência (reordenação, duplicatas, jitter e rajadas de
+ * perda) em latencies/sequence_YYYY-MM-DD_HH-MM-SS.csv, ao lado do CSV de
+ * latências da mesma execução.
+ *
+ * @return 0 em caso de sucesso, -1 em caso de erro
+ */
+int save_sequence_to_csv(const seq_stats_t *seq, const struct tm *timeinfo);
+
+/* Resumo das latências (ns) de uma execução */
+typedef struct {
+    uint32_t samples;   // pacotes com envio e recebimento registrados
+    uint64_t min_ns;
+    uint64_t avg_ns;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+} latency_summary_t;
+
+/**
+ * Calcula min/média/percentis/max das latências (recv - send).
+ * Pacotes enviados antes de min_send_ts (janela de warm-up) são ignorados.
+ *
+ * @param send_timestamp Array com os timestamps de envio
+ * @param recv_timestamp Array com os timestamps de recebimento
+ * @param total_pkts Número total de pacotes
+ * @param min_send_ts Menor timestamp de envio considerado (0 = todos)
+ * @param out Resumo calculado (zerado se não houver amostras)
+ * @return 0 em caso de sucesso, -1 em caso de erro
+ */
+int compute_latency_summary(const uint64_t *send_timestamp,
+                            const uint64_t *recv_timestamp,
+                            uint32_t total_pkts, uint64_t min_send_ts,
+                            latency_summary_t *out);
+
+/**
+ * Calcula min/média/percentis/max de um conjunto de amostras em ns.
+ * O array é ordenado no lugar.
+ *
+ * @param samples Amostras (ordenadas ao final)
+ * @param n Número de amostras
+ * @param out Resumo calculado (zerado se n == 0)
+ */
+void compute_sample_summary(uint64_t *samples, uint32_t n, latency_summary_t *out);
+
 #endif /* SAVE_METRICS_H */
\ No newline at end of file
@@ -0,0 +1,129 @@
+#ifndef SEQ_STATS_H
+#define SEQ_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "clock.h"
+
+/*
+ * Análise de sequência em fluxo contínuo: reordenação (RFC 4737), duplicatas,
+ * chegadas tardias, jitter entre chegadas (RFC 3550) e distribuição do
+ * tamanho das rajadas de perda. Custo O(1) por pacote e memória fixa; o
+ * número de sequência é o ID de correlação (crescente na ordem de envio).
+ *
+ * Histogramas em potências de 2: a faixa b conta valores em [2^b, 2^(b+1)),
+ * e a última faixa acumula tudo acima.
+ */
+#define SEQ_HIST_BUCKETS  16
+
+typedef struct {
+    uint32_t next_exp;          // RFC 4737 NextExp: maior seq recebido + 1
+    uint32_t arrivals;          // primeiras chegadas consideradas
+    uint32_t reordered;         // chegaram com seq < NextExp
+    uint32_t reorder_max;       // maior deslocamento (NextExp - 1 - seq), em IDs
+    uint64_t reorder_sum;
+    uint32_t reorder_hist[SEQ_HIST_BUCKETS];
+    uint32_t duplicates;        // chegadas repetidas de um ID já recebido
+    uint32_t late;              // latência acima do prazo de perda
+
+    /* RFC 3550 (A.8): J += (|D| - J) / 16, guardado como 16 * J */
+    uint64_t prev_transit;
+    int      have_transit;
+    uint64_t jitter16;          // na unidade do relógio até seq_stats_to_ns()
+
+    /* rajadas de perda: preenchidas por seq_stats_sent() após a execução */
+    uint32_t cur_burst;
+    uint32_t loss_bursts;
+    uint32_t burst_max;
+    uint32_t burst_hist[SEQ_HIST_BUCKETS];
+} seq_stats_t;
+
+/* faixa de um valor >= 1 */
+static inline uint32_t seq_hist_bucket(uint64_t v) {
+    const uint32_t b = 63u - (uint32_t)__builtin_clzll(v | 1);
+    return b < SEQ_HIST_BUCKETS ? b : SEQ_HIST_BUCKETS - 1;
+}
+
+/**
+ * Registra a primeira chegada de seq. Chamada apenas pela thread RX.
+ *
+ * @param send_ts     timestamp de envio (0 = desconhecido: fica fora do jitter e dos tardios)
+ * @param recv_ts     timestamp de recepção, no mesmo relógio
+ * @param late_after  latência acima da qual a chegada é tardia (0 = não conta)
+ */
+static inline void seq_stats_arrival(seq_stats_t *s, uint32_t seq, uint64_t send_ts,
+                                     uint64_t recv_ts, uint64_t late_after) {
+    s->arrivals++;
+    if (seq < s->next_exp) {
+        const uint32_t extent = s->next_exp - 1 - seq;
+        s->reordered++;
+        s->reorder_sum += extent;
+        if (extent > s->reorder_max) s->reorder_max = extent;
+        s->reorder_hist[seq_hist_bucket(extent)]++;
+    } else {
+        s->next_exp = seq + 1;
+    }
+    if (!send_ts) return;
+    const uint64_t transit = recv_ts > send_ts ? recv_ts - send_ts : 0;
+    if (late_after && transit > late_after) s->late++;
+    if (s->have_transit) {
+        const uint64_t d = transit > s->prev_transit ? transit - s->prev_transit
+                                                     : s->prev_transit - transit;
+        s->jitter16 = s->jitter16 + d - ((s->jitter16 + 8) >> 4);
+    }
+    s->prev_transit = transit;
+    s->have_transit = 1;
+}
+
+static inline void seq_stats_duplicate(seq_stats_t *s) {
+    s->duplicates++;
+}
+
+/**
+ * Alimenta as rajadas de perda com um pacote enviado, na ordem de envio.
+ * Feche com seq_stats_sent_end() depois do último.
+ */
+static inline void seq_stats_sent(seq_stats_t *s, int received) {
+    if (!received) {
+        s->cur_burst++;
+        return;
+    }
+    if (!s->cur_burst) return;
+    s->loss_bursts++;
+    if (s->cur_burst > s->burst_max) s->burst_max = s->cur_burst;
+    s->burst_hist[seq_hist_bucket(s->cur_burst)]++;
+    s->cur_burst = 0;
+}
+
+static inline void seq_stats_sent_end(seq_stats_t *s) {
+    seq_stats_sent(s, 1);
+}
+
+/* jitter RFC 3550, na unidade em que está jitter16 */
+static inline uint64_t seq_stats_jitter(const seq_stats_t *s) {
+    return s->jitter16 >> 4;
+}
+
+/**
+ * Soma as contagens de src em dst (execuções em várias instâncias). O jitter
+ * resultante é a média dos dois, ponderada pelas chegadas.
+ */
+void seq_stats_merge(seq_stats_t *dst, const seq_stats_t *src);
+
+/**
+ * Converte o jitter da unidade do relógio para ns (uma única vez).
+ */
+void seq_stats_to_ns(seq_stats_t *s, const clock_src_t *clk);
+
+/**
+ * Imprime o resumo de uma execução (jitter já em ns).
+ */
+void seq_stats_print(const seq_stats_t *s, FILE *out);
+
+/**
+ * Grava o resumo e os histogramas em CSV (metric,value).
+ * @return 0 em sucesso, -1 em erro
+ */
+int seq_stats_save_csv(const seq_stats_t *s, const char *filename);
+
+#endif // SEQ_STATS_H
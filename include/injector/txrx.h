@@ -2,27 +2,150 @@
 #define TXRX_H
 
 #include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include "../generator/packet.h"
+#include "save_metrics.h"
+#include "rt.h"
+#include "io_backend.h"
+#include "flow_stats.h"
+#include "seq_stats.h"
+#include "clock.h"
+#include "rx_record.h"
+#include "instr.h"
+#include "pipeline.h"
+#include "rx_queue.h"
 
+#define TXRX_RATE_UNLIMITED UINT64_MAX  // envia o mais rápido possível, sem pausas
+
+/* Motores de TX/RX */
+#define TXRX_ENGINE_THREADS  0      // uma thread TX e uma RX, uma syscall por pacote
+#define TXRX_ENGINE_URING    1      // uma thread sobre io_uring (AF_PACKET)
+#define TXRX_ENGINE_UDP      2      // TX por sockets UDP do kernel com GSO + sendmmsg, RX por thread
+
+#define TXRX_RX_WORKERS_MAX  16     // analisadores do RX (--rx-workers)
+
+/* Opções de uma execução de TX/RX */
+typedef struct {
+    uint64_t        rate_pps;       // taxa ofertada em pacotes/s (0 = pausa fixa de 1 ms, TXRX_RATE_UNLIMITED = sem pausa)
+    uint32_t        timeout_ms;     // cool-down: espera após o último envio
+    uint32_t        warmup_ms;      // pacotes enviados nesta janela inicial ficam fora das métricas
+    int             save_csv;       // grava latencies/latency_*.csv
+    int             quiet;          // não imprime o resumo
+    rt_opts_t       rt;             // mlock, afinidade e SCHED_FIFO das threads
+    io_impair_t     impair;         // perda/atraso/reordenação injetados no RX
+    int             engine;         // TXRX_ENGINE_*
+    int             sqpoll;         // io_uring: thread de submissão no kernel (IORING_SETUP_SQPOLL)
+    uint32_t        flow_top;       // imprime os N piores fluxos (0 = não imprime)
+    const char      *flow_csv;      // exporta as estatísticas de todos os fluxos (NULL = não exporta)
+    int             stamp;          // TX carimba seq e instante de envio no tag de sonda de cada quadro
+    uint32_t        loop_count;     // envia a lista em ciclo até este total de quadros (0 = uma passagem; exige stamp)
+    int             clock;          // CLOCK_SOURCE_* dos timestamps de TX/RX
+    uint32_t        late_ms;        // prazo de perda: latência acima disto conta como chegada tardia (0 = timeout_ms)
+    int             keep_flows;     // entrega a tabela de fluxos em result->flows (em ns)
+    rx_record_cfg_t record;         // grava os quadros recebidos (record.path NULL = não grava)
+    int             instrument;     // mede o custo de cada estágio e imprime os contadores da instrumentação
+    const char      *stats_json;    // grava resumo e instrumentação em JSON (NULL = não grava)
+    pipeline_cfg_t  pipeline;       // gera os quadros durante o TX (pipeline.set NULL = usa a lista)
+    uint32_t        rx_workers;     // analisadores do RX em threads próprias (0 = a thread RX analisa)
+} txrx_opts_t;
+
+/* Resultado de uma execução de TX/RX (pacotes de warm-up excluídos) */
+typedef struct {
+    uint32_t            sent;
+    uint32_t            received;
+    uint32_t            lost;
+    double              loss_pct;
+    uint32_t            warmup_pkts;    // pacotes descartados pela janela de warm-up
+    double              offered_pps;
+    double              achieved_pps;   // taxa efetivamente enviada
+    latency_summary_t   latency;
+    latency_summary_t   tx_jitter;      // atraso do envio em relação ao prazo agendado
+    latency_summary_t   rx_delivery;    // atraso entre o timestamp do kernel e a thread RX
+    seq_stats_t         seq;            // reordenação, duplicatas, tardios, jitter (ns) e rajadas de perda
+    flow_stats_t        *flows;         // com opts.keep_flows: fluxos em ns (liberar com flow_stats_free)
+} txrx_result_t;
 
 typedef struct {
     packet_list_t   *list;
     const char      *iface_send;
     const char      *iface_recv;
     uint32_t        timeout_ms;
+    txrx_opts_t     opts;
 
-    uint32_t        total_pkts;
-    uint64_t        *send_timestamp;
+    uint32_t        total_pkts;     // tamanho dos arrays de timestamps (maior seq possível)
+    uint32_t        total_sends;    // quadros a enviar (a lista inteira ou loop_count)
+    uint32_t        ids_per_lap;    // maior ID da lista; em loop, seq = volta * ids_per_lap + ID
+    uint32_t        expected_ids;   // pacotes com ID de correlação (sessões TCP e fragmentos têm pacotes sem ID)
+    int             by_position;    // nenhum pacote tem ID: o slot é a posição na lista
+    clock_src_t     clock;          // relógio do caminho quente
+    uint64_t        realtime_offset; // CLOCK_REALTIME - CLOCK_MONOTONIC, para o tx_ns do tag de sonda
+    uint64_t        *send_timestamp; // em ticks de clock até o relatório, depois em ns
     uint64_t        *recv_timestamp;
 
+    uint64_t        *tx_lateness;   // atraso de cada envio em relação ao prazo (ticks, depois ns)
+    uint64_t        *rx_delivery;   // atraso kernel -> thread RX de cada recebimento
+    atomic_uint     rx_delivery_cnt;
+    numa_region_t   mem_tx;         // send_timestamp e tx_lateness, no nó do TX
+    numa_region_t   mem_rx;         // recv_timestamp e rx_delivery, no nó do RX
+    numa_region_t   mem_pkts;       // cópia dos quadros no nó do TX (addr NULL = dados originais da lista)
+    void            **pkt_data;     // ponteiros originais dos quadros, restaurados no fim
+    int             node_tx;        // nó NUMA de cada lado (-1 = sem política)
+    int             node_rx;
+    const char      *node_tx_why;   // origem da escolha ("CPU", "interface", "pedido")
+    const char      *node_rx_why;
+    flow_stats_t    *flow_stats;    // por fluxo (NULL = desligado); escrito só pelo RX
+    seq_stats_t     seq;            // análise de sequência da execução; escrito só pelo RX
+    uint64_t        late_after;     // prazo de perda em ticks de clock
+    rx_record_t     *recorder;      // gravação dos quadros recebidos (NULL = desligada); alimentado só pelo RX
+    rx_record_stats_t record_stats;
+    instr_t         instr;          // contadores por thread e custo dos estágios
+    pipeline_t      *pipe;          // construtoras em fluxo (NULL = a lista já está pronta)
+    pipeline_stats_t pipe_stats;
+    struct rx_worker *rx_workers;   // analisadores alimentados pela captura (NULL = RX analisa)
+    uint32_t        n_rx_workers;
+    atomic_int      rx_capture_done; // a captura parou: os analisadores esvaziam as filas e saem
+
     pthread_mutex_t lock;
-    pthread_cond_t  cond_all_recv;
+    pthread_cond_t  cond_rx_ready;
+    int             rx_state;       // 0 = abrindo, 1 = capturando, -1 = falhou
+
+    uint64_t        tx_start;       // ticks de clock
+    atomic_uint_fast64_t tx_end;
+    atomic_int      tx_done;        // TX terminou (ou falhou)
 } txrx_ctx_t;
 
+/// Índice em send_timestamp do pacote na posição idx da lista, ou UINT32_MAX
+/// se ele não é medido (controle das sessões TCP, segmentos e fragmentos
+/// seguintes ao primeiro).
+static inline uint32_t txrx_slot(const txrx_ctx_t *ctx, const packet_t *pkt, uint32_t idx) {
+    if (pkt->id) return pkt->id - 1;
+    return ctx->by_position ? idx : UINT32_MAX;
+}
+
+/// Envios com prazo: taxa finita ou lista escalonada (rate_pps/start_ms nos templates).
+static inline int txrx_paced(const txrx_ctx_t *ctx) {
+    const uint64_t rate = ctx->opts.rate_pps;
+    return ctx->list->lap_ns || (rate && rate != TXRX_RATE_UNLIMITED);
+}
+
+/// Prazo (em ticks) do envio idx: na lista escalonada, o tx_offset_ns do
+/// pacote na volta lap; senão, idx / rate a partir do início.
+static inline uint64_t txrx_deadline(const txrx_ctx_t *ctx, uint32_t idx, uint32_t lap,
+                                     uint64_t tx_offset_ns) {
+    const uint64_t lap_ns = ctx->list->lap_ns;
+    const uint64_t ns = lap_ns ? (uint64_t)lap * lap_ns + tx_offset_ns
+                               : (uint64_t)idx * 1000000000ULL / ctx->opts.rate_pps;
+    return ctx->tx_start + clock_src_from_ns(&ctx->clock, ns);
+}
+
+/// Dorme até perto do prazo (em ticks do relógio) e completa em espera ativa.
+void txrx_wait_until(const clock_src_t *clk, uint64_t deadline);
+
     /// Configura e dispara o teste de TX/RX.
     /// @param list        lista de pacotes (deve conter payloads prefixados com ID|…)
-    /// @param iface_send  interface para envio (ex.: "eth0")
-    /// @param iface_recv  interface para captura (ex.: "eth0" ou outra)
+    /// @param iface_send  interface para envio (ex.: "eth0", "file:saida.pcap" ou "mem")
+    /// @param iface_recv  interface para captura (ex.: "eth0", "file:entrada.pcap" ou "mem")
     /// @param timeout_ms  tempo máximo de espera, em milissegundos, após o último envio
     /// @return 0 em sucesso, !=0 em erro
     int txrx_run(packet_list_t *list,
@@ -30,6 +153,17 @@ typedef struct {
                  const char *iface_recv,
                  uint32_t timeout_ms);
 
-
+    /// Igual a txrx_run(), com taxa, warm-up e resultado estruturado.
+    /// A lista pode ser reutilizada em várias execuções (ex.: busca RFC 2544).
+    /// Com opts->pipeline.set, os quadros são gerados durante o TX (só motor de
+    /// threads, sem loop) e list é só um cabeçalho vazio, que recebe lap_ns.
+    /// @param opts        opções da execução
+    /// @param result      opcional: preenchido com contadores e latências
+    /// @return 0 em sucesso, !=0 em erro
+    int txrx_run_ex(packet_list_t *list,
+                    const char *iface_send,
+                    const char *iface_recv,
+                    const txrx_opts_t *opts,
+                    txrx_result_t *result);
 
 #endif // TXRX_H
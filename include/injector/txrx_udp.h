@@ -0,0 +1,24 @@
+#ifndef TXRX_UDP_H
+#define TXRX_UDP_H
+
+#include "txrx.h"
+
+/**
+ * TX de camada 4 por sockets UDP do kernel, para carga UDP em volume.
+ *
+ * Abre um socket UDP conectado por fluxo (5-tupla dos quadros da lista) e
+ * envia só o payload de cada quadro: cabeçalhos IP/UDP e checksums ficam a
+ * cargo do kernel. Datagramas consecutivos do mesmo fluxo e de mesmo tamanho
+ * são agrupados em uma mensagem com UDP_SEGMENT (GSO) e as mensagens vão em
+ * lote por sendmmsg. O tag de sonda de cada datagrama é carimbado antes do
+ * envio, então o RX correlaciona e mede a latência como no TX por quadros.
+ *
+ * Roda na thread TX (o RX continua o de sempre). Exige lista só com UDP sem
+ * fragmentos; o endereço de origem não precisa ser local (IP_FREEBIND).
+ *
+ * @param ctx  contexto já alocado por txrx_run_ex()
+ * @return 0 em sucesso, -1 se o envio não pôde ser iniciado
+ */
+int txrx_udp_send(txrx_ctx_t *ctx);
+
+#endif // TXRX_UDP_H
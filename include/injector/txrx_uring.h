@@ -0,0 +1,28 @@
+#ifndef TXRX_URING_H
+#define TXRX_URING_H
+
+#include "txrx.h"
+
+/**
+ * Motor de TX/RX em uma única thread sobre io_uring e sockets AF_PACKET.
+ *
+ * Os quadros são copiados para um arena contíguo registrado no anel
+ * (WRITE_FIXED); as leituras RX usam um conjunto de buffers também
+ * registrado (READ_FIXED). Mantém lotes de envios e recepções em voo e
+ * processa as conclusões em bloco. O timestamp de envio de cada pacote é
+ * o instante da submissão, atribuído apenas quando a conclusão confirma o
+ * envio.
+ *
+ * Só funciona com interfaces ao vivo ("eth0" ou "pcap:eth0").
+ *
+ * @param ctx  contexto já alocado por txrx_run_ex()
+ * @return 0 em sucesso, -1 se o motor não pôde ser iniciado
+ */
+int txrx_uring_run(txrx_ctx_t *ctx);
+
+/**
+ * Indica se o binário foi compilado com suporte a io_uring.
+ */
+int txrx_uring_available(void);
+
+#endif // TXRX_URING_H
@@ -0,0 +1,255 @@
+/**
+ * netwagon.h
+ * API pública da libnetwagon: construção de quadros em buffers do chamador,
+ * sem alocação, e templates compilados com carimbo de ID.
+ */
+
+#ifndef NETWAGON_H
+#define NETWAGON_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "generator/ip.h"
+#include "generator/packet.h"
+#include "generator/template.h"
+
+#define NW_ETH_HEADER_SIZE  14
+#define NW_ETH_FCS_SIZE     4
+#define NW_ID_DIGITS        10      // campo de ID de largura fixa ("0000000042|")
+#define NW_MAX_FRAME_LEN    65535
+#define NW_JUMBO_FRAME_LEN  16384   // quadros jumbo (MTU 9000+) cabem inteiros nos buffers de RX
+#define NW_IPV4_MIN_MTU     68
+#define NW_IPV6_MIN_MTU     1280
+#define NW_IPV6_FRAG_SIZE   8       // cabeçalho de extensão Fragment
+#define NW_VNET_HDR_SIZE    10      // struct virtio_net_hdr (PACKET_VNET_HDR)
+
+/*
+ * Tag de sonda binário no início do payload, em ordem de rede:
+ * magic(4) | seq(4) | tx_ns(8). Substitui o "ID|" quando o TX carimba cada
+ * envio; tx_ns é o instante de envio em CLOCK_REALTIME (0 = não carimbado).
+ */
+#define NW_PROBE_MAGIC      0x4E575052u     // "NWPR"
+#define NW_PROBE_TAG_SIZE   16
+#define NW_PROBE_DWELL_SIZE 8               // permanência no refletor, logo após o tag (opcional)
+
+/* Cabeçalhos fixos de um fluxo; o payload varia a cada quadro */
+typedef struct {
+    ip_version_t ip_version;        // IPv4 ou IPv6
+    int          transport;         // IPPROTO_TCP, IPPROTO_UDP ou IPPROTO_ICMP (ICMPv6 no IPv6)
+    uint8_t      src_addr[16];      // endereço binário (IPv4 usa os 4 primeiros bytes)
+    uint8_t      dst_addr[16];
+    uint16_t     src_port;
+    uint16_t     dst_port;
+    uint32_t     tcp_seq;
+    uint32_t     tcp_ack;
+    uint8_t      tcp_flags;
+    uint8_t      icmp_type;
+    uint8_t      icmp_code;
+    uint16_t     icmp_id;
+    uint16_t     icmp_seq;
+    uint16_t     ip_id;             // IPv4 identification
+    uint8_t      ttl;               // TTL / hop limit
+    int          ethernet;          // 1 = o quadro começa no cabeçalho Ethernet
+    int          csum_offload;      // 1 = checksum TCP/UDP parcial (só o pseudocabeçalho): o kernel/NIC completa
+    uint8_t      dst_mac[6];
+    uint8_t      src_mac[6];
+} nw_flow_t;
+
+/* Pilha de cabeçalhos de um quadro, do Ethernet externo ao IP interno */
+#define NW_STACK_MAX_TUNNELS 4
+typedef struct {
+    size_t   l3_offset;                         // IP interno
+    uint16_t ethertype;                         // do IP interno: 0x0800 ou 0x86DD
+    uint8_t  n_tunnels;                         // túneis GRE/VXLAN atravessados
+    uint16_t tunnel_ip[NW_STACK_MAX_TUNNELS];   // IP externo de cada túnel
+    uint16_t inner_eth[NW_STACK_MAX_TUNNELS];   // Ethernet dentro do túnel (0 = nenhum)
+} nw_stack_t;
+
+/* Template compilado: quadro-modelo com campo de ID de largura fixa */
+typedef struct {
+    const uint8_t *frame;           // quadro-modelo (buffer do chamador)
+    size_t         len;
+    size_t         l4_offset;       // início do cabeçalho de transporte
+    size_t         csum_offset;     // checksum de transporte
+    size_t         id_offset;       // primeiro dígito do ID
+    int            udp;             // checksum UDP 0 é transmitido como 0xFFFF
+} nw_compiled_t;
+
+/**
+ * Inicializa um fluxo com valores padrão (TTL 64, Ethernet com os MACs
+ * padrão do NetWagon, janela TCP 5840).
+ *
+ * @param f          Fluxo a preencher
+ * @param ip_ver     IP_V4 ou IP_V6
+ * @param transport  IPPROTO_TCP, IPPROTO_UDP ou IPPROTO_ICMP
+ * @param src_ip     Endereço de origem em texto
+ * @param dst_ip     Endereço de destino em texto
+ * @return 0 em sucesso, -1 se algum endereço for inválido
+ */
+int nw_flow_init(nw_flow_t *f, ip_version_t ip_ver, int transport,
+                 const char *src_ip, const char *dst_ip);
+
+/**
+ * Inicializa um fluxo a partir de um template carregado do JSON.
+ */
+int nw_flow_from_template(nw_flow_t *f, const packet_template_t *t);
+
+/**
+ * Bytes de cabeçalho (Ethernet opcional + IP + transporte) de um fluxo.
+ */
+size_t nw_header_size(const nw_flow_t *f);
+
+/**
+ * Monta um quadro no buffer do chamador, sem alocar memória.
+ * Com f->csum_offload, o checksum TCP/UDP recebe só a soma do
+ * pseudocabeçalho (CHECKSUM_PARTIAL) e o payload não é percorrido.
+ *
+ * @param f             Fluxo
+ * @param payload       Payload (pode ser NULL se payload_size == 0)
+ * @param payload_size  Tamanho do payload
+ * @param buf           Destino
+ * @param cap           Capacidade de buf
+ * @return tamanho do quadro, ou -1 se não couber
+ */
+int nw_build(const nw_flow_t *f, const void *payload, size_t payload_size,
+             uint8_t *buf, size_t cap);
+
+/**
+ * Monta n quadros do mesmo fluxo, um a cada stride bytes de buf.
+ *
+ * @param lens  Tamanho de cada quadro montado
+ * @return número de quadros montados (para no primeiro que não couber)
+ */
+size_t nw_build_batch(const nw_flow_t *f,
+                      const void *const *payloads, const size_t *sizes,
+                      uint8_t *buf, size_t stride, size_t *lens, size_t n);
+
+/**
+ * Versão com alocação, usada pelos create_*_packet(): devolve um packet_t
+ * sem cabeçalho Ethernet, pronto para add_packet_to_list().
+ */
+packet_t *nw_packet_new(const nw_flow_t *f, const void *payload, size_t payload_size);
+
+/**
+ * Número de fragmentos de um datagrama IP (sem Ethernet) de len bytes para
+ * o MTU dado, ou 0 se o MTU não comporta o cabeçalho e 8 bytes de dados.
+ */
+size_t nw_fragment_count(const uint8_t *dgram, size_t len, size_t mtu);
+
+/**
+ * Fragmenta um datagrama IP já montado (sem Ethernet), sem alocar memória.
+ * IPv4: MF e offset no cabeçalho, mesma identificação, DF desligado.
+ * IPv6: cabeçalho Fragment com a identificação ident.
+ * O checksum de transporte do datagrama original fica no primeiro fragmento.
+ *
+ * @param buf     Destino: fragmento i em buf + i * stride (stride >= mtu)
+ * @param lens    Tamanho de cada fragmento
+ * @return número de fragmentos escritos (0 em erro)
+ */
+size_t nw_fragment(const uint8_t *dgram, size_t len, size_t mtu, uint32_t ident,
+                   uint8_t *buf, size_t stride, size_t *lens);
+
+/**
+ * Atualiza um checksum quando um campo de 32 bits muda de old_val para
+ * new_val (RFC 1624). Valores e checksum em ordem de host.
+ */
+uint16_t nw_csum_replace32(uint16_t csum, uint32_t old_val, uint32_t new_val);
+
+/**
+ * Compila um template em um quadro-modelo com payload "0000000000|payload",
+ * completado com zeros até frame_size (com FCS; 0 = tamanho natural).
+ *
+ * @param buf  Destino do quadro-modelo (deve viver enquanto out for usado)
+ * @return 0 em sucesso, -1 se não couber em cap
+ */
+int nw_template_compile(const packet_template_t *t, size_t frame_size,
+                        uint8_t *buf, size_t cap, nw_compiled_t *out);
+
+/**
+ * Grava o ID em uma cópia do quadro-modelo e atualiza o checksum de
+ * transporte de forma incremental (RFC 1624), sem percorrer o payload.
+ * Pode ser chamada de novo sobre o mesmo quadro.
+ */
+void nw_template_stamp(const nw_compiled_t *c, uint8_t *frame, uint32_t id);
+
+/**
+ * Copia o quadro-modelo para n posições de buf (a cada stride bytes) e
+ * carimba IDs sequenciais a partir de first_id.
+ *
+ * @return número de quadros escritos (0 se stride < c->len)
+ */
+size_t nw_template_stamp_batch(const nw_compiled_t *c, uint8_t *buf, size_t stride,
+                               uint32_t first_id, size_t n);
+
+/**
+ * Escreve um tag de sonda (magic, seq e tx_ns = 0) em p, que deve ter
+ * NW_PROBE_TAG_SIZE bytes. Usado na montagem; o checksum é calculado depois.
+ */
+void nw_probe_tag_init(uint8_t *p, uint32_t seq);
+
+/**
+ * Carimba seq e tx_ns no tag de um quadro Ethernet já montado e atualiza o
+ * checksum de transporte de forma incremental (RFC 1624). O transporte é o
+ * interno, depois da pilha de encapsulamento (nw_stack_parse()).
+ *
+ * @param frame    Quadro a partir do cabeçalho Ethernet
+ * @param len      Tamanho do quadro
+ * @param tag_off  Offset do tag no quadro (início do payload)
+ * @return 0 em sucesso, -1 se o quadro não for IPv4/IPv6 com TCP/UDP/ICMP
+ *         ou o tag não couber
+ */
+int nw_probe_stamp(uint8_t *frame, size_t len, size_t tag_off, uint32_t seq, uint64_t tx_ns);
+
+/**
+ * Igual a nw_probe_stamp() para quadros com checksum parcial (csum_offload):
+ * o kernel/NIC soma o payload no envio, então o checksum não é tocado.
+ */
+int nw_probe_stamp_partial(uint8_t *frame, size_t len, size_t tag_off, uint32_t seq, uint64_t tx_ns);
+
+/**
+ * Preenche o virtio_net_hdr (NW_VNET_HDR_SIZE bytes, ordem de host) que
+ * acompanha um quadro Ethernet enviado por socket com PACKET_VNET_HDR.
+ * Com csum_partial, pede ao kernel/NIC o checksum TCP/UDP; com gso_size
+ * menor que o payload, pede a segmentação TSO (TCP) ou GSO (UDP) do
+ * super-quadro. Outros quadros recebem um cabeçalho vazio.
+ *
+ * @param csum_partial  quadro montado com csum_offload
+ * @param gso_size      payload de cada segmento (0 = quadro já no tamanho final)
+ * @return 0 em sucesso, -1 se gso_size for pedido para quadro sem TCP/UDP parcial
+ */
+int nw_vnet_hdr(const uint8_t *frame, size_t len, int csum_partial, uint16_t gso_size, void *hdr);
+
+/**
+ * Grava, logo após o tag de sonda, o tempo em ns que o quadro passou no
+ * refletor e atualiza o checksum de transporte de forma incremental.
+ *
+ * @return 0 em sucesso, -1 se não houver tag em tag_off ou os 8 bytes não couberem
+ */
+int nw_probe_stamp_dwell(uint8_t *frame, size_t len, size_t tag_off, uint64_t dwell_ns);
+
+/**
+ * Devolve um quadro Ethernet à origem: troca MACs, endereços IP (também os
+ * externos de túneis) e, em TCP/UDP, as portas internas. Os checksums
+ * continuam válidos sem recálculo.
+ *
+ * @return 0 em sucesso, -1 se o quadro não for IPv4/IPv6
+ */
+int nw_reflect(uint8_t *frame, size_t len);
+
+/**
+ * Percorre a pilha de encapsulamento de um quadro Ethernet até o IP interno:
+ * tags 802.1Q/QinQ, rótulos MPLS, GRE (IP ou Ethernet transparente) e
+ * VXLAN na porta 4789. Fragmentos IP externos não são abertos.
+ *
+ * @return 0 em sucesso, -1 se o quadro não chega a um IPv4/IPv6
+ */
+int nw_stack_parse(const uint8_t *frame, size_t len, nw_stack_t *st);
+
+/**
+ * Lê um tag de sonda no início de um payload.
+ *
+ * @return 1 se houver tag (seq e tx_ns preenchidos), 0 caso contrário
+ */
+int nw_probe_read(const uint8_t *payload, size_t len, uint32_t *seq, uint64_t *tx_ns);
+
+#endif // NETWAGON_H
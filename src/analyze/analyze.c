@@ -0,0 +1,672 @@
+// analyze.c
+// netwagon-analyze: análise offline e paralela dos CSVs de latência (latencies/latency_*.csv)
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../../include/injector/flow_stats.h"
+
+#define MAX_THREADS     256
+#define MAX_INTERVALS   10000           // pontos da série temporal (o intervalo é ampliado acima disso)
+#define MIN_CHUNK       (1u << 20)      // arquivos menores que isso por thread usam menos threads
+#define SEL_BITS        11              // dígito da seleção por radix: 2048 faixas por rodada
+#define SEL_BINS        (1u << SEL_BITS)
+#define N_QUANTILES     5
+
+/* percentis exatos, com o mesmo posto de compute_sample_summary(): (n - 1) * num / den */
+static const struct {
+    const char *name;
+    uint32_t   num;
+    uint32_t   den;
+} quantiles[N_QUANTILES] = {
+    { "p50",    50,   100   },
+    { "p90",    90,   100   },
+    { "p99",    99,   100   },
+    { "p99.9",  999,  1000  },
+    { "p99.99", 9999, 10000 }
+};
+
+typedef struct run run_t;
+
+/* Fatia do arquivo processada por uma thread */
+typedef struct {
+    run_t      *run;
+    const char *begin;
+    const char *end;
+
+    uint64_t   *lat;            // latências (ns) dos pacotes recebidos da fatia
+    uint64_t   n_lat;
+    uint64_t   cap;
+    int        oom;
+
+    uint64_t   rows;
+    uint64_t   sent;
+    uint64_t   bad;             // linhas malformadas
+    uint64_t   sum;
+    uint64_t   min;
+    uint64_t   max;
+    uint64_t   send_min;
+    uint64_t   send_max;
+
+    uint64_t   (*hist)[SEL_BINS];   // contagens da rodada de seleção, por percentil
+
+    flow_stat_t *series;        // intervalos [series_first, series_first + series_n)
+    uint64_t   series_first;
+    uint32_t   series_n;
+} chunk_t;
+
+/* Rodada da seleção por radix: fixa os bits acima de 'above' e conta o próximo dígito */
+typedef struct {
+    unsigned   above;
+    unsigned   shift;
+    uint64_t   prefix[N_QUANTILES];
+} sel_round_t;
+
+/* Uma execução (um arquivo de resultado) */
+struct run {
+    const char  *path;
+    const char  *map;
+    size_t      size;
+    chunk_t     *chunks;
+    int         n_chunks;
+
+    uint64_t    rows;
+    uint64_t    sent;
+    uint64_t    received;
+    uint64_t    bad;
+    uint64_t    sum;
+    uint64_t    min;
+    uint64_t    max;
+    uint64_t    send_min;
+    uint64_t    send_max;
+    uint64_t    q[N_QUANTILES];
+    sel_round_t round;
+
+    uint64_t    interval_ns;    // 0 = sem série
+    flow_stat_t *series;
+    uint32_t    n_series;
+
+    double      parse_ms;
+    double      select_ms;
+};
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+/* roda fn em cada fatia, uma thread por fatia (na própria thread se não criar) */
+static void run_parallel(run_t *r, void *(*fn)(void *)) {
+    pthread_t th[MAX_THREADS];
+    int created[MAX_THREADS];
+    for (int i = 0; i < r->n_chunks; i++) {
+        created[i] = pthread_create(&th[i], NULL, fn, &r->chunks[i]) == 0;
+        if (!created[i]) fn(&r->chunks[i]);
+    }
+    for (int i = 0; i < r->n_chunks; i++) {
+        if (created[i]) pthread_join(th[i], NULL);
+    }
+}
+
+static inline const char *parse_u64(const char *p, const char *end, uint64_t *v) {
+    const char *start = p;
+    uint64_t x = 0;
+    while (p < end && (unsigned)(*p - '0') < 10) {
+        x = x * 10 + (uint64_t)(*p - '0');
+        p++;
+    }
+    *v = x;
+    return p == start ? NULL : p;
+}
+
+/*
+ * Lê uma linha "ID,send_timestamp,recv_timestamp". Devolve o início da
+ * próxima linha e 1 se a linha é válida.
+ */
+static inline const char *parse_row(const char *p, const char *end, uint64_t *send, uint64_t *recv,
+                                    int *ok) {
+    uint64_t id;
+    const char *q = parse_u64(p, end, &id);
+    if (q && q < end && *q == ',' && (q = parse_u64(q + 1, end, send)) && q < end && *q == ',' &&
+        (q = parse_u64(q + 1, end, recv))) {
+        if (q < end && *q == '\r') q++;
+        if (q == end || *q == '\n') {
+            *ok = 1;
+            return q < end ? q + 1 : end;
+        }
+    }
+    *ok = 0;
+    q = memchr(p, '\n', (size_t)(end - p));
+    return q ? q + 1 : end;
+}
+
+static inline uint64_t row_latency(uint64_t send, uint64_t recv) {
+    // RX pode registrar antes do TX gravar o seu timestamp (mesmo host)
+    return recv > send ? recv - send : 0;
+}
+
+/* passada 1: contadores e latências da fatia */
+static void *parse_chunk(void *arg) {
+    chunk_t *c = arg;
+    c->min = c->send_min = UINT64_MAX;
+    c->cap = (uint64_t)(c->end - c->begin) / 40 + 16;   // ~49 bytes por linha recebida
+    c->lat = malloc(c->cap * sizeof(uint64_t));
+    if (!c->lat) {
+        c->oom = 1;
+        return NULL;
+    }
+    const char *p = c->begin;
+    while (p < c->end) {
+        uint64_t send, recv;
+        int ok;
+        p = parse_row(p, c->end, &send, &recv, &ok);
+        if (!ok) {
+            c->bad++;
+            continue;
+        }
+        c->rows++;
+        if (!send) continue;        // não enviado
+        c->sent++;
+        if (send < c->send_min) c->send_min = send;
+        if (send > c->send_max) c->send_max = send;
+        if (!recv) continue;        // perdido
+        const uint64_t lat = row_latency(send, recv);
+        if (c->n_lat == c->cap) {
+            uint64_t *grown = realloc(c->lat, c->cap * 2 * sizeof(uint64_t));
+            if (!grown) {
+                c->oom = 1;
+                return NULL;
+            }
+            c->lat = grown;
+            c->cap *= 2;
+        }
+        c->lat[c->n_lat++] = lat;
+        c->sum += lat;
+        if (lat < c->min) c->min = lat;
+        if (lat > c->max) c->max = lat;
+    }
+    return NULL;
+}
+
+/* rodada de seleção: histograma do próximo dígito dos candidatos de cada percentil */
+static void *select_chunk(void *arg) {
+    chunk_t *c = arg;
+    const sel_round_t *rd = &c->run->round;
+    const uint64_t mask = ((uint64_t)1 << (rd->above - rd->shift)) - 1;
+    memset(c->hist, 0, N_QUANTILES * sizeof(*c->hist));
+    for (uint64_t i = 0; i < c->n_lat; i++) {
+        const uint64_t v = c->lat[i];
+        const uint64_t hi = rd->above >= 64 ? 0 : v >> rd->above;
+        const uint32_t digit = (uint32_t)((v >> rd->shift) & mask);
+        for (int q = 0; q < N_QUANTILES; q++) {
+            if (hi == rd->prefix[q]) c->hist[q][digit]++;
+        }
+    }
+    return NULL;
+}
+
+/* passada 2: série temporal da fatia (latência por histograma, como nos fluxos) */
+static void *series_chunk(void *arg) {
+    chunk_t *c = arg;
+    const run_t *r = c->run;
+    if (!c->series) return NULL;
+    const char *p = c->begin;
+    while (p < c->end) {
+        uint64_t send, recv;
+        int ok;
+        p = parse_row(p, c->end, &send, &recv, &ok);
+        if (!ok || !send) continue;
+        flow_stat_t *f = &c->series[(send - r->send_min) / r->interval_ns - c->series_first];
+        f->sent++;
+        if (!recv) continue;
+        const uint64_t lat = row_latency(send, recv);
+        f->received++;
+        f->samples++;
+        f->sum_ns += lat;
+        if (lat < f->min_ns) f->min_ns = lat;
+        if (lat > f->max_ns) f->max_ns = lat;
+        f->hist[flow_hist_bucket(lat)]++;
+    }
+    return NULL;
+}
+
+static void free_chunks(run_t *r) {
+    if (!r->chunks) return;
+    for (int i = 0; i < r->n_chunks; i++) {
+        free(r->chunks[i].lat);
+        free(r->chunks[i].hist);
+        free(r->chunks[i].series);
+    }
+    free(r->chunks);
+    r->chunks = NULL;
+}
+
+/* divide o arquivo em fatias terminadas em fim de linha */
+static int split_chunks(run_t *r, int threads) {
+    const char *begin = r->map, *end = r->map + r->size;
+    // cabeçalho "ID,send_timestamp,recv_timestamp"
+    if (begin < end && (unsigned)(*begin - '0') >= 10) {
+        const char *nl = memchr(begin, '\n', r->size);
+        begin = nl ? nl + 1 : end;
+    }
+    const size_t len = (size_t)(end - begin);
+    int n = threads;
+    if ((size_t)n > len / MIN_CHUNK) n = (int)(len / MIN_CHUNK);
+    if (n < 1) n = 1;
+    r->chunks = calloc((size_t)n, sizeof(chunk_t));
+    if (!r->chunks) return -1;
+    r->n_chunks = n;
+    const char *p = begin;
+    for (int i = 0; i < n; i++) {
+        chunk_t *c = &r->chunks[i];
+        c->run   = r;
+        c->begin = p;
+        const char *cut = begin + len / (size_t)n * (size_t)(i + 1);
+        if (i == n - 1 || cut >= end) {
+            cut = end;
+        } else {
+            if (cut < p) cut = p;
+            const char *nl = memchr(cut, '\n', (size_t)(end - cut));
+            cut = nl ? nl + 1 : end;
+        }
+        c->end = cut;
+        p = cut;
+        c->hist = malloc(N_QUANTILES * sizeof(*c->hist));
+        if (!c->hist) return -1;
+    }
+    return 0;
+}
+
+/* percentis exatos por seleção em rodadas de SEL_BITS bits, sem ordenar nem copiar */
+static void select_quantiles(run_t *r) {
+    uint64_t rank[N_QUANTILES];
+    for (int q = 0; q < N_QUANTILES; q++) {
+        rank[q] = (r->received - 1) * quantiles[q].num / quantiles[q].den;
+        r->round.prefix[q] = 0;
+    }
+    unsigned above = r->max ? 64u - (unsigned)__builtin_clzll(r->max) : 1;
+    while (above > 0) {
+        const unsigned width = above > SEL_BITS ? SEL_BITS : above;
+        r->round.above = above;
+        r->round.shift = above - width;
+        run_parallel(r, select_chunk);
+        for (int q = 0; q < N_QUANTILES; q++) {
+            uint64_t seen = 0;
+            uint32_t digit = 0;
+            for (uint32_t b = 0; b < (1u << width); b++) {
+                uint64_t cnt = 0;
+                for (int i = 0; i < r->n_chunks; i++) cnt += r->chunks[i].hist[q][b];
+                if (seen + cnt > rank[q]) {
+                    digit = b;
+                    break;
+                }
+                seen += cnt;
+            }
+            rank[q] -= seen;
+            r->round.prefix[q] = (r->round.prefix[q] << width) | digit;
+        }
+        above -= width;
+    }
+    for (int q = 0; q < N_QUANTILES; q++) r->q[q] = r->round.prefix[q];
+}
+
+static int build_series(run_t *r) {
+    const uint64_t span = r->send_max - r->send_min + 1;
+    if ((span + r->interval_ns - 1) / r->interval_ns > MAX_INTERVALS) {
+        r->interval_ns = (span + MAX_INTERVALS - 1) / MAX_INTERVALS;
+        fprintf(stderr, "Aviso: '%s': intervalo da série ampliado para %.3f ms (máx. %d pontos)\n",
+                r->path, r->interval_ns / 1e6, MAX_INTERVALS);
+    }
+    r->n_series = (uint32_t)((r->send_max - r->send_min) / r->interval_ns + 1);
+    for (int i = 0; i < r->n_chunks; i++) {
+        chunk_t *c = &r->chunks[i];
+        if (!c->sent) continue;
+        c->series_first = (c->send_min - r->send_min) / r->interval_ns;
+        c->series_n = (uint32_t)((c->send_max - r->send_min) / r->interval_ns - c->series_first + 1);
+        c->series = calloc(c->series_n, sizeof(flow_stat_t));
+        if (!c->series) return -1;
+        for (uint32_t k = 0; k < c->series_n; k++) c->series[k].min_ns = UINT64_MAX;
+    }
+    r->series = calloc(r->n_series, sizeof(flow_stat_t));
+    if (!r->series) return -1;
+    for (uint32_t k = 0; k < r->n_series; k++) r->series[k].min_ns = UINT64_MAX;
+
+    run_parallel(r, series_chunk);
+
+    for (int i = 0; i < r->n_chunks; i++) {
+        const chunk_t *c = &r->chunks[i];
+        for (uint32_t k = 0; c->series && k < c->series_n; k++) {
+            const flow_stat_t *s = &c->series[k];
+            flow_stat_t *d = &r->series[c->series_first + k];
+            d->sent     += s->sent;
+            d->received += s->received;
+            d->samples  += s->samples;
+            d->sum_ns   += s->sum_ns;
+            if (s->min_ns < d->min_ns) d->min_ns = s->min_ns;
+            if (s->max_ns > d->max_ns) d->max_ns = s->max_ns;
+            for (uint32_t b = 0; b < FLOW_HIST_BUCKETS; b++) d->hist[b] += s->hist[b];
+        }
+    }
+    return 0;
+}
+
+static int analyze_run(run_t *r, int threads) {
+    int fd = open(r->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "Erro: não abriu '%s': %s\n", r->path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr, "Erro: '%s' vazio ou ilegível\n", r->path);
+        close(fd);
+        return -1;
+    }
+    r->size = (size_t)st.st_size;
+    void *map = mmap(NULL, r->size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Erro: mmap de '%s': %s\n", r->path, strerror(errno));
+        return -1;
+    }
+    r->map = map;
+    madvise(map, r->size, MADV_SEQUENTIAL);
+
+    int rc = -1;
+    double t0 = now_ms();
+    if (split_chunks(r, threads) != 0) {
+        fprintf(stderr, "Erro: sem memória\n");
+        goto out;
+    }
+    run_parallel(r, parse_chunk);
+    r->min = r->send_min = UINT64_MAX;
+    for (int i = 0; i < r->n_chunks; i++) {
+        const chunk_t *c = &r->chunks[i];
+        if (c->oom) {
+            fprintf(stderr, "Erro: sem memória para as latências de '%s'\n", r->path);
+            goto out;
+        }
+        r->rows     += c->rows;
+        r->sent     += c->sent;
+        r->received += c->n_lat;
+        r->bad      += c->bad;
+        r->sum      += c->sum;
+        if (c->min < r->min) r->min = c->min;
+        if (c->max > r->max) r->max = c->max;
+        if (c->send_min < r->send_min) r->send_min = c->send_min;
+        if (c->send_max > r->send_max) r->send_max = c->send_max;
+    }
+    if (!r->rows) {
+        fprintf(stderr, "Erro: '%s' não tem linhas ID,send_timestamp,recv_timestamp\n", r->path);
+        goto out;
+    }
+    if (!r->received) r->min = 0;
+    r->parse_ms = now_ms() - t0;
+
+    t0 = now_ms();
+    if (r->received) select_quantiles(r);
+    r->select_ms = now_ms() - t0;
+    // as latências não são mais necessárias: libera antes do próximo arquivo
+    for (int i = 0; i < r->n_chunks; i++) {
+        free(r->chunks[i].lat);
+        r->chunks[i].lat = NULL;
+    }
+
+    if (r->interval_ns && r->sent && build_series(r) != 0) {
+        fprintf(stderr, "Erro: sem memória para a série de '%s'\n", r->path);
+        goto out;
+    }
+    rc = 0;
+out:
+    free_chunks(r);
+    munmap((void *)r->map, r->size);
+    r->map = NULL;
+    return rc;
+}
+
+static uint64_t run_lost(const run_t *r) {
+    return r->sent - r->received;
+}
+
+static double run_loss_pct(const run_t *r) {
+    return r->sent ? (double)run_lost(r) / (double)r->sent * 100.0 : 0.0;
+}
+
+static uint64_t run_avg(const run_t *r) {
+    return r->received ? r->sum / r->received : 0;
+}
+
+/* ---------------- saída em texto ---------------- */
+
+static void print_run_text(const run_t *r, int index, FILE *out) {
+    fprintf(out, "[%d] %s\n", index + 1, r->path);
+    fprintf(out, "  linhas=%llu enviados=%llu recebidos=%llu perdidos=%llu perda=%.2f%%\n",
+            (unsigned long long)r->rows, (unsigned long long)r->sent,
+            (unsigned long long)r->received, (unsigned long long)run_lost(r), run_loss_pct(r));
+    if (r->received) {
+        fprintf(out, "  Latência (us): min=%.1f média=%.1f", r->min / 1e3, run_avg(r) / 1e3);
+        for (int q = 0; q < N_QUANTILES; q++) {
+            fprintf(out, " %s=%.1f", quantiles[q].name, r->q[q] / 1e3);
+        }
+        fprintf(out, " max=%.1f\n", r->max / 1e3);
+    }
+    if (r->bad) {
+        fprintf(out, "  linhas malformadas ignoradas: %llu\n", (unsigned long long)r->bad);
+    }
+    fprintf(out, "  análise: leitura %.0f ms, percentis %.0f ms, %d thread(s)\n",
+            r->parse_ms, r->select_ms, r->n_chunks);
+    if (!r->series) return;
+    fprintf(out, "  Série (intervalo de %.3f ms; percentis pelo histograma, erro <= 12,5%%):\n",
+            r->interval_ns / 1e6);
+    fprintf(out, "  %10s %10s %10s %7s %9s %9s %9s\n",
+            "t(s)", "enviados", "recebidos", "perda%", "p50(us)", "p99(us)", "max(us)");
+    for (uint32_t k = 0; k < r->n_series; k++) {
+        const flow_stat_t *f = &r->series[k];
+        if (!f->sent) continue;
+        fprintf(out, "  %10.3f %10u %10u %7.2f %9.1f %9.1f %9.1f\n",
+                (double)k * r->interval_ns / 1e9, f->sent, f->received,
+                (double)(f->sent - f->received) / f->sent * 100.0,
+                flow_stats_percentile(f, 0.50) / 1e3, flow_stats_percentile(f, 0.99) / 1e3,
+                f->samples ? f->max_ns / 1e3 : 0.0);
+    }
+}
+
+static void print_delta_row(const char *name, double base, double cur, FILE *out) {
+    fprintf(out, "  %-10s %12.2f %12.2f %+12.2f", name, base, cur, cur - base);
+    if (base != 0.0) {
+        fprintf(out, " %+9.2f%%\n", (cur - base) / base * 100.0);
+    } else {
+        fprintf(out, " %10s\n", "-");
+    }
+}
+
+static void print_compare_text(const run_t *base, const run_t *r, int index, FILE *out) {
+    fprintf(out, "Comparação [%d] x [1] (latências em us):\n", index + 1);
+    fprintf(out, "  %-10s %12s %12s %12s %10s\n", "métrica", "[1]", "atual", "delta", "delta%");
+    print_delta_row("perda%", run_loss_pct(base), run_loss_pct(r), out);
+    print_delta_row("média", run_avg(base) / 1e3, run_avg(r) / 1e3, out);
+    for (int q = 0; q < N_QUANTILES; q++) {
+        print_delta_row(quantiles[q].name, base->q[q] / 1e3, r->q[q] / 1e3, out);
+    }
+    print_delta_row("max", base->max / 1e3, r->max / 1e3, out);
+}
+
+/* ---------------- saída em JSON ---------------- */
+
+static void json_string(const char *s, FILE *out) {
+    fputc('"', out);
+    for (; *s; s++) {
+        const unsigned char ch = (unsigned char)*s;
+        if (ch == '"' || ch == '\\') {
+            fprintf(out, "\\%c", ch);
+        } else if (ch < 0x20) {
+            fprintf(out, "\\u%04x", ch);
+        } else {
+            fputc(ch, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void json_latency(const run_t *r, FILE *out) {
+    fprintf(out, "{\"min\": %llu, \"avg\": %llu", (unsigned long long)r->min,
+            (unsigned long long)run_avg(r));
+    for (int q = 0; q < N_QUANTILES; q++) {
+        fprintf(out, ", \"%s\": %llu", quantiles[q].name, (unsigned long long)r->q[q]);
+    }
+    fprintf(out, ", \"max\": %llu}", (unsigned long long)r->max);
+}
+
+static void print_json(const run_t *runs, int n, FILE *out) {
+    fprintf(out, "{\n  \"runs\": [");
+    for (int i = 0; i < n; i++) {
+        const run_t *r = &runs[i];
+        fprintf(out, "%s\n    {\"file\": ", i ? "," : "");
+        json_string(r->path, out);
+        fprintf(out, ", \"rows\": %llu, \"sent\": %llu, \"received\": %llu, \"lost\": %llu, "
+                     "\"loss_pct\": %.6f, \"malformed\": %llu,\n     \"latency_ns\": ",
+                (unsigned long long)r->rows, (unsigned long long)r->sent,
+                (unsigned long long)r->received, (unsigned long long)run_lost(r),
+                run_loss_pct(r), (unsigned long long)r->bad);
+        json_latency(r, out);
+        if (r->series) {
+            fprintf(out, ",\n     \"series\": {\"interval_ns\": %llu, \"points\": [",
+                    (unsigned long long)r->interval_ns);
+            int first = 1;
+            for (uint32_t k = 0; k < r->n_series; k++) {
+                const flow_stat_t *f = &r->series[k];
+                if (!f->sent) continue;
+                fprintf(out, "%s\n       {\"t_ns\": %llu, \"sent\": %u, \"received\": %u, "
+                             "\"loss_pct\": %.6f, \"p50_ns\": %llu, \"p99_ns\": %llu, \"max_ns\": %llu}",
+                        first ? "" : ",", (unsigned long long)k * r->interval_ns, f->sent, f->received,
+                        (double)(f->sent - f->received) / f->sent * 100.0,
+                        (unsigned long long)flow_stats_percentile(f, 0.50),
+                        (unsigned long long)flow_stats_percentile(f, 0.99),
+                        (unsigned long long)(f->samples ? f->max_ns : 0));
+                first = 0;
+            }
+            fprintf(out, "]}");
+        }
+        fprintf(out, "}");
+    }
+    fprintf(out, "\n  ]");
+    if (n > 1) {
+        fprintf(out, ",\n  \"comparison\": [");
+        for (int i = 1; i < n; i++) {
+            const run_t *b = &runs[0], *r = &runs[i];
+            fprintf(out, "%s\n    {\"baseline\": 0, \"run\": %d, \"loss_pct_delta\": %.6f, "
+                         "\"latency_ns_delta\": {\"avg\": %lld",
+                    i > 1 ? "," : "", i, run_loss_pct(r) - run_loss_pct(b),
+                    (long long)run_avg(r) - (long long)run_avg(b));
+            for (int q = 0; q < N_QUANTILES; q++) {
+                fprintf(out, ", \"%s\": %lld", quantiles[q].name, (long long)r->q[q] - (long long)b->q[q]);
+            }
+            fprintf(out, ", \"max\": %lld}}", (long long)r->max - (long long)b->max);
+        }
+        fprintf(out, "\n  ]");
+    }
+    fprintf(out, "\n}\n");
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [opções] <latency.csv> [<latency.csv> ...]\n", prog);
+    printf("  -j <n>           Threads de análise (default: CPUs online, máx. %d)\n", MAX_THREADS);
+    printf("  -i <ms>          Série temporal da latência e da perda em intervalos de ms (default: desligada)\n");
+    printf("  --json           Saída em JSON em vez de texto\n");
+    printf("  -o <file>        Grava a saída no arquivo em vez da saída padrão\n");
+    printf("  -h               Exibe esta ajuda e sai\n");
+    printf("Lê os CSVs ID,send_timestamp,recv_timestamp gravados em latencies/ (mmap, fatias\n");
+    printf("em paralelo) e calcula perda e percentis exatos. Com mais de um arquivo, compara\n");
+    printf("cada execução com a primeira.\n");
+}
+
+enum {
+    OPT_JSON = 256
+};
+
+static const struct option long_options[] = {
+    { "threads",  required_argument, NULL, 'j' },
+    { "interval", required_argument, NULL, 'i' },
+    { "json",     no_argument,       NULL, OPT_JSON },
+    { "output",   required_argument, NULL, 'o' },
+    { "help",     no_argument,       NULL, 'h' },
+    { NULL, 0, NULL, 0 }
+};
+
+int main(int argc, char *argv[]) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > MAX_THREADS ? MAX_THREADS : cpus > 0 ? (int)cpus : 1;
+    double interval_ms = 0.0;
+    int json = 0;
+    const char *output = NULL;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "j:i:o:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'j': threads = atoi(optarg); break;
+            case 'i': interval_ms = strtod(optarg, NULL); break;
+            case 'o': output = optarg; break;
+            case OPT_JSON: json = 1; break;
+            case 'h':
+            default:
+                print_usage(argv[0]);
+                return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "Erro: informe ao menos um arquivo de resultado.\n");
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (threads < 1 || threads > MAX_THREADS || interval_ms < 0.0) {
+        fprintf(stderr, "Erro: -j deve estar em 1..%d e -i >= 0\n", MAX_THREADS);
+        return EXIT_FAILURE;
+    }
+
+    const int n = argc - optind;
+    run_t *runs = calloc((size_t)n, sizeof(run_t));
+    if (!runs) {
+        fprintf(stderr, "Erro: sem memória\n");
+        return EXIT_FAILURE;
+    }
+    int rc = EXIT_SUCCESS;
+    for (int i = 0; i < n && rc == EXIT_SUCCESS; i++) {
+        runs[i].path        = argv[optind + i];
+        runs[i].interval_ns = (uint64_t)(interval_ms * 1e6);
+        if (analyze_run(&runs[i], threads) != 0) rc = EXIT_FAILURE;
+    }
+
+    if (rc == EXIT_SUCCESS) {
+        FILE *out = output ? fopen(output, "w") : stdout;
+        if (!out) {
+            fprintf(stderr, "Erro: não abriu '%s': %s\n", output, strerror(errno));
+            rc = EXIT_FAILURE;
+        } else {
+            if (json) {
+                print_json(runs, n, out);
+            } else {
+                for (int i = 0; i < n; i++) print_run_text(&runs[i], i, out);
+                for (int i = 1; i < n; i++) print_compare_text(&runs[0], &runs[i], i, out);
+            }
+            if (out != stdout && fclose(out) != 0) {
+                perror("netwagon-analyze: fclose");
+                rc = EXIT_FAILURE;
+            }
+        }
+    }
+
+    for (int i = 0; i < n; i++) free(runs[i].series);
+    free(runs);
+    return rc;
+}
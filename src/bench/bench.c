@@ -0,0 +1,636 @@
+// bench.c
+// Microbenchmarks do pipeline de pacotes (netwagon_bench)
+#include <jansson.h>
+#include <pcap.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "../../include/generator/packet.h"
+#include "../../include/generator/pcap_writer.h"
+#include "../../include/generator/proto_icmp.h"
+#include "../../include/generator/proto_tcp.h"
+#include "../../include/generator/proto_udp.h"
+#include "../../include/generator/reader.h"
+#include "../../include/netwagon.h"
+#include "../../include/injector/rx_parse.h"
+#include "../../include/injector/txrx.h"
+
+#define DEFAULT_MIN_TIME_MS 200
+#define DEFAULT_REPEAT      5
+#define MAX_REPEAT          32
+#define BATCH               256     // pacotes por lote nos benchmarks de construção
+
+/* ---- contagem de alocações (malloc/calloc/realloc via --wrap do linker) ---- */
+
+static atomic_uint_fast64_t alloc_count;
+static atomic_uint_fast64_t alloc_bytes;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&alloc_bytes, size, memory_order_relaxed);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&alloc_bytes, n * size, memory_order_relaxed);
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&alloc_bytes, size, memory_order_relaxed);
+    return __real_realloc(ptr, size);
+}
+
+/* jansson aloca pela sua própria interface */
+static void *json_counting_malloc(size_t size) {
+    return __wrap_malloc(size);
+}
+
+/* ---- infraestrutura ---- */
+
+typedef struct bench_case {
+    const char *name;
+    size_t      param;                           // tamanho, família IP, etc.
+    int         (*setup)(struct bench_case *);   // fora da medição
+    void        (*run)(struct bench_case *, uint64_t iters);
+    void        (*teardown)(struct bench_case *);   // também após setup com falha (estado parcial)
+    size_t      bytes_per_op;                    // para MB/s (0 = não se aplica)
+    uint64_t    pkts_per_op;                     // para pacotes/s
+} bench_case_t;
+
+typedef struct {
+    double   ns_per_op;
+    double   allocs_per_op;
+    double   alloc_bytes_per_op;
+    uint64_t iters;
+} bench_sample_t;
+
+static volatile uint64_t sink;  // impede que o compilador descarte resultados
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* ---- dados comuns ---- */
+
+static uint8_t  payload_buf[9000];
+static packet_t *batch[BATCH];
+
+static void fill_payload(void) {
+    for (size_t i = 0; i < sizeof(payload_buf); i++) {
+        payload_buf[i] = (uint8_t)(i * 31 + 7);
+    }
+    memcpy(payload_buf, "1|", 2);
+}
+
+static void free_packet(packet_t *p) {
+    if (!p) return;
+    free(p->data);
+    free(p);
+}
+
+/* ---- calculate_checksum ---- */
+
+static void run_checksum(bench_case_t *bc, uint64_t iters) {
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) {
+        acc += calculate_checksum((uint16_t *)payload_buf, bc->param);
+    }
+    sink += acc;
+}
+
+/* ---- create_*_packet ---- */
+
+#define BUILD_PAYLOAD 64
+
+static packet_t *build_one(int proto, ip_version_t ver) {
+    const char *src = ver == IP_V4 ? "192.168.1.100" : "2001:db8::1";
+    const char *dst = ver == IP_V4 ? "192.168.1.1"   : "2001:db8::2";
+    switch (proto) {
+        case IPPROTO_TCP:
+            return create_tcp_packet(ver, src, dst, 45678, 80, 1000, 0, TCP_SYN,
+                                     payload_buf, BUILD_PAYLOAD);
+        case IPPROTO_UDP:
+            return create_udp_packet(ver, src, dst, 53123, 2000,
+                                     payload_buf, BUILD_PAYLOAD);
+        default:
+            return create_icmp_packet(ver, src, dst, 8, 0, 0, 0,
+                                      payload_buf, BUILD_PAYLOAD);
+    }
+}
+
+/* param: proto * 10 + versão */
+static void run_build(bench_case_t *bc, uint64_t iters) {
+    int proto = (int)(bc->param / 10);
+    ip_version_t ver = (bc->param % 10) == 4 ? IP_V4 : IP_V6;
+    for (uint64_t i = 0; i < iters; i += BATCH) {
+        uint64_t n = iters - i < BATCH ? iters - i : BATCH;
+        for (uint64_t j = 0; j < n; j++) batch[j] = build_one(proto, ver);
+        for (uint64_t j = 0; j < n; j++) free_packet(batch[j]);
+    }
+}
+
+/* ---- libnetwagon: quadros em buffer do chamador ---- */
+
+#define FRAME_STRIDE 2048
+
+static uint8_t       frame_buf[BATCH * FRAME_STRIDE];
+static nw_flow_t     bench_flow;
+static nw_compiled_t compiled;
+
+static int setup_flow(bench_case_t *bc) {
+    int proto = (int)(bc->param / 10);
+    ip_version_t ver = (bc->param % 10) == 4 ? IP_V4 : IP_V6;
+    if (nw_flow_init(&bench_flow, ver, proto,
+                     ver == IP_V4 ? "192.168.1.100" : "2001:db8::1",
+                     ver == IP_V4 ? "192.168.1.1"   : "2001:db8::2") != 0) {
+        return -1;
+    }
+    bench_flow.src_port = 53123;
+    bench_flow.dst_port = 2000;
+    return 0;
+}
+
+static void run_nw_build(bench_case_t *bc, uint64_t iters) {
+    (void)bc;
+    for (uint64_t i = 0; i < iters; i++) {
+        uint8_t *frame = frame_buf + (i % BATCH) * FRAME_STRIDE;
+        sink += (uint64_t)nw_build(&bench_flow, payload_buf, BUILD_PAYLOAD, frame, FRAME_STRIDE);
+    }
+}
+
+/* template UDP/IPv4 compilado para quadros de 64 bytes */
+static int setup_compiled(bench_case_t *bc) {
+    (void)bc;
+    static char pl[] = "bench";
+    static uint8_t model[FRAME_STRIDE];
+    packet_template_t t;
+    memset(&t, 0, sizeof(t));
+    t.ip_version   = IP_V4;
+    t.transport    = IPPROTO_UDP;
+    t.src_port     = 53123;
+    t.dst_port     = 2000;
+    t.payload      = pl;
+    t.payload_size = sizeof(pl) - 1;
+    strcpy(t.src_ip, "192.168.1.100");
+    strcpy(t.dst_ip, "192.168.1.1");
+    return nw_template_compile(&t, 64, model, sizeof(model), &compiled);
+}
+
+static void run_stamp_batch(bench_case_t *bc, uint64_t iters) {
+    for (uint64_t i = 0; i < iters; i += bc->param) {
+        uint64_t n = iters - i < bc->param ? iters - i : bc->param;
+        sink += nw_template_stamp_batch(&compiled, frame_buf, FRAME_STRIDE, (uint32_t)i + 1, n);
+    }
+}
+
+/* quadro com tag de sonda carimbado no envio (seq + tx_ns) */
+static int    probe_len;
+static size_t probe_off;
+
+static int setup_probe(bench_case_t *bc) {
+    if (setup_flow(bc) != 0) return -1;
+    uint8_t pl[NW_PROBE_TAG_SIZE + BUILD_PAYLOAD];
+    nw_probe_tag_init(pl, 0);
+    memcpy(pl + NW_PROBE_TAG_SIZE, payload_buf, BUILD_PAYLOAD);
+    probe_off = nw_header_size(&bench_flow);
+    probe_len = nw_build(&bench_flow, pl, sizeof(pl), frame_buf, FRAME_STRIDE);
+    return probe_len > 0 ? 0 : -1;
+}
+
+static void run_probe_stamp(bench_case_t *bc, uint64_t iters) {
+    (void)bc;
+    for (uint64_t i = 0; i < iters; i++) {
+        sink += (uint64_t)nw_probe_stamp(frame_buf, (size_t)probe_len, probe_off,
+                                         (uint32_t)i, now_ns());
+    }
+}
+
+/* caminho do refletor: troca de endereços e portas + permanência após o tag */
+static void run_reflect(bench_case_t *bc, uint64_t iters) {
+    (void)bc;
+    for (uint64_t i = 0; i < iters; i++) {
+        sink += (uint64_t)nw_reflect(frame_buf, (size_t)probe_len);
+        sink += (uint64_t)nw_probe_stamp_dwell(frame_buf, (size_t)probe_len, probe_off, i);
+    }
+}
+
+/* datagrama UDP/IPv4 jumbo fragmentado para MTU 1500 */
+#define FRAG_DGRAM  9000
+#define FRAG_MTU    1500
+
+static uint8_t frag_dgram[FRAG_DGRAM];
+static size_t  frag_lens[FRAG_DGRAM / 8];
+
+static int setup_fragment(bench_case_t *bc) {
+    if (setup_flow(bc) != 0) return -1;
+    bench_flow.ethernet = 0;
+    static uint8_t pl[FRAG_DGRAM];
+    const size_t hdr = nw_header_size(&bench_flow);
+    if (nw_build(&bench_flow, pl, FRAG_DGRAM - hdr, frag_dgram, sizeof(frag_dgram)) < 0) return -1;
+    bc->pkts_per_op = nw_fragment_count(frag_dgram, FRAG_DGRAM, FRAG_MTU);
+    return bc->pkts_per_op ? 0 : -1;
+}
+
+static void run_fragment(bench_case_t *bc, uint64_t iters) {
+    (void)bc;
+    for (uint64_t i = 0; i < iters; i++) {
+        sink += nw_fragment(frag_dgram, FRAG_DGRAM, FRAG_MTU, (uint32_t)i,
+                            frame_buf, FRAME_STRIDE, frag_lens);
+    }
+}
+
+/* ---- add_ethernet_header ---- */
+
+static void run_ethernet(bench_case_t *bc, uint64_t iters) {
+    (void)bc;
+    for (uint64_t i = 0; i < iters; i++) {
+        packet_t *p = batch[i % BATCH];
+        add_ethernet_header(p);
+        // remove o cabeçalho sem realocar, para medir sempre o mesmo tamanho
+        p->length -= 14;
+        memmove(p->data, (uint8_t *)p->data + 14, p->length);
+    }
+}
+
+static int setup_ethernet(bench_case_t *bc) {
+    (void)bc;
+    for (int i = 0; i < BATCH; i++) {
+        batch[i] = build_one(IPPROTO_UDP, IP_V4);
+        if (!batch[i]) return -1;
+    }
+    return 0;
+}
+
+static void teardown_batch(bench_case_t *bc) {
+    (void)bc;
+    for (int i = 0; i < BATCH; i++) {
+        free_packet(batch[i]);
+        batch[i] = NULL;
+    }
+}
+
+/* ---- load_templates_from_json ---- */
+
+static char json_path[64];
+
+/* param: número de templates (10 pacotes cada) */
+static int setup_json(bench_case_t *bc) {
+    snprintf(json_path, sizeof(json_path), "/tmp/netwagon_bench_%d.json", (int)getpid());
+    FILE *f = fopen(json_path, "w");
+    if (!f) return -1;
+    static const char *kinds[] = { "tcp", "udp", "icmp" };
+    fputs("[\n", f);
+    for (size_t i = 0; i < bc->param; i++) {
+        int v6 = (i % 4) == 3;
+        fprintf(f,
+                "  {\"protocol_family\": \"%s\", \"transport_protocol\": \"%s\", "
+                "\"src_ip\": \"%s\", \"dst_ip\": \"%s\", \"src_port\": %zu, \"dst_port\": 80, "
+                "\"tcp_seq\": 1000, \"tcp_ack_seq\": 0, \"tcp_flags\": 2, "
+                "\"icmp_type\": %d, \"icmp_code\": 0, "
+                "\"payload\": \"NetWagon benchmark payload %zu\", \"packet_count\": 10}%s\n",
+                v6 ? "ipv6" : "ipv4", kinds[i % 3],
+                v6 ? "2001:db8::1" : "10.0.0.1", v6 ? "2001:db8::2" : "10.0.0.2",
+                1024 + i % 60000, v6 ? 128 : 8, i,
+                i + 1 < bc->param ? "," : "");
+    }
+    fputs("]\n", f);
+    fclose(f);
+    return 0;
+}
+
+static void run_json(bench_case_t *bc, uint64_t iters) {
+    (void)bc;
+    for (uint64_t i = 0; i < iters; i++) {
+        packet_list_t *list = create_packet_list();
+        load_templates_from_json(json_path, list);
+        sink += (uint64_t)list->count;
+        free_packet_list(list);
+    }
+}
+
+static void teardown_json(bench_case_t *bc) {
+    (void)bc;
+    if (json_path[0]) unlink(json_path);
+    json_path[0] = '\0';
+}
+
+/* ---- write_packet_list_to_pcap e parse/correlação RX ---- */
+
+static packet_list_t *canned;
+static uint64_t     *canned_recv;
+
+/* lista com proporção TCP/UDP/ICMP e IPv4/IPv6 parecida com template.json */
+static int setup_canned(bench_case_t *bc) {
+    canned = create_packet_list();
+    if (!canned) return -1;
+    static const int protos[] = { IPPROTO_TCP, IPPROTO_UDP, IPPROTO_ICMP };
+    for (size_t i = 0; i < bc->param; i++) {
+        char pl[32];
+        int len = snprintf(pl, sizeof(pl), "%zu|bench", i + 1);
+        ip_version_t ver = (i % 4) == 3 ? IP_V6 : IP_V4;
+        const char *src = ver == IP_V4 ? "10.0.0.1" : "2001:db8::1";
+        const char *dst = ver == IP_V4 ? "10.0.0.2" : "2001:db8::2";
+        packet_t *p;
+        switch (protos[i % 3]) {
+            case IPPROTO_TCP:
+                p = create_tcp_packet(ver, src, dst, 1024, 80, 1, 0, TCP_ACK, pl, (size_t)len);
+                break;
+            case IPPROTO_UDP:
+                p = create_udp_packet(ver, src, dst, 1024, 2000, pl, (size_t)len);
+                break;
+            default:
+                p = create_icmp_packet(ver, src, dst, ver == IP_V4 ? 8 : 128, 0, 0, 0, pl, (size_t)len);
+                break;
+        }
+        if (!p) return -1;
+        p->id = (uint32_t)(i + 1);
+        add_packet_to_list(canned, p);
+    }
+    canned_recv = calloc(bc->param, sizeof(uint64_t));
+    return canned_recv ? 0 : -1;
+}
+
+static void teardown_canned(bench_case_t *bc) {
+    (void)bc;
+    free_packet_list(canned);
+    free(canned_recv);
+    canned = NULL;
+    canned_recv = NULL;
+}
+
+static void run_pcap_write(bench_case_t *bc, uint64_t iters) {
+    (void)bc;
+    pcap_dumper_t *d = open_pcap_file("/dev/null", 65535, DLT_EN10MB);
+    if (!d) return;
+    for (uint64_t i = 0; i < iters; i++) {
+        sink += (uint64_t)write_packet_list_to_pcap(d, canned);
+    }
+    close_pcap_file(d);
+}
+
+static void run_rx_parse(bench_case_t *bc, uint64_t iters) {
+    rx_correlator_t corr = {
+        .recv_timestamp = canned_recv,
+        .total_pkts     = (uint32_t)bc->param,
+        .received       = 0
+    };
+    for (uint64_t i = 0; i < iters; i++) {
+        memset(canned_recv, 0, bc->param * sizeof(uint64_t));
+        corr.received = 0;
+        for (packet_t *p = canned->head; p; p = p->next) {
+            rx_frame_info_t info;
+            if (rx_parse_frame(p->data, p->length, &info) == 0) {
+                rx_correlate(&corr, info.id, i + 1);
+            }
+        }
+        sink += corr.received;
+    }
+}
+
+/* atribuição por fluxo no RX: 12 fluxos (protocolo x família) */
+static flow_stats_t *bench_flows;
+
+static int setup_flow_stats(bench_case_t *bc) {
+    if (setup_canned(bc) != 0) return -1;
+    uint16_t i = 0;
+    for (packet_t *p = canned->head; p; p = p->next) {
+        p->tmpl = i++ % 12;
+    }
+    bench_flows = flow_stats_create(canned, (uint32_t)bc->param);
+    return bench_flows ? 0 : -1;
+}
+
+static void run_flow_stats(bench_case_t *bc, uint64_t iters) {
+    for (uint64_t i = 0; i < iters; i++) {
+        for (uint32_t id = 1; id <= bc->param; id++) {
+            flow_stats_record(bench_flows, id, 1000, 1000 + ((i * 7919 + id * 104729) & 0xFFFFF), 0);
+        }
+    }
+    sink += bench_flows->flows[0].samples;
+}
+
+static void teardown_flow_stats(bench_case_t *bc) {
+    flow_stats_free(bench_flows);
+    bench_flows = NULL;
+    teardown_canned(bc);
+}
+
+/* leitura do relógio do caminho quente (param = CLOCK_SOURCE_*) */
+static clock_src_t bench_clock;
+
+static int setup_clock(bench_case_t *bc) {
+    clock_src_init(&bench_clock, (int)bc->param);   // sem TSC: avisa e mede CLOCK_MONOTONIC
+    return 0;
+}
+
+static void run_clock_now(bench_case_t *bc, uint64_t iters) {
+    (void)bc;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < iters; i++) {
+        acc += clock_src_now(&bench_clock);
+    }
+    sink += acc;
+}
+
+/* TX -> anel em memória -> RX completo, sem interface de rede */
+static void run_txrx_mem(bench_case_t *bc, uint64_t iters) {
+    txrx_opts_t opts;
+    memset(&opts, 0, sizeof(opts));
+    rt_opts_init(&opts.rt);
+    opts.rate_pps   = TXRX_RATE_UNLIMITED;
+    opts.timeout_ms = 1000;
+    opts.quiet      = 1;
+    for (uint64_t i = 0; i < iters; i++) {
+        txrx_result_t res;
+        if (txrx_run_ex(canned, "mem:bench", "mem:bench", &opts, &res) == 0) {
+            sink += res.received;
+            if (res.received != bc->param) {
+                fprintf(stderr, "txrx_mem_e2e: recebidos %u de %zu\n", res.received, bc->param);
+            }
+        }
+    }
+}
+
+/* ---- tabela de benchmarks ---- */
+
+#define CANNED_PKTS 1024
+
+static bench_case_t cases[] = {
+    { "checksum/20",      20,   NULL, run_checksum, NULL, 20,   0 },
+    { "checksum/64",      64,   NULL, run_checksum, NULL, 64,   0 },
+    { "checksum/512",     512,  NULL, run_checksum, NULL, 512,  0 },
+    { "checksum/1500",    1500, NULL, run_checksum, NULL, 1500, 0 },
+    { "checksum/9000",    9000, NULL, run_checksum, NULL, 9000, 0 },
+    { "create_tcp_packet/ipv4",  IPPROTO_TCP * 10 + 4,  NULL, run_build, NULL, 0, 1 },
+    { "create_tcp_packet/ipv6",  IPPROTO_TCP * 10 + 6,  NULL, run_build, NULL, 0, 1 },
+    { "create_udp_packet/ipv4",  IPPROTO_UDP * 10 + 4,  NULL, run_build, NULL, 0, 1 },
+    { "create_udp_packet/ipv6",  IPPROTO_UDP * 10 + 6,  NULL, run_build, NULL, 0, 1 },
+    { "create_icmp_packet/ipv4", IPPROTO_ICMP * 10 + 4, NULL, run_build, NULL, 0, 1 },
+    { "create_icmp_packet/ipv6", IPPROTO_ICMP * 10 + 6, NULL, run_build, NULL, 0, 1 },
+    { "nw_build/udp_ipv4",       IPPROTO_UDP * 10 + 4, setup_flow, run_nw_build, NULL, 0, 1 },
+    { "nw_build/tcp_ipv6",       IPPROTO_TCP * 10 + 6, setup_flow, run_nw_build, NULL, 0, 1 },
+    { "nw_template_stamp_batch/256", BATCH, setup_compiled, run_stamp_batch, NULL, 0, 1 },
+    { "nw_probe_stamp/udp_ipv4",     IPPROTO_UDP * 10 + 4, setup_probe, run_probe_stamp, NULL, 0, 1 },
+    { "nw_reflect_dwell/udp_ipv4",   IPPROTO_UDP * 10 + 4, setup_probe, run_reflect, NULL, 0, 1 },
+    { "nw_fragment/udp_ipv4_9000",   IPPROTO_UDP * 10 + 4, setup_fragment, run_fragment, NULL, FRAG_DGRAM, 1 },
+    { "add_ethernet_header",     0, setup_ethernet, run_ethernet, teardown_batch, 0, 1 },
+    { "load_templates_from_json/1000x10", 1000, setup_json, run_json, teardown_json, 0, 10000 },
+    { "write_packet_list_to_pcap/1024", CANNED_PKTS, setup_canned, run_pcap_write, teardown_canned, 0, CANNED_PKTS },
+    { "rx_parse_correlate/1024", CANNED_PKTS, setup_canned, run_rx_parse, teardown_canned, 0, CANNED_PKTS },
+    { "flow_stats_record/1024", CANNED_PKTS, setup_flow_stats, run_flow_stats, teardown_flow_stats, 0, CANNED_PKTS },
+    { "clock_src_now/monotonic", CLOCK_SOURCE_MONOTONIC, setup_clock, run_clock_now, NULL, 0, 1 },
+    { "clock_src_now/tsc",       CLOCK_SOURCE_TSC,       setup_clock, run_clock_now, NULL, 0, 1 },
+    { "txrx_mem_e2e/1024", CANNED_PKTS, setup_canned, run_txrx_mem, teardown_canned, 0, CANNED_PKTS },
+};
+
+/* Executa iters operações e mede tempo e alocações */
+static bench_sample_t measure(bench_case_t *bc, uint64_t iters) {
+    bench_sample_t s;
+    uint64_t a0 = atomic_load(&alloc_count);
+    uint64_t b0 = atomic_load(&alloc_bytes);
+    uint64_t t0 = now_ns();
+    bc->run(bc, iters);
+    uint64_t t1 = now_ns();
+    s.iters              = iters;
+    s.ns_per_op          = (double)(t1 - t0) / (double)iters;
+    s.allocs_per_op      = (double)(atomic_load(&alloc_count) - a0) / (double)iters;
+    s.alloc_bytes_per_op = (double)(atomic_load(&alloc_bytes) - b0) / (double)iters;
+    return s;
+}
+
+/* Dobra as iterações até a execução durar pelo menos min_time_ns */
+static uint64_t calibrate(bench_case_t *bc, uint64_t min_time_ns) {
+    uint64_t iters = 1;
+    for (;;) {
+        uint64_t t0 = now_ns();
+        bc->run(bc, iters);
+        uint64_t elapsed = now_ns() - t0;
+        if (elapsed >= min_time_ns || iters >= (1ULL << 40)) break;
+        if (elapsed < min_time_ns / 100) iters *= 10;
+        else iters = (uint64_t)((double)iters * 1.2 * (double)min_time_ns / (double)(elapsed + 1)) + 1;
+    }
+    return iters;
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [opções]\n", prog);
+    printf("  -f, --filter <texto>   Executa apenas benchmarks cujo nome contém o texto\n");
+    printf("  -t, --min-time <ms>    Duração mínima de cada repetição (default=%d)\n", DEFAULT_MIN_TIME_MS);
+    printf("  -n, --repeat <n>       Repetições; reporta a mediana (default=%d)\n", DEFAULT_REPEAT);
+    printf("  -j, --json             Saída em JSON lines (uma linha por benchmark)\n");
+    printf("  -l, --list             Lista os benchmarks e sai\n");
+    printf("  -h, --help             Exibe esta ajuda e sai\n");
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "filter",   required_argument, NULL, 'f' },
+        { "min-time", required_argument, NULL, 't' },
+        { "repeat",   required_argument, NULL, 'n' },
+        { "json",     no_argument,       NULL, 'j' },
+        { "list",     no_argument,       NULL, 'l' },
+        { "help",     no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    const char *filter = NULL;
+    uint64_t min_time_ns = DEFAULT_MIN_TIME_MS * 1000000ULL;
+    int repeat = DEFAULT_REPEAT;
+    int json = 0, list_only = 0;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "f:t:n:jlh", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'f': filter = optarg; break;
+            case 't': min_time_ns = strtoull(optarg, NULL, 10) * 1000000ULL; break;
+            case 'n': repeat = atoi(optarg);
+                      if (repeat < 1) repeat = 1;
+                      if (repeat > MAX_REPEAT) repeat = MAX_REPEAT;
+                      break;
+            case 'j': json = 1; break;
+            case 'l': list_only = 1; break;
+            case 'h':
+            default:
+                print_usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    const size_t n_cases = sizeof(cases) / sizeof(cases[0]);
+    if (list_only) {
+        for (size_t i = 0; i < n_cases; i++) printf("%s\n", cases[i].name);
+        return EXIT_SUCCESS;
+    }
+
+    // execuções repetíveis: mesma semente para os IDs IP aleatórios dos builders
+    srand(1);
+    json_set_alloc_funcs(json_counting_malloc, free);
+    fill_payload();
+
+    if (!json) {
+        printf("%-36s %12s %14s %12s %10s %12s\n",
+               "benchmark", "ns/op", "pacotes/s", "MB/s", "allocs/op", "bytes/op");
+    }
+
+    int failures = 0;
+    for (size_t i = 0; i < n_cases; i++) {
+        bench_case_t *bc = &cases[i];
+        if (filter && !strstr(bc->name, filter)) continue;
+
+        if (bc->setup && bc->setup(bc) != 0) {
+            fprintf(stderr, "%s: falha no setup\n", bc->name);
+            // libera o que o setup chegou a alocar antes de falhar
+            if (bc->teardown) bc->teardown(bc);
+            failures++;
+            continue;
+        }
+
+        uint64_t iters = calibrate(bc, min_time_ns);
+        double ns[MAX_REPEAT];
+        bench_sample_t s = { 0 };
+        for (int r = 0; r < repeat; r++) {
+            s = measure(bc, iters);
+            ns[r] = s.ns_per_op;
+        }
+        qsort(ns, (size_t)repeat, sizeof(double), cmp_double);
+        double median = ns[repeat / 2];
+        double pps    = bc->pkts_per_op ? (double)bc->pkts_per_op * 1e9 / median : 0.0;
+        double mbps   = bc->bytes_per_op ? (double)bc->bytes_per_op * 1e3 / median : 0.0;
+
+        if (json) {
+            printf("{\"name\":\"%s\",\"iterations\":%llu,\"repeat\":%d,"
+                   "\"ns_per_op\":%.3f,\"ns_per_op_min\":%.3f,\"ns_per_op_max\":%.3f,"
+                   "\"packets_per_sec\":%.1f,\"mb_per_sec\":%.1f,"
+                   "\"allocs_per_op\":%.3f,\"alloc_bytes_per_op\":%.1f}\n",
+                   bc->name, (unsigned long long)iters, repeat,
+                   median, ns[0], ns[repeat - 1], pps, mbps,
+                   s.allocs_per_op, s.alloc_bytes_per_op);
+        } else {
+            printf("%-36s %12.1f %14.0f %12.1f %10.2f %12.1f\n",
+                   bc->name, median, pps, mbps, s.allocs_per_op, s.alloc_bytes_per_op);
+        }
+        fflush(stdout);
+
+        if (bc->teardown) bc->teardown(bc);
+    }
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+#include "../../include/generator/arrival.h"
+#include <math.h>
+#include <string.h>
+
+/* xorshift64*: uniforme em (0, 1] */
+static double arrival_rand(arrival_t *a) {
+    a->rng ^= a->rng >> 12;
+    a->rng ^= a->rng << 25;
+    a->rng ^= a->rng >> 27;
+    return (double)(((a->rng * 0x2545F4914F6CDD1DULL) >> 11) + 1) / 9007199254740992.0;
+}
+
+/* duração de um período com média mean_ns */
+static double draw_period(arrival_t *a, arrival_dist_t dist, double mean_ns) {
+    switch (dist) {
+        case ARRIVAL_DIST_EXPONENTIAL:
+            return -mean_ns * log(arrival_rand(a));
+        case ARRIVAL_DIST_PARETO: {
+            // x_m escolhido para que a média seja mean_ns
+            const double shape = a->cfg.pareto_shape;
+            return mean_ns * (shape - 1.0) / shape / pow(arrival_rand(a), 1.0 / shape);
+        }
+        default:
+            return mean_ns;
+    }
+}
+
+static double next_gap(arrival_t *a) {
+    switch (a->cfg.model) {
+        case ARRIVAL_POISSON:
+            return -a->gap_ns * log(arrival_rand(a));
+        case ARRIVAL_ONOFF: {
+            // cabe mais uma rodada no período ON; senão, resto do ON + OFF e novo ON
+            if (a->on_left_ns >= a->gap_ns) {
+                a->on_left_ns -= a->gap_ns;
+                return a->gap_ns;
+            }
+            const double gap = a->on_left_ns + draw_period(a, a->cfg.off_dist, (double)a->cfg.off_ns);
+            a->on_left_ns = draw_period(a, a->cfg.on_dist, (double)a->cfg.on_ns);
+            return gap;
+        }
+        case ARRIVAL_MICROBURST:
+            // train rodadas a line_gap_ns; o silêncio completa o período train * gap_ns
+            if (++a->in_train < a->cfg.train) return (double)a->line_gap_ns;
+            a->in_train = 0;
+            return a->gap_ns * a->cfg.train - (double)a->line_gap_ns * (a->cfg.train - 1);
+        default:
+            return a->gap_ns;
+    }
+}
+
+void arrival_init(arrival_t *a, const arrival_cfg_t *cfg, double gap_ns, uint64_t wire_bytes) {
+    memset(a, 0, sizeof(*a));
+    a->cfg    = *cfg;
+    a->gap_ns = gap_ns;
+    // splitmix64 da semente: sementes pequenas (1, 2, ...) dariam primeiros sorteios viciados
+    uint64_t z = cfg->seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    a->rng    = (z ^ (z >> 31)) | 1;
+    if (cfg->model == ARRIVAL_ONOFF) {
+        a->on_left_ns = draw_period(a, cfg->on_dist, (double)cfg->on_ns);
+    }
+    if (cfg->model == ARRIVAL_MICROBURST) {
+        a->line_gap_ns = cfg->line_mbps ? wire_bytes * 8000 / cfg->line_mbps : 0;
+        if (!a->line_gap_ns) a->line_gap_ns = 1;
+        // taxa de linha abaixo da média pedida: o trem vira fluxo constante
+        if ((double)a->line_gap_ns > gap_ns) a->line_gap_ns = (uint64_t)gap_ns;
+    }
+}
+
+void arrival_refill(arrival_t *a) {
+    // a parte fracionária passa para o intervalo seguinte: a média não deriva
+    for (uint32_t i = 0; i < ARRIVAL_BATCH; i++) {
+        const double g = next_gap(a) + a->carry_ns;
+        a->gap[i] = (uint64_t)g;
+        a->carry_ns = g - (double)a->gap[i];
+    }
+    a->pos = 0;
+    a->n   = ARRIVAL_BATCH;
+}
+
+uint64_t arrival_min_gap(const arrival_t *a) {
+    if (a->cfg.model == ARRIVAL_MICROBURST) return a->line_gap_ns;
+    return (uint64_t)a->gap_ns;
+}
+
+int arrival_model_parse(const char *name, arrival_model_t *out) {
+    if (!name || strcmp(name, "constant") == 0) *out = ARRIVAL_CONSTANT;
+    else if (strcmp(name, "poisson") == 0) *out = ARRIVAL_POISSON;
+    else if (strcmp(name, "onoff") == 0) *out = ARRIVAL_ONOFF;
+    else if (strcmp(name, "microburst") == 0) *out = ARRIVAL_MICROBURST;
+    else return -1;
+    return 0;
+}
+
+int arrival_dist_parse(const char *name, arrival_dist_t *out) {
+    if (!name || strcmp(name, "constant") == 0) *out = ARRIVAL_DIST_CONSTANT;
+    else if (strcmp(name, "exponential") == 0) *out = ARRIVAL_DIST_EXPONENTIAL;
+    else if (strcmp(name, "pareto") == 0) *out = ARRIVAL_DIST_PARETO;
+    else return -1;
+    return 0;
+}
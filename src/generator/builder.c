@@ -0,0 +1,667 @@
+// builder.c
+// Construção de quadros em buffers do chamador (libnetwagon)
+#include "../../include/netwagon.h"
+#include "../../include/generator/proto_icmp.h"
+#include "../../include/generator/proto_tcp.h"
+#include "../../include/generator/proto_udp.h"
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <linux/virtio_net.h>
+
+#ifndef VIRTIO_NET_HDR_GSO_UDP_L4
+#define VIRTIO_NET_HDR_GSO_UDP_L4 5     // USO, Linux 6.2+
+#endif
+
+static const uint8_t DEFAULT_DST_MAC[6] = { 0xAA,0xBB,0xCC,0xDD,0xEE,0xFF };
+static const uint8_t DEFAULT_SRC_MAC[6] = { 0x11,0x22,0x33,0x44,0x55,0x66 };
+
+/* ---- checksum em ordem de rede, sem buffer temporário ---- */
+
+static uint64_t csum_partial(const uint8_t *p, size_t len, uint64_t sum) {
+    while (len > 1) {
+        sum += (uint32_t)p[0] << 8 | p[1];
+        p += 2;
+        len -= 2;
+    }
+    if (len) sum += (uint32_t)p[0] << 8;
+    return sum;
+}
+
+static uint16_t csum_fold(uint64_t sum) {
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16_t)~sum;
+}
+
+static void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static uint16_t get16(const uint8_t *p) {
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+/* soma do pseudocabeçalho IPv4/IPv6 */
+static uint64_t pseudo_sum(const nw_flow_t *f, uint8_t proto, size_t l4_len) {
+    size_t alen = f->ip_version == IP_V4 ? 4 : 16;
+    uint64_t sum = csum_partial(f->src_addr, alen, 0);
+    sum = csum_partial(f->dst_addr, alen, sum);
+    sum += proto;
+    sum += (uint32_t)l4_len;   // IPv6 usa 32 bits; a soma em 16 bits dá o mesmo resultado
+    return sum;
+}
+
+static size_t ip_header_size(const nw_flow_t *f) {
+    return f->ip_version == IP_V4 ? sizeof(struct ip_header_v4) : sizeof(struct ip_header_v6);
+}
+
+static size_t l4_header_size(const nw_flow_t *f) {
+    switch (f->transport) {
+        case IPPROTO_TCP:  return sizeof(struct tcp_header);
+        case IPPROTO_ICMP: return sizeof(struct icmp_header);
+        default:           return sizeof(struct udp_header);
+    }
+}
+
+static uint8_t wire_proto(const nw_flow_t *f) {
+    switch (f->transport) {
+        case IPPROTO_TCP:  return IP_PROTO_TCP;
+        case IPPROTO_ICMP: return f->ip_version == IP_V4 ? IP_PROTO_ICMP : IP_PROTO_ICMPV6;
+        default:           return IP_PROTO_UDP;
+    }
+}
+
+/* offset do checksum dentro do cabeçalho de transporte */
+static size_t l4_csum_offset(const nw_flow_t *f) {
+    switch (f->transport) {
+        case IPPROTO_TCP:  return 16;
+        case IPPROTO_ICMP: return 2;
+        default:           return 6;
+    }
+}
+
+size_t nw_header_size(const nw_flow_t *f) {
+    return (f->ethernet ? NW_ETH_HEADER_SIZE : 0) + ip_header_size(f) + l4_header_size(f);
+}
+
+int nw_flow_init(nw_flow_t *f, ip_version_t ip_ver, int transport,
+                 const char *src_ip, const char *dst_ip) {
+    memset(f, 0, sizeof(*f));
+    f->ip_version = ip_ver;
+    f->transport  = transport;
+    f->ttl        = 64;
+    f->ethernet   = 1;
+    memcpy(f->dst_mac, DEFAULT_DST_MAC, 6);
+    memcpy(f->src_mac, DEFAULT_SRC_MAC, 6);
+
+    int af = ip_ver == IP_V4 ? AF_INET : AF_INET6;
+    if (!src_ip || !dst_ip ||
+        inet_pton(af, src_ip, f->src_addr) != 1 ||
+        inet_pton(af, dst_ip, f->dst_addr) != 1) {
+        return -1;
+    }
+    return 0;
+}
+
+int nw_flow_from_template(nw_flow_t *f, const packet_template_t *t) {
+    if (nw_flow_init(f, t->ip_version, t->transport, t->src_ip, t->dst_ip) != 0) {
+        return -1;
+    }
+    f->src_port  = t->src_port;
+    f->dst_port  = t->dst_port;
+    f->tcp_seq   = t->tcp_seq;
+    f->tcp_ack   = t->tcp_ack;
+    f->tcp_flags = t->tcp_flags;
+    f->icmp_type = t->icmp_type;
+    f->icmp_code = t->icmp_code;
+    if (t->encap) {
+        memcpy(f->dst_mac, t->encap->hdr, 6);
+        memcpy(f->src_mac, t->encap->hdr + 6, 6);
+    }
+    return 0;
+}
+
+/* Escreve cabeçalhos e checksums; o payload já está em buf + nw_header_size() */
+static size_t finish_frame(const nw_flow_t *f, uint8_t *buf, size_t payload_size) {
+    uint8_t *p = buf;
+    const uint8_t proto = wire_proto(f);
+
+    // 1) Ethernet: DST(6) | SRC(6) | EtherType(2)
+    if (f->ethernet) {
+        memcpy(p, f->dst_mac, 6);
+        memcpy(p + 6, f->src_mac, 6);
+        put16(p + 12, f->ip_version == IP_V4 ? 0x0800 : 0x86DD);
+        p += NW_ETH_HEADER_SIZE;
+    }
+
+    // 2) IP
+    const size_t l4_len = l4_header_size(f) + payload_size;
+    uint8_t *l4 = p + ip_header_size(f);
+    if (f->ip_version == IP_V4) {
+        memset(p, 0, 20);
+        p[0] = (4 << 4) | 5;
+        put16(p + 2, (uint16_t)(20 + l4_len));
+        put16(p + 4, f->ip_id);
+        put16(p + 6, 0x4000);           // DF
+        p[8] = f->ttl;
+        p[9] = proto;
+        memcpy(p + 12, f->src_addr, 4);
+        memcpy(p + 16, f->dst_addr, 4);
+        put16(p + 10, csum_fold(csum_partial(p, 20, 0)));
+    } else {
+        memset(p, 0, 8);
+        p[0] = 6 << 4;
+        put16(p + 4, (uint16_t)l4_len);
+        p[6] = proto;
+        p[7] = f->ttl;
+        memcpy(p + 8, f->src_addr, 16);
+        memcpy(p + 24, f->dst_addr, 16);
+    }
+
+    // 3) Transporte
+    switch (f->transport) {
+        case IPPROTO_TCP:
+            put16(l4 + 0, f->src_port);
+            put16(l4 + 2, f->dst_port);
+            l4[4] = (uint8_t)(f->tcp_seq >> 24); l4[5] = (uint8_t)(f->tcp_seq >> 16);
+            l4[6] = (uint8_t)(f->tcp_seq >> 8);  l4[7] = (uint8_t)f->tcp_seq;
+            l4[8] = (uint8_t)(f->tcp_ack >> 24); l4[9] = (uint8_t)(f->tcp_ack >> 16);
+            l4[10] = (uint8_t)(f->tcp_ack >> 8); l4[11] = (uint8_t)f->tcp_ack;
+            put16(l4 + 12, (uint16_t)((5 << 12) | f->tcp_flags));   // Data offset = 5, flags
+            put16(l4 + 14, 5840);
+            put16(l4 + 16, 0);
+            put16(l4 + 18, 0);
+            break;
+        case IPPROTO_ICMP:
+            l4[0] = f->icmp_type;
+            l4[1] = f->icmp_code;
+            put16(l4 + 2, 0);
+            put16(l4 + 4, f->icmp_id);
+            put16(l4 + 6, f->icmp_seq);
+            break;
+        default:
+            put16(l4 + 0, f->src_port);
+            put16(l4 + 2, f->dst_port);
+            put16(l4 + 4, (uint16_t)l4_len);
+            put16(l4 + 6, 0);
+            break;
+    }
+
+    // checksum parcial: só o pseudocabeçalho, sem complemento; o kernel/NIC soma o resto
+    if (f->csum_offload && f->transport != IPPROTO_ICMP) {
+        put16(l4 + l4_csum_offset(f), (uint16_t)~csum_fold(pseudo_sum(f, proto, l4_len)));
+        return (size_t)(l4 - buf) + l4_len;
+    }
+
+    // ICMPv4 não usa pseudocabeçalho
+    uint64_t sum = (f->transport == IPPROTO_ICMP && f->ip_version == IP_V4)
+                       ? 0 : pseudo_sum(f, proto, l4_len);
+    uint16_t csum = csum_fold(csum_partial(l4, l4_len, sum));
+    if (csum == 0 && f->transport == IPPROTO_UDP) csum = 0xFFFF;
+    put16(l4 + l4_csum_offset(f), csum);
+
+    return (size_t)(l4 - buf) + l4_len;
+}
+
+int nw_build(const nw_flow_t *f, const void *payload, size_t payload_size,
+             uint8_t *buf, size_t cap) {
+    const size_t hdr = nw_header_size(f);
+    if (!buf || hdr + payload_size > cap || hdr + payload_size > NW_MAX_FRAME_LEN) return -1;
+    if (payload_size > 0) memmove(buf + hdr, payload, payload_size);
+    return (int)finish_frame(f, buf, payload_size);
+}
+
+size_t nw_build_batch(const nw_flow_t *f,
+                      const void *const *payloads, const size_t *sizes,
+                      uint8_t *buf, size_t stride, size_t *lens, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        int len = nw_build(f, payloads[i], sizes[i], buf + i * stride, stride);
+        if (len < 0) return i;
+        if (lens) lens[i] = (size_t)len;
+    }
+    return n;
+}
+
+packet_t *nw_packet_new(const nw_flow_t *f, const void *payload, size_t payload_size) {
+    packet_t *packet = calloc(1, sizeof(packet_t));
+    if (!packet) return NULL;
+
+    nw_flow_t l3 = *f;
+    l3.ethernet = 0;    // add_packet_to_list() acrescenta o Ethernet
+    const size_t len = nw_header_size(&l3) + payload_size;
+    packet->data = malloc(len);
+    if (!packet->data || nw_build(&l3, payload, payload_size, packet->data, len) < 0) {
+        free(packet->data);
+        free(packet);
+        return NULL;
+    }
+
+    packet->length     = len;
+    packet->ip_version = f->ip_version;
+    switch (f->transport) {
+        case IPPROTO_TCP:  packet->protocol = PROTO_TCP; break;
+        case IPPROTO_ICMP: packet->protocol = f->ip_version == IP_V4 ? PROTO_ICMP : PROTO_ICMPv6; break;
+        default:           packet->protocol = PROTO_UDP; break;
+    }
+    packet->id   = 0;
+    packet->csum_partial = f->csum_offload && f->transport != IPPROTO_ICMP;
+    packet->next = NULL;
+    return packet;
+}
+
+/* ---- fragmentação IP ---- */
+
+/* cabeçalho repetido em cada fragmento e dados por fragmento (múltiplo de 8) */
+static int frag_geometry(const uint8_t *dgram, size_t len, size_t mtu, size_t *hdr, size_t *chunk) {
+    if (len < 20) return -1;
+    switch (dgram[0] >> 4) {
+        case 4:
+            *hdr = (size_t)(dgram[0] & 0x0F) * 4;
+            if (*hdr < 20 || mtu < *hdr + 8) return -1;
+            *chunk = (mtu - *hdr) & ~(size_t)7;
+            break;
+        case 6:
+            *hdr = sizeof(struct ip_header_v6);
+            if (mtu < *hdr + NW_IPV6_FRAG_SIZE + 8) return -1;
+            *chunk = (mtu - *hdr - NW_IPV6_FRAG_SIZE) & ~(size_t)7;
+            break;
+        default:
+            return -1;
+    }
+    return len > *hdr ? 0 : -1;
+}
+
+size_t nw_fragment_count(const uint8_t *dgram, size_t len, size_t mtu) {
+    size_t hdr, chunk;
+    if (frag_geometry(dgram, len, mtu, &hdr, &chunk) != 0) return 0;
+    return (len - hdr + chunk - 1) / chunk;
+}
+
+size_t nw_fragment(const uint8_t *dgram, size_t len, size_t mtu, uint32_t ident,
+                   uint8_t *buf, size_t stride, size_t *lens) {
+    size_t hdr, chunk;
+    if (!buf || stride < mtu || frag_geometry(dgram, len, mtu, &hdr, &chunk) != 0) return 0;
+    const uint8_t *data = dgram + hdr;
+    const size_t dlen = len - hdr;
+
+    size_t n = 0;
+    for (size_t off = 0; off < dlen; off += chunk, n++) {
+        const size_t part = dlen - off < chunk ? dlen - off : chunk;
+        const int more = off + part < dlen;
+        uint8_t *p = buf + n * stride;
+        memcpy(p, dgram, hdr);
+        if (hdr == sizeof(struct ip_header_v6) && (dgram[0] >> 4) == 6) {
+            uint8_t *fh = p + hdr;
+            fh[0] = dgram[6];                       // próximo cabeçalho original
+            fh[1] = 0;
+            put16(fh + 2, (uint16_t)(off | (more ? 1 : 0)));    // offset em unidades de 8 bytes << 3
+            put16(fh + 4, (uint16_t)(ident >> 16));
+            put16(fh + 6, (uint16_t)ident);
+            p[6] = IP_PROTO_FRAGMENT;
+            put16(p + 4, (uint16_t)(NW_IPV6_FRAG_SIZE + part));
+            memcpy(fh + NW_IPV6_FRAG_SIZE, data + off, part);
+            lens[n] = hdr + NW_IPV6_FRAG_SIZE + part;
+        } else {
+            put16(p + 2, (uint16_t)(hdr + part));
+            put16(p + 6, (uint16_t)((more ? 0x2000 : 0) | (off >> 3)));   // MF, sem DF
+            put16(p + 10, 0);
+            put16(p + 10, csum_fold(csum_partial(p, hdr, 0)));
+            memcpy(p + hdr, data + off, part);
+            lens[n] = hdr + part;
+        }
+    }
+    return n;
+}
+
+uint16_t nw_csum_replace32(uint16_t csum, uint32_t old_val, uint32_t new_val) {
+    // RFC 1624: HC' = ~(~HC + ~m + m')
+    uint64_t sum = (uint16_t)~csum;
+    sum += (uint16_t)~(old_val >> 16) + (uint16_t)~(old_val & 0xFFFF);
+    sum += (new_val >> 16) + (new_val & 0xFFFF);
+    return csum_fold(sum);
+}
+
+/* ---- tag de sonda ---- */
+
+static void put32(uint8_t *p, uint32_t v) {
+    put16(p, (uint16_t)(v >> 16));
+    put16(p + 2, (uint16_t)v);
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return (uint32_t)get16(p) << 16 | get16(p + 2);
+}
+
+void nw_probe_tag_init(uint8_t *p, uint32_t seq) {
+    put32(p, NW_PROBE_MAGIC);
+    put32(p + 4, seq);
+    memset(p + 8, 0, 8);
+}
+
+int nw_stack_parse(const uint8_t *frame, size_t len, nw_stack_t *st) {
+    st->n_tunnels = 0;
+    if (len < NW_ETH_HEADER_SIZE) return -1;
+    uint16_t type = get16(frame + 12);
+    size_t off = NW_ETH_HEADER_SIZE;
+    for (;;) {
+        switch (type) {
+            case 0x8100:
+            case 0x88A8:
+            case 0x9100:
+                if (off + 4 > len) return -1;
+                type = get16(frame + off + 2);
+                off += 4;
+                continue;
+            case 0x8847:
+            case 0x8848: {
+                // rótulos até o bit de fim de pilha; o conteúdo é IP, pela versão
+                int bos = 0;
+                while (!bos) {
+                    if (off + 4 > len) return -1;
+                    bos = frame[off + 2] & 0x01;
+                    off += 4;
+                }
+                if (off >= len || ((frame[off] >> 4) != 4 && (frame[off] >> 4) != 6)) return -1;
+                type = (frame[off] >> 4) == 4 ? 0x0800 : 0x86DD;
+                continue;
+            }
+            case 0x0800:
+            case 0x86DD:
+                break;
+            default:
+                return -1;
+        }
+
+        // IP: externo de um túnel GRE/VXLAN ou o interno
+        size_t l4;
+        uint8_t proto;
+        int whole;
+        if (type == 0x0800) {
+            if (off + 20 > len) return -1;
+            l4    = off + (size_t)(frame[off] & 0x0F) * 4;
+            proto = frame[off + 9];
+            whole = !(get16(frame + off + 6) & 0x3FFF);
+        } else {
+            if (off + sizeof(struct ip_header_v6) > len) return -1;
+            l4    = off + sizeof(struct ip_header_v6);
+            proto = frame[off + 6];
+            whole = 1;
+        }
+        size_t eth = 0;
+        size_t inner = 0;
+        if (whole && st->n_tunnels < NW_STACK_MAX_TUNNELS) {
+            if (proto == IP_PROTO_GRE && l4 + 4 <= len && !(get16(frame + l4) & 0x4007)) {
+                // versão 0 sem roteamento: checksum, chave e sequência opcionais
+                const uint16_t flags = get16(frame + l4);
+                inner = l4 + 4 + (flags & 0x8000 ? 4 : 0) + (flags & 0x2000 ? 4 : 0) +
+                        (flags & 0x1000 ? 4 : 0);
+                type = get16(frame + l4 + 2);
+                if (type == 0x6558) eth = inner;    // Ethernet transparente
+            } else if (proto == IP_PROTO_UDP && l4 + 16 + NW_ETH_HEADER_SIZE <= len &&
+                       get16(frame + l4 + 2) == ENCAP_VXLAN_PORT && (frame[l4 + 8] & 0x08) &&
+                       frame[l4 + 15] == 0) {
+                eth = inner = l4 + 16;
+            }
+        }
+        if (!inner) {
+            st->l3_offset = off;
+            st->ethertype = type;
+            return 0;
+        }
+        if (eth) {
+            if (eth + NW_ETH_HEADER_SIZE > len) return -1;
+            type  = get16(frame + eth + 12);
+            inner = eth + NW_ETH_HEADER_SIZE;
+        }
+        st->tunnel_ip[st->n_tunnels] = (uint16_t)off;
+        st->inner_eth[st->n_tunnels] = (uint16_t)eth;
+        st->n_tunnels++;
+        off = inner;
+    }
+}
+
+/*
+ * Localiza o cabeçalho de transporte interno de um quadro Ethernet.
+ * Fragmentos IPv4 e IPv6 só têm transporte no primeiro; nos demais retorna -1.
+ */
+static int l4_locate(const uint8_t *frame, size_t len, nw_stack_t *st, size_t *l4, uint8_t *proto) {
+    if (nw_stack_parse(frame, len, st) != 0) return -1;
+    const uint8_t *ip = frame + st->l3_offset;
+    switch (st->ethertype) {
+        case 0x0800:
+            if (get16(ip + 6) & 0x1FFF) return -1;
+            *l4 = st->l3_offset + (size_t)(ip[0] & 0x0F) * 4;
+            *proto = ip[9];
+            break;
+        default:
+            *l4 = st->l3_offset + sizeof(struct ip_header_v6);
+            *proto = ip[6];
+            if (*proto == IP_PROTO_FRAGMENT) {
+                if (*l4 + NW_IPV6_FRAG_SIZE > len || (get16(frame + *l4 + 2) & 0xFFF8)) return -1;
+                *proto = frame[*l4];
+                *l4 += NW_IPV6_FRAG_SIZE;
+            }
+            break;
+    }
+    return *l4 <= len ? 0 : -1;
+}
+
+/* localiza o checksum de transporte a partir dos cabeçalhos do próprio quadro */
+static int probe_csum_off(const uint8_t *frame, size_t len, size_t tag_off, size_t *csum_out,
+                          uint8_t *proto_out) {
+    if (len < NW_ETH_HEADER_SIZE + 20) return -1;
+    nw_stack_t st;
+    size_t l4;
+    uint8_t proto;
+    if (l4_locate(frame, len, &st, &l4, &proto) != 0) return -1;
+    size_t csum_off;
+    switch (proto) {
+        case IP_PROTO_TCP:    csum_off = l4 + 16; break;
+        case IP_PROTO_UDP:    csum_off = l4 + 6;  break;
+        case IP_PROTO_ICMP:
+        case IP_PROTO_ICMPV6: csum_off = l4 + 2;  break;
+        default:              return -1;
+    }
+    // o tag precisa estar alinhado a 16 bits em relação ao transporte
+    if (csum_off + 2 > tag_off || ((tag_off - l4) & 1)) return -1;
+    *csum_out  = csum_off;
+    *proto_out = proto;
+    return 0;
+}
+
+/* troca n bytes (n par) em frame + off e ajusta o checksum em csum_off (RFC 1624) */
+static void probe_write(uint8_t *frame, size_t off, const uint8_t *val, size_t n,
+                        size_t csum_off, uint8_t proto) {
+    uint8_t *field = frame + off;
+    uint64_t sum = (uint16_t)~get16(frame + csum_off);
+    for (size_t i = 0; i < n; i += 2) {
+        sum += (uint16_t)~get16(field + i);
+    }
+    memcpy(field, val, n);
+    for (size_t i = 0; i < n; i += 2) {
+        sum += get16(field + i);
+    }
+    uint16_t csum = csum_fold(sum);
+    if (csum == 0 && proto == IP_PROTO_UDP) csum = 0xFFFF;
+    put16(frame + csum_off, csum);
+}
+
+int nw_probe_stamp(uint8_t *frame, size_t len, size_t tag_off, uint32_t seq, uint64_t tx_ns) {
+    size_t csum_off;
+    uint8_t proto;
+    if (tag_off + NW_PROBE_TAG_SIZE > len ||
+        probe_csum_off(frame, len, tag_off, &csum_off, &proto) != 0) return -1;
+
+    // só seq e tx_ns mudam (12 bytes); RFC 1624: HC' = ~(~HC + ~m + m')
+    uint8_t val[12];
+    put32(val, seq);
+    put32(val + 4, (uint32_t)(tx_ns >> 32));
+    put32(val + 8, (uint32_t)tx_ns);
+    probe_write(frame, tag_off + 4, val, sizeof(val), csum_off, proto);
+    return 0;
+}
+
+int nw_probe_stamp_partial(uint8_t *frame, size_t len, size_t tag_off, uint32_t seq, uint64_t tx_ns) {
+    if (tag_off + NW_PROBE_TAG_SIZE > len) return -1;
+    put32(frame + tag_off + 4, seq);
+    put32(frame + tag_off + 8, (uint32_t)(tx_ns >> 32));
+    put32(frame + tag_off + 12, (uint32_t)tx_ns);
+    return 0;
+}
+
+int nw_vnet_hdr(const uint8_t *frame, size_t len, int csum_partial, uint16_t gso_size, void *hdr) {
+    struct virtio_net_hdr vh;
+    memset(&vh, 0, sizeof(vh));
+    nw_stack_t st;
+    size_t l4;
+    uint8_t proto;
+    if (csum_partial && len >= NW_ETH_HEADER_SIZE + 20 && l4_locate(frame, len, &st, &l4, &proto) == 0 &&
+        (proto == IP_PROTO_TCP || proto == IP_PROTO_UDP)) {
+        const int v4 = st.ethertype == 0x0800;
+        const size_t l4_hdr = proto == IP_PROTO_TCP ? (size_t)(frame[l4 + 12] >> 4) * 4 : 8;
+        vh.flags       = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+        vh.csum_start  = (uint16_t)l4;
+        vh.csum_offset = proto == IP_PROTO_TCP ? 16 : 6;
+        if (gso_size && len > l4 + l4_hdr + gso_size) {
+            vh.gso_type = proto == IP_PROTO_UDP ? VIRTIO_NET_HDR_GSO_UDP_L4
+                        : v4 ? VIRTIO_NET_HDR_GSO_TCPV4 : VIRTIO_NET_HDR_GSO_TCPV6;
+            vh.gso_size = gso_size;
+            vh.hdr_len  = (uint16_t)(l4 + l4_hdr);
+        }
+    } else if (gso_size) {
+        return -1;
+    }
+    memcpy(hdr, &vh, NW_VNET_HDR_SIZE);
+    return 0;
+}
+
+int nw_probe_stamp_dwell(uint8_t *frame, size_t len, size_t tag_off, uint64_t dwell_ns) {
+    size_t csum_off;
+    uint8_t proto;
+    if (tag_off + NW_PROBE_TAG_SIZE + NW_PROBE_DWELL_SIZE > len ||
+        get32(frame + tag_off) != NW_PROBE_MAGIC ||
+        probe_csum_off(frame, len, tag_off, &csum_off, &proto) != 0) return -1;
+
+    uint8_t val[NW_PROBE_DWELL_SIZE];
+    put32(val, (uint32_t)(dwell_ns >> 32));
+    put32(val + 4, (uint32_t)dwell_ns);
+    probe_write(frame, tag_off + NW_PROBE_TAG_SIZE, val, sizeof(val), csum_off, proto);
+    return 0;
+}
+
+/* troca origem e destino de n bytes cada, lado a lado em p */
+static void swap_pair(uint8_t *p, size_t n) {
+    uint8_t tmp[16];
+    memcpy(tmp, p, n);
+    memcpy(p, p + n, n);
+    memcpy(p + n, tmp, n);
+}
+
+/* endereços de um cabeçalho IPv4/IPv6 */
+static void swap_ip(uint8_t *ip) {
+    if ((ip[0] >> 4) == 4) swap_pair(ip + 12, 4);
+    else swap_pair(ip + 8, 16);
+}
+
+int nw_reflect(uint8_t *frame, size_t len) {
+    nw_stack_t st;
+    if (len < NW_ETH_HEADER_SIZE + 20 || nw_stack_parse(frame, len, &st) != 0) return -1;
+
+    // as trocas só permutam palavras de 16 bits dentro das somas: checksums continuam válidos.
+    // Túneis voltam pelo mesmo caminho: MACs e IPs externos também são trocados
+    swap_pair(frame, 6);
+    for (uint8_t i = 0; i < st.n_tunnels; i++) {
+        swap_ip(frame + st.tunnel_ip[i]);
+        if (st.inner_eth[i]) swap_pair(frame + st.inner_eth[i], 6);
+    }
+    swap_ip(frame + st.l3_offset);
+
+    // portas só no primeiro fragmento
+    size_t l4;
+    uint8_t proto;
+    if (l4_locate(frame, len, &st, &l4, &proto) == 0 && (proto == IP_PROTO_TCP || proto == IP_PROTO_UDP)) {
+        if (l4 + 4 > len) return -1;
+        swap_pair(frame + l4, 2);
+    }
+    return 0;
+}
+
+int nw_probe_read(const uint8_t *payload, size_t len, uint32_t *seq, uint64_t *tx_ns) {
+    if (len < NW_PROBE_TAG_SIZE || get32(payload) != NW_PROBE_MAGIC) return 0;
+    *seq   = get32(payload + 4);
+    *tx_ns = (uint64_t)get32(payload + 8) << 32 | get32(payload + 12);
+    return 1;
+}
+
+/* ---- templates compilados ---- */
+
+int nw_template_compile(const packet_template_t *t, size_t frame_size,
+                        uint8_t *buf, size_t cap, nw_compiled_t *out) {
+    nw_flow_t f;
+    if (!t || !buf || !out || nw_flow_from_template(&f, t) != 0) return -1;
+
+    // com pilha de encapsulamento, o quadro interno começa depois dos cabeçalhos externos
+    const size_t outer = t->encap ? t->encap->len : 0;
+    if (t->encap) f.ethernet = 0;
+
+    // payload: "0000000000|" + payload original, com zeros até o tamanho pedido
+    const size_t hdr = outer + nw_header_size(&f);
+    size_t pl_len = NW_ID_DIGITS + 1 + t->payload_size;
+    if (frame_size > hdr + NW_ETH_FCS_SIZE + pl_len) {
+        pl_len = frame_size - NW_ETH_FCS_SIZE - hdr;
+    }
+    if (hdr + pl_len > cap || hdr + pl_len > NW_MAX_FRAME_LEN) return -1;
+
+    uint8_t *pl = buf + hdr;
+    memset(pl, '0', NW_ID_DIGITS);
+    pl[NW_ID_DIGITS] = '|';
+    if (t->payload_size) memcpy(pl + NW_ID_DIGITS + 1, t->payload, t->payload_size);
+    memset(pl + NW_ID_DIGITS + 1 + t->payload_size, 0,
+           pl_len - NW_ID_DIGITS - 1 - t->payload_size);
+
+    out->frame       = buf;
+    out->len         = outer + finish_frame(&f, buf + outer, pl_len);
+    if (t->encap) encap_write(t->encap, buf, out->len);
+    out->l4_offset   = hdr - l4_header_size(&f);
+    out->csum_offset = out->l4_offset + l4_csum_offset(&f);
+    out->id_offset   = hdr;
+    out->udp         = f.transport == IPPROTO_UDP;
+    return 0;
+}
+
+void nw_template_stamp(const nw_compiled_t *c, uint8_t *frame, uint32_t id) {
+    // janela alinhada a 16 bits em relação ao início do transporte; os bytes
+    // vizinhos entram iguais no valor antigo e no novo
+    const size_t start = c->id_offset - ((c->id_offset - c->l4_offset) & 1);
+    const size_t span  = (c->id_offset + NW_ID_DIGITS - start + 1) & ~(size_t)1;
+    uint8_t old[NW_ID_DIGITS + 2];
+    memcpy(old, frame + start, span);
+
+    uint8_t *field = frame + c->id_offset;
+    for (int i = NW_ID_DIGITS - 1; i >= 0; i--) {
+        field[i] = (uint8_t)('0' + id % 10);
+        id /= 10;
+    }
+
+    // RFC 1624: HC' = ~(~HC + ~m + m')
+    uint64_t sum = (uint16_t)~get16(frame + c->csum_offset);
+    for (size_t i = 0; i < span; i += 2) {
+        sum += (uint16_t)~get16(old + i);
+        sum += get16(frame + start + i);
+    }
+    uint16_t csum = csum_fold(sum);
+    if (csum == 0 && c->udp) csum = 0xFFFF;
+    put16(frame + c->csum_offset, csum);
+}
+
+size_t nw_template_stamp_batch(const nw_compiled_t *c, uint8_t *buf, size_t stride,
+                               uint32_t first_id, size_t n) {
+    if (stride < c->len) return 0;
+    for (size_t i = 0; i < n; i++) {
+        uint8_t *frame = buf + i * stride;
+        memcpy(frame, c->frame, c->len);
+        nw_template_stamp(c, frame, first_id + (uint32_t)i);
+    }
+    return n;
+}
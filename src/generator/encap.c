@@ -0,0 +1,220 @@
+#include "../../include/generator/encap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#define IPV4_HEADER_SIZE  20
+#define IPV6_HEADER_SIZE  40
+#define UDP_HEADER_SIZE   8
+#define VXLAN_HEADER_SIZE 8
+#define ETH_HEADER_SIZE   14
+
+static const uint8_t DEFAULT_DST_MAC[6] = { 0xAA,0xBB,0xCC,0xDD,0xEE,0xFF };
+static const uint8_t DEFAULT_SRC_MAC[6] = { 0x11,0x22,0x33,0x44,0x55,0x66 };
+
+/* o que vem antes da próxima camada: define onde vai o tipo dela */
+enum { CTX_L2, CTX_MPLS, CTX_GRE };
+
+static void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    put16(p, (uint16_t)(v >> 16));
+    put16(p + 2, (uint16_t)v);
+}
+
+int encap_parse_mac(const char *s, uint8_t mac[6]) {
+    unsigned int b[6];
+    char end;
+    if (!s || sscanf(s, "%2x:%2x:%2x:%2x:%2x:%2x%c", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &end) != 6) {
+        return -1;
+    }
+    for (int i = 0; i < 6; i++) mac[i] = (uint8_t)b[i];
+    return 0;
+}
+
+/*
+ * Grava o tipo da camada seguinte no campo da anterior (EtherType da VLAN,
+ * do Ethernet ou protocolo do GRE). Depois de MPLS não há campo: o último
+ * rótulo recebe o bit de fim de pilha e o tipo vem do próprio conteúdo.
+ */
+static void link_next(uint8_t *h, int ctx, size_t field, uint16_t type) {
+    if (ctx == CTX_MPLS) {
+        h[field + 2] |= 0x01;
+    } else {
+        put16(h + field, type);
+    }
+}
+
+/* IP externo de um túnel em h + off; devolve o tamanho do cabeçalho */
+static size_t write_outer_ip(encap_t *e, const encap_layer_t *l, int v4, const uint8_t *src,
+                             const uint8_t *dst, uint8_t proto, size_t off) {
+    uint8_t *ip = e->hdr + off;
+    const uint8_t ttl = l->ttl ? l->ttl : 64;
+    encap_ip_t *rec = &e->ip[e->n_ip++];
+    rec->off = (uint16_t)off;
+    rec->v4  = (uint8_t)v4;
+    if (!v4) {
+        put32(ip, 0x60000000u);
+        ip[6] = proto;
+        ip[7] = ttl;
+        memcpy(ip + 8, src, 16);
+        memcpy(ip + 24, dst, 16);
+        return IPV6_HEADER_SIZE;
+    }
+    ip[0] = 0x45;
+    ip[8] = ttl;
+    ip[9] = proto;
+    memcpy(ip + 12, src, 4);
+    memcpy(ip + 16, dst, 4);
+    // comprimento e checksum ficam zerados: entram por pacote
+    uint32_t sum = 0;
+    for (size_t i = 0; i < IPV4_HEADER_SIZE; i += 2) {
+        sum += (uint32_t)(ip[i] << 8 | ip[i + 1]);
+    }
+    rec->sum = sum;
+    return IPV4_HEADER_SIZE;
+}
+
+int encap_compile(const encap_layer_t *layers, size_t n, const uint8_t *dst_mac,
+                  const uint8_t *src_mac, ip_version_t inner, uint32_t entropy, encap_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (n > ENCAP_MAX_LAYERS) {
+        fprintf(stderr, "encap: no máximo %d camadas\n", ENCAP_MAX_LAYERS);
+        return -1;
+    }
+    uint8_t *h = out->hdr;
+    memcpy(h, dst_mac ? dst_mac : DEFAULT_DST_MAC, 6);
+    memcpy(h + 6, src_mac ? src_mac : DEFAULT_SRC_MAC, 6);
+    size_t len   = ETH_HEADER_SIZE;
+    size_t field = 12;      // onde vai o tipo da próxima camada (último rótulo, depois de MPLS)
+    int ctx = CTX_L2;
+
+    for (size_t i = 0; i < n; i++) {
+        const encap_layer_t *l = &layers[i];
+        switch (l->type) {
+            case ENCAP_VLAN:
+                if (ctx != CTX_L2) {
+                    fprintf(stderr, "encap: camada %zu: VLAN só depois de Ethernet, VLAN ou VXLAN\n", i);
+                    return -1;
+                }
+                if (len + 4 > ENCAP_MAX_HDR) goto too_big;
+                put16(h + field, l->tpid);
+                put16(h + len, (uint16_t)((l->pcp & 0x7) << 13 | (l->vid & 0x0FFF)));
+                field = len + 2;
+                len += 4;
+                break;
+            case ENCAP_MPLS:
+                if (len + 4 > ENCAP_MAX_HDR) goto too_big;
+                // rótulos seguidos formam uma pilha: só o primeiro leva o EtherType
+                if (ctx != CTX_MPLS) put16(h + field, ETHERTYPE_MPLS);
+                put32(h + len, (l->label & 0xFFFFF) << 12 | (uint32_t)(l->pcp & 0x7) << 9 |
+                               (l->ttl ? l->ttl : 64));
+                field = len;
+                len += 4;
+                ctx = CTX_MPLS;
+                break;
+            case ENCAP_GRE:
+            case ENCAP_VXLAN: {
+                uint8_t src[16], dst[16];
+                int v4 = 1;
+                if (inet_pton(AF_INET, l->src_ip, src) != 1 || inet_pton(AF_INET, l->dst_ip, dst) != 1) {
+                    v4 = 0;
+                    if (inet_pton(AF_INET6, l->src_ip, src) != 1 || inet_pton(AF_INET6, l->dst_ip, dst) != 1) {
+                        fprintf(stderr, "encap: camada %zu: src_ip/dst_ip externos inválidos ou de famílias "
+                                        "diferentes\n", i);
+                        return -1;
+                    }
+                }
+                // UDP sobre IPv6 não pode ter checksum 0 (RFC 8200) e o carimbo da sonda no
+                // TX mudaria o quadro interno que ele cobre: VXLAN só sobre IPv4
+                if (!v4 && l->type == ENCAP_VXLAN) {
+                    fprintf(stderr, "encap: camada %zu: VXLAN só com IP externo IPv4\n", i);
+                    return -1;
+                }
+                const size_t ip_size = v4 ? IPV4_HEADER_SIZE : IPV6_HEADER_SIZE;
+                const size_t need = l->type == ENCAP_GRE
+                                  ? ip_size + 4 + (l->has_key ? 4 : 0)
+                                  : ip_size + UDP_HEADER_SIZE + VXLAN_HEADER_SIZE + ETH_HEADER_SIZE;
+                if (len + need > ENCAP_MAX_HDR) goto too_big;
+                link_next(h, ctx, field, v4 ? 0x0800 : 0x86DD);
+                len += write_outer_ip(out, l, v4, src, dst,
+                                      l->type == ENCAP_GRE ? IP_PROTO_GRE : IP_PROTO_UDP, len);
+                if (l->type == ENCAP_GRE) {
+                    // GRE sem checksum nem sequência (RFC 2890); o protocolo é o da próxima camada
+                    put16(h + len, l->has_key ? 0x2000 : 0);
+                    field = len + 2;
+                    if (l->has_key) put32(h + len + 4, l->key);
+                    len += 4 + (l->has_key ? 4 : 0);
+                    ctx = CTX_GRE;
+                    break;
+                }
+                // VXLAN (RFC 7348): porta de origem pelo fluxo interno, checksum UDP 0
+                const uint16_t sport = l->src_port ? l->src_port : (uint16_t)(49152 | (entropy & 0x3FFF));
+                put16(h + len, sport);
+                put16(h + len + 2, ENCAP_VXLAN_PORT);
+                out->udp_off[out->n_udp++] = (uint16_t)len;
+                len += UDP_HEADER_SIZE;
+                h[len] = 0x08;
+                put32(h + len + 4, (l->key & 0xFFFFFF) << 8);
+                len += VXLAN_HEADER_SIZE;
+                // MACs internos zerados: repete os do Ethernet externo
+                static const uint8_t zero[6];
+                memcpy(h + len, memcmp(l->inner_dst_mac, zero, 6) ? l->inner_dst_mac : h, 6);
+                memcpy(h + len + 6, memcmp(l->inner_src_mac, zero, 6) ? l->inner_src_mac : h + 6, 6);
+                field = len + 12;
+                len += ETH_HEADER_SIZE;
+                ctx = CTX_L2;
+                break;
+            }
+        }
+    }
+    link_next(h, ctx, field, inner == IP_V4 ? 0x0800 : 0x86DD);
+    out->len      = (uint16_t)len;
+    out->n_layers = (uint8_t)n;
+    return 0;
+
+too_big:
+    fprintf(stderr, "encap: cabeçalhos externos excedem %d bytes\n", ENCAP_MAX_HDR);
+    return -1;
+}
+
+void encap_write(const encap_t *e, uint8_t *frame, size_t len) {
+    memcpy(frame, e->hdr, e->len);
+    for (uint8_t i = 0; i < e->n_ip; i++) {
+        const encap_ip_t *ip = &e->ip[i];
+        uint8_t *p = frame + ip->off;
+        if (!ip->v4) {
+            put16(p + 4, (uint16_t)(len - ip->off - IPV6_HEADER_SIZE));
+            continue;
+        }
+        const uint16_t total = (uint16_t)(len - ip->off);
+        uint32_t sum = ip->sum + total;
+        sum = (sum & 0xFFFF) + (sum >> 16);
+        sum = (sum & 0xFFFF) + (sum >> 16);
+        put16(p + 2, total);
+        put16(p + 10, (uint16_t)~sum);
+    }
+    for (uint8_t i = 0; i < e->n_udp; i++) {
+        put16(frame + e->udp_off[i] + 4, (uint16_t)(len - e->udp_off[i]));
+    }
+}
+
+int encap_packet(const encap_t *e, packet_t *pkt) {
+    if (!e) {
+        add_ethernet_header(pkt);
+        return 0;
+    }
+    const size_t len = e->len + pkt->length;
+    uint8_t *frame = malloc(len);
+    if (!frame) return -1;
+    memcpy(frame + e->len, pkt->data, pkt->length);
+    encap_write(e, frame, len);
+    free(pkt->data);
+    pkt->data   = frame;
+    pkt->length = len;
+    return 0;
+}
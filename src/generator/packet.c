@@ -1,5 +1,6 @@
 
 #include "../../include/generator/packet.h"
+#include "../../include/generator/tcp_flow.h"
 #include <stdlib.h>
 #include <string.h>
 #include <arpa/inet.h>
@@ -59,6 +60,8 @@ packet_list_t* create_packet_list() {
         list->head = NULL;
         list->tail = NULL;
         list->count = 0;
+        list->flows = NULL;
+        list->lap_ns = 0;
     }
     return list;
 }
@@ -77,6 +80,7 @@ void free_packet_list(packet_list_t *list) {
         current = next;
     }
 
+    tcp_flow_table_free(list->flows);
     free(list);
 }
 
@@ -85,6 +89,13 @@ void add_packet_to_list(packet_list_t *list, packet_t *packet) {
     if (!list || !packet) return;
 
     add_ethernet_header(packet);
+    append_packet_to_list(list, packet);
+}
+
+/* Adicionar quadro já completo à lista */
+void append_packet_to_list(packet_list_t *list, packet_t *packet) {
+    if (!list || !packet) return;
+
     packet->next = NULL;
 
     if (!list->head) {
@@ -6,157 +6,820 @@
 #include "../../include/generator/proto_tcp.h"
 #include "../../include/generator/proto_udp.h"
 #include "../../include/generator/proto_icmp.h"
+#include "../../include/generator/tcp_flow.h"
+#include "../../include/generator/scheduler.h"
+#include "../../include/generator/encap.h"
+#include "../../include/netwagon.h"
 
-int load_templates_from_json(const char *filename,
-                             packet_list_t *list) {
-    json_error_t error;
-    json_t *root = json_load_file(filename, 0, &error);
-    if (!root) {
-        fprintf(stderr, "Erro ao abrir JSON '%s': %s\n", filename, error.text);
+#define ETHERNET_HEADER_SIZE 14
+#define ETHERNET_FCS_SIZE    4
+
+/*
+ * "arrival": "poisson" ou {"model": "onoff", "on_ms": 5, "off_ms": 20, ...}.
+ * Ausente = constante. A semente padrão é o índice do template: execuções
+ * repetidas sorteiam os mesmos intervalos.
+ */
+static int parse_arrival(const json_t *js, size_t idx, arrival_cfg_t *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->pareto_shape = 1.5;
+    cfg->train        = 32;
+    cfg->line_mbps    = 1000;
+    cfg->seed         = idx + 1;
+    if (!js) return 0;
+
+    const char *model = json_is_string(js) ? json_string_value(js)
+                                           : json_string_value(json_object_get(js, "model"));
+    if (arrival_model_parse(model, &cfg->model) != 0 ||
+        arrival_dist_parse(json_string_value(json_object_get(js, "on_dist")), &cfg->on_dist) != 0 ||
+        arrival_dist_parse(json_string_value(json_object_get(js, "off_dist")), &cfg->off_dist) != 0) {
+        fprintf(stderr, "Template %zu: arrival inválido (modelos: constant, poisson, onoff, "
+                        "microburst; distribuições: constant, exponential, pareto)\n", idx);
+        return 1;
+    }
+    if (!json_is_object(js)) return 0;
+
+    const double on_ms  = json_number_value(json_object_get(js, "on_ms"));
+    const double off_ms = json_number_value(json_object_get(js, "off_ms"));
+    const json_t *shape = json_object_get(js, "pareto_shape");
+    const json_t *train = json_object_get(js, "train");
+    const json_t *line  = json_object_get(js, "line_mbps");
+    const json_t *seed  = json_object_get(js, "seed");
+    if (shape) cfg->pareto_shape = json_number_value(shape);
+    if (train) cfg->train = (uint32_t)json_integer_value(train);
+    if (line) cfg->line_mbps = (uint32_t)json_integer_value(line);
+    if (seed) cfg->seed = (uint64_t)json_integer_value(seed);
+    cfg->on_ns  = (uint64_t)(on_ms * 1e6);
+    cfg->off_ns = (uint64_t)(off_ms * 1e6);
+    if (cfg->model == ARRIVAL_ONOFF && (on_ms <= 0 || off_ms < 0)) {
+        fprintf(stderr, "Template %zu: arrival onoff exige on_ms > 0 e off_ms >= 0\n", idx);
+        return 1;
+    }
+    if (cfg->pareto_shape <= 1.0 || cfg->train < 1 || cfg->line_mbps < 1) {
+        fprintf(stderr, "Template %zu: arrival exige pareto_shape > 1, train >= 1 e line_mbps >= 1\n", idx);
+        return 1;
+    }
+    return 0;
+}
+
+/* hash do fluxo interno: porta de origem VXLAN estável por template */
+static uint32_t template_entropy(const packet_template_t *t) {
+    uint32_t h = 2166136261u;
+    for (const char *c = t->src_ip; *c; c++) h = (h ^ (uint8_t)*c) * 16777619u;
+    for (const char *c = t->dst_ip; *c; c++) h = (h ^ (uint8_t)*c) * 16777619u;
+    h = (h ^ t->src_port) * 16777619u;
+    h = (h ^ t->dst_port) * 16777619u;
+    return h ^ h >> 16;
+}
+
+/* Uma camada de "encap"; retorna 0 em sucesso */
+static int parse_encap_layer(const json_t *js, size_t idx, size_t k, encap_layer_t *l) {
+    memset(l, 0, sizeof(*l));
+    const char *type = json_string_value(json_object_get(js, "type"));
+    const json_int_t vid   = json_integer_value(json_object_get(js, "vid"));
+    const json_int_t pcp   = json_integer_value(json_object_get(js, json_object_get(js, "tc") ? "tc" : "pcp"));
+    const json_int_t ttl   = json_integer_value(json_object_get(js, "ttl"));
+    const json_int_t label = json_integer_value(json_object_get(js, "label"));
+    const json_t *tpid = json_object_get(js, "tpid");
+    const json_t *key  = json_object_get(js, json_object_get(js, "vni") ? "vni" : "key");
+    if (!type) {
+        fprintf(stderr, "Template %zu: encap[%zu] sem \"type\"\n", idx, k);
+        return 1;
+    }
+    if (pcp < 0 || pcp > 7 || ttl < 0 || ttl > 255) {
+        fprintf(stderr, "Template %zu: encap[%zu]: pcp/tc entre 0 e 7 e ttl entre 0 e 255\n", idx, k);
+        return 1;
+    }
+    l->pcp = (uint8_t)pcp;
+    l->ttl = (uint8_t)ttl;
+
+    if (strcmp(type, "vlan") == 0 || strcmp(type, "qinq") == 0) {
+        l->type = ENCAP_VLAN;
+        l->tpid = type[0] == 'q' ? ETHERTYPE_QINQ : ETHERTYPE_VLAN;
+        if (tpid) l->tpid = (uint16_t)json_integer_value(tpid);
+        if (vid < 0 || vid > 4094) {
+            fprintf(stderr, "Template %zu: encap[%zu]: vid deve estar entre 0 e 4094\n", idx, k);
+            return 1;
+        }
+        l->vid = (uint16_t)vid;
+        return 0;
+    }
+    if (strcmp(type, "mpls") == 0) {
+        l->type = ENCAP_MPLS;
+        if (label < 0 || label > 0xFFFFF) {
+            fprintf(stderr, "Template %zu: encap[%zu]: label deve estar entre 0 e 1048575\n", idx, k);
+            return 1;
+        }
+        l->label = (uint32_t)label;
+        return 0;
+    }
+    if (strcmp(type, "gre") != 0 && strcmp(type, "vxlan") != 0) {
+        fprintf(stderr, "Template %zu: encap[%zu]: type deve ser vlan, qinq, mpls, gre ou vxlan\n", idx, k);
+        return 1;
+    }
+
+    // túneis: IP externo próprio
+    l->type = type[0] == 'g' ? ENCAP_GRE : ENCAP_VXLAN;
+    const char *src_ip = json_string_value(json_object_get(js, "src_ip"));
+    const char *dst_ip = json_string_value(json_object_get(js, "dst_ip"));
+    if (!src_ip || !dst_ip) {
+        fprintf(stderr, "Template %zu: encap[%zu]: %s exige src_ip e dst_ip externos\n", idx, k, type);
         return 1;
     }
+    snprintf(l->src_ip, sizeof(l->src_ip), "%s", src_ip);
+    snprintf(l->dst_ip, sizeof(l->dst_ip), "%s", dst_ip);
+    l->has_key = key != NULL;
+    l->key     = (uint32_t)json_integer_value(key);
+    if (l->type == ENCAP_GRE) return 0;
+
+    const char *inner_dst = json_string_value(json_object_get(js, "inner_dst_mac"));
+    const char *inner_src = json_string_value(json_object_get(js, "inner_src_mac"));
+    if (json_integer_value(key) < 0 || json_integer_value(key) > 0xFFFFFF ||
+        (inner_dst && encap_parse_mac(inner_dst, l->inner_dst_mac) != 0) ||
+        (inner_src && encap_parse_mac(inner_src, l->inner_src_mac) != 0)) {
+        fprintf(stderr, "Template %zu: encap[%zu]: vni entre 0 e 16777215 e MACs internos "
+                        "no formato aa:bb:cc:dd:ee:ff\n", idx, k);
+        return 1;
+    }
+    // o RX só reconhece VXLAN na porta padrão: outra porta nunca seria desencapsulada
+    const json_t *dst_port = json_object_get(js, "dst_port");
+    if (dst_port && json_integer_value(dst_port) != ENCAP_VXLAN_PORT) {
+        fprintf(stderr, "Template %zu: encap[%zu]: vxlan só usa a porta de destino %d\n",
+                idx, k, ENCAP_VXLAN_PORT);
+        return 1;
+    }
+    l->src_port = (uint16_t)json_integer_value(json_object_get(js, "src_port"));
+    return 0;
+}
+
+/*
+ * "src_mac"/"dst_mac" e "encap": [{"type": "vlan", "vid": 100}, ...], da
+ * camada mais externa para a mais interna. Os cabeçalhos externos são
+ * montados aqui, uma vez; sem nenhum dos três, t->encap fica NULL.
+ */
+static int parse_encap(const json_t *obj, size_t idx, packet_template_t *t) {
+    const json_t *js    = json_object_get(obj, "encap");
+    const char *src_mac = json_string_value(json_object_get(obj, "src_mac"));
+    const char *dst_mac = json_string_value(json_object_get(obj, "dst_mac"));
+    if (!js && !src_mac && !dst_mac) return 0;
+
+    uint8_t smac[6], dmac[6];
+    if ((src_mac && encap_parse_mac(src_mac, smac) != 0) ||
+        (dst_mac && encap_parse_mac(dst_mac, dmac) != 0)) {
+        fprintf(stderr, "Template %zu: src_mac/dst_mac no formato aa:bb:cc:dd:ee:ff\n", idx);
+        return 1;
+    }
+    const size_t n = js ? json_array_size(js) : 0;
+    if ((js && !json_is_array(js)) || n > ENCAP_MAX_LAYERS) {
+        fprintf(stderr, "Template %zu: encap deve ser um array de até %d camadas\n", idx, ENCAP_MAX_LAYERS);
+        return 1;
+    }
+    // o servidor emulado precisaria da pilha invertida
+    if (n && t->tcp_flows) {
+        fprintf(stderr, "Template %zu: encap não se aplica a sessões TCP (tcp_flows)\n", idx);
+        return 1;
+    }
+    encap_layer_t layers[ENCAP_MAX_LAYERS];
+    for (size_t k = 0; k < n; k++) {
+        if (parse_encap_layer(json_array_get(js, k), idx, k, &layers[k]) != 0) return 1;
+    }
+
+    t->encap = malloc(sizeof(encap_t));
+    if (!t->encap) {
+        fprintf(stderr, "Falha ao alocar memória para encap\n");
+        return 1;
+    }
+    if (encap_compile(layers, n, dst_mac ? dmac : NULL, src_mac ? smac : NULL, t->ip_version,
+                      template_entropy(t), t->encap) != 0) {
+        fprintf(stderr, "Template %zu: encap inválido\n", idx);
+        free(t->encap);
+        t->encap = NULL;
+        return 1;
+    }
+    return 0;
+}
+
+/* Preenche set a partir da raiz JSON já carregada (consome root) */
+static int parse_template_set(json_t *root, template_set_t *set) {
     if (!json_is_array(root)) {
         fprintf(stderr, "Formato inválido: raiz JSON deve ser um array\n");
         json_decref(root);
         return 1;
     }
 
-    uint32_t next_id = 1; // inicializa ID incremental
+    size_t n = json_array_size(root);
+    set->items = calloc(n ? n : 1, sizeof(packet_template_t));
+    if (!set->items) {
+        fprintf(stderr, "Falha ao alocar memória para templates\n");
+        json_decref(root);
+        return 1;
+    }
 
     size_t idx;
     json_t *obj;
     json_array_foreach(root, idx, obj) {
+        packet_template_t *t = &set->items[set->count];
+
         const char *family_s = json_string_value(json_object_get(obj, "protocol_family"));
         const char *trans_s  = json_string_value(json_object_get(obj, "transport_protocol"));
         const char *src_ip   = json_string_value(json_object_get(obj, "src_ip"));
         const char *dst_ip   = json_string_value(json_object_get(obj, "dst_ip"));
-        int src_port         = (int)json_integer_value(json_object_get(obj, "src_port"));
-        int dst_port         = (int)json_integer_value(json_object_get(obj, "dst_port"));
-        uint32_t packet_count= (uint32_t)json_integer_value(json_object_get(obj, "packet_count"));
+
+        if (!src_ip || !dst_ip) {
+            fprintf(stderr, "Template %zu: src_ip/dst_ip obrigatórios\n", idx);
+            json_decref(root);
+            free_template_set(set);
+            return 1;
+        }
 
         // Seleciona família de IP
-        int af = AF_INET;
+        t->ip_version = IP_V4;
         if (family_s && strcmp(family_s, "ipv6") == 0) {
-            af = AF_INET6;
+            t->ip_version = IP_V6;
         }
 
         // Seleciona protocolo de transporte
-        int proto = IPPROTO_UDP;
+        t->transport = IPPROTO_UDP;
         if (trans_s) {
-            if (strcmp(trans_s, "tcp") == 0) proto = IPPROTO_TCP;
-            else if (strcmp(trans_s, "icmp") == 0) proto = IPPROTO_ICMP;
+            if (strcmp(trans_s, "tcp") == 0) t->transport = IPPROTO_TCP;
+            else if (strcmp(trans_s, "icmp") == 0) t->transport = IPPROTO_ICMP;
+        }
+
+        snprintf(t->src_ip, sizeof(t->src_ip), "%s", src_ip);
+        snprintf(t->dst_ip, sizeof(t->dst_ip), "%s", dst_ip);
+        t->src_port     = (uint16_t)json_integer_value(json_object_get(obj, "src_port"));
+        t->dst_port     = (uint16_t)json_integer_value(json_object_get(obj, "dst_port"));
+        t->packet_count = (uint32_t)json_integer_value(json_object_get(obj, "packet_count"));
+        t->frame_size   = (uint32_t)json_integer_value(json_object_get(obj, "frame_size"));
+
+        // MTU IP (opcional): datagramas maiores viram segmentos TCP ou fragmentos
+        json_int_t mtu = json_integer_value(json_object_get(obj, "mtu"));
+        const json_int_t min_mtu = t->ip_version == IP_V4 ? NW_IPV4_MIN_MTU : NW_IPV6_MIN_MTU;
+        if (mtu && (mtu < min_mtu || mtu > 65535)) {
+            fprintf(stderr, "Template %zu: mtu deve estar entre %lld e 65535\n",
+                    idx, (long long)min_mtu);
+            json_decref(root);
+            free_template_set(set);
+            return 1;
+        }
+        t->mtu = (uint32_t)mtu;
+
+        // Fluxo no escalonador (opcionais): taxa, início, peso e rajada
+        const double rate_pps = json_number_value(json_object_get(obj, "rate_pps"));
+        const double start_ms = json_number_value(json_object_get(obj, "start_ms"));
+        const json_t *weight  = json_object_get(obj, "weight");
+        const json_t *burst   = json_object_get(obj, "burst");
+        t->weight = weight ? (uint32_t)json_integer_value(weight) : 1;
+        t->burst  = burst ? (uint32_t)json_integer_value(burst) : 1;
+        if (rate_pps < 0 || (rate_pps > 0 && rate_pps < 1) || start_ms < 0 ||
+            (weight && (json_integer_value(weight) < 1 || json_integer_value(weight) > 1000000)) ||
+            (burst && (json_integer_value(burst) < 1 || json_integer_value(burst) > 65535))) {
+            fprintf(stderr, "Template %zu: rate_pps deve ser >= 1, start_ms >= 0, weight entre 1 e "
+                            "1000000 e burst entre 1 e 65535\n", idx);
+            json_decref(root);
+            free_template_set(set);
+            return 1;
+        }
+        t->rate_pps = (uint64_t)rate_pps;
+        t->start_ns = (uint64_t)(start_ms * 1e6);
+        if (parse_arrival(json_object_get(obj, "arrival"), idx, &t->arrival) != 0) {
+            json_decref(root);
+            free_template_set(set);
+            return 1;
         }
 
         // Parâmetros TCP/ICMP (opcionais)
-        uint32_t tcp_seq   = (uint32_t)json_integer_value(json_object_get(obj, "tcp_seq"));
-        uint32_t tcp_ack   = (uint32_t)json_integer_value(json_object_get(obj, "tcp_ack_seq"));
-        uint8_t  tcp_flags = (uint8_t)json_integer_value(json_object_get(obj, "tcp_flags"));
-        uint8_t  icmp_type = (uint8_t)json_integer_value(json_object_get(obj, "icmp_type"));
-        uint8_t  icmp_code = (uint8_t)json_integer_value(json_object_get(obj, "icmp_code"));
+        t->tcp_seq   = (uint32_t)json_integer_value(json_object_get(obj, "tcp_seq"));
+        t->tcp_ack   = (uint32_t)json_integer_value(json_object_get(obj, "tcp_ack_seq"));
+        t->tcp_flags = (uint8_t)json_integer_value(json_object_get(obj, "tcp_flags"));
+        t->icmp_type = (uint8_t)json_integer_value(json_object_get(obj, "icmp_type"));
+        t->icmp_code = (uint8_t)json_integer_value(json_object_get(obj, "icmp_code"));
+
+        // Sessões TCP com estado (opcionais)
+        if (t->transport == IPPROTO_TCP) {
+            t->tcp_flows       = (uint32_t)json_integer_value(json_object_get(obj, "tcp_flows"));
+            t->tcp_segments    = (uint32_t)json_integer_value(json_object_get(obj, "tcp_segments"));
+            t->tcp_concurrency = (uint32_t)json_integer_value(json_object_get(obj, "tcp_concurrency"));
+            t->tcp_emulate_server = json_is_true(json_object_get(obj, "tcp_emulate_server"));
+            if (t->tcp_flows && !json_object_get(obj, "tcp_segments")) t->tcp_segments = 1;
+
+            const char *close_s = json_string_value(json_object_get(obj, "tcp_close"));
+            t->tcp_close = TCP_CLOSE_FIN;
+            if (close_s && strcmp(close_s, "rst") == 0) t->tcp_close = TCP_CLOSE_RST;
+            else if (close_s && strcmp(close_s, "none") == 0) t->tcp_close = TCP_CLOSE_NONE;
+        }
 
         // Payload original (string)
         const char *pl_str = json_string_value(json_object_get(obj, "payload"));
-        size_t pl_size     = pl_str ? strlen(pl_str) : 0;
-
-        for (uint32_t i = 0; i < packet_count; ++i) {
-            // --- Monta payload com ID no início ---
-            // Reserve espaço para: [ID] + separador + payload original + '\0'
-            // Supondo até 10 dígitos de ID; 12 = espaço para "[", "]", "|" e '\0'
-            size_t buf_size =  pl_size + 12;
-            char *pl_with_id = malloc(buf_size);
-            if (!pl_with_id) {
-                fprintf(stderr, "Falha ao alocar memória para payload\n");
-                json_decref(root);
-                return 1;
+        t->payload_size = pl_str ? strlen(pl_str) : 0;
+        t->payload      = strdup(pl_str ? pl_str : "");
+        if (!t->payload) {
+            fprintf(stderr, "Falha ao alocar memória para payload\n");
+            json_decref(root);
+            free_template_set(set);
+            return 1;
+        }
+        if (parse_encap(obj, idx, t) != 0) {
+            free(t->payload);
+            json_decref(root);
+            free_template_set(set);
+            return 1;
+        }
+
+        set->count++;
+    }
+
+    json_decref(root);
+    return 0;
+}
+
+int load_template_set(const char *filename, template_set_t *set) {
+    if (!filename || !set) return 1;
+    memset(set, 0, sizeof(*set));
+
+    json_error_t error;
+    json_t *root = json_load_file(filename, 0, &error);
+    if (!root) {
+        fprintf(stderr, "Erro ao abrir JSON '%s': %s\n", filename, error.text);
+        return 1;
+    }
+    return parse_template_set(root, set);
+}
+
+int load_template_set_buffer(const char *text, size_t len, template_set_t *set) {
+    if (!text || !set) return 1;
+    memset(set, 0, sizeof(*set));
+
+    json_error_t error;
+    json_t *root = json_loadb(text, len, 0, &error);
+    if (!root) {
+        fprintf(stderr, "Erro no JSON de templates: %s\n", error.text);
+        return 1;
+    }
+    return parse_template_set(root, set);
+}
+
+/* pacotes que um template gera */
+static uint32_t template_packet_count(const packet_template_t *t) {
+    return t->tcp_flows ? tcp_session_packet_count(t) : t->packet_count;
+}
+
+int template_set_shard(template_set_t *set, uint32_t shard, uint32_t n_shards, uint16_t *orig_idx) {
+    if (!set || !orig_idx || !n_shards || shard >= n_shards) return 1;
+    const size_t n = set->count;
+    // o índice original vai em uint16_t, como packet_t.tmpl e flow_stat_t.tmpl
+    if (n > (size_t)UINT16_MAX + 1) {
+        fprintf(stderr, "Divisão de templates: no máximo %u templates\n", UINT16_MAX + 1);
+        return 1;
+    }
+    uint32_t *owner  = malloc((n ? n : 1) * sizeof(uint32_t));
+    uint8_t  *placed = calloc(n ? n : 1, 1);
+    uint64_t *load   = calloc(n_shards, sizeof(uint64_t));
+    if (!owner || !placed || !load) {
+        free(owner);
+        free(placed);
+        free(load);
+        fprintf(stderr, "Falha ao alocar memória para dividir os templates\n");
+        return 1;
+    }
+
+    // poucos templates: cada um (exceto sessões TCP) é dividido entre todas as partes
+    const int split = n < n_shards;
+    // templates inteiros: o maior primeiro, na parte menos carregada (LPT)
+    for (size_t done = 0; done < n; done++) {
+        size_t pick = SIZE_MAX;
+        for (size_t i = 0; i < n; i++) {
+            if (placed[i]) continue;
+            if (pick == SIZE_MAX ||
+                template_packet_count(&set->items[i]) > template_packet_count(&set->items[pick])) {
+                pick = i;
             }
-            // Ex.: "1|Hello TCP!"
-            int len = snprintf(pl_with_id,
-                               buf_size,
-                               "%u|%s",
-                               next_id++,
-                               pl_str ? pl_str : "");
-            if (len < 0 || (size_t)len >= buf_size) {
-                fprintf(stderr, "Erro ao formatar payload com ID\n");
-                free(pl_with_id);
-                json_decref(root);
-                return 1;
+        }
+        placed[pick] = 1;
+        if (split && !set->items[pick].tcp_flows) {
+            owner[pick] = UINT32_MAX;
+            continue;
+        }
+        uint32_t best = 0;
+        for (uint32_t k = 1; k < n_shards; k++) {
+            if (load[k] < load[best]) best = k;
+        }
+        load[best] += template_packet_count(&set->items[pick]);
+        owner[pick] = best;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++) {
+        packet_template_t *t = &set->items[i];
+        if (owner[i] != UINT32_MAX && owner[i] != shard) {
+            free(t->payload);
+            free(t->encap);
+            continue;
+        }
+        if (owner[i] == UINT32_MAX) {
+            t->packet_count = t->packet_count / n_shards + (shard < t->packet_count % n_shards);
+            if (t->rate_pps) t->rate_pps = t->rate_pps / n_shards ? t->rate_pps / n_shards : 1;
+        }
+        orig_idx[kept] = (uint16_t)i;
+        set->items[kept++] = *t;
+    }
+    set->count = kept;
+    free(owner);
+    free(placed);
+    free(load);
+    return 0;
+}
+
+void free_template_set(template_set_t *set) {
+    if (!set) return;
+    for (size_t i = 0; i < set->count; i++) {
+        free(set->items[i].payload);
+        free(set->items[i].encap);
+    }
+    free(set->items);
+    set->items = NULL;
+    set->count = 0;
+}
+
+uint32_t template_set_packet_count(const template_set_t *set) {
+    uint32_t total = 0;
+    for (size_t i = 0; set && i < set->count; i++) {
+        const packet_template_t *t = &set->items[i];
+        total += t->tcp_flows ? tcp_session_packet_count(t) : t->packet_count;
+    }
+    return total;
+}
+
+int template_set_scheduled(const template_set_t *set) {
+    for (size_t i = 0; set && i < set->count; i++) {
+        const packet_template_t *t = &set->items[i];
+        if (t->rate_pps || t->start_ns || t->arrival.model != ARRIVAL_CONSTANT) return 1;
+    }
+    return 0;
+}
+
+/* Tamanho dos cabeçalhos (Ethernet ou pilha de encapsulamento + IP + L4) de um template */
+static size_t template_header_size(const packet_template_t *t) {
+    size_t ip_size = (t->ip_version == IP_V4) ? sizeof(struct ip_header_v4)
+                                              : sizeof(struct ip_header_v6);
+    size_t l4_size;
+    switch (t->transport) {
+        case IPPROTO_TCP: l4_size = sizeof(struct tcp_header);  break;
+        case IPPROTO_ICMP: l4_size = sizeof(struct icmp_header); break;
+        default:          l4_size = sizeof(struct udp_header);  break;
+    }
+    return (t->encap ? t->encap->len : ETHERNET_HEADER_SIZE) + ip_size + l4_size;
+}
+
+/*
+ * Cria um pacote do template com o payload já montado (seq_off = deslocamento
+ * do segmento TCP; csum_offload = checksum TCP/UDP parcial, completado no envio)
+ */
+static packet_t *create_packet_from_template(const packet_template_t *t,
+                                             const void *payload,
+                                             size_t payload_size,
+                                             uint32_t seq_off,
+                                             int csum_offload) {
+    nw_flow_t flow;
+    if (nw_flow_from_template(&flow, t) != 0) return NULL;
+    flow.tcp_seq     += seq_off;
+    flow.csum_offload = csum_offload;
+    if (t->ip_version == IP_V4) flow.ip_id = (uint16_t)(rand() & 0xFFFF);
+    return nw_packet_new(&flow, payload, payload_size);
+}
+
+/* Destino dos pacotes gerados: a lista ou o sink de build_packets_stream() */
+typedef struct {
+    packet_list_t   *list;          // != NULL: acrescenta à lista
+    packet_stream_t *stream;
+    int             scheduled;      // lista escalonada: cada pacote leva o prazo da rodada
+    uint64_t        due_ns;
+} emit_out_t;
+
+/*
+ * Entrega um pacote sem Ethernet, com os cabeçalhos externos do template;
+ * last = último pacote do datagrama
+ */
+static int emit_packet(const packet_template_t *t, emit_out_t *out, packet_t *pkt, int last) {
+    // segmentos e fragmentos do datagrama saem juntos, no prazo da rodada
+    if (out->scheduled) pkt->tx_offset_ns = out->due_ns;
+    if (encap_packet(t->encap, pkt) != 0) {
+        fprintf(stderr, "Falha ao alocar memória para encapsular pacote\n");
+        free(pkt->data);
+        free(pkt);
+        return 1;
+    }
+    if (out->list) {
+        append_packet_to_list(out->list, pkt);
+        return 0;
+    }
+    pkt->next = NULL;
+    return out->stream->sink(out->stream->arg, pkt, last);
+}
+
+/* Quebra um datagrama IP maior que o MTU em fragmentos (o primeiro herda os metadados) */
+static int add_fragments(const packet_template_t *t, emit_out_t *out, packet_t *pkt, size_t mtu,
+                         int last) {
+    const size_t n = nw_fragment_count(pkt->data, pkt->length, mtu);
+    uint8_t *buf  = malloc(n * mtu);
+    size_t *lens  = malloc(n * sizeof(*lens));
+    int rc = 1;
+    if (!n || !buf || !lens || nw_fragment(pkt->data, pkt->length, mtu, pkt->id, buf, mtu, lens) != n) {
+        fprintf(stderr, "Falha ao fragmentar datagrama de %zu bytes (mtu %zu)\n", pkt->length, mtu);
+        goto out;
+    }
+    for (size_t i = 0; i < n; i++) {
+        packet_t *frag = calloc(1, sizeof(packet_t));
+        if (frag) frag->data = malloc(lens[i]);
+        if (!frag || !frag->data) {
+            fprintf(stderr, "Falha ao alocar memória para fragmento\n");
+            free(frag);
+            goto out;
+        }
+        memcpy(frag->data, buf + i * mtu, lens[i]);
+        frag->length     = lens[i];
+        frag->ip_version = pkt->ip_version;
+        frag->protocol   = pkt->protocol;
+        frag->tmpl       = pkt->tmpl;
+        if (i == 0) {
+            frag->id = pkt->id;
+            // IPv6: o tag de sonda fica depois do cabeçalho Fragment
+            if (pkt->probe_off) {
+                frag->probe_off = (uint16_t)(pkt->probe_off +
+                                             (pkt->ip_version == IP_V6 ? NW_IPV6_FRAG_SIZE : 0));
             }
+        }
+        if (emit_packet(t, out, frag, last && i + 1 == n) != 0) goto out;
+    }
+    rc = 0;
+out:
+    free(buf);
+    free(lens);
+    free(pkt->data);
+    free(pkt);
+    return rc;
+}
+
+/*
+ * Gera um datagrama do template respeitando o MTU: TCP vira segmentos de
+ * até MSS bytes com seq crescente, UDP/ICMP vira fragmentos IP. Só o
+ * primeiro pacote leva o ID de correlação e o tag de sonda.
+ * Com csum_offload, TCP e UDP viram super-quadros de até 64 KB que o
+ * kernel/NIC segmenta no envio (TSO/GSO com PACKET_VNET_HDR).
+ */
+static int emit_datagram(const packet_template_t *t, uint16_t t_idx, emit_out_t *out,
+                         const char *payload, size_t pl_len, uint32_t id, uint16_t probe_off,
+                         int csum_offload) {
+    const size_t ip_size = t->ip_version == IP_V4 ? sizeof(struct ip_header_v4)
+                                                  : sizeof(struct ip_header_v6);
+    // o virtio_net_hdr só descreve TSO/GSO sobre Ethernet simples
+    if (csum_offload && t->encap && t->encap->n_layers) {
+        fprintf(stderr, "Template %u: encap não combina com TX 'vnet:' (checksum parcial)\n", t_idx);
+        return 1;
+    }
+    size_t seg_len = pl_len;
+    size_t gso = 0;
+    if (t->transport == IPPROTO_TCP && t->mtu) {
+        const size_t mss = t->mtu - ip_size - sizeof(struct tcp_header);
+        const size_t max = csum_offload ? (65535 - ip_size - sizeof(struct tcp_header)) / mss * mss : mss;
+        if (seg_len > max) seg_len = max;
+        if (csum_offload) gso = mss;
+    } else if (t->transport == IPPROTO_UDP && t->mtu && csum_offload) {
+        gso = t->mtu - ip_size - sizeof(struct udp_header);
+    }
 
-            // Cria o pacote apropriado
-            packet_t *pkt = NULL;
-            if (af == AF_INET) {
-                switch (proto) {
-                    case IPPROTO_TCP:
-                        pkt = create_tcp_packet(
-                            IP_V4,
-                            src_ip, dst_ip,
-                            (uint16_t)src_port,
-                            (uint16_t)dst_port,
-                            tcp_seq, tcp_ack,
-                            tcp_flags,
-                            pl_with_id, (size_t)len
-                        );
-                        break;
-                    case IPPROTO_UDP:
-                        pkt = create_udp_packet(
-                            IP_V4,
-                            src_ip, dst_ip,
-                            (uint16_t)src_port,
-                            (uint16_t)dst_port,
-                            pl_with_id, (size_t)len
-                        );
-                        break;
-                    case IPPROTO_ICMP:
-                        pkt = create_icmp_packet(
-                            IP_V4,
-                            src_ip, dst_ip,
-                            icmp_type, icmp_code,
-                            0, 0,
-                            pl_with_id, (size_t)len
-                        );
-                        break;
-                }
-            } else { // IPv6
-                switch (proto) {
-                    case IPPROTO_TCP:
-                        pkt = create_tcp_packet(
-                            IP_V6,
-                            src_ip, dst_ip,
-                            (uint16_t)src_port,
-                            (uint16_t)dst_port,
-                            tcp_seq, tcp_ack,
-                            tcp_flags,
-                            pl_with_id, (size_t)len
-                        );
-                        break;
-                    case IPPROTO_UDP:
-                        pkt = create_udp_packet(
-                            IP_V6,
-                            src_ip, dst_ip,
-                            (uint16_t)src_port,
-                            (uint16_t)dst_port,
-                            pl_with_id, (size_t)len
-                        );
-                        break;
-                    case IPPROTO_ICMP:
-                        pkt = create_icmp_packet(
-                            IP_V6,
-                            src_ip, dst_ip,
-                            icmp_type, icmp_code,
-                            0, 0,
-                            pl_with_id, (size_t)len
-                        );
-                        break;
-                }
+    size_t off = 0;
+    do {
+        const size_t part = pl_len - off < seg_len ? pl_len - off : seg_len;
+        packet_t *pkt = create_packet_from_template(t, payload + off, part, (uint32_t)off, csum_offload);
+        if (!pkt) {
+            fprintf(stderr, "Template %u: datagrama de %zu bytes de payload excede o limite do IP (65535)\n",
+                    t_idx, part);
+            return 1;
+        }
+        pkt->tmpl = t_idx;
+        if (off == 0) {
+            pkt->id        = id;
+            pkt->probe_off = probe_off;
+        }
+        if (gso && part > gso) pkt->gso_size = (uint16_t)gso;
+        const int last = off + part >= pl_len;
+        if (t->mtu && !pkt->gso_size && pkt->length > t->mtu) {
+            if (add_fragments(t, out, pkt, t->mtu, last) != 0) return 1;
+        } else if (emit_packet(t, out, pkt, last) != 0) {
+            return 1;
+        }
+        off += part;
+    } while (off < pl_len);
+    return 0;
+}
+
+/* Monta o payload de uma cópia do template (ID ou tag de sonda + payload) e a emite */
+static int emit_template_packet(const template_set_t *set, const packet_template_t *t,
+                                uint16_t t_idx, emit_out_t *out, size_t frame_size,
+                                uint32_t id, size_t *short_frames) {
+    size_t hdr_size = template_header_size(t);
+    // --frame-sizes tem prioridade sobre o frame_size do template
+    const size_t fsize = frame_size ? frame_size : t->frame_size;
+
+    // --- Monta payload com ID no início ---
+    // Reserve espaço para: ID (até 10 dígitos) + separador + payload original + '\0'
+    size_t buf_size = t->payload_size + (set->probe_tag ? NW_PROBE_TAG_SIZE : 12);
+    size_t target   = 0;
+    if (fsize > 0 && fsize > hdr_size + ETHERNET_FCS_SIZE) {
+        target = fsize - ETHERNET_FCS_SIZE - hdr_size;
+        if (target > buf_size) buf_size = target;
+    }
+
+    char *pl_with_id = calloc(1, buf_size);
+    if (!pl_with_id) {
+        fprintf(stderr, "Falha ao alocar memória para payload\n");
+        return 1;
+    }
+    int len;
+    if (set->probe_tag) {
+        // Tag de sonda binário seguido do payload original
+        nw_probe_tag_init((uint8_t *)pl_with_id, id);
+        memcpy(pl_with_id + NW_PROBE_TAG_SIZE, t->payload, t->payload_size);
+        len = (int)(NW_PROBE_TAG_SIZE + t->payload_size);
+    } else {
+        // Ex.: "1|Hello TCP!"
+        len = snprintf(pl_with_id, buf_size, "%u|%s", id, t->payload);
+        if (len < 0 || (size_t)len >= buf_size) {
+            fprintf(stderr, "Erro ao formatar payload com ID\n");
+            free(pl_with_id);
+            return 1;
+        }
+    }
+
+    // Completa com zeros até o tamanho de quadro pedido
+    size_t pl_len = (size_t)len;
+    if (fsize > 0) {
+        if (target > pl_len) pl_len = target;
+        else if (frame_size > 0 && target < pl_len) (*short_frames)++;
+    }
+
+    int rc = emit_datagram(t, t_idx, out, pl_with_id, pl_len, id,
+                           set->probe_tag ? (uint16_t)hdr_size : 0, set->csum_offload);
+    free(pl_with_id);
+    return rc;
+}
+
+/*
+ * Prepara um fluxo do escalonador por template (sessões TCP ficam de fora).
+ * Com prazos (scheduled), templates sem rate_pps dividem set->rate_pps pelo
+ * peso; sem prazos, a "taxa" é o próprio peso e só define a intercalação.
+ */
+static int prepare_streams(const template_set_t *set, int scheduled, size_t frame_size,
+                           sched_stream_t *streams, arrival_t *arrivals) {
+    uint64_t unrated_weight = 0;
+    for (size_t i = 0; i < set->count; i++) {
+        const packet_template_t *t = &set->items[i];
+        if (!t->tcp_flows && t->packet_count && !t->rate_pps) unrated_weight += t->weight;
+    }
+    for (size_t i = 0; i < set->count; i++) {
+        const packet_template_t *t = &set->items[i];
+        sched_stream_t *s = &streams[i];
+        if (t->tcp_flows || !t->packet_count) continue;
+        s->burst = t->burst;
+        s->count = (t->packet_count + t->burst - 1) / t->burst;
+        if (!scheduled) {
+            s->rate = t->weight;
+            continue;
+        }
+        s->start_ns = t->start_ns;
+        s->rate = t->rate_pps ? t->rate_pps : set->rate_pps * t->weight / unrated_weight;
+        if (!s->rate) {
+            fprintf(stderr, "Template %zu: sem rate_pps e sem parte de --rate (informe --rate ou "
+                            "rate_pps em todos os templates)\n", i);
+            return 1;
+        }
+        if (t->arrival.model != ARRIVAL_CONSTANT) {
+            // rodada no fio: quadros + preâmbulo e IFG (20 bytes)
+            size_t fsize = frame_size ? frame_size : t->frame_size;
+            if (!fsize) {
+                fsize = template_header_size(t) + t->payload_size + ETHERNET_FCS_SIZE +
+                        (set->probe_tag ? NW_PROBE_TAG_SIZE : 12);
             }
+            arrival_init(&arrivals[i], &t->arrival, (double)t->burst * 1e9 / (double)s->rate,
+                         (uint64_t)t->burst * (fsize + 20));
+            s->arrival = &arrivals[i];
+        }
+    }
+    return 0;
+}
 
-            if (pkt) {
-                add_packet_to_list(list, pkt);
+/*
+ * Fluxos intercalados pela roda de tempo, na ordem dos prazos, com IDs a
+ * partir de next_id. Só os datagramas com (ID - 1) % n_parts == part são
+ * montados; os demais só avançam o escalonador e a numeração.
+ */
+static int build_streams(const template_set_t *set, size_t frame_size, emit_out_t *out,
+                         uint32_t next_id, uint32_t part, uint32_t n_parts,
+                         uint64_t *lap_ns, size_t *short_frames) {
+    sched_stream_t *streams = calloc(set->count ? set->count : 1, sizeof(sched_stream_t));
+    uint32_t *emitted = calloc(set->count ? set->count : 1, sizeof(uint32_t));
+    arrival_t *arrivals = calloc(set->count ? set->count : 1, sizeof(arrival_t));
+    sched_wheel_t *wheel = malloc(sizeof(sched_wheel_t));
+    int rc = 1;
+    if (!streams || !emitted || !arrivals || !wheel) {
+        fprintf(stderr, "Falha ao alocar memória para o escalonador\n");
+        goto out;
+    }
+    if (prepare_streams(set, out->scheduled, frame_size, streams, arrivals) != 0 ||
+        sched_init(wheel, streams, (uint32_t)set->count) != 0) {
+        goto out;
+    }
+    uint32_t s_idx;
+    while (sched_next(wheel, &s_idx, &out->due_ns) == 0) {
+        const packet_template_t *t = &set->items[s_idx];
+        for (uint32_t b = 0; b < t->burst && emitted[s_idx] < t->packet_count; b++) {
+            if ((next_id - 1) % n_parts == part &&
+                emit_template_packet(set, t, (uint16_t)s_idx, out, frame_size, next_id,
+                                     short_frames) != 0) {
+                goto out;
             }
-            free(pl_with_id);
+            emitted[s_idx]++;
+            next_id++;
         }
     }
+    *lap_ns = 0;
+    if (out->scheduled) {
+        *lap_ns = 1;
+        for (size_t i = 0; i < set->count; i++) {
+            const uint64_t end = streams[i].count ? sched_stream_end(&streams[i]) : 0;
+            if (end > *lap_ns) *lap_ns = end;
+        }
+    }
+    rc = 0;
+out:
+    free(streams);
+    free(emitted);
+    free(arrivals);
+    free(wheel);
+    return rc;
+}
 
-    json_decref(root);
+int build_packets_from_templates(const template_set_t *set,
+                                 packet_list_t *list,
+                                 size_t frame_size) {
+    if (!set || !list) return 1;
+
+    uint32_t next_id = 1; // inicializa ID incremental
+    size_t   short_frames = 0;
+    const int scheduled = template_set_scheduled(set);
+
+    // sessões TCP: em bloco, antes dos fluxos intercalados
+    for (size_t t_idx = 0; t_idx < set->count; t_idx++) {
+        const packet_template_t *t = &set->items[t_idx];
+        if (!t->tcp_flows) continue;
+        if (scheduled) {
+            fprintf(stderr, "Template %zu: sessões TCP (tcp_flows) não combinam com rate_pps/start_ms\n",
+                    t_idx);
+            return 1;
+        }
+        packet_t *last = list->tail;
+        if (tcp_sessions_build(t, list, &next_id, frame_size, set->probe_tag) != 0) return 1;
+        for (packet_t *p = last ? last->next : list->head; p; p = p->next) {
+            p->tmpl = (uint16_t)t_idx;
+        }
+    }
+
+    // demais templates: fluxos intercalados pela roda de tempo, na ordem dos prazos
+    emit_out_t out = { .list = list, .scheduled = scheduled };
+    uint64_t lap_ns;
+    if (build_streams(set, frame_size, &out, next_id, 0, 1, &lap_ns, &short_frames) != 0) return 1;
+    if (scheduled) list->lap_ns = lap_ns;
+
+    if (short_frames > 0) {
+        fprintf(stderr, "Aviso: %zu pacotes excedem o quadro de %zu bytes e "
+                        "foram mantidos no tamanho natural\n",
+                short_frames, frame_size);
+    }
     return 0;
 }
+
+int build_packets_stream(const template_set_t *set, packet_stream_t *st) {
+    if (!set || !st || !st->sink || st->part >= (st->n_parts ? st->n_parts : 1)) return 1;
+    for (size_t t_idx = 0; t_idx < set->count; t_idx++) {
+        if (set->items[t_idx].tcp_flows) {
+            fprintf(stderr, "Template %zu: sessões TCP (tcp_flows) não são geradas em fluxo\n", t_idx);
+            return 1;
+        }
+    }
+    emit_out_t out = { .stream = st, .scheduled = template_set_scheduled(set) };
+    st->short_frames = 0;
+    return build_streams(set, st->frame_size, &out, 1, st->part, st->n_parts ? st->n_parts : 1,
+                         &st->lap_ns, &st->short_frames);
+}
+
+int load_templates_from_json(const char *filename,
+                             packet_list_t *list) {
+    template_set_t set;
+    if (load_template_set(filename, &set) != 0) {
+        return 1;
+    }
+
+    int rc = build_packets_from_templates(&set, list, 0);
+    free_template_set(&set);
+    return rc;
+}
@@ -0,0 +1,112 @@
+#include "../../include/generator/scheduler.h"
+#include <string.h>
+
+#define SCHED_MASK      (SCHED_SLOTS - 1)
+#define SCHED_MAX_TICK  1000000ULL
+
+/* prazo da rodada k de um fluxo, sem acumular erro de arredondamento */
+static uint64_t stream_due(const sched_stream_t *s, uint32_t k) {
+    return s->start_ns + (uint64_t)(((unsigned __int128)k * s->burst * 1000000000ULL) / s->rate);
+}
+
+uint64_t sched_stream_end(const sched_stream_t *s) {
+    if (s->arrival) return s->due_ns;
+    return s->rate ? stream_due(s, s->count) : s->start_ns;
+}
+
+static void wheel_insert(sched_wheel_t *w, uint32_t idx) {
+    sched_stream_t *s = &w->streams[idx];
+    uint64_t tick = s->due_ns / w->tick_ns;
+    if (tick < w->cursor) tick = w->cursor;     // atrasado: vai para a fatia corrente
+    s->link = SCHED_NONE;
+    if (tick >= w->cursor + SCHED_SLOTS) {
+        s->link = w->overflow;
+        w->overflow = idx;
+        return;
+    }
+    const uint32_t slot = (uint32_t)(tick & SCHED_MASK);
+    if (w->head[slot] == SCHED_NONE) {
+        w->head[slot] = idx;
+    } else {
+        w->streams[w->tail[slot]].link = idx;
+    }
+    w->tail[slot] = idx;
+    w->in_wheel++;
+}
+
+/* traz para a roda os fluxos do transbordo que entraram no horizonte */
+static void wheel_refill(sched_wheel_t *w) {
+    uint32_t idx = w->overflow;
+    w->overflow = SCHED_NONE;
+    while (idx != SCHED_NONE) {
+        const uint32_t next = w->streams[idx].link;
+        wheel_insert(w, idx);
+        idx = next;
+    }
+}
+
+int sched_init(sched_wheel_t *w, sched_stream_t *streams, uint32_t n_streams) {
+    memset(w, 0, sizeof(*w));
+    memset(w->head, 0xFF, sizeof(w->head));
+    w->streams   = streams;
+    w->n_streams = n_streams;
+    w->overflow  = SCHED_NONE;
+
+    uint64_t min_gap = SCHED_MAX_TICK * 2;
+    uint64_t first = UINT64_MAX;
+    for (uint32_t i = 0; i < n_streams; i++) {
+        sched_stream_t *s = &streams[i];
+        s->done   = 0;
+        s->due_ns = s->start_ns;
+        if (!s->count) continue;
+        if (!s->rate || !s->burst) return -1;
+        const uint64_t gap = s->arrival ? arrival_min_gap(s->arrival)
+                                        : (uint64_t)s->burst * 1000000000ULL / s->rate;
+        if (gap < min_gap) min_gap = gap;
+        if (s->start_ns < first) first = s->start_ns;
+        w->pending++;
+    }
+    w->tick_ns = min_gap / 2 ? min_gap / 2 : 1;
+    if (w->tick_ns > SCHED_MAX_TICK) w->tick_ns = SCHED_MAX_TICK;
+    w->cursor = w->pending ? first / w->tick_ns : 0;
+    for (uint32_t i = 0; i < n_streams; i++) {
+        if (streams[i].count) wheel_insert(w, i);
+    }
+    return 0;
+}
+
+int sched_next(sched_wheel_t *w, uint32_t *stream, uint64_t *due_ns) {
+    if (!w->pending) return -1;
+    for (;;) {
+        const uint32_t slot = (uint32_t)(w->cursor & SCHED_MASK);
+        const uint32_t idx = w->head[slot];
+        if (idx != SCHED_NONE) {
+            sched_stream_t *s = &w->streams[idx];
+            w->head[slot] = s->link;
+            w->in_wheel--;
+            *stream = idx;
+            *due_ns = s->due_ns;
+            ++s->done;
+            s->due_ns = s->arrival ? s->due_ns + arrival_next_gap(s->arrival) : stream_due(s, s->done);
+            if (s->done < s->count) {
+                wheel_insert(w, idx);
+            } else {
+                w->pending--;
+            }
+            return 0;
+        }
+        if (!w->in_wheel) {
+            // roda vazia: salta direto para o prazo mais próximo do transbordo
+            uint64_t min_tick = UINT64_MAX;
+            for (uint32_t i = w->overflow; i != SCHED_NONE; i = w->streams[i].link) {
+                const uint64_t t = w->streams[i].due_ns / w->tick_ns;
+                if (t < min_tick) min_tick = t;
+            }
+            w->cursor = min_tick;
+            wheel_refill(w);
+            continue;
+        }
+        w->cursor++;
+        if ((w->cursor & SCHED_MASK) == 0) wheel_refill(w);
+    }
+}
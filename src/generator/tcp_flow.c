@@ -0,0 +1,401 @@
+// tcp_flow.c
+#include "../../include/generator/tcp_flow.h"
+#include "../../include/generator/proto_tcp.h"
+#include "../../include/netwagon.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EMULATED_ISN_SEED 0x5EED1234u
+#define FIRST_EPHEMERAL   1024
+
+/* ---- tabela de fluxos ---- */
+
+tcp_flow_table_t *tcp_flow_table_create(uint32_t max_flows) {
+    uint64_t cap = 16;
+    while (cap < (uint64_t)max_flows * 2) cap <<= 1;
+    if (cap > (1ULL << 31)) return NULL;
+
+    tcp_flow_table_t *table = calloc(1, sizeof(tcp_flow_table_t));
+    if (!table) return NULL;
+    table->slots = calloc(cap, sizeof(tcp_flow_t));
+    if (!table->slots) {
+        free(table);
+        return NULL;
+    }
+    table->mask = (uint32_t)(cap - 1);
+    return table;
+}
+
+void tcp_flow_table_free(tcp_flow_table_t *table) {
+    if (!table) return;
+    free(table->slots);
+    free(table);
+}
+
+/* mistura final do splitmix64 */
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t hash_endpoint(const uint8_t *addr, uint16_t port, size_t addr_len) {
+    uint64_t h = 0xCBF29CE484222325ULL ^ port;
+    for (size_t i = 0; i < addr_len; i++) {
+        h = (h ^ addr[i]) * 0x100000001B3ULL;
+    }
+    return mix64(h);
+}
+
+uint64_t tcp_flow_key(const uint8_t *addr_a, uint16_t port_a,
+                      const uint8_t *addr_b, uint16_t port_b, size_t addr_len) {
+    uint64_t ha = hash_endpoint(addr_a, port_a, addr_len);
+    uint64_t hb = hash_endpoint(addr_b, port_b, addr_len);
+    // ordem canônica: o mesmo fluxo nos dois sentidos
+    uint64_t lo = ha < hb ? ha : hb;
+    uint64_t hi = ha < hb ? hb : ha;
+    uint64_t key = mix64(lo ^ (hi * 0x9E3779B97F4A7C15ULL));
+    return key ? key : 1;
+}
+
+uint32_t tcp_flow_insert(tcp_flow_table_t *table, uint64_t key,
+                         uint32_t client_isn, uint32_t emulated_isn, uint16_t client_port) {
+    if (table->count >= (table->mask + 1) / 2) return 0;
+    uint32_t i = (uint32_t)key & table->mask;
+    while (table->slots[i].key) {
+        if (table->slots[i].key == key) return 0;
+        i = (i + 1) & table->mask;
+    }
+    tcp_flow_t *f = &table->slots[i];
+    f->key          = key;
+    f->client_isn   = client_isn;
+    f->emulated_isn = emulated_isn;
+    f->client_port  = client_port;
+    atomic_init(&f->server_isn, emulated_isn);
+    atomic_init(&f->state, TCP_FLOW_SYN_SENT);
+    table->count++;
+    return i + 1;
+}
+
+void tcp_flow_table_reset(tcp_flow_table_t *table) {
+    if (!table) return;
+    for (uint32_t i = 0; i <= table->mask; i++) {
+        tcp_flow_t *f = &table->slots[i];
+        if (!f->key) continue;
+        atomic_store_explicit(&f->server_isn, f->emulated_isn, memory_order_relaxed);
+        atomic_store_explicit(&f->state, TCP_FLOW_SYN_SENT, memory_order_relaxed);
+    }
+    table->synack_seen = table->rst_seen = 0;
+    table->first_synack = table->last_synack = 0;
+}
+
+tcp_flow_t *tcp_flow_lookup(tcp_flow_table_t *table, uint64_t key) {
+    uint32_t i = (uint32_t)key & table->mask;
+    while (table->slots[i].key) {
+        if (table->slots[i].key == key) return &table->slots[i];
+        i = (i + 1) & table->mask;
+    }
+    return NULL;
+}
+
+/* ---- geração das sessões ---- */
+
+static uint32_t session_packets(const packet_template_t *t) {
+    const int emulate = t->tcp_emulate_server;
+    uint32_t n = 2 + (emulate ? 1 : 0);                      // SYN, [SYN-ACK], ACK
+    n += t->tcp_segments * (emulate ? 2 : 1);                // dados, [ACK do servidor]
+    if (t->tcp_close == TCP_CLOSE_FIN) n += emulate ? 3 : 2; // FIN, [FIN-ACK], ACK
+    else if (t->tcp_close == TCP_CLOSE_RST) n += 1;
+    return n;
+}
+
+uint32_t tcp_session_packet_count(const packet_template_t *t) {
+    return t->tcp_flows * session_packets(t);
+}
+
+/* soma n ao endereço (últimos 32 bits, ordem de rede) */
+static void addr_add(uint8_t *addr, size_t len, uint32_t n) {
+    uint32_t v = (uint32_t)addr[len - 4] << 24 | (uint32_t)addr[len - 3] << 16 |
+                 (uint32_t)addr[len - 2] << 8 | addr[len - 1];
+    v += n;
+    addr[len - 4] = (uint8_t)(v >> 24);
+    addr[len - 3] = (uint8_t)(v >> 16);
+    addr[len - 2] = (uint8_t)(v >> 8);
+    addr[len - 1] = (uint8_t)v;
+}
+
+/* estado de geração de uma sessão */
+typedef struct {
+    nw_flow_t client;       // cliente -> servidor
+    nw_flow_t server;       // servidor -> cliente (modo emulado)
+    uint32_t  client_isn;
+    uint32_t  server_isn;
+    uint32_t  sent;         // bytes de dados enviados pelo cliente
+    uint32_t  flow;         // índice + 1 na tabela
+} session_t;
+
+static int emit(packet_list_t *list, nw_flow_t *f, uint8_t flags, uint32_t seq, uint32_t ack,
+                const void *payload, size_t payload_size, uint32_t id, uint32_t flow) {
+    f->tcp_flags = flags;
+    f->tcp_seq   = seq;
+    f->tcp_ack   = ack;
+    packet_t *pkt = nw_packet_new(f, payload, payload_size);
+    if (!pkt) return -1;
+    pkt->id   = id;
+    pkt->flow = flow;
+    pkt->tcp_ack = ack;
+    add_packet_to_list(list, pkt);
+    return 0;
+}
+
+int tcp_sessions_build(const packet_template_t *t, packet_list_t *list,
+                       uint32_t *next_id, size_t frame_size, int probe_tag) {
+    nw_flow_t base;
+    if (nw_flow_from_template(&base, t) != 0) {
+        fprintf(stderr, "Template TCP: endereço inválido (%s -> %s)\n", t->src_ip, t->dst_ip);
+        return 1;
+    }
+    base.ethernet = 0;   // add_packet_to_list() acrescenta o Ethernet
+
+    if (!list->flows) {
+        list->flows = tcp_flow_table_create(t->tcp_flows);
+    } else if (list->flows->count + t->tcp_flows > (list->flows->mask + 1) / 2) {
+        // vários templates de sessão: recria com espaço para todos
+        tcp_flow_table_t *old = list->flows;
+        tcp_flow_table_t *bigger = tcp_flow_table_create(old->count + t->tcp_flows);
+        uint32_t *remap = calloc((size_t)old->mask + 1, sizeof(uint32_t));
+        if (bigger && remap) {
+            for (uint32_t i = 0; i <= old->mask; i++) {
+                const tcp_flow_t *f = &old->slots[i];
+                if (f->key) {
+                    remap[i] = tcp_flow_insert(bigger, f->key, f->client_isn,
+                                               f->emulated_isn, f->client_port);
+                }
+            }
+            // pacotes já gerados apontam para o índice antigo
+            for (packet_t *p = list->head; p; p = p->next) {
+                if (p->flow) p->flow = remap[p->flow - 1];
+            }
+        } else {
+            tcp_flow_table_free(bigger);
+            bigger = NULL;
+        }
+        free(remap);
+        tcp_flow_table_free(old);
+        list->flows = bigger;
+    }
+    if (!list->flows) {
+        fprintf(stderr, "Falha ao alocar tabela de fluxos TCP\n");
+        return 1;
+    }
+
+    const size_t alen = t->ip_version == IP_V4 ? 4 : 16;
+    const uint32_t base_port = t->src_port ? t->src_port : FIRST_EPHEMERAL;
+    const uint32_t ports = 65536 - base_port;
+    const uint32_t conc = t->tcp_concurrency ? t->tcp_concurrency : t->tcp_flows;
+
+    // payload dos segmentos: "ID|payload", completado até o quadro pedido
+    const size_t hdr_size = NW_ETH_HEADER_SIZE + nw_header_size(&base);
+    size_t pl_cap = t->payload_size + (probe_tag ? NW_PROBE_TAG_SIZE : 12);
+    size_t target = 0;
+    if (frame_size > hdr_size + NW_ETH_FCS_SIZE) {
+        target = frame_size - NW_ETH_FCS_SIZE - hdr_size;
+        if (target > pl_cap) pl_cap = target;
+    }
+    char *pl = calloc(1, pl_cap);
+    session_t *batch = calloc(conc, sizeof(session_t));
+    if (!pl || !batch) {
+        free(pl);
+        free(batch);
+        fprintf(stderr, "Falha ao alocar memória para sessões TCP\n");
+        return 1;
+    }
+
+    int rc = 0;
+    for (uint32_t first = 0; first < t->tcp_flows && rc == 0; first += conc) {
+        const uint32_t n = t->tcp_flows - first < conc ? t->tcp_flows - first : conc;
+
+        // fluxos do lote: porta de origem sequencial, depois endereço de origem
+        for (uint32_t k = 0; k < n; k++) {
+            session_t *s = &batch[k];
+            const uint32_t f = first + k;
+            s->client = base;
+            s->client.src_port = (uint16_t)(base_port + f % ports);
+            addr_add(s->client.src_addr, alen, f / ports);
+            s->server = s->client;
+            memcpy(s->server.src_addr, s->client.dst_addr, alen);
+            memcpy(s->server.dst_addr, s->client.src_addr, alen);
+            s->server.src_port = s->client.dst_port;
+            s->server.dst_port = s->client.src_port;
+
+            s->client_isn = t->tcp_seq + f * 0x9E3779B1u;
+            s->server_isn = (uint32_t)mix64(EMULATED_ISN_SEED ^ f);
+            s->sent = 0;
+            uint64_t key = tcp_flow_key(s->client.src_addr, s->client.src_port,
+                                        s->client.dst_addr, s->client.dst_port, alen);
+            s->flow = tcp_flow_insert(list->flows, key, s->client_isn, s->server_isn,
+                                      s->client.src_port);
+            // sem fluxo, a sessão sairia sem acompanhamento nem correção de ACK
+            if (!s->flow) {
+                fprintf(stderr, "Template TCP: sessão %u repete a 5-tupla de outra (templates com os "
+                                "mesmos endereços e portas, ou endereços de origem esgotados)\n", f);
+                rc = 1;
+                break;
+            }
+        }
+
+        // abertura: SYN, [SYN-ACK], ACK
+        for (uint32_t k = 0; k < n && rc == 0; k++) {
+            session_t *s = &batch[k];
+            rc = emit(list, &s->client, TCP_SYN, s->client_isn, 0, NULL, 0, 0, s->flow);
+        }
+        for (uint32_t k = 0; k < n && rc == 0 && t->tcp_emulate_server; k++) {
+            session_t *s = &batch[k];
+            rc = emit(list, &s->server, TCP_SYN | TCP_ACK, s->server_isn, s->client_isn + 1,
+                      NULL, 0, 0, 0);
+        }
+        for (uint32_t k = 0; k < n && rc == 0; k++) {
+            session_t *s = &batch[k];
+            rc = emit(list, &s->client, TCP_ACK, s->client_isn + 1, s->server_isn + 1,
+                      NULL, 0, 0, s->flow);
+        }
+
+        // dados: um segmento por fluxo a cada rodada
+        for (uint32_t seg = 0; seg < t->tcp_segments && rc == 0; seg++) {
+            for (uint32_t k = 0; k < n && rc == 0; k++) {
+                session_t *s = &batch[k];
+                const uint32_t id = (*next_id)++;
+                int len;
+                if (probe_tag) {
+                    nw_probe_tag_init((uint8_t *)pl, id);
+                    memcpy(pl + NW_PROBE_TAG_SIZE, t->payload, t->payload_size);
+                    len = (int)(NW_PROBE_TAG_SIZE + t->payload_size);
+                } else {
+                    len = snprintf(pl, pl_cap, "%u|%s", id, t->payload);
+                    if (len < 0 || (size_t)len >= pl_cap) {
+                        rc = 1;
+                        break;
+                    }
+                }
+                size_t pl_len = (size_t)len;
+                if (target > pl_len) {
+                    memset(pl + pl_len, 0, target - pl_len);
+                    pl_len = target;
+                }
+                const uint32_t seq = s->client_isn + 1 + s->sent;
+                rc = emit(list, &s->client, TCP_PSH | TCP_ACK, seq, s->server_isn + 1,
+                          pl, pl_len, id, s->flow);
+                if (rc == 0 && probe_tag) list->tail->probe_off = (uint16_t)hdr_size;
+                s->sent += (uint32_t)pl_len;
+                if (rc == 0 && t->tcp_emulate_server) {
+                    rc = emit(list, &s->server, TCP_ACK, s->server_isn + 1,
+                              s->client_isn + 1 + s->sent, NULL, 0, 0, 0);
+                }
+            }
+        }
+
+        // encerramento
+        for (uint32_t k = 0; k < n && rc == 0; k++) {
+            session_t *s = &batch[k];
+            const uint32_t seq = s->client_isn + 1 + s->sent;
+            if (t->tcp_close == TCP_CLOSE_RST) {
+                rc = emit(list, &s->client, TCP_RST | TCP_ACK, seq, s->server_isn + 1,
+                          NULL, 0, 0, s->flow);
+            } else if (t->tcp_close == TCP_CLOSE_FIN) {
+                rc = emit(list, &s->client, TCP_FIN | TCP_ACK, seq, s->server_isn + 1,
+                          NULL, 0, 0, s->flow);
+            }
+        }
+        for (uint32_t k = 0; k < n && rc == 0 && t->tcp_close == TCP_CLOSE_FIN; k++) {
+            session_t *s = &batch[k];
+            const uint32_t seq = s->client_isn + 1 + s->sent;
+            if (t->tcp_emulate_server) {
+                rc = emit(list, &s->server, TCP_FIN | TCP_ACK, s->server_isn + 1, seq + 1,
+                          NULL, 0, 0, 0);
+            }
+            if (rc == 0) {
+                rc = emit(list, &s->client, TCP_ACK, seq + 1, s->server_isn + 2,
+                          NULL, 0, 0, s->flow);
+            }
+        }
+    }
+
+    if (rc != 0) fprintf(stderr, "Falha ao gerar sessões TCP\n");
+    free(pl);
+    free(batch);
+    return rc;
+}
+
+/* ---- acompanhamento em tempo de execução ---- */
+
+static uint32_t load32(const uint8_t *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+void tcp_flow_observe(tcp_flow_table_t *table, const uint8_t *frame, size_t caplen,
+                      size_t l3_offset, size_t l4_offset, int ip_version, uint64_t now) {
+    if (!table || caplen < l4_offset + 20) return;
+    const uint8_t *tcp = frame + l4_offset;
+    const uint8_t flags = tcp[13];
+    if (!(flags & (TCP_SYN | TCP_RST))) return;
+
+    const uint8_t *src, *dst;
+    size_t alen;
+    if (ip_version == 4) {
+        src = frame + l3_offset + 12;
+        dst = frame + l3_offset + 16;
+        alen = 4;
+    } else {
+        src = frame + l3_offset + 8;
+        dst = frame + l3_offset + 24;
+        alen = 16;
+    }
+    uint16_t sport = (uint16_t)(tcp[0] << 8 | tcp[1]);
+    uint16_t dport = (uint16_t)(tcp[2] << 8 | tcp[3]);
+    tcp_flow_t *f = tcp_flow_lookup(table, tcp_flow_key(src, sport, dst, dport, alen));
+    if (!f) return;
+
+    if ((flags & (TCP_SYN | TCP_ACK)) == (TCP_SYN | TCP_ACK) && sport != f->client_port) {
+        if (atomic_load_explicit(&f->state, memory_order_relaxed) != TCP_FLOW_SYN_SENT) return;
+        atomic_store_explicit(&f->server_isn, load32(tcp + 4), memory_order_relaxed);
+        atomic_store_explicit(&f->state, TCP_FLOW_ESTABLISHED, memory_order_release);
+        if (!table->synack_seen++) table->first_synack = now;
+        table->last_synack = now;
+    } else if ((flags & TCP_RST) && sport != f->client_port) {
+        // o RST do próprio cliente também passa pela captura: conta só o do servidor
+        if (atomic_load_explicit(&f->state, memory_order_relaxed) != TCP_FLOW_RESET) {
+            atomic_store_explicit(&f->state, TCP_FLOW_RESET, memory_order_release);
+            table->rst_seen++;
+        }
+    }
+}
+
+void tcp_flow_patch_ack(tcp_flow_table_t *table, uint32_t flow, uint8_t *frame,
+                        size_t len, ip_version_t ip_version, uint32_t orig_ack) {
+    if (!table || flow == 0 || flow > table->mask + 1) return;
+    tcp_flow_t *f = &table->slots[flow - 1];
+    const size_t l4 = NW_ETH_HEADER_SIZE + (ip_version == IP_V4 ? 20 : 40);
+    if (len < l4 + 20) return;
+    uint8_t *tcp = frame + l4;
+    if (!(tcp[13] & TCP_ACK)) return;
+
+    // mantém o deslocamento em relação ao ISN emulado (SYN/FIN do servidor consumidos)
+    uint32_t new_ack = orig_ack;
+    if (atomic_load_explicit(&f->state, memory_order_acquire) == TCP_FLOW_ESTABLISHED) {
+        new_ack = atomic_load_explicit(&f->server_isn, memory_order_relaxed) + (orig_ack - f->emulated_isn);
+    }
+    const uint32_t old_ack = load32(tcp + 8);
+    if (new_ack == old_ack) return;
+    uint16_t csum = (uint16_t)(tcp[16] << 8 | tcp[17]);
+    csum = nw_csum_replace32(csum, old_ack, new_ack);
+    tcp[8]  = (uint8_t)(new_ack >> 24);
+    tcp[9]  = (uint8_t)(new_ack >> 16);
+    tcp[10] = (uint8_t)(new_ack >> 8);
+    tcp[11] = (uint8_t)new_ack;
+    tcp[16] = (uint8_t)(csum >> 8);
+    tcp[17] = (uint8_t)csum;
+}
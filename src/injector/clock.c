@@ -0,0 +1,135 @@
+// clock.c
+#include "../include/injector/clock.h"
+#include <stdio.h>
+#include <string.h>
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#define CALIBRATION_NS  50000000ULL     // 50 ms
+#define CALIBRATION_TRIES 5
+
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+const char *clock_src_name(int source) {
+    return source == CLOCK_SOURCE_TSC ? "tsc" : "monotonic";
+}
+
+#if defined(__x86_64__)
+
+/* procura as flags de TSC estável em /proc/cpuinfo (-1 = não foi possível ler) */
+static int cpuinfo_has_stable_tsc(void) {
+    FILE *fp = fopen("/proc/cpuinfo", "r");
+    if (!fp) return -1;
+    char line[4096];
+    int found = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "flags", 5) != 0) continue;
+        found = strstr(line, " constant_tsc") && strstr(line, " nonstop_tsc");
+        break;
+    }
+    fclose(fp);
+    return found;
+}
+
+/* o kernel rebaixa o TSC de clocksource quando o julga instável */
+static int kernel_trusts_tsc(void) {
+    FILE *fp = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+    if (!fp) return -1;
+    char name[64] = "";
+    int ok = fgets(name, sizeof(name), fp) && strncmp(name, "tsc", 3) == 0;
+    fclose(fp);
+    return ok;
+}
+
+static int tsc_invariant(const char **why) {
+    unsigned eax, ebx, ecx, edx;
+    // CPUID 0x80000007, EDX bit 8: TSC invariante (constante e sem parada em C-states)
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007 ||
+        !__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8))) {
+        // em VMs o bit costuma faltar; as flags do kernel decidem
+        if (cpuinfo_has_stable_tsc() != 1) {
+            *why = "CPU sem TSC invariante (constant_tsc/nonstop_tsc)";
+            return 0;
+        }
+    }
+    if (kernel_trusts_tsc() == 0) {
+        *why = "o kernel não usa o TSC como clocksource (instável?)";
+        return 0;
+    }
+    return 1;
+}
+
+/* leitura pareada TSC/CLOCK_MONOTONIC com a menor janela entre as tentativas */
+static void sample_pair(uint64_t *tsc, uint64_t *ns) {
+    uint64_t best = UINT64_MAX;
+    *tsc = *ns = 0;     // nenhuma leitura aproveitada: a calibração falha
+    for (int i = 0; i < CALIBRATION_TRIES; i++) {
+        unsigned aux;
+        uint64_t t0 = __rdtscp(&aux);
+        uint64_t n  = mono_ns();
+        uint64_t t1 = __rdtscp(&aux);
+        if (t1 - t0 < best) {
+            best = t1 - t0;
+            *tsc = t0 + (t1 - t0) / 2;
+            *ns  = n;
+        }
+    }
+}
+
+/* calibração única por processo */
+static clock_src_t tsc_cal;
+static int tsc_cal_done;
+
+static int tsc_calibrate(clock_src_t *c) {
+    if (!tsc_cal_done) {
+        uint64_t tsc0, ns0, tsc1, ns1;
+        sample_pair(&tsc0, &ns0);
+        struct timespec ts = { .tv_sec = 0, .tv_nsec = (long)CALIBRATION_NS };
+        nanosleep(&ts, NULL);
+        sample_pair(&tsc1, &ns1);
+        if (tsc1 <= tsc0 || ns1 <= ns0) return -1;
+
+        const uint64_t hz = (uint64_t)((unsigned __int128)(tsc1 - tsc0) * 1000000000ULL / (ns1 - ns0));
+        if (hz < 1000000ULL) return -1;
+        tsc_cal.source     = CLOCK_SOURCE_TSC;
+        tsc_cal.hz         = hz;
+        tsc_cal.mult       = (uint64_t)(((unsigned __int128)1000000000ULL << 32) / hz);
+        tsc_cal.inv_mult   = (uint64_t)(((unsigned __int128)hz << 32) / 1000000000ULL);
+        tsc_cal.base_ticks = tsc1;
+        tsc_cal.base_ns    = ns1;
+        tsc_cal_done = 1;
+    }
+    *c = tsc_cal;
+    return 0;
+}
+
+#endif // __x86_64__
+
+static int fallback_warned;     // avisa uma única vez por processo
+
+int clock_src_init(clock_src_t *c, int want) {
+    memset(c, 0, sizeof(*c));
+    c->source = CLOCK_SOURCE_MONOTONIC;
+    c->hz     = 1000000000ULL;
+
+    if (want != CLOCK_SOURCE_TSC) return c->source;
+#if defined(__x86_64__)
+    const char *why = NULL;
+    if (!tsc_invariant(&why)) {
+        if (!fallback_warned++) fprintf(stderr, "Aviso: %s; usando CLOCK_MONOTONIC\n", why);
+    } else if (tsc_calibrate(c) != 0) {
+        if (!fallback_warned++) fprintf(stderr, "Aviso: falha ao calibrar o TSC; usando CLOCK_MONOTONIC\n");
+        c->source = CLOCK_SOURCE_MONOTONIC;
+    }
+#else
+    if (!fallback_warned++) {
+        fprintf(stderr, "Aviso: relógio TSC só existe em x86-64; usando CLOCK_MONOTONIC\n");
+    }
+#endif
+    return c->source;
+}
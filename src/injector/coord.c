@@ -0,0 +1,746 @@
+// coord.c
+#define _GNU_SOURCE
+#include "../include/injector/coord.h"
+#include "../include/generator/template.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <jansson.h>
+#include <netdb.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#define COORD_MAX_WORKERS   256
+#define COORD_MAX_MSG       (16ULL << 20)       // JOB (JSON dos templates), READY, ERROR
+#define COORD_MAX_RESULT    (256ULL << 20)      // RESULT: ~1,2 KB de histograma por fluxo
+#define COORD_MAX_HELLO     COORD_SPEC_SIZE     // antes do token, nada maior é aceito
+#define COORD_CONNECT_TRIES 50              // x 100 ms: tempo para um worker lançado abrir o socket
+
+static uint64_t realtime_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* ---------- transporte ---------- */
+
+/*
+ * "unix:/caminho", "tcp:host:porta" ou "host:porta" -> socket conectado ou em
+ * escuta. Em escuta, host vazio é o loopback e "*" são todas as interfaces.
+ */
+static int coord_socket(const char *addr, int listening) {
+    if (strncmp(addr, "unix:", 5) == 0) {
+        struct sockaddr_un sun;
+        memset(&sun, 0, sizeof(sun));
+        sun.sun_family = AF_UNIX;
+        if (strlen(addr + 5) >= sizeof(sun.sun_path)) {
+            fprintf(stderr, "coord: caminho longo demais '%s'\n", addr + 5);
+            return -1;
+        }
+        strcpy(sun.sun_path, addr + 5);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        if (listening) {
+            // socket 0600: só o dono do worker conecta
+            unlink(sun.sun_path);
+            const mode_t old = umask(077);
+            const int bound = bind(fd, (struct sockaddr *)&sun, sizeof(sun));
+            umask(old);
+            if (bound != 0 || listen(fd, 4) != 0) {
+                close(fd);
+                return -1;
+            }
+        } else if (connect(fd, (struct sockaddr *)&sun, sizeof(sun)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    char host[COORD_SPEC_SIZE];
+    snprintf(host, sizeof(host), "%s", strncmp(addr, "tcp:", 4) == 0 ? addr + 4 : addr);
+    char *colon = strrchr(host, ':');
+    if (!colon) {
+        fprintf(stderr, "coord: endereço sem porta '%s'\n", addr);
+        return -1;
+    }
+    *colon = '\0';
+    const char *port = colon + 1;
+    char *h = host;
+    if (*h == '[') {                            // [::1]:7070
+        h++;
+        char *end = strchr(h, ']');
+        if (end) *end = '\0';
+    }
+    const int any = strcmp(h, "*") == 0;
+    if (any) h = NULL;
+    else if (*h == '\0') h = listening ? "127.0.0.1" : NULL;
+
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = listening && any ? AI_PASSIVE : 0;
+    const int gai = getaddrinfo(h, port, &hints, &res);
+    if (gai != 0) {
+        fprintf(stderr, "coord: '%s': %s\n", addr, gai_strerror(gai));
+        return -1;
+    }
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        const int one = 1;
+        if (listening) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 4) == 0) break;
+        } else if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+/* comparação em tempo constante no conteúdo (o tamanho não é segredo) */
+static int token_equal(const char *a, size_t alen, const char *b) {
+    const size_t blen = strlen(b);
+    unsigned diff = alen != blen;
+    for (size_t i = 0; i < alen && i < blen; i++) diff |= (unsigned)(a[i] ^ b[i]);
+    return diff == 0;
+}
+
+static int write_all(int fd, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    while (len > 0) {
+        const ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p   += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *buf, size_t len) {
+    uint8_t *p = buf;
+    while (len > 0) {
+        const ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;     // erro ou conexão fechada
+        p   += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* mensagem = cabeçalho + a + b */
+static int coord_send(int fd, uint32_t type, const void *a, size_t alen, const void *b, size_t blen) {
+    coord_hdr_t hdr = { .magic = COORD_MAGIC, .type = type, .len = alen + blen };
+    if (write_all(fd, &hdr, sizeof(hdr)) != 0) return -1;
+    if (alen && write_all(fd, a, alen) != 0) return -1;
+    if (blen && write_all(fd, b, blen) != 0) return -1;
+    return 0;
+}
+
+/*
+ * Recebe uma mensagem de até max bytes; *payload (terminado em '\0') deve
+ * ser liberado pelo chamador.
+ */
+static int coord_recv(int fd, uint32_t *type, void **payload, size_t *len, uint64_t max) {
+    coord_hdr_t hdr;
+    *payload = NULL;
+    if (read_all(fd, &hdr, sizeof(hdr)) != 0) return -1;
+    if (hdr.magic != COORD_MAGIC) {
+        fprintf(stderr, "coord: mensagem inválida (versões diferentes?)\n");
+        return -1;
+    }
+    if (hdr.len > max) {
+        fprintf(stderr, "coord: mensagem de %llu bytes excede o limite de %llu\n",
+                (unsigned long long)hdr.len, (unsigned long long)max);
+        return -1;
+    }
+    char *buf = malloc(hdr.len + 1);
+    if (!buf) return -1;
+    if (hdr.len && read_all(fd, buf, hdr.len) != 0) {
+        free(buf);
+        return -1;
+    }
+    buf[hdr.len] = '\0';
+    *type    = hdr.type;
+    *payload = buf;
+    *len     = hdr.len;
+    return 0;
+}
+
+static void coord_send_error(int fd, const char *msg) {
+    coord_send(fd, COORD_MSG_ERROR, msg, strlen(msg), NULL, 0);
+}
+
+/* ---------- worker ---------- */
+
+typedef struct {
+    coord_job_t   job;
+    packet_list_t *list;
+    uint16_t      *orig_idx;    // template local -> índice no JSON completo
+} worker_job_t;
+
+static void worker_job_free(worker_job_t *w) {
+    if (w->list) free_packet_list(w->list);
+    free(w->orig_idx);
+    w->list = NULL;
+    w->orig_idx = NULL;
+}
+
+/* monta a lista da parte pedida; devolve o texto do erro ou NULL */
+static const char *worker_prepare(worker_job_t *w, const void *payload, size_t len) {
+    if (len < sizeof(coord_job_t)) return "JOB truncado";
+    memcpy(&w->job, payload, sizeof(coord_job_t));
+    w->job.tx[COORD_SPEC_SIZE - 1] = w->job.rx[COORD_SPEC_SIZE - 1] = '\0';
+
+    const int csum_offload = (io_tx_spec_flags(w->job.tx) & IO_FLAG_VNET_HDR) != 0;
+    if (csum_offload && w->job.engine != TXRX_ENGINE_THREADS) return "TX 'vnet:' exige --engine threads";
+
+    template_set_t set;
+    const char *json = (const char *)payload + sizeof(coord_job_t);
+    if (load_template_set_buffer(json, len - sizeof(coord_job_t), &set) != 0) return "templates inválidos";
+    w->orig_idx = calloc(set.count ? set.count : 1, sizeof(uint16_t));
+    w->list     = create_packet_list();
+    if (!w->orig_idx || !w->list ||
+        template_set_shard(&set, w->job.shard, w->job.n_shards, w->orig_idx) != 0) {
+        free_template_set(&set);
+        return "falha ao dividir os templates";
+    }
+    set.probe_tag    = w->job.stamp;
+    set.csum_offload = csum_offload;
+    set.rate_pps     = w->job.rate_pps == TXRX_RATE_UNLIMITED ? 0 : w->job.rate_pps;
+    const int rc = build_packets_from_templates(&set, w->list, 0);
+    free_template_set(&set);
+    return rc == 0 ? NULL : "falha ao gerar pacotes";
+}
+
+/* espera o instante de partida, executa e devolve o resultado */
+static int worker_run(int fd, worker_job_t *w, const void *payload, size_t len) {
+    if (len < sizeof(coord_start_t) || !w->list) {
+        coord_send_error(fd, "START sem JOB");
+        return -1;
+    }
+    coord_start_t start;
+    memcpy(&start, payload, sizeof(start));
+    struct timespec ts = { .tv_sec  = (time_t)(start.start_ns / 1000000000ULL),
+                           .tv_nsec = (long)(start.start_ns % 1000000000ULL) };
+    while (clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+
+    coord_result_t out;
+    memset(&out, 0, sizeof(out));
+    const uint64_t now = realtime_now_ns();
+    out.start_late_ns = now > start.start_ns ? now - start.start_ns : 0;
+    out.flow_size     = sizeof(flow_stat_t);
+
+    // parte vazia (mais workers que pacotes): nada a enviar
+    if (w->list->count > 0) {
+        txrx_opts_t opts;
+        memset(&opts, 0, sizeof(opts));
+        rt_opts_init(&opts.rt);
+        opts.rate_pps   = w->job.rate_pps;
+        opts.timeout_ms = w->job.timeout_ms;
+        opts.warmup_ms  = w->job.warmup_ms;
+        opts.late_ms    = w->job.late_ms;
+        opts.engine     = w->job.engine;
+        opts.sqpoll     = w->job.sqpoll;
+        opts.stamp      = w->job.stamp;
+        opts.clock      = w->job.clock;
+        opts.impair     = w->job.impair;
+        opts.quiet      = 1;
+        opts.keep_flows = 1;
+        out.rc = txrx_run_ex(w->list, w->job.tx, w->job.rx, &opts, &out.result);
+    }
+
+    flow_stats_t *fs = out.result.flows;
+    out.result.flows = NULL;
+    if (fs) {
+        out.n_flows = fs->count;
+        for (uint32_t i = 0; i < fs->count; i++) {
+            fs->flows[i].tmpl = w->orig_idx[fs->flows[i].tmpl];
+        }
+    }
+    const int rc = coord_send(fd, COORD_MSG_RESULT, &out, sizeof(out),
+                              fs ? fs->flows : NULL, fs ? (size_t)fs->count * sizeof(flow_stat_t) : 0);
+    flow_stats_free(fs);
+    worker_job_free(w);
+    return rc;
+}
+
+/* primeira mensagem da conexão: HELLO com o token do worker; 0 = aceito */
+static int worker_hello(int fd, const char *token) {
+    uint32_t type;
+    void *payload;
+    size_t len;
+    if (coord_recv(fd, &type, &payload, &len, COORD_MAX_HELLO) != 0) return -1;
+    const int ok = type == COORD_MSG_HELLO && token_equal(payload, len, token);
+    free(payload);
+    if (!ok) {
+        fprintf(stderr, "worker: conexão recusada (token ausente ou diferente)\n");
+        coord_send_error(fd, "token inválido (" COORD_TOKEN_ENV ")");
+        return -1;
+    }
+    return 0;
+}
+
+/* atende um coordenador; 1 = BYE recebido */
+static int worker_session(int fd, const char *token) {
+    if (worker_hello(fd, token) != 0) return 0;
+    worker_job_t w;
+    memset(&w, 0, sizeof(w));
+    int bye = 0;
+    for (;;) {
+        uint32_t type;
+        void *payload;
+        size_t len;
+        if (coord_recv(fd, &type, &payload, &len, COORD_MAX_MSG) != 0) break;
+        if (type == COORD_MSG_JOB) {
+            worker_job_free(&w);
+            const char *err = worker_prepare(&w, payload, len);
+            if (err) {
+                worker_job_free(&w);
+                coord_send_error(fd, err);
+            } else {
+                coord_ready_t ready = { .packets = (uint32_t)w.list->count };
+                coord_send(fd, COORD_MSG_READY, &ready, sizeof(ready), NULL, 0);
+            }
+        } else if (type == COORD_MSG_START) {
+            worker_run(fd, &w, payload, len);
+        } else if (type == COORD_MSG_BYE) {
+            bye = 1;
+        }
+        free(payload);
+        if (bye) break;
+    }
+    worker_job_free(&w);
+    return bye;
+}
+
+int coord_worker_serve(const char *addr) {
+    const char *token = getenv(COORD_TOKEN_ENV);
+    if (!token) token = "";
+    if (strlen(token) > COORD_MAX_HELLO) {
+        fprintf(stderr, "worker: %s com mais de %d bytes\n", COORD_TOKEN_ENV, COORD_MAX_HELLO);
+        return 1;
+    }
+    // um JOB lê e grava arquivos (file:) com os privilégios do worker: TCP, mesmo
+    // no loopback, alcança qualquer usuário do host; só o socket Unix 0600 dispensa o token
+    if (!token[0] && strncmp(addr, "unix:", 5) != 0) {
+        fprintf(stderr, "worker: escuta TCP exige %s (o mesmo no coordenador); "
+                        "sem token, use unix:/caminho\n", COORD_TOKEN_ENV);
+        return 1;
+    }
+    int lfd = coord_socket(addr, 1);
+    if (lfd < 0) {
+        fprintf(stderr, "worker: não escutou em '%s': %s\n", addr, strerror(errno));
+        return 1;
+    }
+    printf("Worker escutando em '%s'\n", addr);
+    fflush(stdout);
+    for (;;) {
+        int fd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            perror("worker: accept");
+            break;
+        }
+        const int bye = worker_session(fd, token);
+        close(fd);
+        if (bye) break;
+    }
+    close(lfd);
+    if (strncmp(addr, "unix:", 5) == 0) unlink(addr + 5);
+    return 0;
+}
+
+/* ---------- coordenador ---------- */
+
+typedef struct {
+    char           addr[COORD_SPEC_SIZE];
+    char           tx[COORD_SPEC_SIZE];
+    char           rx[COORD_SPEC_SIZE];
+    pid_t          pid;         // processo local lançado (0 = worker externo)
+    int            fd;
+    uint32_t       packets;
+    uint64_t       rate_pps;
+    coord_result_t res;
+    flow_stat_t    *flows;
+} coord_worker_t;
+
+static int load_cluster(const char *filename, coord_worker_t *w, uint32_t *n) {
+    json_error_t error;
+    json_t *root = json_load_file(filename, 0, &error);
+    if (!root) {
+        fprintf(stderr, "Erro ao abrir JSON '%s': %s\n", filename, error.text);
+        return -1;
+    }
+    *n = 0;
+    int rc = 0;
+    const size_t count = json_array_size(root);
+    if (!json_is_array(root) || count == 0 || count > COORD_MAX_WORKERS) {
+        fprintf(stderr, "coord: '%s' deve ser um array de 1 a %d workers\n", filename, COORD_MAX_WORKERS);
+        rc = -1;
+    }
+    for (size_t i = 0; rc == 0 && i < count; i++) {
+        const json_t *obj = json_array_get(root, i);
+        const char *connect_s = json_string_value(json_object_get(obj, "connect"));
+        const char *tx = json_string_value(json_object_get(obj, "tx"));
+        const char *rx = json_string_value(json_object_get(obj, "rx"));
+        if (!tx || !rx || strlen(tx) >= COORD_SPEC_SIZE || strlen(rx) >= COORD_SPEC_SIZE) {
+            fprintf(stderr, "coord: worker %zu: tx e rx obrigatórios\n", i);
+            rc = -1;
+            break;
+        }
+        memset(&w[i], 0, sizeof(w[i]));
+        w[i].fd = -1;
+        snprintf(w[i].addr, sizeof(w[i].addr), "%s", connect_s ? connect_s : "");
+        snprintf(w[i].tx, sizeof(w[i].tx), "%s", tx);
+        snprintf(w[i].rx, sizeof(w[i].rx), "%s", rx);
+        (*n)++;
+    }
+    json_decref(root);
+    return rc;
+}
+
+static char *read_file(const char *filename, size_t *len) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        fprintf(stderr, "Erro ao abrir '%s': %s\n", filename, strerror(errno));
+        return NULL;
+    }
+    char *buf = NULL;
+    long size = -1;
+    if (fseek(fp, 0, SEEK_END) == 0) size = ftell(fp);
+    if (size >= 0 && fseek(fp, 0, SEEK_SET) == 0) buf = malloc((size_t)size + 1);
+    if (buf && fread(buf, 1, (size_t)size, fp) != (size_t)size) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(fp);
+    if (!buf) {
+        fprintf(stderr, "Erro ao ler '%s'\n", filename);
+        return NULL;
+    }
+    buf[size] = '\0';
+    *len = (size_t)size;
+    return buf;
+}
+
+/* processo local: o próprio executável em modo worker, num socket Unix em dir (mkdtemp, 0700) */
+static int launch_worker(coord_worker_t *w, uint32_t k, const char *dir) {
+    snprintf(w->addr, sizeof(w->addr), "unix:%s/worker-%u.sock", dir, k);
+    const pid_t pid = fork();
+    if (pid < 0) {
+        perror("coord: fork");
+        return -1;
+    }
+    if (pid == 0) {
+        const int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) dup2(devnull, STDOUT_FILENO);
+        execl("/proc/self/exe", "netwagon", "--worker", w->addr, (char *)NULL);
+        _exit(127);
+    }
+    w->pid = pid;
+    return 0;
+}
+
+/* conecta e se apresenta com o token */
+static int connect_worker(coord_worker_t *w, uint32_t k, const char *token) {
+    for (int i = 0; i < COORD_CONNECT_TRIES; i++) {
+        w->fd = coord_socket(w->addr, 0);
+        if (w->fd >= 0) {
+            if (coord_send(w->fd, COORD_MSG_HELLO, token, strlen(token), NULL, 0) == 0) return 0;
+            fprintf(stderr, "coord: worker %u: falha ao enviar HELLO\n", k);
+            return -1;
+        }
+        if (w->pid && waitpid(w->pid, NULL, WNOHANG) == w->pid) {
+            w->pid = 0;         // o worker lançado já terminou
+            break;
+        }
+        usleep(100000);
+    }
+    fprintf(stderr, "coord: worker %u: sem conexão com '%s'\n", k, w->addr);
+    return -1;
+}
+
+/* espera a resposta de um worker; ERROR vira mensagem e -1 */
+static int expect(coord_worker_t *w, uint32_t k, uint32_t want, void **payload, size_t *len) {
+    uint32_t type;
+    const uint64_t max = want == COORD_MSG_RESULT ? COORD_MAX_RESULT : COORD_MAX_MSG;
+    if (coord_recv(w->fd, &type, payload, len, max) != 0) {
+        fprintf(stderr, "coord: worker %u: conexão perdida\n", k);
+        return -1;
+    }
+    if (type == COORD_MSG_ERROR) {
+        fprintf(stderr, "coord: worker %u: %s\n", k, (char *)*payload);
+    } else if (type == want) {
+        return 0;
+    } else {
+        fprintf(stderr, "coord: worker %u: resposta inesperada (%u)\n", k, type);
+    }
+    free(*payload);
+    *payload = NULL;
+    return -1;
+}
+
+/*
+ * Ordem por template original + 5-tupla. O key do worker não serve: é o hash
+ * com o índice do template dentro da parte dele, que difere entre workers.
+ */
+static int cmp_flow(const void *a, const void *b) {
+    const flow_stat_t *x = a, *y = b;
+    if (x->tmpl != y->tmpl) return x->tmpl < y->tmpl ? -1 : 1;
+    if (x->ip_version != y->ip_version) return x->ip_version < y->ip_version ? -1 : 1;
+    if (x->proto != y->proto) return x->proto < y->proto ? -1 : 1;
+    if (x->src_port != y->src_port) return x->src_port < y->src_port ? -1 : 1;
+    if (x->dst_port != y->dst_port) return x->dst_port < y->dst_port ? -1 : 1;
+    const int c = memcmp(x->src_addr, y->src_addr, sizeof(x->src_addr));
+    if (c) return c;
+    return memcmp(x->dst_addr, y->dst_addr, sizeof(x->dst_addr));
+}
+
+/* junta os fluxos de todos os workers: o mesmo fluxo (template + 5-tupla) vira uma linha */
+static flow_stat_t *merge_flows(coord_worker_t *w, uint32_t n, uint32_t *count) {
+    uint64_t total = 0;
+    for (uint32_t k = 0; k < n; k++) total += w[k].res.n_flows;
+    *count = 0;
+    flow_stat_t *all = malloc((total ? total : 1) * sizeof(flow_stat_t));
+    if (!all) return NULL;
+    uint32_t m = 0;
+    for (uint32_t k = 0; k < n; k++) {
+        if (w[k].res.n_flows) memcpy(&all[m], w[k].flows, (size_t)w[k].res.n_flows * sizeof(flow_stat_t));
+        m += w[k].res.n_flows;
+    }
+    qsort(all, m, sizeof(flow_stat_t), cmp_flow);
+    uint32_t out = 0;
+    for (uint32_t i = 0; i < m; i++) {
+        if (out && cmp_flow(&all[out - 1], &all[i]) == 0) {
+            flow_stat_merge(&all[out - 1], &all[i]);
+        } else {
+            all[out++] = all[i];
+        }
+    }
+    *count = out;
+    return all;
+}
+
+static void coord_report(coord_worker_t *w, uint32_t n, const txrx_opts_t *opts) {
+    uint64_t sent = 0, received = 0, lost = 0, warmup = 0;
+    double offered = 0.0, achieved = 0.0;
+    seq_stats_t seq;
+    memset(&seq, 0, sizeof(seq));
+
+    printf("Workers:\n");
+    for (uint32_t k = 0; k < n; k++) {
+        const txrx_result_t *r = &w[k].res.result;
+        printf("  %-3u %-36s tx=%s rx=%s: pacotes=%u enviados=%u recebidos=%u perda=%.2f%% "
+               "obtida=%.0f pps p99=%.1f us partida=+%.1f us%s\n",
+               k, w[k].addr, w[k].tx, w[k].rx, w[k].packets, r->sent, r->received, r->loss_pct,
+               r->achieved_pps, r->latency.p99_ns / 1e3, w[k].res.start_late_ns / 1e3,
+               w[k].res.rc ? " (falhou)" : "");
+        sent     += r->sent;
+        received += r->received;
+        lost     += r->lost;
+        warmup   += r->warmup_pkts;
+        offered  += r->offered_pps;
+        achieved += r->achieved_pps;
+        seq_stats_merge(&seq, &r->seq);
+    }
+
+    uint32_t n_flows = 0;
+    flow_stat_t *flows = merge_flows(w, n, &n_flows);
+    flow_stat_t all;
+    memset(&all, 0, sizeof(all));
+    all.min_ns = UINT64_MAX;
+    for (uint32_t i = 0; flows && i < n_flows; i++) flow_stat_merge(&all, &flows[i]);
+
+    printf("TX/RX coordenado concluído: workers=%u, enviados=%llu, recebidos=%llu, perdidos=%llu, "
+           "perda=%.2f%%\n", n, (unsigned long long)sent, (unsigned long long)received,
+           (unsigned long long)lost, sent ? (double)lost / (double)sent * 100.0 : 0.0);
+    if (warmup) printf("Warm-up: %llu pacotes fora das métricas\n", (unsigned long long)warmup);
+    if (all.samples) {
+        printf("Latência (us, histograma combinado): min=%.1f média=%.1f p50=%.1f p99=%.1f "
+               "p99.9=%.1f max=%.1f\n",
+               all.min_ns / 1e3, (double)all.sum_ns / all.samples / 1e3,
+               flow_stats_percentile(&all, 0.50) / 1e3, flow_stats_percentile(&all, 0.99) / 1e3,
+               flow_stats_percentile(&all, 0.999) / 1e3, all.max_ns / 1e3);
+    }
+    if (offered > 0.0) {
+        printf("Taxa: ofertada=%.0f pps, obtida=%.0f pps (soma dos workers)\n", offered, achieved);
+    } else {
+        printf("Taxa: obtida=%.0f pps (soma dos workers)\n", achieved);
+    }
+    seq_stats_print(&seq, stdout);
+
+    if (flows) {
+        flow_stats_t fs;
+        memset(&fs, 0, sizeof(fs));
+        fs.flows = flows;
+        fs.count = n_flows;
+        flow_stats_print_top(&fs, opts->flow_top, stdout);
+        if (opts->flow_csv && flow_stats_save_csv(&fs, opts->flow_csv) != 0) {
+            fprintf(stderr, "Falha ao exportar estatísticas por fluxo\n");
+        }
+    }
+    free(flows);
+}
+
+int coord_run(const char *cluster_file, const char *templates_file, const txrx_opts_t *opts) {
+    if (!cluster_file || !templates_file || !opts) return -1;
+    coord_worker_t *w = calloc(COORD_MAX_WORKERS, sizeof(coord_worker_t));
+    size_t json_len = 0;
+    char *json = read_file(templates_file, &json_len);
+    uint32_t n = 0;
+    int rc = -1;
+    char dir[] = "/tmp/netwagon-coord-XXXXXX";
+    int have_dir = 0;
+    const char *token = getenv(COORD_TOKEN_ENV);
+    if (!token) token = "";
+    if (!w || !json || load_cluster(cluster_file, w, &n) != 0) goto out;
+    if (json_len + sizeof(coord_job_t) > COORD_MAX_MSG || strlen(token) > COORD_MAX_HELLO) {
+        fprintf(stderr, "coord: templates acima de %llu MiB ou %s acima de %d bytes\n",
+                (unsigned long long)(COORD_MAX_MSG >> 20), COORD_TOKEN_ENV, COORD_MAX_HELLO);
+        goto out;
+    }
+
+    // partes e orçamentos de taxa, calculados aqui com a mesma divisão dos workers
+    uint64_t total = 0;
+    for (uint32_t k = 0; k < n; k++) {
+        template_set_t set;
+        uint16_t *idx = NULL;
+        if (load_template_set_buffer(json, json_len, &set) != 0) goto out;
+        idx = calloc(set.count ? set.count : 1, sizeof(uint16_t));
+        if (!idx || template_set_shard(&set, k, n, idx) != 0) {
+            free(idx);
+            free_template_set(&set);
+            goto out;
+        }
+        w[k].packets = template_set_packet_count(&set);
+        total += w[k].packets;
+        free(idx);
+        free_template_set(&set);
+    }
+    if (total == 0) {
+        fprintf(stderr, "coord: templates não geram pacotes\n");
+        goto out;
+    }
+    const int finite = opts->rate_pps && opts->rate_pps != TXRX_RATE_UNLIMITED;
+    for (uint32_t k = 0; k < n; k++) {
+        w[k].rate_pps = opts->rate_pps;
+        if (finite) {
+            w[k].rate_pps = (uint64_t)((unsigned __int128)opts->rate_pps * w[k].packets / total);
+            if (!w[k].rate_pps) w[k].rate_pps = 1;
+        }
+    }
+
+    // conecta (lançando os workers locais) e distribui as partes
+    for (uint32_t k = 0; k < n; k++) {
+        if (w[k].addr[0]) continue;
+        if (!have_dir) {
+            if (!mkdtemp(dir)) {
+                perror("coord: mkdtemp");
+                goto out;
+            }
+            have_dir = 1;
+        }
+        if (launch_worker(&w[k], k, dir) != 0) goto out;
+    }
+    for (uint32_t k = 0; k < n; k++) {
+        if (connect_worker(&w[k], k, token) != 0) goto out;
+        coord_job_t job;
+        memset(&job, 0, sizeof(job));
+        job.shard      = k;
+        job.n_shards   = n;
+        job.rate_pps   = w[k].rate_pps;
+        job.timeout_ms = opts->timeout_ms;
+        job.warmup_ms  = opts->warmup_ms;
+        job.late_ms    = opts->late_ms;
+        job.engine     = opts->engine;
+        job.sqpoll     = opts->sqpoll;
+        job.stamp      = opts->stamp;
+        job.clock      = opts->clock;
+        job.impair     = opts->impair;
+        job.impair.seed += k;       // perdas independentes entre os workers
+        memcpy(job.tx, w[k].tx, sizeof(job.tx));
+        memcpy(job.rx, w[k].rx, sizeof(job.rx));
+        if (coord_send(w[k].fd, COORD_MSG_JOB, &job, sizeof(job), json, json_len) != 0) {
+            fprintf(stderr, "coord: worker %u: falha ao enviar a parte\n", k);
+            goto out;
+        }
+    }
+    for (uint32_t k = 0; k < n; k++) {
+        void *payload;
+        size_t len;
+        if (expect(&w[k], k, COORD_MSG_READY, &payload, &len) != 0) goto out;
+        free(payload);
+    }
+
+    // partida sincronizada (entre hosts, depende de NTP/PTP)
+    coord_start_t start = { .start_ns = realtime_now_ns() + COORD_START_LEAD_MS * 1000000ULL };
+    printf("Iniciando TX/RX coordenado: %u workers, %llu pacotes, partida em %d ms\n",
+           n, (unsigned long long)total, COORD_START_LEAD_MS);
+    fflush(stdout);
+    for (uint32_t k = 0; k < n; k++) {
+        if (coord_send(w[k].fd, COORD_MSG_START, &start, sizeof(start), NULL, 0) != 0) {
+            fprintf(stderr, "coord: worker %u: falha ao enviar START\n", k);
+            goto out;
+        }
+    }
+
+    int failed = 0;
+    for (uint32_t k = 0; k < n; k++) {
+        void *payload;
+        size_t len;
+        if (expect(&w[k], k, COORD_MSG_RESULT, &payload, &len) != 0) goto out;
+        memcpy(&w[k].res, payload, len < sizeof(coord_result_t) ? len : sizeof(coord_result_t));
+        const size_t flows_len = (size_t)w[k].res.n_flows * sizeof(flow_stat_t);
+        if (len != sizeof(coord_result_t) + flows_len || w[k].res.flow_size != sizeof(flow_stat_t)) {
+            fprintf(stderr, "coord: worker %u: resultado incompatível (versões diferentes?)\n", k);
+            free(payload);
+            goto out;
+        }
+        w[k].res.result.flows = NULL;
+        w[k].flows = malloc(flows_len ? flows_len : 1);
+        if (w[k].flows) memcpy(w[k].flows, (char *)payload + sizeof(coord_result_t), flows_len);
+        else w[k].res.n_flows = 0;
+        free(payload);
+        if (w[k].res.rc != 0) failed = 1;
+    }
+    coord_report(w, n, opts);
+    rc = failed ? -1 : 0;
+
+out:
+    for (uint32_t k = 0; w && k < n; k++) {
+        if (w[k].pid) {
+            // worker lançado: BYE se a conexão existe, senão SIGTERM
+            if (w[k].fd < 0 || coord_send(w[k].fd, COORD_MSG_BYE, NULL, 0, NULL, 0) != 0) {
+                kill(w[k].pid, SIGTERM);
+            }
+            waitpid(w[k].pid, NULL, 0);
+            unlink(w[k].addr + 5);
+        }
+        if (w[k].fd >= 0) close(w[k].fd);
+        free(w[k].flows);
+    }
+    if (have_dir) rmdir(dir);
+    free(w);
+    free(json);
+    return rc;
+}
@@ -0,0 +1,322 @@
+// flow_stats.c
+#include "../include/injector/flow_stats.h"
+#include "../include/injector/rx_parse.h"
+#include "../include/generator/tcp_flow.h"
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+/* FNV-1a seguido da mistura final do splitmix64 */
+static uint64_t hash_bytes(uint64_t h, const uint8_t *p, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static uint64_t flow_key(uint16_t tmpl, uint8_t proto, const uint8_t *src, const uint8_t *dst,
+                         size_t alen, uint16_t sport, uint16_t dport) {
+    uint8_t meta[7] = {
+        (uint8_t)(tmpl >> 8), (uint8_t)tmpl, proto,
+        (uint8_t)(sport >> 8), (uint8_t)sport, (uint8_t)(dport >> 8), (uint8_t)dport
+    };
+    uint64_t h = 0xCBF29CE484222325ULL;
+    h = hash_bytes(h, meta, sizeof(meta));
+    h = hash_bytes(h, src, alen);
+    h = hash_bytes(h, dst, alen);
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h ? h : 1;
+}
+
+void flow_stats_free(flow_stats_t *fs) {
+    if (!fs) return;
+    free(fs->flows);
+    free(fs->slots);
+    free(fs->id_flow);
+    free(fs);
+}
+
+flow_stats_t *flow_stats_create(const packet_list_t *list, uint32_t n_ids) {
+    if (!list || n_ids == 0) return NULL;
+
+    // um fluxo por template, mais um por sessão TCP
+    uint32_t templates = 0;
+    for (const packet_t *p = list->head; p; p = p->next) {
+        if ((uint32_t)p->tmpl + 1 > templates) templates = (uint32_t)p->tmpl + 1;
+    }
+    const uint64_t max_flows = (uint64_t)templates + (list->flows ? list->flows->count : 0);
+    uint64_t cap = 16;
+    while (cap < max_flows * 2) cap <<= 1;
+    if (cap > (1ULL << 31)) return NULL;
+
+    flow_stats_t *fs = calloc(1, sizeof(flow_stats_t));
+    if (!fs) return NULL;
+    fs->flows   = calloc(max_flows, sizeof(flow_stat_t));
+    fs->slots   = calloc(cap, sizeof(flow_slot_t));
+    fs->id_flow = malloc((size_t)n_ids * sizeof(uint32_t));
+    if (!fs->flows || !fs->slots || !fs->id_flow) {
+        flow_stats_free(fs);
+        return NULL;
+    }
+    memset(fs->id_flow, 0xFF, (size_t)n_ids * sizeof(uint32_t));
+    fs->mask  = (uint32_t)(cap - 1);
+    fs->n_ids = n_ids;
+
+    uint32_t overflow = 0;
+    for (const packet_t *p = list->head; p; p = p->next) {
+        if (!p->id || p->id > n_ids) continue;
+        rx_frame_info_t info;
+        const uint8_t *frame = p->data;
+        if (rx_parse_frame(frame, p->length, &info) != 0) continue;
+
+        const size_t alen = info.ip_version == 4 ? 4 : 16;
+        const uint8_t *src = frame + info.l3_offset + (info.ip_version == 4 ? 12 : 8);
+        const uint8_t *dst = src + alen;
+        uint16_t sport = 0, dport = 0;
+        if (info.l4_proto == IPPROTO_TCP || info.l4_proto == IPPROTO_UDP) {
+            const uint8_t *l4 = frame + info.l4_offset;
+            sport = (uint16_t)(l4[0] << 8 | l4[1]);
+            dport = (uint16_t)(l4[2] << 8 | l4[3]);
+        }
+        const uint64_t key = flow_key(p->tmpl, info.l4_proto, src, dst, alen, sport, dport);
+
+        uint32_t i = (uint32_t)key & fs->mask;
+        while (fs->slots[i].key && fs->slots[i].key != key) {
+            i = (i + 1) & fs->mask;
+        }
+        if (!fs->slots[i].key) {
+            if (fs->count == max_flows) {
+                overflow++;
+                continue;
+            }
+            flow_stat_t *f = &fs->flows[fs->count];
+            f->key        = key;
+            f->tmpl       = p->tmpl;
+            f->ip_version = info.ip_version;
+            f->proto      = info.l4_proto;
+            f->src_port   = sport;
+            f->dst_port   = dport;
+            memcpy(f->src_addr, src, alen);
+            memcpy(f->dst_addr, dst, alen);
+            f->min_ns     = UINT64_MAX;
+            fs->slots[i].key  = key;
+            fs->slots[i].flow = fs->count++;
+        }
+        fs->id_flow[p->id - 1] = fs->slots[i].flow;
+    }
+    if (overflow) {
+        fprintf(stderr, "Aviso: %u pacotes de fluxos além dos previstos pelos templates "
+                        "ficaram fora das estatísticas por fluxo\n", overflow);
+    }
+    return fs;
+}
+
+void flow_stats_finish(flow_stats_t *fs, const uint64_t *send_timestamp,
+                       const uint64_t *recv_timestamp, uint32_t total_ids,
+                       uint64_t min_send_ts) {
+    if (!fs) return;
+    for (uint32_t i = 0; i < fs->count; i++) {
+        seq_stats_t *s = &fs->flows[i].seq;
+        fs->flows[i].sent = 0;
+        s->cur_burst = s->loss_bursts = s->burst_max = 0;
+        memset(s->burst_hist, 0, sizeof(s->burst_hist));
+    }
+    for (uint32_t id = 0, lap_id = 0; id < total_ids; id++, lap_id++) {
+        if (lap_id == fs->n_ids) lap_id = 0;
+        const uint32_t idx = fs->id_flow[lap_id];
+        if (idx == UINT32_MAX || !send_timestamp[id] || send_timestamp[id] < min_send_ts) continue;
+        fs->flows[idx].sent++;
+        seq_stats_sent(&fs->flows[idx].seq, recv_timestamp[id] != 0);
+    }
+    for (uint32_t i = 0; i < fs->count; i++) {
+        seq_stats_sent_end(&fs->flows[i].seq);
+    }
+}
+
+/* menor e maior valor de uma faixa do histograma */
+static void bucket_bounds(uint32_t b, uint64_t *lo, uint64_t *hi) {
+    if (b < (1u << FLOW_HIST_SUB_BITS)) {
+        *lo = *hi = b;
+        return;
+    }
+    const unsigned shift = (b >> FLOW_HIST_SUB_BITS) - 1;
+    const uint64_t m = (1u << FLOW_HIST_SUB_BITS) | (b & ((1u << FLOW_HIST_SUB_BITS) - 1));
+    *lo = m << shift;
+    *hi = *lo + (1ULL << shift) - 1;
+}
+
+uint64_t flow_stats_percentile(const flow_stat_t *f, double q) {
+    if (!f->samples) return 0;
+    uint64_t rank = (uint64_t)(q * f->samples + 0.999999);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < FLOW_HIST_BUCKETS; b++) {
+        seen += f->hist[b];
+        if (seen >= rank) {
+            uint64_t lo, hi;
+            bucket_bounds(b, &lo, &hi);
+            uint64_t mid = lo + (hi - lo) / 2;
+            // a faixa não ultrapassa os extremos observados
+            if (mid < f->min_ns) mid = f->min_ns;
+            if (mid > f->max_ns) mid = f->max_ns;
+            return mid;
+        }
+    }
+    return f->max_ns;
+}
+
+void flow_stats_to_ns(flow_stats_t *fs) {
+    if (!fs || !fs->clock) return;
+    const clock_src_t *clk = fs->clock;
+    fs->clock = NULL;
+    if (clk->source == CLOCK_SOURCE_MONOTONIC) return;
+    for (uint32_t i = 0; i < fs->count; i++) {
+        flow_stat_t *f = &fs->flows[i];
+        uint32_t hist[FLOW_HIST_BUCKETS];
+        memset(hist, 0, sizeof(hist));
+        for (uint32_t b = 0; b < FLOW_HIST_BUCKETS; b++) {
+            if (!f->hist[b]) continue;
+            uint64_t lo, hi;
+            bucket_bounds(b, &lo, &hi);
+            hist[flow_hist_bucket(clock_src_to_ns(clk, lo + (hi - lo) / 2))] += f->hist[b];
+        }
+        memcpy(f->hist, hist, sizeof(hist));
+        f->sum_ns = clock_src_to_ns(clk, f->sum_ns);
+        if (f->samples) {
+            f->min_ns = clock_src_to_ns(clk, f->min_ns);
+            f->max_ns = clock_src_to_ns(clk, f->max_ns);
+        }
+        seq_stats_to_ns(&f->seq, clk);
+    }
+}
+
+void flow_stat_merge(flow_stat_t *dst, const flow_stat_t *src) {
+    dst->sent     += src->sent;
+    dst->received += src->received;
+    dst->samples  += src->samples;
+    dst->sum_ns   += src->sum_ns;
+    if (src->samples && src->min_ns < dst->min_ns) dst->min_ns = src->min_ns;
+    if (src->samples && src->max_ns > dst->max_ns) dst->max_ns = src->max_ns;
+    for (uint32_t b = 0; b < FLOW_HIST_BUCKETS; b++) {
+        dst->hist[b] += src->hist[b];
+    }
+    seq_stats_merge(&dst->seq, &src->seq);
+}
+
+/* latência na unidade do relógio -> ns */
+static uint64_t lat_ns(const flow_stats_t *fs, uint64_t v) {
+    return fs->clock ? clock_src_to_ns(fs->clock, v) : v;
+}
+
+static void format_endpoint(const flow_stat_t *f, const uint8_t *addr, uint16_t port,
+                            char *buf, size_t len) {
+    char ip[INET6_ADDRSTRLEN];
+    inet_ntop(f->ip_version == 4 ? AF_INET : AF_INET6, addr, ip, sizeof(ip));
+    if (f->proto == IPPROTO_TCP || f->proto == IPPROTO_UDP) {
+        snprintf(buf, len, f->ip_version == 4 ? "%s:%u" : "[%s]:%u", ip, port);
+    } else {
+        snprintf(buf, len, "%s", ip);
+    }
+}
+
+static const char *proto_name(uint8_t proto) {
+    switch (proto) {
+        case IPPROTO_TCP:    return "tcp";
+        case IPPROTO_UDP:    return "udp";
+        case IPPROTO_ICMP:   return "icmp";
+        case IPPROTO_ICMPV6: return "icmp6";
+        default:             return "?";
+    }
+}
+
+typedef struct {
+    uint32_t idx;
+    uint32_t lost;
+    uint64_t p99;
+} flow_rank_t;
+
+static int cmp_worst(const void *a, const void *b) {
+    const flow_rank_t *x = a, *y = b;
+    if (x->lost != y->lost) return x->lost < y->lost ? 1 : -1;
+    if (x->p99 != y->p99) return x->p99 < y->p99 ? 1 : -1;
+    return x->idx < y->idx ? -1 : (x->idx > y->idx);
+}
+
+static uint32_t flow_lost(const flow_stat_t *f) {
+    return f->sent > f->received ? f->sent - f->received : 0;
+}
+
+void flow_stats_print_top(flow_stats_t *fs, uint32_t n, FILE *out) {
+    if (!fs || !fs->count || !n) return;
+    flow_rank_t *rank = malloc((size_t)fs->count * sizeof(flow_rank_t));
+    if (!rank) return;
+    for (uint32_t i = 0; i < fs->count; i++) {
+        rank[i].idx  = i;
+        rank[i].lost = flow_lost(&fs->flows[i]);
+        rank[i].p99  = flow_stats_percentile(&fs->flows[i], 0.99);
+    }
+    qsort(rank, fs->count, sizeof(flow_rank_t), cmp_worst);
+    if (n > fs->count) n = fs->count;
+
+    fprintf(out, "Fluxos: %u (piores %u por perda e p99)\n", fs->count, n);
+    fprintf(out, "  %-4s %-5s %-46s %9s %9s %7s %9s %9s %9s %7s %9s\n",
+            "tmpl", "proto", "origem -> destino", "enviados", "recebidos", "perda%",
+            "p50(us)", "p99(us)", "max(us)", "reord", "jit(us)");
+    for (uint32_t k = 0; k < n; k++) {
+        const flow_stat_t *f = &fs->flows[rank[k].idx];
+        char src[64], dst[64], pair[132];
+        format_endpoint(f, f->src_addr, f->src_port, src, sizeof(src));
+        format_endpoint(f, f->dst_addr, f->dst_port, dst, sizeof(dst));
+        snprintf(pair, sizeof(pair), "%s -> %s", src, dst);
+        fprintf(out, "  %-4u %-5s %-46s %9u %9u %7.2f %9.1f %9.1f %9.1f %7u %9.1f\n",
+                f->tmpl, proto_name(f->proto), pair, f->sent, f->received,
+                f->sent ? (double)rank[k].lost / f->sent * 100.0 : 0.0,
+                lat_ns(fs, flow_stats_percentile(f, 0.50)) / 1e3, lat_ns(fs, rank[k].p99) / 1e3,
+                f->samples ? lat_ns(fs, f->max_ns) / 1e3 : 0.0,
+                f->seq.reordered, lat_ns(fs, seq_stats_jitter(&f->seq)) / 1e3);
+    }
+    free(rank);
+}
+
+int flow_stats_save_csv(const flow_stats_t *fs, const char *filename) {
+    if (!fs || !filename) return -1;
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        perror("flow_stats_save_csv: fopen");
+        return -1;
+    }
+    fprintf(fp, "template,proto,src,src_port,dst,dst_port,sent,received,lost,loss_pct,"
+                "min_ns,avg_ns,p50_ns,p99_ns,p999_ns,max_ns,"
+                "reordered,reorder_extent_max,duplicates,late,jitter_ns,loss_bursts,loss_burst_max\n");
+    for (uint32_t i = 0; i < fs->count; i++) {
+        const flow_stat_t *f = &fs->flows[i];
+        char src[INET6_ADDRSTRLEN], dst[INET6_ADDRSTRLEN];
+        const int af = f->ip_version == 4 ? AF_INET : AF_INET6;
+        inet_ntop(af, f->src_addr, src, sizeof(src));
+        inet_ntop(af, f->dst_addr, dst, sizeof(dst));
+        const uint32_t lost = flow_lost(f);
+        fprintf(fp, "%u,%s,%s,%u,%s,%u,%u,%u,%u,%.4f,%llu,%llu,%llu,%llu,%llu,%llu,"
+                    "%u,%u,%u,%u,%llu,%u,%u\n",
+                f->tmpl, proto_name(f->proto), src, f->src_port, dst, f->dst_port,
+                f->sent, f->received, lost, f->sent ? (double)lost / f->sent * 100.0 : 0.0,
+                (unsigned long long)(f->samples ? lat_ns(fs, f->min_ns) : 0),
+                (unsigned long long)(f->samples ? lat_ns(fs, f->sum_ns / f->samples) : 0),
+                (unsigned long long)lat_ns(fs, flow_stats_percentile(f, 0.50)),
+                (unsigned long long)lat_ns(fs, flow_stats_percentile(f, 0.99)),
+                (unsigned long long)lat_ns(fs, flow_stats_percentile(f, 0.999)),
+                (unsigned long long)lat_ns(fs, f->max_ns),
+                f->seq.reordered, f->seq.reorder_max, f->seq.duplicates, f->seq.late,
+                (unsigned long long)lat_ns(fs, seq_stats_jitter(&f->seq)),
+                f->seq.loss_bursts, f->seq.burst_max);
+    }
+    if (fclose(fp) != 0) {
+        perror("flow_stats_save_csv: fclose");
+        return -1;
+    }
+    return 0;
+}
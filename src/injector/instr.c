@@ -0,0 +1,132 @@
+// instr.c
+#include "../include/injector/instr.h"
+
+static const char *const STAGE_NAMES[INSTR_STAGES] = {
+    "tx.wait", "tx.prepare", "tx.send", "rx.recv", "rx.queue", "rx.parse", "rx.correlate", "rx.record"
+};
+
+const char *instr_stage_name(instr_stage_t stage) {
+    return stage < INSTR_STAGES ? STAGE_NAMES[stage] : "?";
+}
+
+void instr_merge(instr_t *dst, const instr_t *src) {
+    instr_rx_t *d = &dst->rx;
+    const instr_rx_t *s = &src->rx;
+    d->frames    += s->frames;
+    d->matched   += s->matched;
+    d->duplicate += s->duplicate;
+    d->unparsed  += s->unparsed;
+    d->foreign   += s->foreign;
+    d->idle      += s->idle;
+    for (uint32_t st = 0; st < INSTR_STAGES; st++) {
+        instr_hist_t *h = &dst->stage[st];
+        const instr_hist_t *o = &src->stage[st];
+        h->count += o->count;
+        h->sum   += o->sum;
+        if (o->max > h->max) h->max = o->max;
+        for (uint32_t b = 0; b < INSTR_HIST_BUCKETS; b++) {
+            h->hist[b] += o->hist[b];
+        }
+    }
+}
+
+uint64_t instr_stage_percentile(const instr_hist_t *h, double q) {
+    if (!h->count) return 0;
+    uint64_t rank = (uint64_t)(q * (double)h->count);
+    if (rank >= h->count) rank = h->count - 1;
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < INSTR_HIST_BUCKETS; b++) {
+        seen += h->hist[b];
+        if (seen > rank) {
+            const uint64_t upper = b + 1 < 64 ? (1ULL << (b + 1)) - 1 : UINT64_MAX;
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+void instr_print(const instr_t *in, const clock_src_t *clk, FILE *out) {
+    const instr_tx_t *tx = &in->tx;
+    const instr_rx_t *rx = &in->rx;
+    fprintf(out, "Instrumentação TX: tentativas=%llu enviados=%llu falhas=%llu EAGAIN=%llu ENOBUFS=%llu\n",
+            (unsigned long long)tx->attempts, (unsigned long long)tx->sent,
+            (unsigned long long)tx->failed, (unsigned long long)tx->eagain,
+            (unsigned long long)tx->enobufs);
+    fprintf(out, "Instrumentação RX: quadros=%llu correlacionados=%llu duplicados=%llu sem ID=%llu "
+            "alheios=%llu vazios=%llu",
+            (unsigned long long)rx->frames, (unsigned long long)rx->matched,
+            (unsigned long long)rx->duplicate, (unsigned long long)rx->unparsed,
+            (unsigned long long)rx->foreign, (unsigned long long)rx->idle);
+    if (rx->queue_full) {
+        fprintf(out, " | fila de análise cheia=%llu (%.1f ms parada)",
+                (unsigned long long)rx->queue_full, clock_src_to_ns(clk, rx->queue_wait) / 1e6);
+    }
+    if (rx->kernel_valid) {
+        fprintf(out, " | kernel: recebidos=%llu descartados=%llu descartados na interface=%llu",
+                (unsigned long long)rx->kernel_recv, (unsigned long long)rx->kernel_drop,
+                (unsigned long long)rx->if_drop);
+    }
+    fprintf(out, "\n");
+    if (!in->enabled) return;
+
+    fprintf(out, "  %-14s %10s %10s %10s %10s %10s %12s  (ns, relógio %s)\n",
+            "estágio", "n", "média", "p50", "p99", "max", "total(ms)", clock_src_name(clk->source));
+    for (uint32_t s = 0; s < INSTR_STAGES; s++) {
+        const instr_hist_t *h = &in->stage[s];
+        if (!h->count) continue;
+        fprintf(out, "  %-14s %10llu %10.0f %10llu %10llu %10llu %12.1f\n",
+                instr_stage_name((instr_stage_t)s), (unsigned long long)h->count,
+                (double)clock_src_to_ns(clk, h->sum) / (double)h->count,
+                (unsigned long long)clock_src_to_ns(clk, instr_stage_percentile(h, 0.50)),
+                (unsigned long long)clock_src_to_ns(clk, instr_stage_percentile(h, 0.99)),
+                (unsigned long long)clock_src_to_ns(clk, h->max),
+                clock_src_to_ns(clk, h->sum) / 1e6);
+    }
+}
+
+void instr_write_json(const instr_t *in, const clock_src_t *clk, FILE *out) {
+    const instr_tx_t *tx = &in->tx;
+    const instr_rx_t *rx = &in->rx;
+    fprintf(out, "{\"tx\": {\"attempts\": %llu, \"sent\": %llu, \"failed\": %llu, \"eagain\": %llu, "
+            "\"enobufs\": %llu}, ",
+            (unsigned long long)tx->attempts, (unsigned long long)tx->sent,
+            (unsigned long long)tx->failed, (unsigned long long)tx->eagain,
+            (unsigned long long)tx->enobufs);
+    fprintf(out, "\"rx\": {\"frames\": %llu, \"matched\": %llu, \"duplicate\": %llu, \"unparsed\": %llu, "
+            "\"foreign\": %llu, \"idle\": %llu, \"queue_full\": %llu, \"queue_wait_ns\": %llu",
+            (unsigned long long)rx->frames, (unsigned long long)rx->matched,
+            (unsigned long long)rx->duplicate, (unsigned long long)rx->unparsed,
+            (unsigned long long)rx->foreign, (unsigned long long)rx->idle,
+            (unsigned long long)rx->queue_full,
+            (unsigned long long)clock_src_to_ns(clk, rx->queue_wait));
+    if (rx->kernel_valid) {
+        fprintf(out, ", \"kernel_recv\": %llu, \"kernel_drop\": %llu, \"if_drop\": %llu",
+                (unsigned long long)rx->kernel_recv, (unsigned long long)rx->kernel_drop,
+                (unsigned long long)rx->if_drop);
+    }
+    fprintf(out, "}, \"clock\": \"%s\", \"stages\": {", clock_src_name(clk->source));
+    int first = 1;
+    for (uint32_t s = 0; in->enabled && s < INSTR_STAGES; s++) {
+        const instr_hist_t *h = &in->stage[s];
+        if (!h->count) continue;
+        // hist: contagens por faixa de ticks [2^b, 2^(b+1)), até a última não vazia
+        uint32_t last = 0;
+        for (uint32_t b = 0; b < INSTR_HIST_BUCKETS; b++) {
+            if (h->hist[b]) last = b;
+        }
+        fprintf(out, "%s\"%s\": {\"count\": %llu, \"avg_ns\": %.1f, \"p50_ns\": %llu, \"p99_ns\": %llu, "
+                "\"max_ns\": %llu, \"total_ns\": %llu, \"hist_ticks_log2\": [",
+                first ? "" : ", ", instr_stage_name((instr_stage_t)s), (unsigned long long)h->count,
+                (double)clock_src_to_ns(clk, h->sum) / (double)h->count,
+                (unsigned long long)clock_src_to_ns(clk, instr_stage_percentile(h, 0.50)),
+                (unsigned long long)clock_src_to_ns(clk, instr_stage_percentile(h, 0.99)),
+                (unsigned long long)clock_src_to_ns(clk, h->max),
+                (unsigned long long)clock_src_to_ns(clk, h->sum));
+        for (uint32_t b = 0; b <= last; b++) {
+            fprintf(out, "%s%u", b ? ", " : "", h->hist[b]);
+        }
+        fprintf(out, "]}");
+        first = 0;
+    }
+    fprintf(out, "}}");
+}
@@ -0,0 +1,625 @@
+// io_backend.c
+#include "../../include/injector/io_backend.h"
+#include "../../include/netwagon.h"
+#include <errno.h>
+#include <pcap.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+
+#define MEM_RING_BYTES   (16u << 20)   // 16 MB por anel
+#define MEM_RECORD_HDR   8             // u32 tamanho + u32 reservado
+#define MEM_WRAP_MARK    0xFFFFFFFFu
+#define MEM_POLL_SPINS   1024          // tentativas antes de reportar timeout
+#define CAPTURE_SNAPLEN  65535         // quadros jumbo inteiros
+
+static void set_err(char *errbuf, size_t errlen, const char *fmt, const char *arg) {
+    if (errbuf && errlen) snprintf(errbuf, errlen, fmt, arg);
+}
+
+static io_backend_t *backend_new(const char *kind, int flags) {
+    io_backend_t *b = calloc(1, sizeof(io_backend_t));
+    if (!b) return NULL;
+    b->kind  = kind;
+    b->flags = flags;
+    return b;
+}
+
+/* ---------------- pcap ao vivo ---------------- */
+
+static int pcap_live_send(io_backend_t *b, const uint8_t *frame, size_t len) {
+    pcap_t *pc = b->priv;
+    if (pcap_sendpacket(pc, frame, (int)len) != 0) {
+        if (errno == EAGAIN) b->tx_eagain++;
+        if (errno == ENOBUFS) b->tx_enobufs++;
+        snprintf(b->errbuf, sizeof(b->errbuf), "%s", pcap_geterr(pc));
+        return -1;
+    }
+    return 0;
+}
+
+static int pcap_any_recv(io_backend_t *b, io_frame_t *out) {
+    pcap_t *pc = b->priv;
+    struct pcap_pkthdr *hdr;
+    const u_char *pkt = NULL;
+    int res = pcap_next_ex(pc, &hdr, &pkt);
+    if (res == 1) {
+        out->data           = pkt;
+        out->caplen         = hdr->caplen;
+        out->len            = hdr->len;
+        out->kernel_ts_ns   = (b->flags & IO_FLAG_OFFLINE) ? 0 :
+                              (uint64_t)hdr->ts.tv_sec * 1000000000ULL +
+                              (uint64_t)hdr->ts.tv_usec * 1000ULL;
+        out->extra_delay_ns = 0;
+        return IO_RECV_FRAME;
+    }
+    if (res == 0) return IO_RECV_TIMEOUT;
+    if (res == PCAP_ERROR_BREAK) return IO_RECV_EOF;
+    snprintf(b->errbuf, sizeof(b->errbuf), "%s", pcap_geterr(pc));
+    return IO_RECV_ERROR;
+}
+
+static int pcap_live_stats(io_backend_t *b, io_kernel_stats_t *out) {
+    struct pcap_stat ps;
+    if (pcap_stats(b->priv, &ps) != 0) return -1;
+    out->recv    = ps.ps_recv;
+    out->drop    = ps.ps_drop;
+    out->if_drop = ps.ps_ifdrop;
+    return 0;
+}
+
+static void pcap_any_close(io_backend_t *b) {
+    if (b->priv) pcap_close(b->priv);
+}
+
+static io_backend_t *open_pcap_live(const char *dev, int rx, char *errbuf, size_t errlen) {
+    char pcap_err[PCAP_ERRBUF_SIZE];
+    // mesmos parâmetros de antes: TX sem modo promíscuo, RX promíscuo com timeout de 100 ms
+    pcap_t *pc = rx ? pcap_open_live(dev, CAPTURE_SNAPLEN, 1, 100, pcap_err)
+                    : pcap_open_live(dev, CAPTURE_SNAPLEN, 0, 1, pcap_err);
+    if (!pc) {
+        set_err(errbuf, errlen, "%s", pcap_err);
+        return NULL;
+    }
+    // só quadros que chegam: com TX e RX na mesma interface (p.ex. diante de um
+    // refletor), a cópia dos próprios envios não conta como recebida
+    if (rx) pcap_setdirection(pc, PCAP_D_IN);
+    io_backend_t *b = backend_new("pcap", 0);
+    if (!b) {
+        pcap_close(pc);
+        set_err(errbuf, errlen, "%s", "sem memória");
+        return NULL;
+    }
+    b->priv  = pc;
+    b->send  = pcap_live_send;
+    b->recv  = pcap_any_recv;
+    b->close = pcap_any_close;
+    if (rx) b->kernel_stats = pcap_live_stats;
+    return b;
+}
+
+/* ---------------- AF_PACKET com virtio_net_hdr ---------------- */
+
+typedef struct {
+    int fd;
+} vnet_tx_t;
+
+static int vnet_send_hdr(io_backend_t *b, const void *vnet_hdr, const uint8_t *frame, size_t len) {
+    vnet_tx_t *v = b->priv;
+    struct iovec iov[2] = {
+        { .iov_base = (void *)vnet_hdr, .iov_len = NW_VNET_HDR_SIZE },
+        { .iov_base = (void *)frame,    .iov_len = len }
+    };
+    struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 2 };
+    while (sendmsg(v->fd, &msg, 0) < 0) {
+        if (errno == EINTR) continue;
+        if (errno == ENOBUFS || errno == EAGAIN) {
+            if (errno == EAGAIN) b->tx_eagain++;
+            else b->tx_enobufs++;
+            sched_yield();
+            continue;
+        }
+        snprintf(b->errbuf, sizeof(b->errbuf), "sendmsg: %s", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* quadro comum: cabeçalho virtio vazio (sem offload) */
+static int vnet_send(io_backend_t *b, const uint8_t *frame, size_t len) {
+    static const uint8_t none[NW_VNET_HDR_SIZE];
+    return vnet_send_hdr(b, none, frame, len);
+}
+
+static void vnet_close(io_backend_t *b) {
+    vnet_tx_t *v = b->priv;
+    if (!v) return;
+    if (v->fd >= 0) close(v->fd);
+    free(v);
+}
+
+static io_backend_t *open_vnet_tx(const char *dev, char *errbuf, size_t errlen) {
+    const int ifindex = (int)if_nametoindex(dev);
+    if (ifindex == 0) {
+        set_err(errbuf, errlen, "interface '%s' não encontrada", dev);
+        return NULL;
+    }
+    // protocolo 0: o socket só envia, não recebe cópia do tráfego
+    int fd = socket(AF_PACKET, SOCK_RAW | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        set_err(errbuf, errlen, "socket AF_PACKET: %s", strerror(errno));
+        return NULL;
+    }
+    int one = 1;
+    struct sockaddr_ll sll = { .sll_family = AF_PACKET, .sll_ifindex = ifindex };
+    if (setsockopt(fd, SOL_PACKET, PACKET_VNET_HDR, &one, sizeof(one)) != 0) {
+        set_err(errbuf, errlen, "PACKET_VNET_HDR: %s", strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    if (bind(fd, (struct sockaddr *)&sll, sizeof(sll)) != 0) {
+        set_err(errbuf, errlen, "bind: %s", strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    io_backend_t *b = backend_new("vnet", IO_FLAG_VNET_HDR);
+    vnet_tx_t *v = malloc(sizeof(*v));
+    if (!b || !v) {
+        free(b);
+        free(v);
+        close(fd);
+        set_err(errbuf, errlen, "%s", "sem memória");
+        return NULL;
+    }
+    v->fd        = fd;
+    b->priv      = v;
+    b->send      = vnet_send;
+    b->send_vnet = vnet_send_hdr;
+    b->close     = vnet_close;
+    return b;
+}
+
+/* ---------------- arquivo pcap ---------------- */
+
+typedef struct {
+    pcap_t        *pc;
+    pcap_dumper_t *dumper;
+} file_tx_t;
+
+static int file_send(io_backend_t *b, const uint8_t *frame, size_t len) {
+    file_tx_t *f = b->priv;
+    struct pcap_pkthdr hdr;
+    gettimeofday(&hdr.ts, NULL);
+    hdr.caplen = (bpf_u_int32)len;
+    hdr.len    = (bpf_u_int32)len;
+    pcap_dump((u_char *)f->dumper, &hdr, frame);
+    return 0;
+}
+
+static void file_tx_close(io_backend_t *b) {
+    file_tx_t *f = b->priv;
+    if (!f) return;
+    if (f->dumper) pcap_dump_close(f->dumper);
+    if (f->pc) pcap_close(f->pc);
+    free(f);
+}
+
+static io_backend_t *open_file_tx(const char *path, char *errbuf, size_t errlen) {
+    file_tx_t *f = calloc(1, sizeof(file_tx_t));
+    io_backend_t *b = backend_new("file", 0);
+    if (!f || !b) {
+        free(f);
+        free(b);
+        set_err(errbuf, errlen, "%s", "sem memória");
+        return NULL;
+    }
+    f->pc = pcap_open_dead(DLT_EN10MB, 65535);
+    f->dumper = f->pc ? pcap_dump_open(f->pc, path) : NULL;
+    if (!f->dumper) {
+        set_err(errbuf, errlen, "não foi possível criar '%s'", path);
+        b->priv = f;
+        file_tx_close(b);
+        free(b);
+        return NULL;
+    }
+    b->priv  = f;
+    b->send  = file_send;
+    b->close = file_tx_close;
+    return b;
+}
+
+static io_backend_t *open_file_rx(const char *path, char *errbuf, size_t errlen) {
+    char pcap_err[PCAP_ERRBUF_SIZE];
+    pcap_t *pc = pcap_open_offline(path, pcap_err);
+    if (!pc) {
+        set_err(errbuf, errlen, "%s", pcap_err);
+        return NULL;
+    }
+    io_backend_t *b = backend_new("file", IO_FLAG_OFFLINE | IO_FLAG_SYNTHETIC_TS);
+    if (!b) {
+        pcap_close(pc);
+        set_err(errbuf, errlen, "%s", "sem memória");
+        return NULL;
+    }
+    b->priv  = pc;
+    b->recv  = pcap_any_recv;
+    b->close = pcap_any_close;
+    return b;
+}
+
+/* ---------------- anel em memória (SPSC) ---------------- */
+
+typedef struct mem_ring {
+    char                name[64];
+    int                 refs;
+    atomic_int          consumer;           // há um RX conectado
+    atomic_int          producer_closed;    // TX terminou
+    _Alignas(64) atomic_size_t head;        // bytes escritos (produtor)
+    _Alignas(64) atomic_size_t tail;        // bytes consumidos (consumidor)
+    size_t              pending;            // registro entregue, liberado no próximo recv
+    uint8_t             *buf;
+    size_t              size;
+    struct mem_ring     *next;
+} mem_ring_t;
+
+typedef struct {
+    mem_ring_t *ring;
+    int         is_rx;
+} mem_end_t;
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static mem_ring_t *registry = NULL;
+
+static mem_ring_t *ring_acquire(const char *name) {
+    pthread_mutex_lock(&registry_lock);
+    mem_ring_t *r = registry;
+    while (r && strcmp(r->name, name) != 0) r = r->next;
+    if (!r) {
+        r = calloc(1, sizeof(mem_ring_t));
+        if (r) r->buf = malloc(MEM_RING_BYTES);
+        if (!r || !r->buf) {
+            free(r);
+            pthread_mutex_unlock(&registry_lock);
+            return NULL;
+        }
+        snprintf(r->name, sizeof(r->name), "%s", name);
+        r->size = MEM_RING_BYTES;
+        atomic_init(&r->consumer, 0);
+        atomic_init(&r->producer_closed, 0);
+        atomic_init(&r->head, 0);
+        atomic_init(&r->tail, 0);
+        r->next = registry;
+        registry = r;
+    }
+    r->refs++;
+    pthread_mutex_unlock(&registry_lock);
+    return r;
+}
+
+static void ring_release(mem_ring_t *r) {
+    pthread_mutex_lock(&registry_lock);
+    if (--r->refs == 0) {
+        mem_ring_t **pp = &registry;
+        while (*pp && *pp != r) pp = &(*pp)->next;
+        if (*pp) *pp = r->next;
+        free(r->buf);
+        free(r);
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+static size_t record_size(size_t len) {
+    return (MEM_RECORD_HDR + len + 7) & ~(size_t)7;
+}
+
+static int mem_send(io_backend_t *b, const uint8_t *frame, size_t len) {
+    mem_ring_t *r = ((mem_end_t *)b->priv)->ring;
+    const size_t need = record_size(len);
+    if (need > r->size / 2) {
+        snprintf(b->errbuf, sizeof(b->errbuf), "quadro de %zu bytes excede o anel", len);
+        return -1;
+    }
+
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t pos  = head % r->size;
+    size_t skip = (r->size - pos < need) ? r->size - pos : 0;
+
+    // anel cheio: espera o RX consumir (conta como EAGAIN); sem RX conectado o quadro é descartado
+    int waited = 0;
+    while (head + skip + need - atomic_load_explicit(&r->tail, memory_order_acquire) > r->size) {
+        if (!atomic_load_explicit(&r->consumer, memory_order_acquire)) return 0;
+        if (!waited++) b->tx_eagain++;
+        sched_yield();
+    }
+
+    if (skip) {
+        uint32_t mark = MEM_WRAP_MARK;
+        memcpy(r->buf + pos, &mark, sizeof(mark));
+        head += skip;
+        pos = 0;
+    }
+    uint32_t len32 = (uint32_t)len;
+    memcpy(r->buf + pos, &len32, sizeof(len32));
+    memcpy(r->buf + pos + MEM_RECORD_HDR, frame, len);
+    atomic_store_explicit(&r->head, head + need, memory_order_release);
+    return 0;
+}
+
+static int mem_recv(io_backend_t *b, io_frame_t *out) {
+    mem_ring_t *r = ((mem_end_t *)b->priv)->ring;
+
+    // libera o registro entregue na chamada anterior
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed) + r->pending;
+    if (r->pending) {
+        atomic_store_explicit(&r->tail, tail, memory_order_release);
+        r->pending = 0;
+    }
+
+    for (int spin = 0; spin < MEM_POLL_SPINS; spin++) {
+        size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+        if (head == tail) {
+            if (atomic_load_explicit(&r->producer_closed, memory_order_acquire) &&
+                atomic_load_explicit(&r->head, memory_order_acquire) == tail) {
+                return IO_RECV_EOF;
+            }
+            sched_yield();
+            continue;
+        }
+
+        size_t pos = tail % r->size;
+        uint32_t len32;
+        memcpy(&len32, r->buf + pos, sizeof(len32));
+        if (len32 == MEM_WRAP_MARK) {
+            tail += r->size - pos;
+            atomic_store_explicit(&r->tail, tail, memory_order_release);
+            continue;
+        }
+
+        out->data           = r->buf + pos + MEM_RECORD_HDR;
+        out->caplen         = len32;
+        out->len            = len32;
+        out->kernel_ts_ns   = 0;
+        out->extra_delay_ns = 0;
+        r->pending = record_size(len32);
+        return IO_RECV_FRAME;
+    }
+    return IO_RECV_TIMEOUT;
+}
+
+static void mem_close(io_backend_t *b) {
+    mem_end_t *e = b->priv;
+    if (!e) return;
+    if (e->is_rx) atomic_store(&e->ring->consumer, 0);
+    else atomic_store(&e->ring->producer_closed, 1);
+    ring_release(e->ring);
+    free(e);
+}
+
+static io_backend_t *open_mem(const char *name, int rx, char *errbuf, size_t errlen) {
+    mem_end_t *e = calloc(1, sizeof(mem_end_t));
+    io_backend_t *b = backend_new("mem", 0);
+    if (!e || !b || !(e->ring = ring_acquire(name))) {
+        free(e);
+        free(b);
+        set_err(errbuf, errlen, "%s", "sem memória para o anel");
+        return NULL;
+    }
+    e->is_rx = rx;
+    if (rx) {
+        atomic_store(&e->ring->consumer, 1);
+    } else {
+        atomic_store(&e->ring->producer_closed, 0);
+    }
+    b->priv  = e;
+    b->send  = mem_send;
+    b->recv  = mem_recv;
+    b->close = mem_close;
+    return b;
+}
+
+/* ---------------- degradações no RX ---------------- */
+
+typedef struct {
+    io_backend_t *inner;
+    io_impair_t   cfg;
+    uint64_t      rng;
+    uint8_t      *held;         // quadro adiado pela reordenação
+    size_t        held_cap;
+    io_frame_t    held_frame;
+    int           has_held;
+    int           release_held; // entrega o quadro adiado na próxima chamada
+    uint8_t      *out;          // cópia do quadro que ultrapassou o adiado
+    size_t        out_cap;
+} impair_t;
+
+/* xorshift64*: rápido e reproduzível */
+static double impair_rand(impair_t *im) {
+    im->rng ^= im->rng >> 12;
+    im->rng ^= im->rng << 25;
+    im->rng ^= im->rng >> 27;
+    return (double)((im->rng * 0x2545F4914F6CDD1DULL) >> 11) / 9007199254740992.0;
+}
+
+/*
+ * Copia o quadro para um dos buffers próprios (cada um com a sua capacidade:
+ * crescer a cópia de saída não pode mover o quadro adiado)
+ */
+static int impair_copy(uint8_t **buf, size_t *cap, io_frame_t *f) {
+    if (f->caplen > *cap) {
+        uint8_t *p = realloc(*buf, f->caplen);
+        if (!p) return -1;
+        *buf = p;
+        *cap = f->caplen;
+    }
+    memcpy(*buf, f->data, f->caplen);
+    f->data = *buf;
+    return 0;
+}
+
+static int impair_recv(io_backend_t *b, io_frame_t *out) {
+    impair_t *im = b->priv;
+
+    if (im->release_held) {
+        im->release_held = 0;
+        im->has_held = 0;
+        *out = im->held_frame;
+        return IO_RECV_FRAME;
+    }
+
+    for (;;) {
+        io_frame_t f;
+        int r = im->inner->recv(im->inner, &f);
+        if (r != IO_RECV_FRAME) {
+            if (r == IO_RECV_EOF && im->has_held) {
+                im->has_held = 0;
+                *out = im->held_frame;
+                return IO_RECV_FRAME;
+            }
+            if (r == IO_RECV_ERROR) {
+                snprintf(b->errbuf, sizeof(b->errbuf), "%s", im->inner->errbuf);
+            }
+            return r;
+        }
+
+        if (im->cfg.loss > 0 && impair_rand(im) < im->cfg.loss) continue;
+
+        f.extra_delay_ns += (uint64_t)im->cfg.delay_us * 1000ULL;
+        if (im->cfg.jitter_us) {
+            f.extra_delay_ns += (uint64_t)(impair_rand(im) * im->cfg.jitter_us * 1000.0);
+        }
+
+        if (!im->has_held && im->cfg.reorder > 0 && impair_rand(im) < im->cfg.reorder) {
+            if (impair_copy(&im->held, &im->held_cap, &f) != 0) return IO_RECV_ERROR;
+            im->held_frame = f;
+            im->has_held = 1;
+            continue;
+        }
+
+        if (im->has_held) {
+            if (impair_copy(&im->out, &im->out_cap, &f) != 0) return IO_RECV_ERROR;
+            im->release_held = 1;
+        }
+        *out = f;
+        return IO_RECV_FRAME;
+    }
+}
+
+static int impair_stats(io_backend_t *b, io_kernel_stats_t *out) {
+    io_backend_t *inner = ((impair_t *)b->priv)->inner;
+    return inner->kernel_stats ? inner->kernel_stats(inner, out) : -1;
+}
+
+static void impair_close(io_backend_t *b) {
+    impair_t *im = b->priv;
+    if (!im) return;
+    io_close(im->inner);
+    free(im->held);
+    free(im->out);
+    free(im);
+}
+
+int io_impair_is_zero(const io_impair_t *impair) {
+    return !impair || (impair->loss <= 0 && impair->delay_us == 0 &&
+                       impair->jitter_us == 0 && impair->reorder <= 0);
+}
+
+static io_backend_t *wrap_impair(io_backend_t *inner, const io_impair_t *cfg,
+                                 char *errbuf, size_t errlen) {
+    impair_t *im = calloc(1, sizeof(impair_t));
+    io_backend_t *b = backend_new(inner->kind, inner->flags);
+    if (!im || !b) {
+        free(im);
+        free(b);
+        io_close(inner);
+        set_err(errbuf, errlen, "%s", "sem memória");
+        return NULL;
+    }
+    im->inner = inner;
+    im->cfg   = *cfg;
+    im->rng   = cfg->seed ? cfg->seed : 0x9E3779B97F4A7C15ULL;
+    b->priv  = im;
+    b->recv  = impair_recv;
+    b->close = impair_close;
+    if (inner->kernel_stats) b->kernel_stats = impair_stats;
+    return b;
+}
+
+/* ---------------- abertura ---------------- */
+
+static const char *strip_prefix(const char *spec, const char *prefix) {
+    size_t n = strlen(prefix);
+    return strncmp(spec, prefix, n) == 0 ? spec + n : NULL;
+}
+
+static const char *mem_name(const char *spec) {
+    if (strcmp(spec, "mem") == 0) return "default";
+    return strip_prefix(spec, "mem:");
+}
+
+io_backend_t *io_open_tx(const char *spec, char *errbuf, size_t errlen) {
+    const char *arg;
+    if (!spec) {
+        set_err(errbuf, errlen, "%s", "interface ausente");
+        return NULL;
+    }
+    if ((arg = strip_prefix(spec, "file:"))) return open_file_tx(arg, errbuf, errlen);
+    if ((arg = mem_name(spec)))              return open_mem(arg, 0, errbuf, errlen);
+    if ((arg = strip_prefix(spec, "pcap:"))) return open_pcap_live(arg, 0, errbuf, errlen);
+    if ((arg = strip_prefix(spec, "vnet:"))) return open_vnet_tx(arg, errbuf, errlen);
+    return open_pcap_live(spec, 0, errbuf, errlen);
+}
+
+io_backend_t *io_open_rx(const char *spec, const io_impair_t *impair,
+                         char *errbuf, size_t errlen) {
+    const char *arg;
+    io_backend_t *b;
+    if (!spec) {
+        set_err(errbuf, errlen, "%s", "interface ausente");
+        return NULL;
+    }
+    if ((arg = strip_prefix(spec, "file:")))      b = open_file_rx(arg, errbuf, errlen);
+    else if ((arg = mem_name(spec)))              b = open_mem(arg, 1, errbuf, errlen);
+    else if ((arg = strip_prefix(spec, "pcap:"))) b = open_pcap_live(arg, 1, errbuf, errlen);
+    else if ((arg = strip_prefix(spec, "vnet:"))) b = open_pcap_live(arg, 1, errbuf, errlen);
+    else                                          b = open_pcap_live(spec, 1, errbuf, errlen);
+
+    if (b && !io_impair_is_zero(impair)) {
+        b = wrap_impair(b, impair, errbuf, errlen);
+    }
+    return b;
+}
+
+int io_rx_spec_flags(const char *spec) {
+    if (spec && strip_prefix(spec, "file:")) return IO_FLAG_OFFLINE | IO_FLAG_SYNTHETIC_TS;
+    return 0;
+}
+
+int io_tx_spec_flags(const char *spec) {
+    if (spec && strip_prefix(spec, "vnet:")) return IO_FLAG_VNET_HDR;
+    return 0;
+}
+
+const char *io_live_device(const char *spec) {
+    const char *arg;
+    if (!spec || strip_prefix(spec, "file:") || mem_name(spec)) return NULL;
+    if ((arg = strip_prefix(spec, "pcap:"))) return arg;
+    if ((arg = strip_prefix(spec, "vnet:"))) return arg;
+    return spec;
+}
+
+void io_close(io_backend_t *b) {
+    if (!b) return;
+    if (b->close) b->close(b);
+    free(b);
+}
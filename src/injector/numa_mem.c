@@ -0,0 +1,181 @@
+// numa_mem.c
+#define _GNU_SOURCE
+#include "../include/injector/numa_mem.h"
+#include "../include/injector/io_backend.h"
+#include <dirent.h>
+#include <errno.h>
+#include <linux/mempolicy.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define NUMA_MASK_WORDS 16      // até 1024 nós
+
+// lê um inteiro da primeira linha de um arquivo do sysfs
+static int read_sysfs_int(const char *path, int *value) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    int rc = fscanf(f, "%d", value) == 1 ? 0 : -1;
+    fclose(f);
+    return rc;
+}
+
+int numa_node_count(void) {
+    FILE *f = fopen("/sys/devices/system/node/has_memory", "r");
+    if (!f) return 1;
+
+    char buf[1024];
+    int count = 0;
+    if (fgets(buf, sizeof(buf), f)) {
+        // formato: "0-1" ou "0,2-3"
+        char *save = NULL;
+        for (char *tok = strtok_r(buf, ",\n", &save); tok; tok = strtok_r(NULL, ",\n", &save)) {
+            int lo, hi;
+            int n = sscanf(tok, "%d-%d", &lo, &hi);
+            if (n == 1) hi = lo;
+            if (n >= 1 && hi >= lo) count += hi - lo + 1;
+        }
+    }
+    fclose(f);
+    return count > 0 ? count : 1;
+}
+
+int numa_cpu_node(int cpu) {
+    if (cpu < 0) return -1;
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *dir = opendir(path);
+    if (!dir) return -1;
+
+    // o diretório da CPU tem um link "nodeN" para o seu nó
+    int node = -1;
+    for (struct dirent *e = readdir(dir); e; e = readdir(dir)) {
+        int n;
+        char rest;
+        if (sscanf(e->d_name, "node%d%c", &n, &rest) == 1) {
+            node = n;
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+int numa_iface_node(const char *spec) {
+    spec = io_live_device(spec);
+    if (!spec || !*spec || strchr(spec, '/')) return -1;
+
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node", spec);
+    int node;
+    // interfaces virtuais não têm device; -1 no arquivo = plataforma sem NUMA
+    if (read_sysfs_int(path, &node) != 0 || node < 0) return -1;
+    return node;
+}
+
+int numa_pick_node(int want, int cpu, const char *spec, const char **why) {
+    const char *src = NULL;
+    int node = -1;
+    if (want >= 0) {
+        node = want;
+        src = "pedido";
+    } else if (want == NUMA_MEM_AUTO && numa_node_count() > 1) {
+        // a CPU fixada é quem toca a memória; a interface decide só sem fixação
+        const int cpu_node = numa_cpu_node(cpu);
+        const int dev_node = numa_iface_node(spec);
+        if (cpu_node >= 0) {
+            node = cpu_node;
+            src = "CPU";
+            if (dev_node >= 0 && dev_node != cpu_node) {
+                fprintf(stderr, "NUMA: aviso: CPU %d está no nó %d e a interface '%s' no nó %d\n",
+                        cpu, cpu_node, spec, dev_node);
+            }
+        } else if (dev_node >= 0) {
+            node = dev_node;
+            src = "interface";
+        }
+    }
+    if (why) *why = src;
+    return node;
+}
+
+// mbind(MPOL_PREFERRED) da região, antes do primeiro acesso
+static int prefer_node(void *addr, size_t len, int node) {
+    if (node < 0 || node >= NUMA_MASK_WORDS * 64) {
+        errno = EINVAL;
+        return -1;
+    }
+    unsigned long mask[NUMA_MASK_WORDS];
+    memset(mask, 0, sizeof(mask));
+    mask[node / 64] = 1UL << (node % 64);
+    return (int)syscall(SYS_mbind, addr, len, MPOL_PREFERRED, mask,
+                        (unsigned long)NUMA_MASK_WORDS * 64 + 1, 0);
+}
+
+// mapeamento anônimo alinhado a align (THP só usa extensões alinhadas de 2 MB)
+static void *map_aligned(size_t len, size_t align) {
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    if (align <= page) {
+        return mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    uint8_t *raw = mmap(NULL, len + align, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return MAP_FAILED;
+    uint8_t *start = (uint8_t *)(((uintptr_t)raw + align - 1) & ~(uintptr_t)(align - 1));
+    if (start > raw) munmap(raw, (size_t)(start - raw));
+    const size_t tail = (size_t)(raw + len + align - (start + len));
+    if (tail) munmap(start + len, tail);
+    return start;
+}
+
+int numa_region_alloc(numa_region_t *r, size_t len, int node, int hugepages) {
+    memset(r, 0, sizeof(*r));
+    r->node = -1;
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t unit = hugepages ? NUMA_HUGE_SIZE : page;
+    const size_t mlen = ((len ? len : 1) + unit - 1) & ~(unit - 1);
+
+    void *addr = MAP_FAILED;
+    if (hugepages) {
+        // falha de imediato quando não há páginas reservadas suficientes
+        addr = mmap(NULL, mlen, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (addr != MAP_FAILED) r->pages = NUMA_PAGES_HUGETLB;
+    }
+    if (addr == MAP_FAILED) {
+        addr = map_aligned(mlen, unit);
+        if (addr == MAP_FAILED) {
+            fprintf(stderr, "NUMA: mmap de %zu bytes falhou: %s\n", mlen, strerror(errno));
+            return -1;
+        }
+        if (hugepages && madvise(addr, mlen, MADV_HUGEPAGE) == 0) r->pages = NUMA_PAGES_THP;
+    }
+    r->addr = addr;
+    r->len  = mlen;
+
+    if (node >= 0) {
+        if (prefer_node(addr, mlen, node) == 0) {
+            r->node = node;
+        } else {
+            fprintf(stderr, "NUMA: mbind no nó %d falhou: %s\n", node, strerror(errno));
+        }
+    }
+    return 0;
+}
+
+void numa_region_free(numa_region_t *r) {
+    if (!r || !r->addr) return;
+    munmap(r->addr, r->len);
+    r->addr = NULL;
+    r->len  = 0;
+}
+
+const char *numa_pages_name(int pages) {
+    switch (pages) {
+        case NUMA_PAGES_HUGETLB: return "2 MB";
+        case NUMA_PAGES_THP:     return "THP";
+        default:                 return "comuns";
+    }
+}
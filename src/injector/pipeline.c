@@ -0,0 +1,365 @@
+// pipeline.c
+#include "../include/injector/pipeline.h"
+#include "../include/generator/pcap_writer.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PIPE_IDLE_NS    50000   // espera de uma construtora com a fila cheia e do descarte com a fila vazia
+
+/* Entrada de fila: quadro e marca de último pacote do datagrama */
+typedef struct {
+    packet_t *pkt;
+    uint32_t last;
+} pipe_item_t;
+
+/* Fila de um produtor e um consumidor; head e tail só crescem */
+typedef struct {
+    pipe_item_t      *items;
+    uint32_t         mask;
+    _Atomic uint64_t head __attribute__((aligned(64)));    // escrito só pelo produtor
+    _Atomic uint64_t tail __attribute__((aligned(64)));    // escrito só pelo consumidor
+} pipe_ring_t;
+
+typedef struct {
+    pipeline_t       *p;
+    uint32_t         part;
+    pipe_ring_t      ring;
+    pthread_t        thread;
+    int              running;   // thread criada
+    atomic_int       done;      // geração encerrada (a fila ainda pode ter quadros)
+    int              error;
+    uint64_t         frames;
+    uint64_t         end_ns;
+    uint64_t         lap_ns;
+} pipe_builder_t;
+
+struct pipeline {
+    pipeline_cfg_t   cfg;
+    uint32_t         n_builders;
+    pipe_builder_t   *builders;
+    packet_list_t    *samples;
+    uint32_t         n_ids;
+    flow_stats_t     *fs;
+    uint32_t         *tmpl_flow;    // template -> fluxo em fs (NULL = sem tabela)
+    uint32_t         n_tmpl;
+    uint64_t         t0;            // CLOCK_MONOTONIC de pipeline_create()
+    _Atomic uint64_t first_ns;      // primeiro quadro pronto, desde t0 (0 = nenhum)
+    atomic_int       stop;          // interrompe as construtoras
+    int              started;
+
+    /* consumidor (TX) */
+    uint32_t         cur;           // construtora do próximo ID
+    uint64_t         delivered;
+    uint64_t         first_tx_ns;   // primeiro quadro entregue ao TX, desde t0
+    uint64_t         underruns;
+    uint64_t         wait_ns;
+    uint64_t         retire_waits;
+
+    /* descarte */
+    pipe_ring_t      retired;
+    pthread_t        reaper;
+    atomic_int       tx_done;
+    pcap_dumper_t    *dumper;
+    uint64_t         written;
+};
+
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void nap(long ns) {
+    struct timespec ts = { .tv_sec = 0, .tv_nsec = ns };
+    nanosleep(&ts, NULL);
+}
+
+/* ---------- fila ---------- */
+
+static int ring_init(pipe_ring_t *r, uint32_t cap) {
+    uint32_t size = 2;
+    while (size < cap) size <<= 1;
+    r->items = calloc(size, sizeof(pipe_item_t));
+    if (!r->items) return -1;
+    r->mask = size - 1;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    return 0;
+}
+
+static int ring_push(pipe_ring_t *r, packet_t *pkt, uint32_t last) {
+    const uint64_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    const uint64_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if (head - tail > r->mask) return -1;
+    r->items[head & r->mask] = (pipe_item_t){ pkt, last };
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return 0;
+}
+
+static int ring_pop(pipe_ring_t *r, pipe_item_t *out) {
+    const uint64_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    const uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (tail == head) return -1;
+    *out = r->items[tail & r->mask];
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    return 0;
+}
+
+static void free_packet(packet_t *pkt) {
+    free(pkt->data);
+    free(pkt);
+}
+
+/* esvazia uma fila liberando os quadros (threads já paradas) */
+static void ring_free(pipe_ring_t *r) {
+    pipe_item_t it;
+    while (r->items && ring_pop(r, &it) == 0) {
+        free_packet(it.pkt);
+    }
+    free(r->items);
+    r->items = NULL;
+}
+
+/* ---------- construtoras e descarte ---------- */
+
+static int builder_sink(void *arg, packet_t *pkt, int last) {
+    pipe_builder_t *b = arg;
+    pipeline_t *p = b->p;
+    // o fluxo do ID fica registrado antes de o quadro chegar ao TX (e ao RX)
+    if (p->tmpl_flow && pkt->id && pkt->id <= p->fs->n_ids && pkt->tmpl < p->n_tmpl) {
+        p->fs->id_flow[pkt->id - 1] = p->tmpl_flow[pkt->tmpl];
+    }
+    while (ring_push(&b->ring, pkt, (uint32_t)last) != 0) {
+        if (atomic_load_explicit(&p->stop, memory_order_relaxed)) {
+            free_packet(pkt);
+            return 1;
+        }
+        nap(PIPE_IDLE_NS);
+    }
+    if (b->frames++ == 0) {
+        uint64_t none = 0;
+        const uint64_t t = mono_ns() - p->t0;
+        atomic_compare_exchange_strong(&p->first_ns, &none, t ? t : 1);
+    }
+    return 0;
+}
+
+static void *builder_main(void *arg) {
+    pipe_builder_t *b = arg;
+    pipeline_t *p = b->p;
+    packet_stream_t st;
+    memset(&st, 0, sizeof(st));
+    st.part    = b->part;
+    st.n_parts = p->n_builders;
+    st.sink    = builder_sink;
+    st.arg     = b;
+    if (build_packets_stream(p->cfg.set, &st) != 0 && !atomic_load(&p->stop)) {
+        fprintf(stderr, "Pipeline: construtora %u falhou\n", b->part);
+        b->error = 1;
+    }
+    b->lap_ns = st.lap_ns;
+    b->end_ns = mono_ns() - p->t0;
+    atomic_store_explicit(&b->done, 1, memory_order_release);
+    return NULL;
+}
+
+/* grava (se pedido) e libera os quadros enviados, na ordem de envio */
+static void *reaper_main(void *arg) {
+    pipeline_t *p = arg;
+    for (;;) {
+        const int done = atomic_load_explicit(&p->tx_done, memory_order_acquire);
+        pipe_item_t it;
+        if (ring_pop(&p->retired, &it) != 0) {
+            if (done) break;
+            nap(PIPE_IDLE_NS);
+            continue;
+        }
+        if (p->dumper && write_packet_to_pcap(p->dumper, it.pkt) == 0) p->written++;
+        free_packet(it.pkt);
+    }
+    return NULL;
+}
+
+/* ---------- API ---------- */
+
+pipeline_t *pipeline_create(const pipeline_cfg_t *cfg, uint32_t *n_ids) {
+    const template_set_t *set = cfg->set;
+    for (size_t i = 0; i < set->count; i++) {
+        if (set->items[i].tcp_flows) {
+            fprintf(stderr, "Pipeline: template %zu tem sessões TCP (tcp_flows), que não são geradas em fluxo\n", i);
+            return NULL;
+        }
+    }
+    pipeline_t *p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    p->t0         = mono_ns();
+    p->cfg        = *cfg;
+    p->n_builders = cfg->builders ? cfg->builders : 1;
+    if (p->n_builders > PIPELINE_MAX_BUILDERS) p->n_builders = PIPELINE_MAX_BUILDERS;
+    p->n_ids      = template_set_packet_count(set);
+    p->n_tmpl     = (uint32_t)set->count;
+    atomic_init(&p->first_ns, 0);
+    atomic_init(&p->stop, 0);
+    atomic_init(&p->tx_done, 0);
+
+    const uint32_t depth = cfg->ring ? cfg->ring : PIPELINE_RING_DEFAULT;
+    p->builders = calloc(p->n_builders, sizeof(pipe_builder_t));
+    int ok = p->builders && ring_init(&p->retired, depth * p->n_builders) == 0;
+    for (uint32_t i = 0; ok && i < p->n_builders; i++) {
+        p->builders[i].p    = p;
+        p->builders[i].part = i;
+        atomic_init(&p->builders[i].done, 0);
+        ok = ring_init(&p->builders[i].ring, depth) == 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "Pipeline: falha ao alocar as filas\n");
+        pipeline_stop(p, NULL);
+        return NULL;
+    }
+
+    // um quadro por template, sem prazos: só os endereços importam para os fluxos
+    template_set_t one = *set;
+    one.items    = malloc((set->count ? set->count : 1) * sizeof(packet_template_t));
+    one.rate_pps = 0;
+    p->samples   = create_packet_list();
+    if (!one.items || !p->samples) {
+        free(one.items);
+        pipeline_stop(p, NULL);
+        return NULL;
+    }
+    for (size_t i = 0; i < set->count; i++) {
+        packet_template_t *t = &one.items[i];
+        *t = set->items[i];
+        if (t->packet_count) t->packet_count = 1;
+        t->burst = 1;
+        t->rate_pps = 0;
+        t->start_ns = 0;
+        t->arrival.model = ARRIVAL_CONSTANT;
+    }
+    const int rc = build_packets_from_templates(&one, p->samples, 0);
+    free(one.items);
+    if (rc != 0) {
+        pipeline_stop(p, NULL);
+        return NULL;
+    }
+
+    if (cfg->pcap) {
+        p->dumper = open_pcap_file(cfg->pcap, 65535, DLT_EN10MB);
+        if (!p->dumper) {
+            fprintf(stderr, "Erro criando pcap '%s'\n", cfg->pcap);
+            pipeline_stop(p, NULL);
+            return NULL;
+        }
+    }
+    *n_ids = p->n_ids;
+    return p;
+}
+
+const packet_list_t *pipeline_samples(const pipeline_t *p) {
+    return p->samples;
+}
+
+int pipeline_start(pipeline_t *p, flow_stats_t *fs) {
+    if (fs && p->n_tmpl) {
+        // fluxo de cada template pelas amostras; os IDs das amostras voltam a ficar livres
+        p->tmpl_flow = malloc(p->n_tmpl * sizeof(uint32_t));
+        if (!p->tmpl_flow) return -1;
+        memset(p->tmpl_flow, 0xFF, p->n_tmpl * sizeof(uint32_t));
+        for (const packet_t *s = p->samples->head; s; s = s->next) {
+            if (!s->id || s->id > fs->n_ids) continue;
+            if (s->tmpl < p->n_tmpl) p->tmpl_flow[s->tmpl] = fs->id_flow[s->id - 1];
+            fs->id_flow[s->id - 1] = UINT32_MAX;
+        }
+        p->fs = fs;
+    }
+
+    if (pthread_create(&p->reaper, NULL, reaper_main, p) != 0) {
+        fprintf(stderr, "Pipeline: falha ao criar a thread de descarte\n");
+        return -1;
+    }
+    p->started = 1;
+    for (uint32_t i = 0; i < p->n_builders; i++) {
+        if (pthread_create(&p->builders[i].thread, NULL, builder_main, &p->builders[i]) != 0) {
+            fprintf(stderr, "Pipeline: falha ao criar a construtora %u\n", i);
+            p->builders[i].error = 1;
+            return -1;
+        }
+        p->builders[i].running = 1;
+    }
+    return 0;
+}
+
+packet_t *pipeline_next(pipeline_t *p) {
+    pipe_builder_t *b = &p->builders[p->cur];
+    pipe_item_t it;
+    if (ring_pop(&b->ring, &it) != 0) {
+        const uint64_t t = mono_ns();
+        for (;;) {
+            // done lido antes da fila: tudo o que foi publicado antes dele aparece no pop
+            const int done = atomic_load_explicit(&b->done, memory_order_acquire);
+            if (ring_pop(&b->ring, &it) == 0) break;
+            if (done) return NULL;
+            sched_yield();
+        }
+        // a espera pelo primeiro quadro é o início, não atraso das construtoras
+        if (p->delivered) {
+            p->underruns++;
+            p->wait_ns += mono_ns() - t;
+        }
+    }
+    if (!p->delivered++) p->first_tx_ns = mono_ns() - p->t0;
+    if (it.last) p->cur = (p->cur + 1) % p->n_builders;
+    return it.pkt;
+}
+
+void pipeline_retire(pipeline_t *p, packet_t *pkt) {
+    if (ring_push(&p->retired, pkt, 0) == 0) return;
+    p->retire_waits++;
+    while (ring_push(&p->retired, pkt, 0) != 0) {
+        sched_yield();
+    }
+}
+
+void pipeline_stop(pipeline_t *p, pipeline_stats_t *stats) {
+    if (!p) return;
+    atomic_store(&p->stop, 1);
+    if (p->started) {
+        for (uint32_t i = 0; i < p->n_builders; i++) {
+            if (p->builders[i].running) pthread_join(p->builders[i].thread, NULL);
+        }
+        atomic_store_explicit(&p->tx_done, 1, memory_order_release);
+        pthread_join(p->reaper, NULL);
+    }
+
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+        for (uint32_t i = 0; p->builders && i < p->n_builders; i++) {
+            const pipe_builder_t *b = &p->builders[i];
+            stats->frames += b->frames;
+            if (b->end_ns > stats->build_ns) stats->build_ns = b->end_ns;
+            if (b->error) stats->error = 1;
+        }
+        stats->lap_ns       = p->builders ? p->builders[0].lap_ns : 0;
+        stats->written      = p->written;
+        stats->underruns    = p->underruns;
+        stats->wait_ns      = p->wait_ns;
+        stats->first_ns     = atomic_load(&p->first_ns);
+        stats->first_tx_ns  = p->first_tx_ns;
+        stats->retire_waits = p->retire_waits;
+    }
+
+    for (uint32_t i = 0; p->builders && i < p->n_builders; i++) {
+        ring_free(&p->builders[i].ring);
+    }
+    ring_free(&p->retired);
+    if (p->dumper) close_pcap_file(p->dumper);
+    free_packet_list(p->samples);
+    free(p->tmpl_flow);
+    free(p->builders);
+    free(p);
+}
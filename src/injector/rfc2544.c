@@ -0,0 +1,208 @@
+// rfc2544.c
+#include "../../include/injector/rfc2544.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// preâmbulo + SFD (8) + intervalo entre quadros (12)
+#define ETHERNET_WIRE_OVERHEAD 20
+#define ETHERNET_FCS_SIZE      4
+
+uint64_t rfc2544_line_rate_pps(uint64_t link_mbps, size_t frame_size) {
+    if (frame_size == 0) return 0;
+    return link_mbps * 1000000ULL / ((frame_size + ETHERNET_WIRE_OVERHEAD) * 8);
+}
+
+/* Tamanho médio de quadro (com FCS) de uma lista em tamanho natural */
+static size_t average_frame_size(const packet_list_t *list) {
+    uint64_t total = 0;
+    for (const packet_t *p = list->head; p; p = p->next) {
+        total += p->length + ETHERNET_FCS_SIZE;
+    }
+    return list->count ? (size_t)(total / (uint64_t)list->count) : 0;
+}
+
+static void report_trial(FILE *csv, size_t frame_size, const char *kind,
+                         uint32_t trial, uint64_t rate, uint64_t line_rate,
+                         int pass, const txrx_result_t *r) {
+    double pct = line_rate ? (double)rate * 100.0 / (double)line_rate : 0.0;
+    printf("  [%4zu B] %-9s #%-2u taxa=%10llu pps (%6.2f%%) enviados=%u recebidos=%u "
+           "perda=%.4f%% obtida=%.0f pps p50=%.1fus p99=%.1fus -> %s\n",
+           frame_size, kind, trial, (unsigned long long)rate, pct,
+           r->sent, r->received, r->loss_pct, r->achieved_pps,
+           r->latency.p50_ns / 1e3, r->latency.p99_ns / 1e3,
+           pass ? "OK" : "FALHA");
+
+    if (csv) {
+        fprintf(csv, "%zu,%s,%u,%llu,%.4f,%u,%u,%.6f,%.0f,%d,%llu,%llu,%llu,%llu,%llu\n",
+                frame_size, kind, trial, (unsigned long long)rate, pct,
+                r->sent, r->received, r->loss_pct, r->achieved_pps, pass,
+                (unsigned long long)r->latency.min_ns,
+                (unsigned long long)r->latency.avg_ns,
+                (unsigned long long)r->latency.p50_ns,
+                (unsigned long long)r->latency.p99_ns,
+                (unsigned long long)r->latency.max_ns);
+        fflush(csv);
+    }
+}
+
+/*
+ * Taxa de uma tentativa. Com trial_s, a lista circula até rate x trial_s
+ * quadros: a tentativa dura o mesmo em qualquer taxa, em vez de encolher
+ * para uma rajada de milissegundos perto da taxa de linha.
+ */
+static int set_trial_rate(txrx_opts_t *opts, const rfc2544_cfg_t *cfg, uint64_t rate) {
+    opts->rate_pps = rate;
+    if (!cfg->trial_s) return 0;
+    const uint64_t frames = rate * cfg->trial_s;
+    if (frames > UINT32_MAX) {
+        fprintf(stderr, "RFC 2544: %u s a %llu pps excedem %u quadros por tentativa\n",
+                cfg->trial_s, (unsigned long long)rate, UINT32_MAX);
+        return -1;
+    }
+    opts->loop_count = (uint32_t)frames;
+    return 0;
+}
+
+/* Busca binária da vazão para uma lista já construída */
+static int search_frame_size(packet_list_t *list, size_t frame_size,
+                             const char *iface_send, const char *iface_recv,
+                             const rfc2544_cfg_t *cfg, FILE *csv,
+                             rfc2544_result_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->frame_size = frame_size ? frame_size : average_frame_size(list);
+    out->line_rate_pps = rfc2544_line_rate_pps(cfg->link_mbps, out->frame_size);
+    if (out->line_rate_pps == 0) {
+        fprintf(stderr, "RFC 2544: taxa de linha inválida para %zu bytes\n", out->frame_size);
+        return -1;
+    }
+
+    txrx_opts_t opts = cfg->base;
+    opts.timeout_ms = cfg->cooldown_ms;
+    opts.quiet      = 1;
+
+    const uint64_t line = out->line_rate_pps;
+    // passo mínimo de 1 pps: com resolução 0 a busca repetiria a mesma taxa
+    uint64_t step = (uint64_t)((double)line * cfg->resolution / 100.0);
+    if (step < 1) step = 1;
+    uint64_t lo = 0, hi = line, rate = line, best = 0;
+
+    for (uint32_t trial = 1; trial <= cfg->max_trials && rate > 0; trial++) {
+        txrx_result_t r;
+        if (set_trial_rate(&opts, cfg, rate) != 0) return -1;
+        if (txrx_run_ex(list, iface_send, iface_recv, &opts, &r) != 0) {
+            return -1;
+        }
+        out->trials = trial;
+
+        int pass = r.sent > 0 && r.loss_pct <= cfg->loss_threshold;
+        report_trial(csv, out->frame_size, "search", trial, rate, line, pass, &r);
+        if (r.achieved_pps < (double)rate * 0.99) {
+            fprintf(stderr, "  aviso: TX obteve %.0f pps de %llu pps ofertados; "
+                            "resultado limitado pelo host\n",
+                    r.achieved_pps, (unsigned long long)rate);
+        }
+
+        if (pass) {
+            best = rate;
+            lo = rate;
+            if (rate == line) break;  // taxa de linha aprovada
+        } else {
+            hi = rate;
+        }
+        if (hi - lo <= step) break;
+        rate = lo + (hi - lo) / 2;
+    }
+    out->throughput_pps = best;
+
+    // latência medida na taxa de vazão encontrada
+    if (best > 0) {
+        if (set_trial_rate(&opts, cfg, best) != 0) return -1;
+        if (txrx_run_ex(list, iface_send, iface_recv, &opts, &out->at_throughput) != 0) {
+            return -1;
+        }
+        report_trial(csv, out->frame_size, "latency", out->trials + 1, best, line,
+                     out->at_throughput.loss_pct <= cfg->loss_threshold,
+                     &out->at_throughput);
+    }
+    return 0;
+}
+
+int rfc2544_run(const template_set_t *set,
+                const char *iface_send,
+                const char *iface_recv,
+                const rfc2544_cfg_t *cfg,
+                rfc2544_result_t *results) {
+    if (!set || !cfg || !cfg->frame_sizes || cfg->n_frame_sizes == 0) {
+        fprintf(stderr, "rfc2544_run: argumentos inválidos\n");
+        return -1;
+    }
+    if (template_set_packet_count(set) == 0) {
+        fprintf(stderr, "rfc2544_run: templates não geram pacotes\n");
+        return -1;
+    }
+    if (template_set_scheduled(set)) {
+        // a busca controla a taxa: prazos próprios dos templates a anulariam
+        fprintf(stderr, "rfc2544_run: templates com rate_pps/start_ms não combinam com a busca de vazão\n");
+        return -1;
+    }
+
+    FILE *csv = NULL;
+    if (cfg->report_csv) {
+        csv = fopen(cfg->report_csv, "w");
+        if (!csv) {
+            fprintf(stderr, "rfc2544_run: falha ao abrir '%s'\n", cfg->report_csv);
+            return -1;
+        }
+        fprintf(csv, "frame_size,kind,trial,rate_pps,line_pct,sent,received,loss_pct,"
+                     "achieved_pps,pass,lat_min_ns,lat_avg_ns,lat_p50_ns,lat_p99_ns,lat_max_ns\n");
+    }
+
+    rfc2544_result_t *res = calloc(cfg->n_frame_sizes, sizeof(rfc2544_result_t));
+    if (!res) {
+        if (csv) fclose(csv);
+        return -1;
+    }
+
+    printf("RFC 2544 vazão: enlace=%llu Mbps, perda aceita=%.4f%%, resolução=%.2f%%, ",
+           (unsigned long long)cfg->link_mbps, cfg->loss_threshold, cfg->resolution);
+    if (cfg->trial_s) printf("tentativas de %u s\n", cfg->trial_s);
+    else printf("tentativas de uma passagem da lista\n");
+
+    int rc = 0;
+    for (size_t i = 0; i < cfg->n_frame_sizes && rc == 0; i++) {
+        // a lista de cada tamanho é construída uma vez e reusada em todas as tentativas
+        packet_list_t *list = create_packet_list();
+        if (!list || build_packets_from_templates(set, list, cfg->frame_sizes[i]) != 0) {
+            fprintf(stderr, "rfc2544_run: falha ao gerar pacotes de %zu bytes\n",
+                    cfg->frame_sizes[i]);
+            free_packet_list(list);
+            rc = -1;
+            break;
+        }
+        rc = search_frame_size(list, cfg->frame_sizes[i], iface_send, iface_recv,
+                               cfg, csv, &res[i]);
+        free_packet_list(list);
+    }
+
+    printf("\nRFC 2544 resumo:\n");
+    printf("  %-8s %-14s %-14s %-9s %-11s %-11s %-11s\n",
+           "quadro", "linha (pps)", "vazão (pps)", "% linha", "lat avg us", "lat p99 us", "tentativas");
+    for (size_t i = 0; i < cfg->n_frame_sizes; i++) {
+        const rfc2544_result_t *r = &res[i];
+        if (r->line_rate_pps == 0) continue;
+        printf("  %-8zu %-14llu %-14llu %-9.2f %-11.1f %-11.1f %-11u\n",
+               r->frame_size,
+               (unsigned long long)r->line_rate_pps,
+               (unsigned long long)r->throughput_pps,
+               (double)r->throughput_pps * 100.0 / (double)r->line_rate_pps,
+               r->at_throughput.latency.avg_ns / 1e3,
+               r->at_throughput.latency.p99_ns / 1e3,
+               r->trials);
+    }
+
+    if (results) memcpy(results, res, cfg->n_frame_sizes * sizeof(rfc2544_result_t));
+    free(res);
+    if (csv) fclose(csv);
+    return rc;
+}
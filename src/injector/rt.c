@@ -0,0 +1,106 @@
+// rt.c
+#define _GNU_SOURCE
+#include "../../include/injector/rt.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+void rt_opts_init(rt_opts_t *rt) {
+    if (!rt) return;
+    memset(rt, 0, sizeof(*rt));
+    rt->cpu_tx = -1;
+    rt->cpu_rx = -1;
+    rt->numa_node = NUMA_MEM_AUTO;
+}
+
+/* Escreve um byte por página para forçar a alocação física */
+static void prefault(void *addr, size_t len) {
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    volatile uint8_t *p = addr;
+    for (size_t off = 0; off < len; off += page) {
+        p[off] = p[off];
+    }
+    if (len > 0) p[len - 1] = p[len - 1];
+}
+
+int rt_lock_packets(packet_list_t *list) {
+    int rc = 0;
+    if (mlockall(MCL_CURRENT) != 0) {
+        fprintf(stderr, "RT: mlockall falhou: %s (verifique RLIMIT_MEMLOCK)\n",
+                strerror(errno));
+        rc = -1;
+    }
+    for (packet_t *p = list ? list->head : NULL; p; p = p->next) {
+        prefault(p->data, p->length);
+    }
+    return rc;
+}
+
+int rt_lock_region(void *addr, size_t len) {
+    if (!addr || len == 0) return 0;
+    int rc = 0;
+    if (mlock(addr, len) != 0) {
+        fprintf(stderr, "RT: mlock de %zu bytes falhou: %s\n", len, strerror(errno));
+        rc = -1;
+    }
+    prefault(addr, len);
+    return rc;
+}
+
+int rt_cpu_isolated(int cpu) {
+    FILE *f = fopen("/sys/devices/system/cpu/isolated", "r");
+    if (!f) return -1;
+
+    char buf[1024];
+    int isolated = 0;
+    if (fgets(buf, sizeof(buf), f)) {
+        // formato: "2-3,6,8-11"
+        char *save = NULL;
+        for (char *tok = strtok_r(buf, ",\n", &save); tok; tok = strtok_r(NULL, ",\n", &save)) {
+            int lo, hi;
+            int n = sscanf(tok, "%d-%d", &lo, &hi);
+            if (n == 1) hi = lo;
+            if (n >= 1 && cpu >= lo && cpu <= hi) {
+                isolated = 1;
+                break;
+            }
+        }
+    }
+    fclose(f);
+    return isolated;
+}
+
+int rt_apply_thread(int cpu, int fifo_prio, const char *name) {
+    int rc = 0;
+
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) {
+            fprintf(stderr, "RT: %s não fixou na CPU %d: %s\n", name, cpu, strerror(err));
+            rc = -1;
+        } else if (rt_cpu_isolated(cpu) == 0) {
+            fprintf(stderr, "RT: aviso: CPU %d de %s não está isolada (isolcpus)\n", cpu, name);
+        }
+    }
+
+    if (fifo_prio > 0) {
+        struct sched_param sp;
+        memset(&sp, 0, sizeof(sp));
+        sp.sched_priority = fifo_prio;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+        if (err != 0) {
+            fprintf(stderr, "RT: %s sem SCHED_FIFO(%d): %s\n", name, fifo_prio, strerror(err));
+            rc = -1;
+        }
+    }
+
+    return rc;
+}
@@ -0,0 +1,150 @@
+// rx_parse.c
+#define _GNU_SOURCE
+#include "../../include/injector/rx_parse.h"
+#include "../../include/netwagon.h"
+#include <netinet/in.h>
+#include <string.h>
+
+#define ETHERNET_HEADER_SIZE 14
+#define ETHERTYPE_IPV4       0x0800
+#define ETHERTYPE_IPV6       0x86DD
+#define IPV6_HEADER_SIZE     40
+#define IPV6_FRAGMENT        44
+#define MAX_ID_DIGITS        10
+
+/* Lê "123|" no início do payload; retorna 0 se não houver ID */
+static uint32_t parse_id(const uint8_t *payload, size_t len) {
+    uint64_t id = 0;
+    size_t i = 0;
+    while (i < len && i <= MAX_ID_DIGITS && payload[i] >= '0' && payload[i] <= '9') {
+        id = id * 10 + (uint64_t)(payload[i] - '0');
+        i++;
+    }
+    if (i == 0 || i >= len || payload[i] != '|' || id > UINT32_MAX) return 0;
+    return (uint32_t)id;
+}
+
+size_t rx_probe_stride(const uint8_t *payload, size_t len) {
+    static const uint8_t magic[4] = {
+        NW_PROBE_MAGIC >> 24, (NW_PROBE_MAGIC >> 16) & 0xFF, (NW_PROBE_MAGIC >> 8) & 0xFF, NW_PROBE_MAGIC & 0xFF
+    };
+    if (len < 2 * NW_PROBE_TAG_SIZE) return 0;
+    const uint8_t *next = memmem(payload + NW_PROBE_TAG_SIZE, len - NW_PROBE_TAG_SIZE, magic, sizeof(magic));
+    if (!next) return 0;
+    // todos os segmentos, menos o último, têm o mesmo tamanho
+    const size_t stride = (size_t)(next - payload);
+    for (size_t off = stride; off + NW_PROBE_TAG_SIZE <= len; off += stride) {
+        if (memcmp(payload + off, magic, sizeof(magic)) != 0) return 0;
+    }
+    return stride;
+}
+
+int rx_parse_frame(const uint8_t *frame, size_t caplen, rx_frame_info_t *info) {
+    memset(info, 0, sizeof(*info));
+    if (caplen < ETHERNET_HEADER_SIZE + 20) return -1;
+
+    // 1) Ethernet e pilha de encapsulamento (VLAN/QinQ, MPLS, GRE, VXLAN) até o IP interno
+    nw_stack_t st;
+    if (nw_stack_parse(frame, caplen, &st) != 0) return -1;
+    const uint16_t ethertype = st.ethertype;
+    size_t off = st.l3_offset;
+    info->l3_offset = off;
+
+    // 2) Cabeçalho IP: IHL varia no IPv4, fixo no IPv6.
+    //    Só o primeiro fragmento tem transporte (e o ID)
+    uint8_t proto;
+    if (ethertype == ETHERTYPE_IPV4 && (frame[off] >> 4) == 4) {
+        size_t ihl = (size_t)(frame[off] & 0x0F) * 4;
+        if (ihl < 20 || caplen < off + ihl) return -1;
+        if ((frame[off + 6] << 8 | frame[off + 7]) & 0x1FFF) return -1;
+        proto = frame[off + 9];
+        info->ip_version = 4;
+        off += ihl;
+    } else if (ethertype == ETHERTYPE_IPV6 && (frame[off] >> 4) == 6) {
+        if (caplen < off + IPV6_HEADER_SIZE) return -1;
+        proto = frame[off + 6];
+        info->ip_version = 6;
+        off += IPV6_HEADER_SIZE;
+        if (proto == IPV6_FRAGMENT) {
+            if (caplen < off + NW_IPV6_FRAG_SIZE || ((frame[off + 2] << 8 | frame[off + 3]) & 0xFFF8)) return -1;
+            proto = frame[off];
+            off += NW_IPV6_FRAG_SIZE;
+        }
+    } else {
+        return -1;
+    }
+    info->l4_proto  = proto;
+    info->l4_offset = off;
+
+    // 3) Protocolo de transporte
+    size_t th_len;
+    if (proto == IPPROTO_TCP) {
+        if (caplen < off + 20) return -1;
+        // TCP Data Offset em palavras de 32 bits
+        th_len = (size_t)((frame[off + 12] >> 4) & 0x0F) * 4;
+        if (th_len < 20) return -1;
+    } else if (proto == IPPROTO_UDP || proto == IPPROTO_ICMP || proto == IPPROTO_ICMPV6) {
+        th_len = 8;
+    } else {
+        return -1;
+    }
+
+    // 4) Offset total do payload
+    off += th_len;
+    if (caplen <= off) return -1;
+    info->payload_offset = off;
+    info->payload_len    = caplen - off;
+
+    // 5) Procura ID no payload: tag de sonda binário ou "ID|"
+    if (nw_probe_read(frame + off, info->payload_len, &info->id, &info->tx_ns)) {
+        return info->id ? 0 : -1;
+    }
+    info->id = parse_id(frame + off, info->payload_len);
+    return info->id ? 0 : -1;
+}
+
+uint32_t rx_flow_hash(const uint8_t *frame, size_t caplen) {
+    nw_stack_t st;
+    if (caplen < ETHERNET_HEADER_SIZE + 20 || nw_stack_parse(frame, caplen, &st) != 0) return 0;
+    const uint16_t ethertype = st.ethertype;
+    size_t off = st.l3_offset;
+
+    // XOR dos endereços e das portas: o mesmo valor nos dois sentidos
+    uint32_t h = 0;
+    uint8_t proto;
+    int first = 1;      // primeiro fragmento ou datagrama inteiro: tem portas
+    if (ethertype == ETHERTYPE_IPV4 && (frame[off] >> 4) == 4) {
+        const size_t ihl = (size_t)(frame[off] & 0x0F) * 4;
+        for (size_t i = 0; i < 4; i++) {
+            h = h << 8 | (uint32_t)(frame[off + 12 + i] ^ frame[off + 16 + i]);
+        }
+        first = !((frame[off + 6] << 8 | frame[off + 7]) & 0x1FFF);
+        proto = frame[off + 9];
+        off += ihl;
+    } else if (ethertype == ETHERTYPE_IPV6 && (frame[off] >> 4) == 6) {
+        if (caplen < off + IPV6_HEADER_SIZE) return 0;
+        for (size_t i = 0; i < 16; i++) {
+            h = (h << 8 | h >> 24) ^ (uint32_t)(frame[off + 8 + i] ^ frame[off + 24 + i]);
+        }
+        proto = frame[off + 6];
+        off += IPV6_HEADER_SIZE;
+        if (proto == IPV6_FRAGMENT && caplen >= off + NW_IPV6_FRAG_SIZE) {
+            first = !((frame[off + 2] << 8 | frame[off + 3]) & 0xFFF8);
+            proto = frame[off];
+            off += NW_IPV6_FRAG_SIZE;
+        }
+    } else {
+        return 0;
+    }
+    h ^= proto;
+    if (first && (proto == IPPROTO_TCP || proto == IPPROTO_UDP) && caplen >= off + 4) {
+        h ^= (uint32_t)((frame[off] ^ frame[off + 2]) << 8 | (frame[off + 1] ^ frame[off + 3])) << 8;
+    }
+    // espalha os bits (finalizador do murmur3)
+    h ^= h >> 16;
+    h *= 0x85EBCA6BU;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35U;
+    h ^= h >> 16;
+    return h;
+}
@@ -0,0 +1,80 @@
+// rx_queue.c
+#include "../include/injector/rx_queue.h"
+#include <stdio.h>
+#include <string.h>
+
+int rx_queue_init(rx_queue_t *q, size_t bytes, int node, int hugepages) {
+    memset(q, 0, sizeof(*q));
+    if (numa_region_alloc(&q->mem, bytes, node, hugepages) != 0) {
+        fprintf(stderr, "RX: falha ao alocar a fila de análise\n");
+        return -1;
+    }
+    q->buf  = q->mem.addr;
+    q->size = q->mem.len & ~7ULL;
+    // a captura não paga page faults na primeira volta
+    memset(q->buf, 0, q->size);
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    return 0;
+}
+
+void rx_queue_free(rx_queue_t *q) {
+    numa_region_free(&q->mem);
+    q->buf = NULL;
+}
+
+int rx_queue_push(rx_queue_t *q, const io_frame_t *frame, uint64_t ts, uint64_t wall_ns) {
+    const uint64_t size = (sizeof(rx_queued_t) + frame->caplen + 7) & ~7ULL;
+    const uint64_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    const uint64_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    const uint64_t off  = head % q->size;
+    const uint64_t room = q->size - off;
+    const uint64_t need = room < size ? room + size : size;
+    if (head - tail + need > q->size) return -1;
+
+    uint8_t *dst = q->buf + off;
+    if (room < size) {
+        // o registro não cabe no fim: o resto vira um registro vazio
+        if (room >= sizeof(rx_queued_t)) {
+            rx_queued_t *pad = (rx_queued_t *)dst;
+            pad->size = (uint32_t)room;
+            pad->pad  = 1;
+        }
+        dst = q->buf;
+    }
+    rx_queued_t *r = (rx_queued_t *)dst;
+    r->size           = (uint32_t)size;
+    r->caplen         = (uint32_t)frame->caplen;
+    r->len            = (uint32_t)frame->len;
+    r->pad            = 0;
+    r->ts             = ts;
+    r->wall_ns        = wall_ns;
+    r->kernel_ts_ns   = frame->kernel_ts_ns;
+    r->extra_delay_ns = frame->extra_delay_ns;
+    memcpy(r->data, frame->data, frame->caplen);
+    atomic_store_explicit(&q->head, head + need, memory_order_release);
+    return 0;
+}
+
+const rx_queued_t *rx_queue_peek(rx_queue_t *q) {
+    uint64_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    const uint64_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+    while (tail != head) {
+        const uint64_t off  = tail % q->size;
+        const uint64_t room = q->size - off;
+        const rx_queued_t *r = (const rx_queued_t *)(q->buf + off);
+        if (room < sizeof(rx_queued_t) || r->pad) {
+            // resto da volta: o produtor já escreveu o próximo no início
+            tail += room;
+            atomic_store_explicit(&q->tail, tail, memory_order_release);
+            continue;
+        }
+        return r;
+    }
+    return NULL;
+}
+
+void rx_queue_release(rx_queue_t *q, const rx_queued_t *r) {
+    const uint64_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    atomic_store_explicit(&q->tail, tail + r->size, memory_order_release);
+}
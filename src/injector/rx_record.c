@@ -0,0 +1,408 @@
+// rx_record.c
+#include "../include/injector/rx_record.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REC_PAD         0x1     // resto da volta do anel, sem quadro
+#define REC_TRIGGER     0x2     // quadro que disparou um gatilho
+#define REC_IDLE_NS     100000  // espera da thread de gravação com a fila vazia
+#define REC_FILE_BUF    (1 << 20)
+
+#define PCAP_MAGIC_NS   0xA1B23C4DU
+#define PCAPNG_SHB      0x0A0D0D0AU
+#define PCAPNG_IDB      0x00000001U
+#define PCAPNG_EPB      0x00000006U
+#define PCAPNG_BOM      0x1A2B3C4DU
+
+/* Registro da fila: cabeçalho seguido do quadro, alinhado a 8 bytes */
+typedef struct {
+    uint32_t size;
+    uint32_t flags;             // REC_*
+    uint32_t caplen;
+    uint32_t len;
+    uint64_t ts;                // chegada, em ticks do relógio
+} rec_hdr_t;
+
+/*
+ * Anel de registros de tamanho variável. head e tail só crescem; um registro
+ * nunca dá a volta: o resto do fim do buffer vira um registro REC_PAD (ou é
+ * pulado, se nem um cabeçalho cabe).
+ */
+typedef struct {
+    uint8_t          *buf;
+    uint64_t         size;      // múltiplo de 8
+    _Atomic uint64_t head;      // escrito só pelo produtor
+    _Atomic uint64_t tail;      // escrito só pelo consumidor
+} rec_ring_t;
+
+typedef struct {
+    FILE     *fp;
+    uint64_t bytes;
+    uint64_t first_ns;          // CLOCK_REALTIME do primeiro quadro (0 = nenhum ainda)
+} rec_file_t;
+
+struct rx_record {
+    rx_record_cfg_t   cfg;
+    const clock_src_t *clock;
+    uint64_t          realtime_offset;
+    uint32_t          snaplen;
+    int               pcapng;
+    rec_ring_t        queue;    // RX -> thread de gravação
+    rec_ring_t        ring;     // modo anel: últimos ring_mb MB (buf NULL = contínuo)
+    pthread_t         thread;
+    atomic_int        stop;
+
+    /* produtor (thread RX) */
+    uint64_t          frames;
+    uint64_t          dropped;
+    uint64_t          trigger_lat;  // em ticks (0 = desligado)
+    uint32_t          max_id;
+
+    /* consumidor (thread de gravação) */
+    rec_file_t        out;
+    uint32_t          file_seq;     // último arquivo numerado aberto
+    uint32_t          post_left;    // quadros ainda a gravar após um gatilho
+    uint64_t          written;
+    uint32_t          files;
+    uint32_t          triggers;
+    int               error;
+};
+
+/* ---------- anel ---------- */
+
+static int ring_init(rec_ring_t *q, uint64_t size) {
+    q->size = size & ~7ULL;
+    q->buf  = malloc(q->size);
+    if (!q->buf) return -1;
+    // pré-aloca as páginas: o RX não paga page faults na primeira volta
+    memset(q->buf, 0, q->size);
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    return 0;
+}
+
+/* espaço para um registro de size bytes; *adv inclui o resto pulado da volta */
+static uint8_t *ring_reserve(rec_ring_t *q, uint32_t size, uint64_t *adv) {
+    const uint64_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    const uint64_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    const uint64_t off  = head % q->size;
+    const uint64_t room = q->size - off;
+    const uint64_t need = room < size ? room + size : size;
+    if (head - tail + need > q->size) return NULL;
+    if (room >= size) {
+        *adv = size;
+        return q->buf + off;
+    }
+    if (room >= sizeof(rec_hdr_t)) {
+        rec_hdr_t *pad = (rec_hdr_t *)(q->buf + off);
+        pad->size  = (uint32_t)room;
+        pad->flags = REC_PAD;
+    }
+    *adv = need;
+    return q->buf;
+}
+
+static void ring_publish(rec_ring_t *q, uint64_t adv) {
+    const uint64_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    atomic_store_explicit(&q->head, head + adv, memory_order_release);
+}
+
+/* registro em *pos ou o seguinte, pulando restos de volta; NULL ao chegar em head */
+static rec_hdr_t *ring_at(const rec_ring_t *q, uint64_t *pos, uint64_t head) {
+    while (*pos != head) {
+        const uint64_t off  = *pos % q->size;
+        const uint64_t room = q->size - off;
+        rec_hdr_t *h = (rec_hdr_t *)(q->buf + off);
+        if (room < sizeof(rec_hdr_t) || (h->flags & REC_PAD)) {
+            *pos += room;
+            continue;
+        }
+        return h;
+    }
+    return NULL;
+}
+
+/* registro mais antigo (NULL = vazio) */
+static rec_hdr_t *ring_peek(rec_ring_t *q) {
+    uint64_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    const uint64_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+    rec_hdr_t *h = ring_at(q, &tail, head);
+    atomic_store_explicit(&q->tail, tail, memory_order_release);
+    return h;
+}
+
+static void ring_release(rec_ring_t *q, const rec_hdr_t *h) {
+    const uint64_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    atomic_store_explicit(&q->tail, tail + h->size, memory_order_release);
+}
+
+/* ---------- arquivos ---------- */
+
+static int file_put(rx_record_t *r, const void *p, size_t len) {
+    if (fwrite(p, 1, len, r->out.fp) != len) {
+        if (!r->error) perror("Gravação RX: escrita");
+        r->error = 1;
+        return -1;
+    }
+    r->out.bytes += len;
+    return 0;
+}
+
+/* seq = 0: o próprio cfg.path; senão <nome>.<seq><extensão> */
+static int file_open(rx_record_t *r, uint32_t seq) {
+    char name[4096];
+    const char *path = r->cfg.path;
+    if (seq) {
+        const char *slash = strrchr(path, '/');
+        const char *dot = strrchr(path, '.');
+        if (!dot || (slash && dot < slash)) dot = path + strlen(path);
+        snprintf(name, sizeof(name), "%.*s.%u%s", (int)(dot - path), path, seq, dot);
+        path = name;
+    }
+    memset(&r->out, 0, sizeof(r->out));
+    r->out.fp = fopen(path, "wb");
+    if (!r->out.fp) {
+        fprintf(stderr, "Gravação RX: não abriu '%s'\n", path);
+        r->error = 1;
+        return -1;
+    }
+    setvbuf(r->out.fp, NULL, _IOFBF, REC_FILE_BUF);
+    r->files++;
+
+    if (!r->pcapng) {
+        const struct {
+            uint32_t magic;
+            uint16_t major, minor;
+            int32_t  thiszone;
+            uint32_t sigfigs, snaplen, linktype;
+        } hdr = { PCAP_MAGIC_NS, 2, 4, 0, 0, r->snaplen, 1 };
+        return file_put(r, &hdr, sizeof(hdr));
+    }
+    const struct {
+        uint32_t type, len, bom;
+        uint16_t major, minor;
+        int64_t  section_len;
+        uint32_t len2;
+    } __attribute__((packed)) shb = { PCAPNG_SHB, 28, PCAPNG_BOM, 1, 0, -1, 28 };
+    // interface Ethernet com if_tsresol = 9 (ns)
+    const struct {
+        uint32_t type, len;
+        uint16_t linktype, reserved;
+        uint32_t snaplen;
+        uint16_t opt_code, opt_len;
+        uint8_t  tsresol, pad[3];
+        uint32_t opt_end;
+        uint32_t len2;
+    } idb = { PCAPNG_IDB, 32, 1, 0, r->snaplen, 9, 1, 9, { 0, 0, 0 }, 0, 32 };
+    if (file_put(r, &shb, sizeof(shb)) != 0) return -1;
+    return file_put(r, &idb, sizeof(idb));
+}
+
+static void file_close(rx_record_t *r) {
+    if (!r->out.fp) return;
+    if (fclose(r->out.fp) != 0 && !r->error) {
+        perror("Gravação RX: fechamento");
+        r->error = 1;
+    }
+    r->out.fp = NULL;
+}
+
+static uint64_t rec_realtime_ns(const rx_record_t *r, const rec_hdr_t *h) {
+    return r->realtime_offset + clock_src_mono_ns(r->clock, h->ts);
+}
+
+static void file_write(rx_record_t *r, const rec_hdr_t *h) {
+    if (!r->out.fp || r->error) return;
+    const uint64_t ns = rec_realtime_ns(r, h);
+    const uint8_t *data = (const uint8_t *)(h + 1);
+    if (!r->out.first_ns) r->out.first_ns = ns;
+    int rc;
+    if (!r->pcapng) {
+        const uint32_t rec[4] = { (uint32_t)(ns / 1000000000ULL), (uint32_t)(ns % 1000000000ULL),
+                                  h->caplen, h->len };
+        rc = file_put(r, rec, sizeof(rec));
+        if (rc == 0) rc = file_put(r, data, h->caplen);
+    } else {
+        static const uint8_t zeros[4];
+        const uint32_t pad = (4 - (h->caplen & 3)) & 3;
+        const uint32_t total = 32 + h->caplen + pad;
+        const uint32_t epb[7] = { PCAPNG_EPB, total, 0, (uint32_t)(ns >> 32), (uint32_t)ns,
+                                  h->caplen, h->len };
+        rc = file_put(r, epb, sizeof(epb));
+        if (rc == 0) rc = file_put(r, data, h->caplen);
+        if (rc == 0 && pad) rc = file_put(r, zeros, pad);
+        if (rc == 0) rc = file_put(r, &total, sizeof(total));
+    }
+    if (rc == 0) r->written++;
+}
+
+/* ---------- thread de gravação ---------- */
+
+/* contínuo: roda o arquivo por tamanho ou tempo antes de gravar o quadro */
+static void write_continuous(rx_record_t *r, const rec_hdr_t *h) {
+    const uint64_t max_bytes = (uint64_t)r->cfg.rotate_mb << 20;
+    const uint64_t max_ns = (uint64_t)r->cfg.rotate_s * 1000000000ULL;
+    if (r->out.fp && r->out.first_ns &&
+        ((max_bytes && r->out.bytes + h->size > max_bytes) ||
+         (max_ns && rec_realtime_ns(r, h) - r->out.first_ns >= max_ns))) {
+        file_close(r);
+        file_open(r, ++r->file_seq);
+    }
+    file_write(r, h);
+}
+
+/* anel: guarda o quadro (descartando os mais antigos) e trata os gatilhos */
+static void write_ring(rx_record_t *r, const rec_hdr_t *h) {
+    uint64_t adv;
+    uint8_t *p;
+    while (!(p = ring_reserve(&r->ring, h->size, &adv))) {
+        ring_release(&r->ring, ring_peek(&r->ring));
+    }
+    memcpy(p, h, h->size);
+    ring_publish(&r->ring, adv);
+
+    if (r->post_left) {
+        file_write(r, h);
+        if (--r->post_left == 0) file_close(r);
+        return;
+    }
+    if (!(h->flags & REC_TRIGGER)) return;
+    r->triggers++;
+    if (r->file_seq >= RX_RECORD_MAX_DUMPS || file_open(r, ++r->file_seq) != 0) return;
+    // o que antecedeu a anomalia, inclusive o próprio quadro
+    uint64_t pos = atomic_load_explicit(&r->ring.tail, memory_order_relaxed);
+    const uint64_t head = atomic_load_explicit(&r->ring.head, memory_order_relaxed);
+    for (const rec_hdr_t *q = ring_at(&r->ring, &pos, head); q; q = ring_at(&r->ring, &pos, head)) {
+        file_write(r, q);
+        pos += q->size;
+    }
+    r->post_left = RX_RECORD_TRIGGER_POST;
+}
+
+static void *thread_writer(void *arg) {
+    rx_record_t *r = arg;
+    const struct timespec idle = { 0, REC_IDLE_NS };
+    for (;;) {
+        // stop lido antes da fila: depois dele, o RX não enfileira mais nada
+        const int stop = atomic_load(&r->stop);
+        const rec_hdr_t *h = ring_peek(&r->queue);
+        if (!h) {
+            if (stop) break;
+            nanosleep(&idle, NULL);
+            continue;
+        }
+        if (r->ring.buf) {
+            write_ring(r, h);
+        } else {
+            write_continuous(r, h);
+        }
+        ring_release(&r->queue, h);
+    }
+
+    // anel sem gatilhos: os últimos ring_mb MB vão para o arquivo no fim
+    if (r->ring.buf && !r->cfg.trigger_us && !r->cfg.trigger_gap) {
+        uint64_t pos = atomic_load_explicit(&r->ring.tail, memory_order_relaxed);
+        const uint64_t head = atomic_load_explicit(&r->ring.head, memory_order_relaxed);
+        for (const rec_hdr_t *q = ring_at(&r->ring, &pos, head); q; q = ring_at(&r->ring, &pos, head)) {
+            file_write(r, q);
+            pos += q->size;
+        }
+    }
+    file_close(r);
+    return NULL;
+}
+
+/* ---------- API ---------- */
+
+rx_record_t *rx_record_start(const rx_record_cfg_t *cfg, const clock_src_t *clock,
+                             uint64_t realtime_offset) {
+    if (!cfg || !cfg->path || !clock) return NULL;
+    if ((cfg->trigger_us || cfg->trigger_gap) && !cfg->ring_mb) {
+        fprintf(stderr, "Gravação RX: gatilhos exigem o modo anel\n");
+        return NULL;
+    }
+    rx_record_t *r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    r->cfg             = *cfg;
+    r->clock           = clock;
+    r->realtime_offset = realtime_offset;
+    r->snaplen         = cfg->snaplen && cfg->snaplen < 65535 ? cfg->snaplen : 65535;
+    const size_t plen  = strlen(cfg->path);
+    r->pcapng          = plen >= 7 && strcmp(cfg->path + plen - 7, ".pcapng") == 0;
+    r->trigger_lat     = cfg->trigger_us ? clock_src_from_ns(clock, (uint64_t)cfg->trigger_us * 1000ULL) : 0;
+    atomic_init(&r->stop, 0);
+
+    int ok = ring_init(&r->queue, (uint64_t)RX_RECORD_QUEUE_MB << 20) == 0;
+    if (ok && cfg->ring_mb) ok = ring_init(&r->ring, (uint64_t)cfg->ring_mb << 20) == 0;
+    if (!ok) fprintf(stderr, "Gravação RX: falha ao alocar a fila\n");
+    // contínuo e anel sem gatilhos: o arquivo é aberto já, para falhar antes do TX
+    if (ok && !(cfg->trigger_us || cfg->trigger_gap)) {
+        const int rotating = !cfg->ring_mb && (cfg->rotate_mb || cfg->rotate_s);
+        if (rotating) r->file_seq = 1;
+        ok = file_open(r, r->file_seq) == 0;
+    }
+    if (ok && pthread_create(&r->thread, NULL, thread_writer, r) != 0) {
+        fprintf(stderr, "Gravação RX: falha ao criar a thread\n");
+        ok = 0;
+    }
+    if (!ok) {
+        file_close(r);
+        free(r->queue.buf);
+        free(r->ring.buf);
+        free(r);
+        return NULL;
+    }
+    return r;
+}
+
+void rx_record_push(rx_record_t *r, const uint8_t *data, size_t caplen, size_t len,
+                    uint64_t ts, uint64_t latency, uint32_t id) {
+    r->frames++;
+    uint32_t flags = 0;
+    if (id) {
+        if (r->trigger_lat && latency > r->trigger_lat) flags = REC_TRIGGER;
+        if (id > r->max_id) {
+            // IDs seguem a ordem de envio: um salto é perda (ou reordenação grande)
+            if (r->cfg.trigger_gap && id - r->max_id - 1 >= r->cfg.trigger_gap) flags = REC_TRIGGER;
+            r->max_id = id;
+        }
+    }
+    const uint32_t cap = caplen < r->snaplen ? (uint32_t)caplen : r->snaplen;
+    const uint32_t size = (uint32_t)((sizeof(rec_hdr_t) + cap + 7) & ~(size_t)7);
+    uint64_t adv;
+    uint8_t *p = ring_reserve(&r->queue, size, &adv);
+    if (!p) {
+        r->dropped++;
+        return;
+    }
+    rec_hdr_t *h = (rec_hdr_t *)p;
+    h->size   = size;
+    h->flags  = flags;
+    h->caplen = cap;
+    h->len    = (uint32_t)len;
+    h->ts     = ts;
+    memcpy(h + 1, data, cap);
+    ring_publish(&r->queue, adv);
+}
+
+int rx_record_stop(rx_record_t *r, rx_record_stats_t *stats) {
+    if (!r) return 0;
+    atomic_store(&r->stop, 1);
+    pthread_join(r->thread, NULL);
+    if (stats) {
+        stats->frames   = r->frames;
+        stats->written  = r->written;
+        stats->dropped  = r->dropped;
+        stats->files    = r->files;
+        stats->triggers = r->triggers;
+    }
+    const int rc = r->error ? -1 : 0;
+    free(r->queue.buf);
+    free(r->ring.buf);
+    free(r);
+    return rc;
+}
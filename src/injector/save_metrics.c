@@ -91,4 +91,79 @@ int save_metrics_to_csv(const uint64_t *send_timestamp,
     printf("Métricas salvas em '%s'\n", filename);
 
     return 0;
-}
\ No newline at end of file
+}
+
+int save_sequence_to_csv(const seq_stats_t *seq, const struct tm *timeinfo) {
+    if (!seq || !timeinfo) {
+        fprintf(stderr, "save_sequence_to_csv: argumentos inválidos\n");
+        return -1;
+    }
+    if (ensure_directory_exists() != 0) {
+        return -1;
+    }
+
+    char timestamp[32], filename[64];
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d_%H-%M-%S", timeinfo);
+    snprintf(filename, sizeof(filename), "%s/sequence_%s.csv", "latencies", timestamp);
+    if (seq_stats_save_csv(seq, filename) != 0) {
+        return -1;
+    }
+    printf("Análise de sequência salva em '%s'\n", filename);
+    return 0;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+int compute_latency_summary(const uint64_t *send_timestamp,
+                            const uint64_t *recv_timestamp,
+                            uint32_t total_pkts, uint64_t min_send_ts,
+                            latency_summary_t *out) {
+    if (!send_timestamp || !recv_timestamp || !out) {
+        return -1;
+    }
+    memset(out, 0, sizeof(*out));
+    if (total_pkts == 0) return 0;
+
+    uint64_t *lat = malloc((size_t)total_pkts * sizeof(uint64_t));
+    if (!lat) {
+        fprintf(stderr, "compute_latency_summary: falha ao alocar memória\n");
+        return -1;
+    }
+
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < total_pkts; i++) {
+        if (!send_timestamp[i] || !recv_timestamp[i]) continue;
+        if (send_timestamp[i] < min_send_ts) continue;
+        // RX pode registrar antes do TX gravar o seu timestamp (mesmo host)
+        uint64_t l = recv_timestamp[i] > send_timestamp[i]
+                   ? recv_timestamp[i] - send_timestamp[i] : 0;
+        lat[n++] = l;
+    }
+
+    compute_sample_summary(lat, n, out);
+
+    free(lat);
+    return 0;
+}
+
+void compute_sample_summary(uint64_t *samples, uint32_t n, latency_summary_t *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!samples || n == 0) return;
+
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) sum += samples[i];
+
+    qsort(samples, n, sizeof(uint64_t), cmp_u64);
+    out->samples = n;
+    out->min_ns  = samples[0];
+    out->max_ns  = samples[n - 1];
+    out->avg_ns  = sum / n;
+    out->p50_ns  = samples[(uint64_t)(n - 1) * 50 / 100];
+    out->p99_ns  = samples[(uint64_t)(n - 1) * 99 / 100];
+    out->p999_ns = samples[(uint64_t)(n - 1) * 999 / 1000];
+}
@@ -0,0 +1,93 @@
+// seq_stats.c
+#include "../include/injector/seq_stats.h"
+
+void seq_stats_to_ns(seq_stats_t *s, const clock_src_t *clk) {
+    if (!s || !clk) return;
+    s->jitter16     = clock_src_to_ns(clk, s->jitter16);
+    s->prev_transit = clock_src_to_ns(clk, s->prev_transit);
+}
+
+void seq_stats_merge(seq_stats_t *dst, const seq_stats_t *src) {
+    if (!dst || !src) return;
+    const uint64_t arrivals = (uint64_t)dst->arrivals + src->arrivals;
+    if (arrivals) {
+        dst->jitter16 = (dst->jitter16 * dst->arrivals + src->jitter16 * src->arrivals) / arrivals;
+    }
+    dst->arrivals    += src->arrivals;
+    dst->reordered   += src->reordered;
+    dst->reorder_sum += src->reorder_sum;
+    if (src->reorder_max > dst->reorder_max) dst->reorder_max = src->reorder_max;
+    dst->duplicates  += src->duplicates;
+    dst->late        += src->late;
+    dst->loss_bursts += src->loss_bursts;
+    if (src->burst_max > dst->burst_max) dst->burst_max = src->burst_max;
+    for (uint32_t b = 0; b < SEQ_HIST_BUCKETS; b++) {
+        dst->reorder_hist[b] += src->reorder_hist[b];
+        dst->burst_hist[b]   += src->burst_hist[b];
+    }
+}
+
+/* "1:n 2-3:n 4-7:n ..." só com as faixas não vazias */
+static void print_hist(const uint32_t *hist, FILE *out) {
+    for (uint32_t b = 0; b < SEQ_HIST_BUCKETS; b++) {
+        if (!hist[b]) continue;
+        const unsigned long lo = 1UL << b;
+        if (b == SEQ_HIST_BUCKETS - 1) {
+            fprintf(out, " %lu+:%u", lo, hist[b]);
+        } else if (b == 0) {
+            fprintf(out, " 1:%u", hist[b]);
+        } else {
+            fprintf(out, " %lu-%lu:%u", lo, 2 * lo - 1, hist[b]);
+        }
+    }
+}
+
+void seq_stats_print(const seq_stats_t *s, FILE *out) {
+    if (!s || !s->arrivals) return;
+    fprintf(out, "Sequência: reordenados=%u (%.2f%%) deslocamento médio=%.1f máx=%u | "
+                 "duplicados=%u | tardios=%u | jitter RFC 3550=%.1f us\n",
+            s->reordered, (double)s->reordered / s->arrivals * 100.0,
+            s->reordered ? (double)s->reorder_sum / s->reordered : 0.0, s->reorder_max,
+            s->duplicates, s->late, seq_stats_jitter(s) / 1e3);
+    if (s->reordered) {
+        fprintf(out, "  deslocamentos:");
+        print_hist(s->reorder_hist, out);
+        fputc('\n', out);
+    }
+    if (s->loss_bursts) {
+        fprintf(out, "  rajadas de perda: %u, máx=%u, tamanhos:", s->loss_bursts, s->burst_max);
+        print_hist(s->burst_hist, out);
+        fputc('\n', out);
+    }
+}
+
+int seq_stats_save_csv(const seq_stats_t *s, const char *filename) {
+    if (!s || !filename) return -1;
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        perror("seq_stats_save_csv: fopen");
+        return -1;
+    }
+    fprintf(fp, "metric,value\n");
+    fprintf(fp, "arrivals,%u\n", s->arrivals);
+    fprintf(fp, "reordered,%u\n", s->reordered);
+    fprintf(fp, "reorder_extent_max,%u\n", s->reorder_max);
+    fprintf(fp, "reorder_extent_sum,%llu\n", (unsigned long long)s->reorder_sum);
+    fprintf(fp, "duplicates,%u\n", s->duplicates);
+    fprintf(fp, "late,%u\n", s->late);
+    fprintf(fp, "jitter_ns,%llu\n", (unsigned long long)seq_stats_jitter(s));
+    fprintf(fp, "loss_bursts,%u\n", s->loss_bursts);
+    fprintf(fp, "loss_burst_max,%u\n", s->burst_max);
+    // faixas pelo menor valor: reorder_extent_4 conta deslocamentos de 4 a 7
+    for (uint32_t b = 0; b < SEQ_HIST_BUCKETS; b++) {
+        fprintf(fp, "reorder_extent_%lu,%u\n", 1UL << b, s->reorder_hist[b]);
+    }
+    for (uint32_t b = 0; b < SEQ_HIST_BUCKETS; b++) {
+        fprintf(fp, "loss_burst_%lu,%u\n", 1UL << b, s->burst_hist[b]);
+    }
+    if (fclose(fp) != 0) {
+        perror("seq_stats_save_csv: fclose");
+        return -1;
+    }
+    return 0;
+}
@@ -1,186 +1,1036 @@
 // txrx.c
 #include "../include/injector/txrx.h"
 #include "../include/injector/save_metrics.h"
-#include <pcap.h>
+#include "../include/injector/rx_parse.h"
+#include "../include/injector/io_backend.h"
+#include "../include/injector/txrx_uring.h"
+#include "../include/injector/txrx_udp.h"
+#include "../include/generator/tcp_flow.h"
+#include "../include/netwagon.h"
 #include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 
-static uint64_t now_ns() {
+// abaixo deste limite a espera pelo próximo envio é feita em espera ativa
+#define SPIN_THRESHOLD_NS 50000ULL
+// espera de um analisador do RX com a fila vazia
+#define RX_WORKER_IDLE_NS 20000
+
+static uint64_t realtime_ns() {
     struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (uint64_t)(ts.tv_sec * 1000000000 + ts.tv_nsec);
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void txrx_wait_until(const clock_src_t *clk, uint64_t deadline) {
+    const uint64_t spin = clock_src_from_ns(clk, SPIN_THRESHOLD_NS);
+    uint64_t now = clock_src_now(clk);
+    if (deadline > now + spin) {
+        uint64_t target = clock_src_mono_ns(clk, deadline - spin);
+        struct timespec ts = {
+            .tv_sec  = (time_t)(target / 1000000000ULL),
+            .tv_nsec = (long)(target % 1000000000ULL)
+        };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+    while (clock_src_now(clk) < deadline) {
+        // espera ativa
+    }
+}
+
+// fim da janela de warm-up, em ticks (0 = sem warm-up)
+static uint64_t warmup_end(const txrx_ctx_t *ctx) {
+    return ctx->opts.warmup_ms
+        ? ctx->tx_start + clock_src_from_ns(&ctx->clock, (uint64_t)ctx->opts.warmup_ms * 1000000ULL) : 0;
+}
+
+static void rx_workers_stop(txrx_ctx_t *ctx);
+
+static void free_ctx_arrays(txrx_ctx_t *ctx) {
+    // analisadores escrevem nos arrays: param antes
+    rx_workers_stop(ctx);
+    if (ctx->opts.rt.lock_memory) {
+        munlockall();
+    }
+    if (ctx->pkt_data) {
+        uint32_t i = 0;
+        for (packet_t *p = ctx->list->head; p; p = p->next) {
+            p->data = ctx->pkt_data[i++];
+        }
+        free(ctx->pkt_data);
+    }
+    numa_region_free(&ctx->mem_pkts);
+    numa_region_free(&ctx->mem_tx);
+    numa_region_free(&ctx->mem_rx);
+    flow_stats_free(ctx->flow_stats);
+    rx_record_stop(ctx->recorder, NULL);
+    pipeline_stop(ctx->pipe, NULL);
+    pthread_mutex_destroy(&ctx->lock);
+    pthread_cond_destroy(&ctx->cond_rx_ready);
+}
+
+// copia os quadros da lista para uma região no nó do TX; os originais voltam em free_ctx_arrays
+static int place_packets(txrx_ctx_t *ctx) {
+    size_t total = 0;
+    for (packet_t *p = ctx->list->head; p; p = p->next) {
+        total += (p->length + 63) & ~(size_t)63;
+    }
+    ctx->pkt_data = malloc((size_t)ctx->list->count * sizeof(void *));
+    if (!ctx->pkt_data ||
+        numa_region_alloc(&ctx->mem_pkts, total, ctx->node_tx, ctx->opts.rt.hugepages) != 0) {
+        free(ctx->pkt_data);
+        ctx->pkt_data = NULL;
+        return -1;
+    }
+    uint8_t *dst = ctx->mem_pkts.addr;
+    uint32_t i = 0;
+    for (packet_t *p = ctx->list->head; p; p = p->next) {
+        memcpy(dst, p->data, p->length);
+        ctx->pkt_data[i++] = p->data;
+        p->data = dst;
+        dst += (p->length + 63) & ~(size_t)63;
+    }
+    return 0;
+}
+
+static void tx_finish(txrx_ctx_t *ctx) {
+    atomic_store(&ctx->tx_end, clock_src_now(&ctx->clock));
+    atomic_store(&ctx->tx_done, 1);
+}
+
+// sinaliza à thread principal o estado da captura
+static void rx_set_state(txrx_ctx_t *ctx, int state) {
+    pthread_mutex_lock(&ctx->lock);
+    ctx->rx_state = state;
+    pthread_cond_signal(&ctx->cond_rx_ready);
+    pthread_mutex_unlock(&ctx->lock);
 }
 
 // thread de envio
 static void *thread_tx(void *arg) {
     txrx_ctx_t *ctx = arg;
-    char errbuf[PCAP_ERRBUF_SIZE];
-    pcap_t *pc = pcap_open_live(ctx->iface_send, BUFSIZ, 0, 1, errbuf);
-    if (!pc) {
+    char errbuf[IO_ERRBUF_SIZE];
+    rt_apply_thread(ctx->opts.rt.cpu_tx, ctx->opts.rt.fifo_prio, "TX");
+    io_backend_t *io = io_open_tx(ctx->iface_send, errbuf, sizeof(errbuf));
+    if (!io) {
         fprintf(stderr, "TX: não abriu '%s': %s\n", ctx->iface_send, errbuf);
+        tx_finish(ctx);
         return NULL;
     }
 
-    packet_t *pkt = ctx->list->head;
-    for (uint32_t idx = 0; pkt; pkt = pkt->next, idx++) {
-        const uint64_t t0 = now_ns();
-        if (pcap_sendpacket(pc, pkt->data, pkt->length) != 0) {
-            fprintf(stderr, "TX[%u]: falha: %s\n", idx, pcap_geterr(pc));
+    const clock_src_t *clk = &ctx->clock;
+    const uint64_t rate = ctx->opts.rate_pps;
+    const int paced = txrx_paced(ctx);
+    const uint64_t pause = clock_src_from_ns(clk, 1000000ULL);
+    // em fluxo, os prazos contam a partir do primeiro quadro pronto
+    packet_t *pkt = ctx->pipe ? pipeline_next(ctx->pipe) : ctx->list->head;
+    ctx->tx_start = clock_src_now(clk);
+
+    uint64_t deadline = ctx->tx_start;
+    uint32_t lap_base = 0;      // em loop: seq = lap_base + ID
+    uint32_t lap = 0;
+    instr_t *in = &ctx->instr;
+    const int timed = in->enabled;
+    uint64_t ts_wait = 0, ts_send = 0;
+    for (uint32_t idx = 0; idx < ctx->total_sends && pkt; idx++) {
+        if (timed) ts_wait = clock_src_now(clk);
+        if (paced) {
+            deadline = txrx_deadline(ctx, idx, lap, pkt->tx_offset_ns);
+            txrx_wait_until(clk, deadline);
+        }
+        // sessões TCP: ACK com o ISN real do servidor, se já conhecido
+        tcp_flow_patch_ack(ctx->list->flows, pkt->flow, pkt->data, pkt->length, pkt->ip_version,
+                           pkt->tcp_ack);
+        const uint32_t seq = pkt->id ? lap_base + pkt->id : 0;
+        const uint64_t t0 = clock_src_now(clk);
+        if (ctx->opts.stamp && pkt->probe_off) {
+            const uint64_t tx_ns = clock_src_mono_ns(clk, t0) + ctx->realtime_offset;
+            if (pkt->csum_partial) {
+                nw_probe_stamp_partial(pkt->data, pkt->length, pkt->probe_off, seq, tx_ns);
+            } else {
+                nw_probe_stamp(pkt->data, pkt->length, pkt->probe_off, seq, tx_ns);
+            }
+        }
+        if (timed) {
+            ts_send = clock_src_now(clk);
+            instr_stage_add(in, INSTR_TX_WAIT, t0 - ts_wait);
+            instr_stage_add(in, INSTR_TX_PREPARE, ts_send - t0);
+        }
+        int rc;
+        if (io->send_vnet) {
+            // checksum parcial e TSO/GSO ficam com o kernel/NIC
+            uint8_t vnet_hdr[NW_VNET_HDR_SIZE];
+            nw_vnet_hdr(pkt->data, pkt->length, pkt->csum_partial, pkt->gso_size, vnet_hdr);
+            rc = io->send_vnet(io, vnet_hdr, pkt->data, pkt->length);
+        } else {
+            rc = io->send(io, pkt->data, pkt->length);
+        }
+        if (timed) instr_stage_add(in, INSTR_TX_SEND, clock_src_now(clk) - ts_send);
+        in->tx.attempts++;
+        if (rc != 0) {
+            in->tx.failed++;
+            fprintf(stderr, "TX[%u]: falha: %s\n", idx, io->errbuf);
+        } else {
+            in->tx.sent++;
+        }
+        // quadro que não saiu do host não conta como enviado (nem como perda)
+        uint32_t slot = seq ? seq - 1 : txrx_slot(ctx, pkt, idx);
+        if (rc == 0 && slot < ctx->total_pkts) {
+            ctx->send_timestamp[slot] = t0;
+        }
+        if (idx < ctx->total_pkts) {
+            ctx->tx_lateness[idx] = t0 > deadline ? t0 - deadline : 0;
+        }
+        if (!paced && !rate) {
+            deadline = clock_src_now(clk) + pause;
+            usleep(1000);  // pequenas pausas para não atropelar a interface
+        } else if (!paced) {
+            deadline = clock_src_now(clk);
+        }
+        if (ctx->pipe) {
+            pipeline_retire(ctx->pipe, pkt);
+            pkt = pipeline_next(ctx->pipe);
+            continue;
+        }
+        pkt = pkt->next;
+        if (!pkt) {
+            pkt = ctx->list->head;
+            lap_base += ctx->ids_per_lap;
+            lap++;
         }
-        //pthread_mutex_lock(&ctx->lock);
-        ctx->send_timestamp[idx] = t0;
-        //pthread_mutex_unlock(&ctx->lock);
-        usleep(1000);  // pequenas pausas para não atropelar a interface
     }
 
-    pcap_close(pc);
+    in->tx.eagain  += io->tx_eagain;
+    in->tx.enobufs += io->tx_enobufs;
+    tx_finish(ctx);
+    io_close(io);
     return NULL;
 }
 
-// thread de captura e correlação
+// motor udp: payloads por sockets UDP do kernel, RX como no motor de threads
+static void *thread_tx_udp(void *arg) {
+    txrx_ctx_t *ctx = arg;
+    rt_apply_thread(ctx->opts.rt.cpu_tx, ctx->opts.rt.fifo_prio, "TX");
+    txrx_udp_send(ctx);
+    tx_finish(ctx);
+    return NULL;
+}
+
+/* Analisador do RX: a própria thread RX ou um dos --rx-workers */
+typedef struct {
+    rx_correlator_t corr;
+    uint32_t        expected;       // IDs que encerram a captura (UINT32_MAX = a captura decide)
+    seq_stats_t     *seq;
+    instr_t         *in;
+    rx_record_t     *rec;           // NULL = a captura grava (ou gravação desligada)
+    int             synthetic_ts;
+    int             gso_rx;
+} rx_analyzer_t;
+
+/* Analisador em thread própria, alimentado pela captura por uma fila */
+struct rx_worker {
+    txrx_ctx_t      *ctx;
+    rx_queue_t      queue;
+    rx_analyzer_t   an;
+    seq_stats_t     seq;
+    instr_t         instr;
+    pthread_t       thread;
+    int             running;        // thread criada
+    atomic_uint     received;       // IDs distintos já correlacionados, lido pela captura
+};
+
+static void rx_analyzer_init(txrx_ctx_t *ctx, rx_analyzer_t *a, seq_stats_t *seq, instr_t *in,
+                             rx_record_t *rec, uint32_t expected) {
+    memset(a, 0, sizeof(*a));
+    a->corr.recv_timestamp = ctx->recv_timestamp;
+    a->corr.total_pkts     = ctx->total_pkts;
+    a->expected            = expected;
+    a->seq                 = seq;
+    a->in                  = in;
+    a->rec                 = rec;
+    a->synthetic_ts        = (io_rx_spec_flags(ctx->iface_recv) & IO_FLAG_SYNTHETIC_TS) != 0;
+    a->gso_rx              = ctx->opts.engine == TXRX_ENGINE_UDP;
+}
+
+// ID, correlação, sequência, fluxos e gravação de um quadro que chegou em arrival (ticks).
+// wall_ns: CLOCK_REALTIME da chegada (0 = lê agora); t0: início da análise (só com estágios).
+// Retorna 1 quando todos os IDs esperados pelo analisador chegaram.
+static int rx_analyze(txrx_ctx_t *ctx, rx_analyzer_t *a, const io_frame_t *frame,
+                      uint64_t arrival, uint64_t wall_ns, uint64_t t0) {
+    const clock_src_t *clk = &ctx->clock;
+    instr_t *in = a->in;
+    const int timed = in->enabled;
+    rx_frame_info_t info;
+    const int parsed = rx_parse_frame(frame->data, frame->caplen, &info);
+    tcp_flow_table_t *flows = ctx->list->flows;
+    if (flows && info.l4_proto == IPPROTO_TCP) {
+        tcp_flow_observe(flows, frame->data, frame->caplen, info.l3_offset, info.l4_offset,
+                         info.ip_version, arrival);
+    }
+    if (parsed != 0) in->rx.unparsed++;
+    uint64_t ts_stage = 0;
+    if (timed) {
+        ts_stage = clock_src_now(clk);
+        instr_stage_add(in, INSTR_RX_PARSE, ts_stage - t0);
+    }
+
+    int done = 0;
+    uint64_t t1 = arrival;
+    uint64_t rec_latency = 0;
+    if (parsed == 0) {
+        // motor udp em veth/lo: super-datagrama GSO inteiro, um tag por segmento
+        const size_t stride = a->gso_rx ? rx_probe_stride(frame->data + info.payload_offset, info.payload_len) : 0;
+        size_t seg = 0;
+        do {
+            // envio: o registrado pelo TX ou, se ainda não visível, o do tag de sonda
+            uint64_t sent_at = (info.id >= 1 && info.id <= ctx->total_pkts)
+                                   ? ctx->send_timestamp[info.id - 1] : 0;
+            if (!sent_at && info.tx_ns > ctx->realtime_offset) {
+                sent_at = clock_src_from_mono_ns(clk, info.tx_ns - ctx->realtime_offset);
+            }
+            // sem relógio real: a chegada é o envio mais o atraso injetado
+            const uint64_t extra = frame->extra_delay_ns ? clock_src_from_ns(clk, frame->extra_delay_ns) : 0;
+            if (a->synthetic_ts) {
+                t1 = sent_at ? sent_at + extra : 0;
+            } else {
+                t1 = arrival + extra;
+            }
+            // marca como recebido (apenas a primeira chegada de cada ID)
+            const uint64_t min_send_ts = warmup_end(ctx);
+            const int measured = !sent_at || sent_at >= min_send_ts;
+            const int first = t1 ? rx_correlate(&a->corr, info.id, t1) : -1;
+            if (first == 1) in->rx.matched++;
+            else if (first == 0) in->rx.duplicate++;
+            else in->rx.foreign++;
+            if (first == 0 && measured) {
+                seq_stats_duplicate(a->seq);
+                flow_stats_duplicate(ctx->flow_stats, info.id);
+            }
+            if (sent_at && t1 > sent_at && t1 - sent_at > rec_latency) rec_latency = t1 - sent_at;
+            if (first == 1) {
+                flow_stats_record(ctx->flow_stats, info.id, sent_at, t1, min_send_ts);
+                if (measured) seq_stats_arrival(a->seq, info.id, sent_at, t1, ctx->late_after);
+                if (frame->kernel_ts_ns) {
+                    const uint64_t wall = wall_ns ? wall_ns : realtime_ns();
+                    const uint32_t i = atomic_fetch_add_explicit(&ctx->rx_delivery_cnt, 1,
+                                                                 memory_order_relaxed);
+                    ctx->rx_delivery[i] = wall > frame->kernel_ts_ns ? wall - frame->kernel_ts_ns : 0;
+                }
+                // verifica se todos chegaram
+                if (a->corr.received == a->expected) {
+                    done = 1;
+                }
+            }
+            seg += stride;
+        } while (stride && !done && seg + NW_PROBE_TAG_SIZE <= info.payload_len &&
+                 nw_probe_read(frame->data + info.payload_offset + seg, info.payload_len - seg,
+                               &info.id, &info.tx_ns));
+        if (timed) {
+            const uint64_t t = clock_src_now(clk);
+            instr_stage_add(in, INSTR_RX_CORRELATE, t - ts_stage);
+            ts_stage = t;
+        }
+    }
+    if (a->rec) {
+        rx_record_push(a->rec, frame->data, frame->caplen, frame->len, t1 ? t1 : arrival, rec_latency,
+                       parsed == 0 ? info.id : 0);
+        if (timed) instr_stage_add(in, INSTR_RX_RECORD, clock_src_now(clk) - ts_stage);
+    }
+    return done;
+}
+
+// analisador: esvazia a sua fila até a captura parar
+static void *thread_rx_worker(void *arg) {
+    struct rx_worker *w = arg;
+    txrx_ctx_t *ctx = w->ctx;
+    const clock_src_t *clk = &ctx->clock;
+    const int timed = w->instr.enabled;
+    const struct timespec idle = { .tv_sec = 0, .tv_nsec = RX_WORKER_IDLE_NS };
+    for (;;) {
+        const rx_queued_t *r = rx_queue_peek(&w->queue);
+        if (!r) {
+            if (!atomic_load_explicit(&ctx->rx_capture_done, memory_order_acquire)) {
+                nanosleep(&idle, NULL);
+                continue;
+            }
+            // a captura parou: o que ela enfileirou antes já está visível
+            r = rx_queue_peek(&w->queue);
+            if (!r) break;
+        }
+        const uint64_t t0 = timed ? clock_src_now(clk) : 0;
+        if (timed) instr_stage_add(&w->instr, INSTR_RX_QUEUE, t0 > r->ts ? t0 - r->ts : 0);
+        const io_frame_t frame = {
+            .data           = r->data,
+            .caplen         = r->caplen,
+            .len            = r->len,
+            .kernel_ts_ns   = r->kernel_ts_ns,
+            .extra_delay_ns = r->extra_delay_ns
+        };
+        rx_analyze(ctx, &w->an, &frame, r->ts, r->wall_ns, t0);
+        rx_queue_release(&w->queue, r);
+        atomic_store_explicit(&w->received, w->an.corr.received, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+// filas no nó do RX e threads dos analisadores (--rx-workers)
+static int rx_workers_start(txrx_ctx_t *ctx) {
+    const uint32_t n = ctx->opts.rx_workers;
+    ctx->rx_workers = calloc(n, sizeof(struct rx_worker));
+    if (!ctx->rx_workers) return -1;
+    ctx->n_rx_workers = n;
+    atomic_init(&ctx->rx_capture_done, 0);
+    for (uint32_t i = 0; i < n; i++) {
+        struct rx_worker *w = &ctx->rx_workers[i];
+        w->ctx = ctx;
+        w->instr.enabled = ctx->instr.enabled;
+        atomic_init(&w->received, 0);
+        rx_analyzer_init(ctx, &w->an, &w->seq, &w->instr, NULL, UINT32_MAX);
+        if (rx_queue_init(&w->queue, (size_t)RX_QUEUE_MB << 20, ctx->node_rx, ctx->opts.rt.hugepages) != 0) {
+            return -1;
+        }
+        if (ctx->opts.rt.lock_memory) rt_lock_region(w->queue.mem.addr, w->queue.mem.len);
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        struct rx_worker *w = &ctx->rx_workers[i];
+        if (pthread_create(&w->thread, NULL, thread_rx_worker, w) != 0) {
+            fprintf(stderr, "txrx_run: falha ao criar analisador RX %u\n", i);
+            return -1;
+        }
+        w->running = 1;
+    }
+    return 0;
+}
+
+// encerra os analisadores (a captura já parou) e junta os contadores à execução
+static void rx_workers_stop(txrx_ctx_t *ctx) {
+    if (!ctx->rx_workers) return;
+    atomic_store_explicit(&ctx->rx_capture_done, 1, memory_order_release);
+    for (uint32_t i = 0; i < ctx->n_rx_workers; i++) {
+        struct rx_worker *w = &ctx->rx_workers[i];
+        if (w->running) {
+            pthread_join(w->thread, NULL);
+            seq_stats_merge(&ctx->seq, &w->seq);
+            instr_merge(&ctx->instr, &w->instr);
+        }
+        rx_queue_free(&w->queue);
+    }
+    free(ctx->rx_workers);
+    ctx->rx_workers = NULL;
+}
+
+// IDs distintos correlacionados pelos analisadores
+static uint32_t rx_workers_received(txrx_ctx_t *ctx) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < ctx->n_rx_workers; i++) {
+        n += atomic_load_explicit(&ctx->rx_workers[i].received, memory_order_relaxed);
+    }
+    return n;
+}
+
+// entrega um quadro ao analisador do seu fluxo; com a fila cheia a captura espera e conta
+static void rx_dispatch(txrx_ctx_t *ctx, const io_frame_t *frame, uint64_t now) {
+    const uint32_t n = ctx->n_rx_workers;
+    rx_queue_t *q = &ctx->rx_workers[n > 1 ? rx_flow_hash(frame->data, frame->caplen) % n : 0].queue;
+    const uint64_t wall = frame->kernel_ts_ns ? realtime_ns() : 0;
+    if (rx_queue_push(q, frame, now, wall) == 0) return;
+
+    instr_rx_t *rx = &ctx->instr.rx;
+    const uint64_t t = clock_src_now(&ctx->clock);
+    rx->queue_full++;
+    do {
+        sched_yield();
+    } while (rx_queue_push(q, frame, now, wall) != 0);
+    rx->queue_wait += clock_src_now(&ctx->clock) - t;
+}
+
+// thread de captura; sem --rx-workers, também correlaciona
 static void *thread_rx(void *arg) {
     txrx_ctx_t *ctx = arg;
-    char errbuf[PCAP_ERRBUF_SIZE];
-    pcap_t *pc = pcap_open_live(ctx->iface_recv, BUFSIZ, 1, 100, errbuf);
-    if (!pc) {
+    char errbuf[IO_ERRBUF_SIZE];
+    rt_apply_thread(ctx->opts.rt.cpu_rx, ctx->opts.rt.fifo_prio, "RX");
+
+    // RX offline (arquivo) só é aberto depois do TX: pode ser o arquivo que o TX grava
+    const int offline = io_rx_spec_flags(ctx->iface_recv) & IO_FLAG_OFFLINE;
+    io_backend_t *io = NULL;
+    if (offline) {
+        rx_set_state(ctx, 1);
+        while (!atomic_load(&ctx->tx_done)) {
+            usleep(1000);
+        }
+    }
+    io = io_open_rx(ctx->iface_recv, &ctx->opts.impair, errbuf, sizeof(errbuf));
+    if (!io) {
         fprintf(stderr, "RX: não abriu '%s': %s\n", ctx->iface_recv, errbuf);
+        if (!offline) rx_set_state(ctx, -1);
         return NULL;
     }
+    // captura ativa: libera o início do TX
+    if (!offline) rx_set_state(ctx, 1);
 
-    uint64_t start_wait = 0;
+    const clock_src_t *clk = &ctx->clock;
+    const uint64_t timeout = clock_src_from_ns(clk, (uint64_t)ctx->timeout_ms * 1000000ULL);
+    // com analisadores, a captura só carimba, enfileira e (se pedido) grava
+    const int decoupled = ctx->rx_workers != NULL;
+    rx_analyzer_t an;
+    rx_analyzer_init(ctx, &an, &ctx->seq, &ctx->instr, ctx->recorder, ctx->expected_ids);
+    rx_record_t *rec = decoupled ? ctx->recorder : NULL;
+    instr_t *in = &ctx->instr;
+    const int timed = in->enabled;
+    uint64_t ts_recv = 0;
     int done = 0;
     while (!done) {
 
-        struct pcap_pkthdr *hdr;
-        const u_char *pkt = NULL;
-        int res = pcap_next_ex(pc, &hdr, &pkt);
-        if (res == 1 && hdr->caplen >= 14 + 20) {
-            // 1) Cabeçalho Ethernet fixo (14 bytes)
-            // 2) Cabeçalho IPv4: IHL varia
-            const uint64_t t1 = now_ns();
-            uint8_t  ihl_words = pkt[14] & 0x0F;
-            size_t   ihl       = ihl_words * 4;
-            if (hdr->caplen < 14 + ihl) continue;
-
-            // 3) Protocolo de transporte
-            uint8_t proto = pkt[14 + 9];
-            size_t  th_len = 0;
-            if (proto == IPPROTO_TCP) {
-                // TCP Data Offset em palavras de 32 bits
-                uint8_t doff_words = (pkt[14 + ihl + 12] >> 4) & 0x0F;
-                th_len = doff_words * 4;
-            } else if (proto == IPPROTO_UDP || proto == IPPROTO_ICMP) {
-                th_len = 8;
+        io_frame_t frame;
+        if (timed) ts_recv = clock_src_now(clk);
+        int res = io->recv(io, &frame);
+        // uma leitura do relógio por iteração: carimbo da chegada e teste de timeout
+        const uint64_t now = clock_src_now(clk);
+        if (res == IO_RECV_FRAME) {
+            in->rx.frames++;
+            if (timed) instr_stage_add(in, INSTR_RX_RECV, now - ts_recv);
+            if (!decoupled) {
+                done = rx_analyze(ctx, &an, &frame, now, 0, now);
             } else {
-                continue;
-            }
-
-            // 4) Offset total do payload
-            size_t offset = 14 + ihl + th_len;
-            if (hdr->caplen <= offset) continue;
-            size_t payload_len = hdr->caplen - offset;
-            const u_char *payload = pkt + offset;
-
-            // 5) Procura ID no payload
-            char *sep = memchr((void*)payload, '|', payload_len);
-            if (!sep) continue;
-            int id = atoi((char*)payload);
-            if (id < 1 || id > (int)ctx->total_pkts) continue;
-
-            // 6) Marca como recebido
-            //pthread_mutex_lock(&ctx->lock);
-            if (!ctx->recv_timestamp[id-1]){
-                ctx->recv_timestamp[id-1] = t1;
-                // verifica se todos chegaram
-                int all = 1;
-                for (uint32_t i = 0; i < ctx->total_pkts; i++) {
-                    if (!ctx->recv_timestamp[i]) { all = 0; break; }
-                }
-                if (all) {
-                    done = 1;
-                    pthread_cond_signal(&ctx->cond_all_recv);
+                rx_dispatch(ctx, &frame, now);
+                if (rec) {
+                    const uint64_t ts = timed ? clock_src_now(clk) : 0;
+                    const uint64_t extra = frame.extra_delay_ns ? clock_src_from_ns(clk, frame.extra_delay_ns) : 0;
+                    rx_record_push(rec, frame.data, frame.caplen, frame.len, now + extra, 0, 0);
+                    if (timed) instr_stage_add(in, INSTR_RX_RECORD, clock_src_now(clk) - ts);
                 }
+                done = ctx->expected_ids && rx_workers_received(ctx) == ctx->expected_ids;
             }
-            //pthread_mutex_unlock(&ctx->lock);
+        } else if (res == IO_RECV_TIMEOUT) {
+            in->rx.idle++;
+            if (decoupled) done = ctx->expected_ids && rx_workers_received(ctx) == ctx->expected_ids;
+        }
+        if (res == IO_RECV_ERROR) {
+            fprintf(stderr, "RX: falha: %s\n", io->errbuf);
+            done = 1;
+        } else if (res == IO_RECV_EOF && atomic_load(&ctx->tx_done)) {
+            // nada mais a ler
+            done = 1;
         }
 
-        // timeout global
-        if (!start_wait) start_wait = now_ns();
-        if (now_ns() - start_wait >= (uint64_t)ctx->timeout_ms * 1000000) {
+        // timeout após o último envio (o RX offline vai até o fim do arquivo)
+        if (!offline && atomic_load(&ctx->tx_done) &&
+            now - atomic_load(&ctx->tx_end) >= timeout) {
             done = 1;
-            pthread_cond_signal(&ctx->cond_all_recv);
         }
     }
+    // os analisadores terminam as filas e saem
+    atomic_store_explicit(&ctx->rx_capture_done, 1, memory_order_release);
 
-    pcap_close(pc);
+    io_kernel_stats_t ks;
+    if (io->kernel_stats && io->kernel_stats(io, &ks) == 0) {
+        in->rx.kernel_valid = 1;
+        in->rx.kernel_recv  = ks.recv;
+        in->rx.kernel_drop  = ks.drop;
+        in->rx.if_drop      = ks.if_drop;
+    }
+    io_close(io);
     return NULL;
 }
 
-int txrx_run(packet_list_t *list,
-             const char *iface_send,
-             const char *iface_recv,
-             uint32_t timeout_ms) {
-    if (!list || list->count == 0) {
+// converte os timestamps do relógio do TX/RX (ticks) para ns de CLOCK_MONOTONIC
+static void ctx_to_ns(txrx_ctx_t *ctx) {
+    const clock_src_t *clk = &ctx->clock;
+    if (clk->source == CLOCK_SOURCE_MONOTONIC) return;
+    for (uint32_t i = 0; i < ctx->total_pkts; i++) {
+        if (ctx->send_timestamp[i]) ctx->send_timestamp[i] = clock_src_mono_ns(clk, ctx->send_timestamp[i]);
+        if (ctx->recv_timestamp[i]) ctx->recv_timestamp[i] = clock_src_mono_ns(clk, ctx->recv_timestamp[i]);
+        ctx->tx_lateness[i] = clock_src_to_ns(clk, ctx->tx_lateness[i]);
+    }
+    ctx->tx_start = clock_src_mono_ns(clk, ctx->tx_start);
+    seq_stats_to_ns(&ctx->seq, clk);
+    tcp_flow_table_t *flows = ctx->list->flows;
+    if (flows && flows->synack_seen) {
+        flows->first_synack = clock_src_mono_ns(clk, flows->first_synack);
+        flows->last_synack  = clock_src_mono_ns(clk, flows->last_synack);
+    }
+}
+
+static void json_summary(FILE *fp, const char *name, const latency_summary_t *l) {
+    fprintf(fp, "\"%s\": {\"samples\": %u, \"min_ns\": %llu, \"avg_ns\": %llu, \"p50_ns\": %llu, "
+            "\"p99_ns\": %llu, \"p999_ns\": %llu, \"max_ns\": %llu}",
+            name, l->samples, (unsigned long long)l->min_ns, (unsigned long long)l->avg_ns,
+            (unsigned long long)l->p50_ns, (unsigned long long)l->p99_ns,
+            (unsigned long long)l->p999_ns, (unsigned long long)l->max_ns);
+}
+
+// geração em fluxo: tempo até o primeiro quadro e atraso das construtoras em relação ao TX
+static void print_pipeline(const txrx_ctx_t *ctx, const txrx_result_t *res, FILE *out) {
+    const pipeline_stats_t *ps = &ctx->pipe_stats;
+    fprintf(out, "Pipeline: construtoras=%u, quadros=%llu, primeiro pronto em %.2f ms, "
+            "primeiro envio em %.2f ms, geração em %.1f ms (%.0f quadros/s)\n",
+            ctx->opts.pipeline.builders ? ctx->opts.pipeline.builders : 1,
+            (unsigned long long)ps->frames, ps->first_ns / 1e6, ps->first_tx_ns / 1e6,
+            ps->build_ns / 1e6, ps->build_ns ? (double)ps->frames * 1e9 / (double)ps->build_ns : 0.0);
+    if (ps->underruns) {
+        fprintf(out, "Aviso: construtoras abaixo da taxa: o TX achou a fila vazia %llu vezes "
+                "(%.1f ms de espera; taxa obtida=%.0f pps); use mais construtoras ou a lista pronta\n",
+                (unsigned long long)ps->underruns, ps->wait_ns / 1e6, res->achieved_pps);
+    }
+    if (ps->retire_waits) {
+        fprintf(out, "Aviso: o TX esperou a thread de descarte %llu vezes\n",
+                (unsigned long long)ps->retire_waits);
+    }
+    if (ps->error) fprintf(out, "Aviso: geração interrompida por erro; os quadros seguintes não foram enviados\n");
+    if (ctx->opts.pipeline.pcap) {
+        fprintf(out, "Gravou %llu pacotes em '%s'\n", (unsigned long long)ps->written, ctx->opts.pipeline.pcap);
+    }
+}
+
+// posicionamento da memória do TX/RX: nó aplicado (-1 = nenhum) e páginas
+static void print_placement(const txrx_ctx_t *ctx, FILE *out) {
+    const numa_region_t *side[2] = { &ctx->mem_tx, &ctx->mem_rx };
+    const char *why[2] = { ctx->node_tx_why, ctx->node_rx_why };
+    fprintf(out, "Memória:");
+    for (int i = 0; i < 2; i++) {
+        fprintf(out, "%s %s ", i ? "," : "", i ? "RX" : "TX");
+        if (side[i]->node >= 0) {
+            fprintf(out, "nó %d (%s)", side[i]->node, why[i]);
+        } else {
+            fprintf(out, "sem nó");
+        }
+    }
+    fprintf(out, " | páginas: timestamps TX=%s RX=%s", numa_pages_name(ctx->mem_tx.pages),
+            numa_pages_name(ctx->mem_rx.pages));
+    if (ctx->mem_pkts.addr) fprintf(out, ", quadros=%s", numa_pages_name(ctx->mem_pkts.pages));
+    fprintf(out, "\n");
+}
+
+// resumo da execução e instrumentação em JSON (--stats-json)
+static int save_stats_json(const txrx_ctx_t *ctx, const txrx_result_t *res, const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+    fprintf(fp, "{\"engine\": %d, \"sent\": %u, \"received\": %u, \"lost\": %u, \"loss_pct\": %.4f, "
+            "\"warmup_pkts\": %u, \"offered_pps\": %.1f, \"achieved_pps\": %.1f, ",
+            ctx->opts.engine, res->sent, res->received, res->lost, res->loss_pct,
+            res->warmup_pkts, res->offered_pps, res->achieved_pps);
+    json_summary(fp, "latency", &res->latency);
+    fprintf(fp, ", ");
+    json_summary(fp, "tx_lateness", &res->tx_jitter);
+    fprintf(fp, ", ");
+    json_summary(fp, "rx_delivery", &res->rx_delivery);
+    const seq_stats_t *q = &res->seq;
+    fprintf(fp, ", \"sequence\": {\"reordered\": %u, \"duplicates\": %u, \"late\": %u, "
+            "\"jitter_ns\": %.1f, \"loss_bursts\": %u, \"burst_max\": %u}",
+            q->reordered, q->duplicates, q->late, q->jitter16 / 16.0, q->loss_bursts, q->burst_max);
+    if (ctx->opts.record.path) {
+        const rx_record_stats_t *rs = &ctx->record_stats;
+        fprintf(fp, ", \"record\": {\"frames\": %llu, \"written\": %llu, \"dropped\": %llu, "
+                "\"files\": %u, \"triggers\": %u}",
+                (unsigned long long)rs->frames, (unsigned long long)rs->written,
+                (unsigned long long)rs->dropped, rs->files, rs->triggers);
+    }
+    if (ctx->opts.pipeline.set) {
+        const pipeline_stats_t *ps = &ctx->pipe_stats;
+        fprintf(fp, ", \"pipeline\": {\"builders\": %u, \"frames\": %llu, \"first_ready_ns\": %llu, "
+                "\"first_tx_ns\": %llu, \"build_ns\": %llu, \"underruns\": %llu, \"wait_ns\": %llu, "
+                "\"retire_waits\": %llu, \"pcap_written\": %llu, \"error\": %d}",
+                ctx->opts.pipeline.builders ? ctx->opts.pipeline.builders : 1,
+                (unsigned long long)ps->frames, (unsigned long long)ps->first_ns,
+                (unsigned long long)ps->first_tx_ns, (unsigned long long)ps->build_ns,
+                (unsigned long long)ps->underruns, (unsigned long long)ps->wait_ns,
+                (unsigned long long)ps->retire_waits, (unsigned long long)ps->written, ps->error);
+    }
+    fprintf(fp, ", \"rx_workers\": %u", ctx->n_rx_workers);
+    fprintf(fp, ", \"memory\": {\"tx_node\": %d, \"rx_node\": %d, \"tx_pages\": \"%s\", "
+            "\"rx_pages\": \"%s\", \"packet_pages\": \"%s\"}",
+            ctx->mem_tx.node, ctx->mem_rx.node, numa_pages_name(ctx->mem_tx.pages),
+            numa_pages_name(ctx->mem_rx.pages),
+            ctx->mem_pkts.addr ? numa_pages_name(ctx->mem_pkts.pages) : "lista");
+    fprintf(fp, ", \"instrumentation\": ");
+    instr_write_json(&ctx->instr, &ctx->clock, fp);
+    fprintf(fp, "}\n");
+    if (fclose(fp) != 0) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+// estatísticas, resumo e CSV de uma execução concluída; libera o contexto
+static int txrx_report(txrx_ctx_t *ctx, const txrx_opts_t *opts,
+                       struct tm *timeinfo, txrx_result_t *result) {
+    // o RX parou: a thread de gravação esvazia a fila e fecha os arquivos
+    if (ctx->recorder && rx_record_stop(ctx->recorder, &ctx->record_stats) != 0) {
+        fprintf(stderr, "Falha ao gravar os quadros recebidos\n");
+    }
+    ctx->recorder = NULL;
+    // o TX parou: construtoras e descarte terminam, o pcap é fechado
+    if (ctx->pipe) {
+        pipeline_stop(ctx->pipe, &ctx->pipe_stats);
+        ctx->pipe = NULL;
+        ctx->list->lap_ns = ctx->pipe_stats.lap_ns;
+    }
+    ctx_to_ns(ctx);
+
+    // calcula estatísticas, ignorando a janela de warm-up (o mesmo corte de
+    // warmup_end(), já em ns após ctx_to_ns; 0 = sem warm-up)
+    const uint64_t warmup_end_ns = opts->warmup_ms
+        ? ctx->tx_start + (uint64_t)opts->warmup_ms * 1000000ULL : 0;
+    uint32_t sent_cnt = 0, recv_cnt = 0, warmup_cnt = 0;
+    uint64_t first_tx = UINT64_MAX, last_tx = 0;
+    for (uint32_t i = 0; i < ctx->total_pkts; i++) {
+        if (!ctx->send_timestamp[i]) continue;
+        if (ctx->send_timestamp[i] < first_tx) first_tx = ctx->send_timestamp[i];
+        if (ctx->send_timestamp[i] > last_tx) last_tx = ctx->send_timestamp[i];
+        if (opts->warmup_ms && ctx->send_timestamp[i] < warmup_end_ns) {
+            warmup_cnt++;
+            continue;
+        }
+        sent_cnt++;
+        if (ctx->recv_timestamp[i]) recv_cnt++;
+    }
+    uint32_t loss = sent_cnt - recv_cnt;
+    double loss_rate = sent_cnt ? (double)loss / sent_cnt * 100.0 : 0.0;
+
+    txrx_result_t res;
+    memset(&res, 0, sizeof(res));
+    res.sent        = sent_cnt;
+    res.received    = recv_cnt;
+    res.lost        = loss;
+    res.loss_pct    = loss_rate;
+    res.warmup_pkts = warmup_cnt;
+    res.offered_pps = opts->rate_pps == TXRX_RATE_UNLIMITED ? 0.0 : (double)opts->rate_pps;
+    if (ctx->list->lap_ns) {
+        // lista escalonada: a oferta é a soma das taxas dos fluxos
+        const double frames = opts->pipeline.set ? (double)ctx->pipe_stats.frames : (double)ctx->list->count;
+        res.offered_pps = frames * 1e9 / (double)ctx->list->lap_ns;
+    }
+    if (last_tx > first_tx) {
+        res.achieved_pps = (double)(sent_cnt + warmup_cnt - 1) * 1e9 / (double)(last_tx - first_tx);
+    }
+    compute_latency_summary(ctx->send_timestamp, ctx->recv_timestamp, ctx->total_pkts,
+                            warmup_end_ns, &res.latency);
+    compute_sample_summary(ctx->tx_lateness, sent_cnt + warmup_cnt, &res.tx_jitter);
+    compute_sample_summary(ctx->rx_delivery, atomic_load(&ctx->rx_delivery_cnt), &res.rx_delivery);
+    // rajadas de perda na ordem de envio
+    for (uint32_t i = 0; i < ctx->total_pkts; i++) {
+        if (!ctx->send_timestamp[i] || (opts->warmup_ms && ctx->send_timestamp[i] < warmup_end_ns)) continue;
+        seq_stats_sent(&ctx->seq, ctx->recv_timestamp[i] != 0);
+    }
+    seq_stats_sent_end(&ctx->seq);
+    res.seq = ctx->seq;
+
+    const tcp_flow_table_t *flows = ctx->list->flows;
+
+    if (!opts->quiet) {
+        printf("TX/RX concluído: enviados=%u, recebidos=%u, perdidos=%u, perda=%.2f%%\n",
+               res.sent, res.received, res.lost, res.loss_pct);
+        if (res.latency.samples) {
+            printf("Latência (us): min=%.1f média=%.1f p50=%.1f p99=%.1f max=%.1f\n",
+                   res.latency.min_ns / 1e3, res.latency.avg_ns / 1e3,
+                   res.latency.p50_ns / 1e3, res.latency.p99_ns / 1e3,
+                   res.latency.max_ns / 1e3);
+        }
+        if (opts->rate_pps == TXRX_RATE_UNLIMITED && !ctx->list->lap_ns) {
+            printf("Taxa: obtida=%.0f pps (sem limite)\n", res.achieved_pps);
+        } else if (opts->rate_pps || ctx->list->lap_ns) {
+            printf("Taxa: ofertada=%.0f pps, obtida=%.0f pps\n",
+                   res.offered_pps, res.achieved_pps);
+        }
+        printf("Jitter do host (us): TX atraso p50=%.1f p99=%.1f p99.9=%.1f max=%.1f | "
+               "RX entrega p50=%.1f p99=%.1f p99.9=%.1f max=%.1f\n",
+               res.tx_jitter.p50_ns / 1e3, res.tx_jitter.p99_ns / 1e3,
+               res.tx_jitter.p999_ns / 1e3, res.tx_jitter.max_ns / 1e3,
+               res.rx_delivery.p50_ns / 1e3, res.rx_delivery.p99_ns / 1e3,
+               res.rx_delivery.p999_ns / 1e3, res.rx_delivery.max_ns / 1e3);
+        seq_stats_print(&res.seq, stdout);
+        if (flows && flows->count) {
+            const uint64_t span = flows->last_synack > ctx->tx_start
+                                      ? flows->last_synack - ctx->tx_start : 0;
+            printf("Sessões TCP: fluxos=%u, SYN-ACK=%u (%.2f%%), RST=%u, conexões/s=%.0f\n",
+                   flows->count, flows->synack_seen,
+                   (double)flows->synack_seen / flows->count * 100.0, flows->rst_seen,
+                   span ? (double)flows->synack_seen * 1e9 / (double)span : 0.0);
+        }
+        if (opts->record.path) {
+            const rx_record_stats_t *rs = &ctx->record_stats;
+            printf("Gravação RX: quadros=%llu, gravados=%llu, descartados (fila cheia)=%llu, "
+                   "arquivos=%u, gatilhos=%u\n",
+                   (unsigned long long)rs->frames, (unsigned long long)rs->written,
+                   (unsigned long long)rs->dropped, rs->files, rs->triggers);
+        }
+        if (ctx->n_rx_workers && ctx->instr.rx.queue_full) {
+            printf("Aviso: analisadores RX abaixo da chegada: fila cheia %llu vezes, captura parada "
+                   "%.1f ms (atrasa o carimbo dos quadros seguintes); use mais --rx-workers\n",
+                   (unsigned long long)ctx->instr.rx.queue_full,
+                   clock_src_to_ns(&ctx->clock, ctx->instr.rx.queue_wait) / 1e6);
+        }
+        if (opts->pipeline.set) print_pipeline(ctx, &res, stdout);
+        if (ctx->mem_tx.node >= 0 || ctx->mem_rx.node >= 0 || opts->rt.hugepages) {
+            print_placement(ctx, stdout);
+        }
+        if (opts->instrument) instr_print(&ctx->instr, &ctx->clock, stdout);
+    }
+    if (opts->stats_json && save_stats_json(ctx, &res, opts->stats_json) != 0) {
+        fprintf(stderr, "Falha ao gravar '%s'\n", opts->stats_json);
+    }
+
+    if (ctx->flow_stats) {
+        flow_stats_finish(ctx->flow_stats, ctx->send_timestamp, ctx->recv_timestamp, ctx->total_pkts,
+                          warmup_end_ns);
+        if (!opts->quiet) flow_stats_print_top(ctx->flow_stats, opts->flow_top, stdout);
+        if (opts->flow_csv && flow_stats_save_csv(ctx->flow_stats, opts->flow_csv) != 0) {
+            fprintf(stderr, "Falha ao exportar estatísticas por fluxo\n");
+        }
+        if (opts->keep_flows && result) {
+            flow_stats_to_ns(ctx->flow_stats);
+            res.flows = ctx->flow_stats;
+            ctx->flow_stats = NULL;
+        }
+    }
+
+    if (opts->save_csv &&
+        save_metrics_to_csv(ctx->send_timestamp, ctx->recv_timestamp, ctx->total_pkts, timeinfo) != 0) {
+        fprintf(stderr, "Falha ao salvar métricas de latência\n");
+    }
+    if (opts->save_csv && save_sequence_to_csv(&res.seq, timeinfo) != 0) {
+        fprintf(stderr, "Falha ao salvar a análise de sequência\n");
+    }
+
+    if (result) *result = res;
+
+    // cleanup
+    free_ctx_arrays(ctx);
+
+    return 0;
+}
+
+// motor io_uring: TX e RX na mesma thread
+static void *thread_uring(void *arg) {
+    txrx_ctx_t *ctx = arg;
+    if (txrx_uring_run(ctx) != 0) {
+        rx_set_state(ctx, -1);
+    }
+    return NULL;
+}
+
+int txrx_run_ex(packet_list_t *list,
+                const char *iface_send,
+                const char *iface_recv,
+                const txrx_opts_t *opts,
+                txrx_result_t *result) {
+    const int streamed = opts && opts->pipeline.set;
+    if (!list || (list->count == 0 && !streamed)) {
         fprintf(stderr, "txrx_run: lista vazia\n");
         return -1;
     }
+    if (!opts) {
+        fprintf(stderr, "txrx_run: opções ausentes\n");
+        return -1;
+    }
+    if (opts->loop_count && (!opts->stamp || list->flows || opts->engine == TXRX_ENGINE_URING)) {
+        fprintf(stderr, "txrx_run: loop exige --stamp e não se aplica a sessões TCP nem ao motor io_uring\n");
+        return -1;
+    }
+    if (streamed && (opts->engine != TXRX_ENGINE_THREADS || opts->loop_count || list->count)) {
+        fprintf(stderr, "txrx_run: geração em fluxo exige o motor de threads, sem loop e com a lista vazia\n");
+        return -1;
+    }
+    // gatilhos da gravação dependem da latência, que só os analisadores conhecem
+    if (opts->rx_workers && (opts->rx_workers > TXRX_RX_WORKERS_MAX || opts->engine == TXRX_ENGINE_URING ||
+                             opts->record.trigger_us || opts->record.trigger_gap ||
+                             (opts->rx_workers > 1 && list->flows))) {
+        fprintf(stderr, "txrx_run: analisadores RX (1 a %d) não se aplicam ao motor io_uring nem aos "
+                "gatilhos da gravação; sessões TCP aceitam um só\n", TXRX_RX_WORKERS_MAX);
+        return -1;
+    }
 
     txrx_ctx_t ctx;
     memset(&ctx, 0, sizeof(ctx));
     ctx.list        = list;
     ctx.iface_send  = iface_send;
     ctx.iface_recv  = iface_recv;
-    ctx.timeout_ms  = timeout_ms;
-    ctx.total_pkts  = list->count;
-    ctx.send_timestamp = calloc(ctx.total_pkts, sizeof(uint64_t));
-    ctx.recv_timestamp    = calloc(ctx.total_pkts, sizeof(uint64_t));
+    ctx.timeout_ms  = opts->timeout_ms;
+    ctx.opts        = *opts;
+    if (streamed) {
+        // um ID por datagrama, na ordem de envio; o TX vai até o fim da geração
+        uint32_t n_ids = 0;
+        ctx.pipe = pipeline_create(&opts->pipeline, &n_ids);
+        if (!ctx.pipe) return -1;
+        if (!n_ids) {
+            fprintf(stderr, "txrx_run: templates sem pacotes\n");
+            pipeline_stop(ctx.pipe, NULL);
+            return -1;
+        }
+        ctx.total_pkts = ctx.expected_ids = ctx.ids_per_lap = n_ids;
+        ctx.total_sends = UINT32_MAX;
+        // só marca a lista como escalonada; a duração vem das construtoras no relatório
+        list->lap_ns = template_set_scheduled(opts->pipeline.set) ? 1 : 0;
+    } else {
+        ctx.total_pkts  = list->count;
+        ctx.total_sends = list->count;
+        uint32_t with_id = 0;
+        for (packet_t *p = list->head; p; p = p->next) {
+            if (p->id) with_id++;
+            if (p->id > ctx.ids_per_lap) ctx.ids_per_lap = p->id;
+        }
+        // listas sem nenhum ID (pcap externo) são medidas pela posição
+        ctx.by_position  = !with_id && !list->flows;
+        ctx.expected_ids = ctx.by_position ? (uint32_t)list->count : with_id;
+        if (!ctx.ids_per_lap) ctx.ids_per_lap = list->count;
+        // RFC 2544 e afins repetem a lista: cada execução recomeça o handshake
+        tcp_flow_table_reset(list->flows);
+        if (opts->loop_count) {
+            // seq <= número de envios: cada volta tem ao menos ids_per_lap quadros
+            ctx.total_sends = ctx.total_pkts = opts->loop_count;
+            ctx.expected_ids = opts->loop_count / (uint32_t)list->count * with_id;
+            uint32_t rest = opts->loop_count % (uint32_t)list->count;
+            for (packet_t *p = list->head; p && rest; p = p->next, rest--) {
+                if (p->id) ctx.expected_ids++;
+            }
+        }
+    }
+    clock_src_init(&ctx.clock, opts->clock);
+    ctx.late_after = clock_src_from_ns(&ctx.clock,
+                                       (uint64_t)(opts->late_ms ? opts->late_ms : opts->timeout_ms) * 1000000ULL);
+    ctx.realtime_offset = realtime_ns() - clock_src_mono_ns(&ctx.clock, clock_src_now(&ctx.clock));
+    pthread_mutex_init(&ctx.lock, NULL);
+    pthread_cond_init(&ctx.cond_rx_ready, NULL);
+    // arrays de cada lado no nó de quem os escreve
+    ctx.node_tx = numa_pick_node(opts->rt.numa_node, opts->rt.cpu_tx, iface_send, &ctx.node_tx_why);
+    ctx.node_rx = numa_pick_node(opts->rt.numa_node,
+                                 opts->engine == TXRX_ENGINE_URING ? opts->rt.cpu_tx : opts->rt.cpu_rx,
+                                 iface_recv, &ctx.node_rx_why);
+    const size_t ts_bytes = (size_t)ctx.total_pkts * sizeof(uint64_t);
+    if (numa_region_alloc(&ctx.mem_tx, 2 * ts_bytes, ctx.node_tx, opts->rt.hugepages) != 0 ||
+        numa_region_alloc(&ctx.mem_rx, 2 * ts_bytes, ctx.node_rx, opts->rt.hugepages) != 0) {
+        fprintf(stderr, "txrx_run: falha ao alocar timestamps\n");
+        free_ctx_arrays(&ctx);
+        return -1;
+    }
+    ctx.send_timestamp = ctx.mem_tx.addr;
+    ctx.tx_lateness    = ctx.send_timestamp + ctx.total_pkts;
+    ctx.recv_timestamp = ctx.mem_rx.addr;
+    ctx.rx_delivery    = ctx.recv_timestamp + ctx.total_pkts;
+    // io_uring copia os quadros para a sua própria área de envio
+    if ((ctx.node_tx >= 0 || opts->rt.hugepages) && opts->engine != TXRX_ENGINE_URING && !streamed &&
+        place_packets(&ctx) != 0) {
+        fprintf(stderr, "txrx_run: falha ao alocar os quadros\n");
+        free_ctx_arrays(&ctx);
+        return -1;
+    }
+    if ((opts->flow_top && !opts->quiet) || opts->flow_csv || opts->keep_flows) {
+        ctx.flow_stats = flow_stats_create(streamed ? pipeline_samples(ctx.pipe) : list, ctx.ids_per_lap);
+        if (!ctx.flow_stats) {
+            fprintf(stderr, "txrx_run: falha ao alocar estatísticas por fluxo\n");
+            free_ctx_arrays(&ctx);
+            return -1;
+        }
+        ctx.flow_stats->clock      = &ctx.clock;
+        ctx.flow_stats->late_after = ctx.late_after;
+    }
+    ctx.instr.enabled = opts->instrument || opts->stats_json;
+    if (opts->record.path) {
+        ctx.recorder = rx_record_start(&opts->record, &ctx.clock, ctx.realtime_offset);
+        if (!ctx.recorder) {
+            free_ctx_arrays(&ctx);
+            return -1;
+        }
+    }
+    atomic_init(&ctx.tx_done, 0);
+    atomic_init(&ctx.tx_end, 0);
+
+    // pacotes e timestamps residentes antes do início da medição
+    if (opts->rt.lock_memory) {
+        rt_lock_packets(list);
+        rt_lock_region(ctx.mem_tx.addr, ctx.mem_tx.len);
+        rt_lock_region(ctx.mem_rx.addr, ctx.mem_rx.len);
+    }
     time_t now;
     struct tm *timeinfo;
 
     time(&now);
     timeinfo = localtime(&now);
 
-    //pthread_mutex_init(&ctx.lock, NULL);
-    pthread_cond_init(&ctx.cond_all_recv, NULL);
+    // motor io_uring: uma única thread arma o RX antes de enviar
+    if (opts->engine == TXRX_ENGINE_URING) {
+        pthread_t th;
+        if (pthread_create(&th, NULL, thread_uring, &ctx) != 0) {
+            fprintf(stderr, "txrx_run: falha ao criar thread io_uring\n");
+            free_ctx_arrays(&ctx);
+            return -1;
+        }
+        pthread_join(th, NULL);
+        if (ctx.rx_state < 0) {
+            free_ctx_arrays(&ctx);
+            return -1;
+        }
+        return txrx_report(&ctx, opts, timeinfo, result);
+    }
+
+    // construtoras começam já: o TX só espera a captura ficar ativa
+    if (ctx.pipe && pipeline_start(ctx.pipe, ctx.flow_stats) != 0) {
+        free_ctx_arrays(&ctx);
+        return -1;
+    }
+
+    // analisadores prontos antes da primeira captura
+    if (opts->rx_workers && rx_workers_start(&ctx) != 0) {
+        free_ctx_arrays(&ctx);
+        return -1;
+    }
 
     // inicia threads RX e TX
     pthread_t th_rx, th_tx;
-    pthread_create(&th_rx, NULL, thread_rx, &ctx);
-    usleep(100000);  // garante RX ativo antes de TX começar
-    pthread_create(&th_tx, NULL, thread_tx, &ctx);
-
-    // aguarda sinal de conclusão (todos ou timeout)
-    //pthread_mutex_lock(&ctx.lock);
-    pthread_cond_wait(&ctx.cond_all_recv, &ctx.lock);
-    //pthread_mutex_unlock(&ctx.lock);
-
-    // finaliza threads
-    pthread_join(th_tx, NULL);
-    pthread_join(th_rx, NULL);
+    if (pthread_create(&th_rx, NULL, thread_rx, &ctx) != 0) {
+        fprintf(stderr, "txrx_run: falha ao criar thread RX\n");
+        free_ctx_arrays(&ctx);
+        return -1;
+    }
 
-    // calcula estatísticas
-    uint32_t recv_cnt = 0;
-    for (uint32_t i = 0; i < ctx.total_pkts; i++) {
-        if (ctx.recv_timestamp[i]) recv_cnt++;
+    // TX só começa quando a captura estiver ativa
+    pthread_mutex_lock(&ctx.lock);
+    while (ctx.rx_state == 0) {
+        pthread_cond_wait(&ctx.cond_rx_ready, &ctx.lock);
+    }
+    int rx_state = ctx.rx_state;
+    pthread_mutex_unlock(&ctx.lock);
+    if (rx_state < 0) {
+        pthread_join(th_rx, NULL);
+        free_ctx_arrays(&ctx);
+        return -1;
     }
-    uint32_t loss = ctx.total_pkts - recv_cnt;
-    double loss_rate = (double)loss / ctx.total_pkts * 100.0;
-    printf("TX/RX concluído: enviados=%u, recebidos=%u, perdidos=%u, perda=%.2f%%\n",
-           ctx.total_pkts, recv_cnt, loss, loss_rate);
 
-    if (save_metrics_to_csv(ctx.send_timestamp, ctx.recv_timestamp, ctx.total_pkts, timeinfo) != 0) {
-        fprintf(stderr, "Falha ao salvar métricas de latência\n");
+    if (pthread_create(&th_tx, NULL, opts->engine == TXRX_ENGINE_UDP ? thread_tx_udp : thread_tx,
+                       &ctx) != 0) {
+        fprintf(stderr, "txrx_run: falha ao criar thread TX\n");
+        tx_finish(&ctx);
+        pthread_join(th_rx, NULL);
+        free_ctx_arrays(&ctx);
+        return -1;
     }
 
-    // cleanup
-    free(ctx.send_timestamp);
-    free(ctx.recv_timestamp);
-    //pthread_mutex_destroy(&ctx.lock);
-    pthread_cond_destroy(&ctx.cond_all_recv);
+    // aguarda conclusão (todos recebidos ou timeout após o último envio)
+    pthread_join(th_tx, NULL);
+    pthread_join(th_rx, NULL);
+    rx_workers_stop(&ctx);
 
-    return 0;
+    return txrx_report(&ctx, opts, timeinfo, result);
+}
+
+int txrx_run(packet_list_t *list,
+             const char *iface_send,
+             const char *iface_recv,
+             uint32_t timeout_ms) {
+    txrx_opts_t opts;
+    memset(&opts, 0, sizeof(opts));
+    rt_opts_init(&opts.rt);
+    opts.timeout_ms = timeout_ms;
+    opts.save_csv   = 1;
+    return txrx_run_ex(list, iface_send, iface_recv, &opts, NULL);
 }
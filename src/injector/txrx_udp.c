@@ -0,0 +1,393 @@
+// txrx_udp.c
+#define _GNU_SOURCE
+#include "../../include/injector/txrx_udp.h"
+#include "../../include/netwagon.h"
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT      103
+#endif
+#ifndef IPV6_FREEBIND
+#define IPV6_FREEBIND    78
+#endif
+
+#define UDP_BATCH        64             // mensagens por sendmmsg
+#define UDP_GSO_SEGS     64             // datagramas por mensagem GSO (UDP_MAX_SEGMENTS)
+#define UDP_GSO_BYTES    65000          // payload máximo de uma mensagem GSO
+#define UDP_SNDBUF       (4 << 20)
+#define UDP_HEADER_SIZE  8
+
+/* Um fluxo UDP da lista e seu socket conectado */
+typedef struct {
+    int      family;
+    uint8_t  src[16];
+    uint8_t  dst[16];
+    uint16_t sport;
+    uint16_t dport;
+    int      fd;
+    uint32_t gso_max;   // maior datagrama aceito em GSO (MTU do caminho - cabeçalhos; 0 = sem GSO)
+} udp_flow_t;
+
+/* Payload UDP de um quadro da lista */
+typedef struct {
+    uint32_t flow;      // índice em flows
+    uint32_t off;       // offset do payload no quadro
+    uint32_t len;
+} udp_item_t;
+
+/* 5-tupla e payload de um quadro Ethernet/IP/UDP; -1 se não for UDP inteiro */
+static int parse_udp(const uint8_t *frame, size_t len, udp_flow_t *key, udp_item_t *item) {
+    // túneis e tags não passam por um socket UDP
+    nw_stack_t st;
+    if (len < NW_ETH_HEADER_SIZE + 20 || nw_stack_parse(frame, len, &st) != 0 ||
+        st.l3_offset != NW_ETH_HEADER_SIZE) return -1;
+    const uint8_t *ip = frame + NW_ETH_HEADER_SIZE;
+    size_t l4;
+    memset(key, 0, sizeof(*key));
+    switch (frame[12] << 8 | frame[13]) {
+        case 0x0800:
+            if ((ip[6] << 8 | ip[7]) & 0x3FFF || ip[9] != IPPROTO_UDP) return -1;  // fragmento
+            key->family = AF_INET;
+            memcpy(key->src, ip + 12, 4);
+            memcpy(key->dst, ip + 16, 4);
+            l4 = NW_ETH_HEADER_SIZE + (size_t)(ip[0] & 0x0F) * 4;
+            break;
+        case 0x86DD:
+            if (ip[6] != IPPROTO_UDP) return -1;
+            key->family = AF_INET6;
+            memcpy(key->src, ip + 8, 16);
+            memcpy(key->dst, ip + 24, 16);
+            l4 = NW_ETH_HEADER_SIZE + 40;
+            break;
+        default:
+            return -1;
+    }
+    if (l4 + UDP_HEADER_SIZE > len) return -1;
+    const size_t ulen = (size_t)(frame[l4 + 4] << 8 | frame[l4 + 5]);
+    if (ulen < UDP_HEADER_SIZE || l4 + ulen > len) return -1;
+    key->sport = (uint16_t)(frame[l4] << 8 | frame[l4 + 1]);
+    key->dport = (uint16_t)(frame[l4 + 2] << 8 | frame[l4 + 3]);
+    item->off = (uint32_t)(l4 + UDP_HEADER_SIZE);
+    item->len = (uint32_t)(ulen - UDP_HEADER_SIZE);
+    return 0;
+}
+
+static int same_flow(const udp_flow_t *a, const udp_flow_t *b) {
+    return a->family == b->family && a->sport == b->sport && a->dport == b->dport &&
+           memcmp(a->src, b->src, 16) == 0 && memcmp(a->dst, b->dst, 16) == 0;
+}
+
+/* FNV-1a da 5-tupla seguido da mistura final do splitmix64 */
+static uint64_t flow_hash(const udp_flow_t *f) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    const uint8_t meta[5] = { (uint8_t)f->family, (uint8_t)(f->sport >> 8), (uint8_t)f->sport,
+                              (uint8_t)(f->dport >> 8), (uint8_t)f->dport };
+    for (size_t i = 0; i < sizeof(meta); i++) h = (h ^ meta[i]) * 0x100000001B3ULL;
+    for (size_t i = 0; i < 16; i++) h = (h ^ f->src[i]) * 0x100000001B3ULL;
+    for (size_t i = 0; i < 16; i++) h = (h ^ f->dst[i]) * 0x100000001B3ULL;
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
+}
+
+static void sockaddr_of(const udp_flow_t *f, int dst, struct sockaddr_storage *ss, socklen_t *sl) {
+    memset(ss, 0, sizeof(*ss));
+    if (f->family == AF_INET) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)ss;
+        sin->sin_family = AF_INET;
+        sin->sin_port   = htons(dst ? f->dport : f->sport);
+        memcpy(&sin->sin_addr, dst ? f->dst : f->src, 4);
+        *sl = sizeof(*sin);
+    } else {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)ss;
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port   = htons(dst ? f->dport : f->sport);
+        memcpy(&sin6->sin6_addr, dst ? f->dst : f->src, 16);
+        *sl = sizeof(*sin6);
+    }
+}
+
+/* socket conectado do fluxo: origem do quadro (mesmo não local), destino e MTU do caminho */
+static int flow_open(udp_flow_t *f, const char *dev) {
+    f->fd = socket(f->family, SOCK_DGRAM | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (f->fd < 0) {
+        perror("udp: socket");
+        return -1;
+    }
+    int one = 1, sndbuf = UDP_SNDBUF;
+    setsockopt(f->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(f->fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    setsockopt(f->fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    if (f->family == AF_INET) {
+        setsockopt(f->fd, IPPROTO_IP, IP_FREEBIND, &one, sizeof(one));
+    } else {
+        setsockopt(f->fd, IPPROTO_IPV6, IPV6_FREEBIND, &one, sizeof(one));
+    }
+    if (dev && setsockopt(f->fd, SOL_SOCKET, SO_BINDTODEVICE, dev, (socklen_t)strlen(dev)) != 0) {
+        fprintf(stderr, "udp: SO_BINDTODEVICE '%s': %s (seguindo pela rota)\n", dev, strerror(errno));
+    }
+
+    struct sockaddr_storage ss;
+    socklen_t sl;
+    sockaddr_of(f, 0, &ss, &sl);
+    if (bind(f->fd, (struct sockaddr *)&ss, sl) != 0) {
+        perror("udp: bind");
+        return -1;
+    }
+    sockaddr_of(f, 1, &ss, &sl);
+    if (connect(f->fd, (struct sockaddr *)&ss, sl) != 0) {
+        perror("udp: connect");
+        return -1;
+    }
+
+    int mtu = 0;
+    socklen_t ml = sizeof(mtu);
+    const int ok = f->family == AF_INET
+        ? getsockopt(f->fd, IPPROTO_IP, IP_MTU, &mtu, &ml)
+        : getsockopt(f->fd, IPPROTO_IPV6, IPV6_MTU, &mtu, &ml);
+    const int hdr = (f->family == AF_INET ? 20 : 40) + UDP_HEADER_SIZE;
+    f->gso_max = ok == 0 && mtu > hdr ? (uint32_t)(mtu - hdr) : 0;
+    return 0;
+}
+
+static int gso_warned;
+
+/*
+ * Envia as mensagens já montadas; mensagem GSO recusada vai datagrama a
+ * datagrama. Em erro, os cnt->sent datagramas a mais desde a chamada são os
+ * primeiros do lote, na ordem.
+ */
+static int send_batch(udp_flow_t *f, struct mmsghdr *msgs, unsigned n, instr_tx_t *cnt) {
+    unsigned done = 0;
+    while (done < n) {
+        int r = sendmmsg(f->fd, msgs + done, n - done, 0);
+        cnt->attempts++;
+        if (r > 0) {
+            for (int i = 0; i < r; i++) cnt->sent += msgs[done + (unsigned)i].msg_hdr.msg_iovlen;
+            done += (unsigned)r;
+            continue;
+        }
+        // ECONNREFUSED: ICMP de porta inalcançável de um envio anterior
+        if (errno == EINTR || errno == ECONNREFUSED) continue;
+        if (errno == ENOBUFS || errno == EAGAIN) {
+            if (errno == EAGAIN) cnt->eagain++;
+            else cnt->enobufs++;
+            sched_yield();
+            continue;
+        }
+        struct msghdr *m = &msgs[done].msg_hdr;
+        if ((errno == EINVAL || errno == EIO) && m->msg_controllen) {
+            if (!gso_warned++) fprintf(stderr, "udp: GSO recusado (%s); enviando sem UDP_SEGMENT\n", strerror(errno));
+            f->gso_max = 0;
+            for (size_t i = 0; i < m->msg_iovlen; i++) {
+                cnt->attempts++;
+                while (send(f->fd, m->msg_iov[i].iov_base, m->msg_iov[i].iov_len, 0) < 0) {
+                    if (errno == ENOBUFS) cnt->enobufs++;
+                    if (errno != EINTR && errno != ECONNREFUSED && errno != ENOBUFS) {
+                        return -1;
+                    }
+                }
+                cnt->sent++;
+            }
+            done++;
+            continue;
+        }
+        return -1;
+    }
+    return 0;
+}
+
+int txrx_udp_send(txrx_ctx_t *ctx) {
+    const uint32_t n = (uint32_t)ctx->list->count;
+    if (ctx->list->flows) {
+        fprintf(stderr, "udp: sessões TCP não são suportadas pelo motor udp\n");
+        return -1;
+    }
+    udp_item_t *items   = calloc(n, sizeof(udp_item_t));
+    udp_flow_t *flows   = NULL;
+    struct mmsghdr *msgs = calloc(UDP_BATCH, sizeof(struct mmsghdr));
+    struct iovec *iov   = calloc((size_t)UDP_BATCH * UDP_GSO_SEGS, sizeof(struct iovec));
+    char (*cmsg)[CMSG_SPACE(sizeof(uint16_t))] = calloc(UDP_BATCH, sizeof(*cmsg));
+    uint32_t *slots     = calloc((size_t)UDP_BATCH * UDP_GSO_SEGS, sizeof(uint32_t));  // slot de cada iov
+    uint32_t n_flows = 0, cap_flows = 0;
+    // 5-tupla -> índice em flows + 1 (endereçamento aberto, ocupação <= 50%)
+    uint32_t mask = 15;
+    while (mask < 2 * (uint64_t)n) mask = mask * 2 + 1;
+    uint32_t *lookup = calloc((size_t)mask + 1, sizeof(uint32_t));
+    int rc = -1;
+    if (!items || !msgs || !iov || !cmsg || !slots || !lookup) {
+        fprintf(stderr, "udp: falha ao alocar memória\n");
+        goto out;
+    }
+
+    // um fluxo por 5-tupla distinta (quadros do mesmo template costumam ser vizinhos)
+    const char *dev = io_live_device(ctx->iface_send);
+    uint32_t idx = 0, last = 0;
+    for (packet_t *pkt = ctx->list->head; pkt; pkt = pkt->next, idx++) {
+        udp_flow_t key;
+        if (parse_udp(pkt->data, pkt->length, &key, &items[idx]) != 0) {
+            fprintf(stderr, "udp: quadro %u não é um datagrama UDP inteiro (motor udp só envia UDP sem fragmentos nem encapsulamento)\n",
+                    idx);
+            goto out;
+        }
+        if (n_flows && same_flow(&flows[last], &key)) {
+            items[idx].flow = last;
+            continue;
+        }
+        uint32_t h = (uint32_t)flow_hash(&key) & mask;
+        while (lookup[h] && !same_flow(&flows[lookup[h] - 1], &key)) h = (h + 1) & mask;
+        uint32_t f = lookup[h] ? lookup[h] - 1 : n_flows;
+        if (f == n_flows) {
+            if (n_flows == cap_flows) {
+                cap_flows = cap_flows ? cap_flows * 2 : 16;
+                udp_flow_t *grown = realloc(flows, cap_flows * sizeof(udp_flow_t));
+                if (!grown) {
+                    fprintf(stderr, "udp: falha ao alocar fluxos\n");
+                    goto out;
+                }
+                flows = grown;
+            }
+            flows[n_flows] = key;
+            lookup[h] = n_flows + 1;
+            if (flow_open(&flows[n_flows++], dev) != 0) goto out;
+        }
+        items[idx].flow = last = f;
+    }
+
+    const clock_src_t *clk = &ctx->clock;
+    const int paced = txrx_paced(ctx);
+    const int pause = !paced && !ctx->opts.rate_pps;    // sem taxa: um por vez, com pausa
+    ctx->tx_start = clock_src_now(clk);
+
+    packet_t *pkt = ctx->list->head;
+    uint32_t pos = 0;           // posição de pkt na lista
+    uint32_t lap_base = 0;      // em loop: seq = lap_base + ID
+    uint32_t lap = 0;
+    instr_t *in = &ctx->instr;
+    const int timed = in->enabled;
+    uint64_t ts_wait = 0;
+    idx = 0;
+    while (idx < ctx->total_sends) {
+        if (timed) ts_wait = clock_src_now(clk);
+        if (paced) {
+            txrx_wait_until(clk, txrx_deadline(ctx, idx, lap, pkt->tx_offset_ns));
+        }
+        const uint64_t now = clock_src_now(clk);
+        if (timed) instr_stage_add(in, INSTR_TX_WAIT, now - ts_wait);
+        const uint64_t tx_ns = clock_src_mono_ns(clk, now) + ctx->realtime_offset;
+        udp_flow_t *f = &flows[items[pos].flow];
+
+        // lote: quadros do mesmo fluxo cujo prazo já chegou (sem taxa: um por vez)
+        unsigned nmsg = 0, niov = 0;
+        uint32_t seg = 0, bytes = 0;
+        while (idx < ctx->total_sends && &flows[items[pos].flow] == f) {
+            const udp_item_t *it = &items[pos];
+            const uint64_t due = paced ? txrx_deadline(ctx, idx, lap, pkt->tx_offset_ns) : now;
+            if (nmsg && (pause || due > now)) break;
+
+            struct msghdr *m = nmsg ? &msgs[nmsg - 1].msg_hdr : NULL;
+            // GSO: todos os segmentos do tamanho do primeiro, só o último pode ser menor
+            const int join = m && seg && it->len <= seg && it->len <= f->gso_max &&
+                             m->msg_iov[m->msg_iovlen - 1].iov_len == seg &&
+                             m->msg_iovlen < UDP_GSO_SEGS && bytes + it->len <= UDP_GSO_BYTES;
+            if (!join) {
+                if (nmsg == UDP_BATCH) break;
+                m = &msgs[nmsg].msg_hdr;
+                memset(m, 0, sizeof(*m));
+                m->msg_iov    = &iov[niov];
+                m->msg_iovlen = 0;
+                m->msg_control = cmsg[nmsg];
+                nmsg++;
+                seg   = it->len;
+                bytes = 0;
+            }
+            const uint32_t seq = pkt->id ? lap_base + pkt->id : 0;
+            if (ctx->opts.stamp && pkt->probe_off) {
+                nw_probe_stamp(pkt->data, pkt->length, pkt->probe_off, seq, tx_ns);
+            }
+            const uint32_t slot = seq ? seq - 1 : txrx_slot(ctx, pkt, idx);
+            if (slot < ctx->total_pkts) {
+                ctx->send_timestamp[slot] = now;
+            }
+            slots[niov] = slot;
+            iov[niov].iov_base = (uint8_t *)pkt->data + it->off;
+            iov[niov].iov_len  = it->len;
+            niov++;
+            m->msg_iovlen++;
+            bytes += it->len;
+            if (idx < ctx->total_pkts) {
+                ctx->tx_lateness[idx] = now > due ? now - due : 0;
+            }
+            idx++;
+            pkt = pkt->next;
+            pos++;
+            if (!pkt) {
+                pkt = ctx->list->head;
+                pos = 0;
+                lap_base += ctx->ids_per_lap;
+                lap++;
+            }
+        }
+
+        // UDP_SEGMENT só nas mensagens com mais de um datagrama
+        for (unsigned i = 0; i < nmsg; i++) {
+            struct msghdr *m = &msgs[i].msg_hdr;
+            if (m->msg_iovlen < 2) {
+                m->msg_control = NULL;
+                m->msg_controllen = 0;
+                continue;
+            }
+            m->msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+            struct cmsghdr *c = CMSG_FIRSTHDR(m);
+            c->cmsg_level = SOL_UDP;
+            c->cmsg_type  = UDP_SEGMENT;
+            c->cmsg_len   = CMSG_LEN(sizeof(uint16_t));
+            const uint16_t gso = (uint16_t)m->msg_iov[0].iov_len;
+            memcpy(CMSG_DATA(c), &gso, sizeof(gso));
+        }
+        uint64_t ts_send = 0;
+        if (timed) {
+            ts_send = clock_src_now(clk);
+            instr_stage_add(in, INSTR_TX_PREPARE, ts_send - now);
+        }
+        const uint64_t sent_before = in->tx.sent;
+        if (send_batch(f, msgs, nmsg, &in->tx) != 0) {
+            fprintf(stderr, "udp: falha no envio: %s\n", strerror(errno));
+            // o que não saiu do host é erro de TX, não perda no DUT
+            const uint32_t out = (uint32_t)(in->tx.sent - sent_before);
+            for (unsigned i = out; i < niov; i++) {
+                if (slots[i] < ctx->total_pkts) ctx->send_timestamp[slots[i]] = 0;
+            }
+            in->tx.failed += niov - out;
+        }
+        if (timed) instr_stage_add(in, INSTR_TX_SEND, clock_src_now(clk) - ts_send);
+        if (pause) usleep(1000);  // pequenas pausas para não atropelar a interface
+    }
+    rc = 0;
+
+out:
+    for (uint32_t i = 0; i < n_flows; i++) {
+        if (flows[i].fd >= 0) close(flows[i].fd);
+    }
+    free(flows);
+    free(items);
+    free(msgs);
+    free(iov);
+    free(cmsg);
+    free(slots);
+    free(lookup);
+    return rc;
+}
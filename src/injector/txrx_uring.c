@@ -0,0 +1,577 @@
+// txrx_uring.c
+#define _GNU_SOURCE
+#include "../../include/injector/txrx_uring.h"
+#include "../../include/injector/rx_parse.h"
+#include "../../include/generator/tcp_flow.h"
+#include "../../include/netwagon.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef NETWAGON_HAVE_IO_URING
+
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <linux/io_uring.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#define URING_ENTRIES    1024
+#define TX_DEPTH         256            // envios em voo
+#define RX_DEPTH         256            // leituras em voo
+#define RX_SLOT_SIZE     NW_JUMBO_FRAME_LEN     // quadros jumbo inteiros
+#define ARENA_ALIGN      64
+#define MAX_FIXED_BUF    (1UL << 30)    // limite do kernel por buffer registrado
+#define SPIN_THRESHOLD_NS 50000ULL
+#define IDLE_WAIT_NS     1000000ULL     // espera máxima por conclusões sem envio pendente
+#define RX_TAG           (1ULL << 63)
+
+enum { BUF_TX = 0, BUF_RX = 1 };
+enum { FILE_TX = 0, FILE_RX = 1 };
+
+typedef struct {
+    int                  fd;
+    unsigned             *sq_head, *sq_tail, *sq_mask, *sq_flags, *sq_array;
+    unsigned             *cq_head, *cq_tail, *cq_mask;
+    unsigned             sq_entries;
+    struct io_uring_sqe  *sqes;
+    struct io_uring_cqe  *cqes;
+    void                 *sq_ptr, *cq_ptr;
+    size_t               sq_len, cq_len, sqes_len;
+    unsigned             local_tail;     // SQEs preparados (publicados em uring_enter)
+    int                  sqpoll;
+    int                  ext_arg;
+} uring_t;
+
+static void uring_close(uring_t *u) {
+    if (u->sqes) munmap(u->sqes, u->sqes_len);
+    if (u->cq_ptr && u->cq_ptr != u->sq_ptr) munmap(u->cq_ptr, u->cq_len);
+    if (u->sq_ptr) munmap(u->sq_ptr, u->sq_len);
+    if (u->fd >= 0) close(u->fd);
+}
+
+static int uring_setup(uring_t *u, int sqpoll, int sq_cpu) {
+    struct io_uring_params p;
+    memset(u, 0, sizeof(*u));
+    memset(&p, 0, sizeof(p));
+    u->fd = -1;
+    if (sqpoll) {
+        p.flags = IORING_SETUP_SQPOLL;
+        p.sq_thread_idle = 2000;
+        if (sq_cpu >= 0) {
+            p.flags |= IORING_SETUP_SQ_AFF;
+            p.sq_thread_cpu = (unsigned)sq_cpu;
+        }
+    }
+    u->fd = (int)syscall(__NR_io_uring_setup, URING_ENTRIES, &p);
+    if (u->fd < 0) return -1;
+
+    u->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->cq_len > u->sq_len) u->sq_len = u->cq_len;
+        u->cq_len = u->sq_len;
+    }
+    u->sq_ptr = mmap(NULL, u->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     u->fd, IORING_OFF_SQ_RING);
+    if (u->sq_ptr == MAP_FAILED) {
+        u->sq_ptr = NULL;
+        return -1;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        u->cq_ptr = u->sq_ptr;
+    } else {
+        u->cq_ptr = mmap(NULL, u->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         u->fd, IORING_OFF_CQ_RING);
+        if (u->cq_ptr == MAP_FAILED) {
+            u->cq_ptr = NULL;
+            return -1;
+        }
+    }
+    u->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   u->fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) {
+        u->sqes = NULL;
+        return -1;
+    }
+
+    uint8_t *sq = u->sq_ptr, *cq = u->cq_ptr;
+    u->sq_head    = (unsigned *)(sq + p.sq_off.head);
+    u->sq_tail    = (unsigned *)(sq + p.sq_off.tail);
+    u->sq_mask    = (unsigned *)(sq + p.sq_off.ring_mask);
+    u->sq_flags   = (unsigned *)(sq + p.sq_off.flags);
+    u->sq_array   = (unsigned *)(sq + p.sq_off.array);
+    u->cq_head    = (unsigned *)(cq + p.cq_off.head);
+    u->cq_tail    = (unsigned *)(cq + p.cq_off.tail);
+    u->cq_mask    = (unsigned *)(cq + p.cq_off.ring_mask);
+    u->cqes       = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    u->sq_entries = p.sq_entries;
+    u->local_tail = *u->sq_tail;
+    u->sqpoll     = sqpoll;
+    u->ext_arg    = (p.features & IORING_FEAT_EXT_ARG) != 0;
+    return 0;
+}
+
+static struct io_uring_sqe *uring_get_sqe(uring_t *u) {
+    unsigned head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+    if (u->local_tail - head >= u->sq_entries) return NULL;
+    unsigned idx = u->local_tail & *u->sq_mask;
+    struct io_uring_sqe *sqe = &u->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    u->sq_array[idx] = idx;
+    u->local_tail++;
+    return sqe;
+}
+
+/* Publica os SQEs preparados e, se wait, espera ao menos uma conclusão por até wait_ns */
+static int uring_enter(uring_t *u, int wait, uint64_t wait_ns) {
+    __atomic_store_n(u->sq_tail, u->local_tail, __ATOMIC_RELEASE);
+
+    unsigned to_submit = 0, flags = 0;
+    if (u->sqpoll) {
+        // o thread do kernel consome a SQ; só precisa ser acordado se dormiu
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(u->sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) {
+            flags |= IORING_ENTER_SQ_WAKEUP;
+        }
+    } else {
+        to_submit = u->local_tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+    }
+
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    const void *argp = NULL;
+    size_t argsz = 0;
+    if (wait) {
+        if (!u->ext_arg) {
+            // sem timeout no io_uring_enter: dorme um pouco e reaproveita o polling
+            struct timespec nap = { 0, (long)(wait_ns < IDLE_WAIT_NS ? wait_ns : IDLE_WAIT_NS) };
+            if (to_submit || flags) {
+                if (syscall(__NR_io_uring_enter, u->fd, to_submit, 0, flags, NULL, 0) < 0 &&
+                    errno != EINTR && errno != EBUSY && errno != EAGAIN) {
+                    return -1;
+                }
+            }
+            nanosleep(&nap, NULL);
+            return 0;
+        }
+        memset(&arg, 0, sizeof(arg));
+        ts.tv_sec  = (long long)(wait_ns / 1000000000ULL);
+        ts.tv_nsec = (long long)(wait_ns % 1000000000ULL);
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        argp   = &arg;
+        argsz  = sizeof(arg);
+        flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    }
+    if (!to_submit && !flags) return 0;
+
+    int ret = (int)syscall(__NR_io_uring_enter, u->fd, to_submit, wait ? 1 : 0, flags, argp, argsz);
+    if (ret < 0 && errno != EINTR && errno != ETIME && errno != EBUSY && errno != EAGAIN) {
+        return -1;
+    }
+    return 0;
+}
+
+static int open_packet_socket(const char *dev, int rx) {
+    int ifindex = (int)if_nametoindex(dev);
+    if (ifindex == 0) {
+        fprintf(stderr, "io_uring: interface '%s' não encontrada\n", dev);
+        return -1;
+    }
+    // o socket de envio usa protocolo 0 para não receber cópia do tráfego
+    const uint16_t proto = rx ? htons(ETH_P_ALL) : 0;
+    int fd = socket(AF_PACKET, SOCK_RAW, proto);
+    if (fd < 0) {
+        perror("io_uring: socket AF_PACKET");
+        return -1;
+    }
+    struct sockaddr_ll sll;
+    memset(&sll, 0, sizeof(sll));
+    sll.sll_family   = AF_PACKET;
+    sll.sll_protocol = proto;
+    sll.sll_ifindex  = ifindex;
+    if (bind(fd, (struct sockaddr *)&sll, sizeof(sll)) != 0) {
+        perror("io_uring: bind");
+        close(fd);
+        return -1;
+    }
+    if (rx) {
+        struct packet_mreq mr;
+        memset(&mr, 0, sizeof(mr));
+        mr.mr_ifindex = ifindex;
+        mr.mr_type    = PACKET_MR_PROMISC;
+        setsockopt(fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mr, sizeof(mr));
+#ifdef PACKET_IGNORE_OUTGOING
+        // como no pcap: os próprios envios não contam como recebidos
+        int one = 1;
+        setsockopt(fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &one, sizeof(one));
+#endif
+    }
+    return fd;
+}
+
+/* Arena contíguo com todos os quadros (o "packet store" registrado no anel) */
+typedef struct {
+    uint8_t  *base;
+    size_t   size;
+    size_t   *off;
+    uint32_t *len;
+    uint32_t *slot;     // índice em send_timestamp
+    uint32_t *flow;     // fluxo TCP (0 = nenhum)
+    uint32_t *ack;      // fluxo TCP: ACK montado, base da correção
+    uint32_t *pos;      // ID - 1 -> índice no arena (para o RX achar o instante de submissão)
+    uint8_t  *ipv;      // versão IP, para localizar o cabeçalho TCP
+    uint16_t *probe;    // offset do tag de sonda (0 = sem tag)
+    uint64_t *due;      // tx_offset_ns (lista escalonada)
+    numa_region_t mem;  // memória do arena, no nó do TX
+} tx_store_t;
+
+static void tx_store_free(tx_store_t *s) {
+    numa_region_free(&s->mem);
+    free(s->off);
+    free(s->len);
+    free(s->slot);
+    free(s->flow);
+    free(s->ack);
+    free(s->ipv);
+    free(s->pos);
+    free(s->probe);
+    free(s->due);
+}
+
+static int tx_store_build(tx_store_t *s, const txrx_ctx_t *ctx) {
+    const uint32_t n = ctx->total_pkts;
+    memset(s, 0, sizeof(*s));
+    s->off  = calloc(n, sizeof(size_t));
+    s->len  = calloc(n, sizeof(uint32_t));
+    s->slot = calloc(n, sizeof(uint32_t));
+    s->flow = calloc(n, sizeof(uint32_t));
+    s->ack  = calloc(n, sizeof(uint32_t));
+    s->ipv  = calloc(n, sizeof(uint8_t));
+    s->pos  = calloc(n, sizeof(uint32_t));
+    s->probe = calloc(n, sizeof(uint16_t));
+    s->due  = calloc(n, sizeof(uint64_t));
+    if (!s->off || !s->len || !s->slot || !s->flow || !s->ack || !s->ipv || !s->pos || !s->probe || !s->due) {
+        return -1;
+    }
+
+    size_t total = 0;
+    uint32_t idx = 0;
+    for (packet_t *pkt = ctx->list->head; pkt && idx < n; pkt = pkt->next, idx++) {
+        s->off[idx]  = total;
+        s->len[idx]  = (uint32_t)pkt->length;
+        s->slot[idx] = txrx_slot(ctx, pkt, idx);
+        s->flow[idx] = pkt->flow;
+        s->ack[idx]  = pkt->tcp_ack;
+        s->ipv[idx]  = (uint8_t)pkt->ip_version;
+        s->probe[idx] = pkt->probe_off;
+        s->due[idx]  = pkt->tx_offset_ns;
+        if (s->slot[idx] < n) s->pos[s->slot[idx]] = idx;
+        total += (pkt->length + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    }
+    s->size = (total + 4095) & ~(size_t)4095;
+    if (numa_region_alloc(&s->mem, s->size ? s->size : 4096, ctx->node_tx, ctx->opts.rt.hugepages) != 0) {
+        return -1;
+    }
+    s->base = s->mem.addr;
+
+    idx = 0;
+    for (packet_t *pkt = ctx->list->head; pkt && idx < n; pkt = pkt->next, idx++) {
+        memcpy(s->base + s->off[idx], pkt->data, pkt->length);
+    }
+    return 0;
+}
+
+int txrx_uring_available(void) {
+    return 1;
+}
+
+int txrx_uring_run(txrx_ctx_t *ctx) {
+    const char *tx_dev = io_live_device(ctx->iface_send);
+    const char *rx_dev = io_live_device(ctx->iface_recv);
+    if (!tx_dev || !rx_dev) {
+        fprintf(stderr, "io_uring: só interfaces ao vivo são suportadas ('%s', '%s')\n",
+                ctx->iface_send, ctx->iface_recv);
+        return -1;
+    }
+    rt_apply_thread(ctx->opts.rt.cpu_tx, ctx->opts.rt.fifo_prio, "io_uring");
+
+    int rc = -1;
+    const clock_src_t *clk = &ctx->clock;   // também usado em out:, por qualquer goto
+    int fds[2] = { -1, -1 };
+    uint8_t *rx_pool = NULL;
+    uint64_t *submit_ts = NULL;
+    numa_region_t rx_mem, ts_mem;
+    memset(&rx_mem, 0, sizeof(rx_mem));
+    memset(&ts_mem, 0, sizeof(ts_mem));
+    tx_store_t store;
+    uring_t ring;
+    memset(&store, 0, sizeof(store));
+    memset(&ring, 0, sizeof(ring));
+    ring.fd = -1;
+
+    fds[FILE_TX] = open_packet_socket(tx_dev, 0);
+    fds[FILE_RX] = open_packet_socket(rx_dev, 1);
+    if (fds[FILE_TX] < 0 || fds[FILE_RX] < 0) goto out;
+
+    const uint32_t n = ctx->total_pkts;
+    tcp_flow_table_t *flows = ctx->list->flows;
+    // buffers de cada lado no nó escolhido pelo txrx_run_ex (mmap: alinhados à página)
+    if (numa_region_alloc(&ts_mem, n * sizeof(uint64_t), ctx->node_tx, ctx->opts.rt.hugepages) == 0) {
+        submit_ts = ts_mem.addr;
+    }
+    if (numa_region_alloc(&rx_mem, (size_t)RX_DEPTH * RX_SLOT_SIZE, ctx->node_rx,
+                          ctx->opts.rt.hugepages) == 0) {
+        rx_pool = rx_mem.addr;
+    }
+    if (!submit_ts || !rx_pool || tx_store_build(&store, ctx) != 0) {
+        fprintf(stderr, "io_uring: falha ao alocar buffers\n");
+        goto out;
+    }
+    if (ctx->opts.rt.lock_memory) {
+        rt_lock_region(store.base, store.size);
+        rt_lock_region(rx_pool, (size_t)RX_DEPTH * RX_SLOT_SIZE);
+        rt_lock_region(submit_ts, n * sizeof(uint64_t));
+    }
+
+    if (uring_setup(&ring, ctx->opts.sqpoll, ctx->opts.rt.cpu_rx) != 0) {
+        perror("io_uring: setup");
+        goto out;
+    }
+    // buffers e sockets registrados: sem pin/lookup por operação
+    const int fixed_tx = store.size <= MAX_FIXED_BUF;
+    struct iovec iov[2] = {
+        { .iov_base = store.base, .iov_len = fixed_tx ? store.size : 4096 },
+        { .iov_base = rx_pool,    .iov_len = (size_t)RX_DEPTH * RX_SLOT_SIZE }
+    };
+    if (syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_BUFFERS, iov, 2) < 0) {
+        perror("io_uring: registro de buffers");
+        goto out;
+    }
+    if (syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_FILES, fds, 2) < 0) {
+        perror("io_uring: registro de sockets");
+        goto out;
+    }
+
+    // arma todas as leituras antes do primeiro envio
+    uint32_t rx_rearm[RX_DEPTH];
+    uint32_t n_rearm = 0;
+    for (uint32_t i = 0; i < RX_DEPTH; i++) rx_rearm[n_rearm++] = i;
+
+    const uint64_t rate    = ctx->opts.rate_pps;
+    const int      paced   = txrx_paced(ctx) || !rate;
+    const uint64_t eff_rate = rate ? rate : 1000;   // 0 = pausa de 1 ms, como no motor de threads
+    const uint64_t timeout = clock_src_from_ns(clk, (uint64_t)ctx->timeout_ms * 1000000ULL);
+    const uint64_t spin    = clock_src_from_ns(clk, SPIN_THRESHOLD_NS);
+    rx_correlator_t corr = {
+        .recv_timestamp = ctx->recv_timestamp,
+        .total_pkts     = n,
+        .received       = 0
+    };
+    uint32_t next = 0, inflight = 0, reaped = 0;
+    uint64_t tx_errors = 0;
+    int rx_error_reported = 0;
+    uint64_t tx_end = 0;
+    int done = 0;
+
+    instr_t *in = &ctx->instr;
+    ctx->tx_start = clock_src_now(clk);
+    const int stamp = ctx->opts.stamp;
+    const uint64_t min_send_ts = ctx->opts.warmup_ms
+        ? ctx->tx_start + clock_src_from_ns(clk, (uint64_t)ctx->opts.warmup_ms * 1000000ULL) : 0;
+    while (!done) {
+        // 1) leituras a rearmar
+        while (n_rearm > 0) {
+            struct io_uring_sqe *sqe = uring_get_sqe(&ring);
+            if (!sqe) break;
+            uint32_t s = rx_rearm[--n_rearm];
+            sqe->opcode    = IORING_OP_READ_FIXED;
+            sqe->flags     = IOSQE_FIXED_FILE;
+            sqe->fd        = FILE_RX;
+            sqe->addr      = (uint64_t)(uintptr_t)(rx_pool + (size_t)s * RX_SLOT_SIZE);
+            sqe->len       = RX_SLOT_SIZE;
+            sqe->buf_index = BUF_RX;
+            sqe->user_data = RX_TAG | s;
+        }
+
+        // 2) envios cujo prazo já chegou
+        uint64_t now = clock_src_now(clk);
+        uint64_t next_deadline = 0;
+        while (next < n && inflight < TX_DEPTH) {
+            uint64_t deadline = now;
+            if (ctx->list->lap_ns) {
+                deadline = txrx_deadline(ctx, next, 0, store.due[next]);
+            } else if (paced) {
+                deadline = ctx->tx_start + clock_src_from_ns(clk, (uint64_t)next * 1000000000ULL / eff_rate);
+            }
+            if (deadline > now) {
+                next_deadline = deadline;
+                break;
+            }
+            struct io_uring_sqe *sqe = uring_get_sqe(&ring);
+            if (!sqe) break;
+            if (store.flow[next]) {
+                tcp_flow_patch_ack(flows, store.flow[next], store.base + store.off[next],
+                                   store.len[next], (ip_version_t)store.ipv[next], store.ack[next]);
+            }
+            if (stamp && store.probe[next] && store.slot[next] < n) {
+                nw_probe_stamp(store.base + store.off[next], store.len[next], store.probe[next],
+                               store.slot[next] + 1, clock_src_mono_ns(clk, now) + ctx->realtime_offset);
+            }
+            sqe->opcode    = fixed_tx ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+            sqe->flags     = IOSQE_FIXED_FILE;
+            sqe->fd        = FILE_TX;
+            sqe->addr      = (uint64_t)(uintptr_t)(store.base + store.off[next]);
+            sqe->len       = store.len[next];
+            sqe->buf_index = fixed_tx ? BUF_TX : 0;
+            sqe->user_data = next;
+            submit_ts[next] = now;
+            ctx->tx_lateness[next] = now - deadline;
+            next++;
+            inflight++;
+            in->tx.attempts++;
+        }
+
+        // 3) submete e, se não houver envio iminente, espera conclusões
+        int wait = 0;
+        uint64_t wait_ns = IDLE_WAIT_NS;
+        if (next_deadline) {
+            uint64_t gap = next_deadline - now;
+            if (gap > spin) {
+                wait = 1;
+                wait_ns = clock_src_to_ns(clk, gap - spin);
+            }
+        } else if (next == n || inflight == TX_DEPTH) {
+            wait = 1;
+        }
+        if (uring_enter(&ring, wait, wait_ns) != 0) {
+            perror("io_uring: enter");
+            break;
+        }
+
+        // 4) conclusões em bloco
+        unsigned head = *ring.cq_head;
+        unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        const uint64_t t_reap = clock_src_now(clk);
+        for (; head != tail; head++) {
+            const struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            if (cqe->user_data & RX_TAG) {
+                uint32_t s = (uint32_t)(cqe->user_data & ~RX_TAG);
+                rx_frame_info_t info;
+                const uint8_t *rx_buf = rx_pool + (size_t)s * RX_SLOT_SIZE;
+                int parsed = cqe->res > 0 ? rx_parse_frame(rx_buf, (size_t)cqe->res, &info) : -1;
+                if (cqe->res > 0) {
+                    in->rx.frames++;
+                    if (parsed != 0) in->rx.unparsed++;
+                }
+                if (flows && cqe->res > 0 && info.l4_proto == IPPROTO_TCP) {
+                    tcp_flow_observe(flows, rx_buf, (size_t)cqe->res, info.l3_offset,
+                                     info.l4_offset, info.ip_version, t_reap);
+                }
+                if (parsed == 0) {
+                    const int first = rx_correlate(&corr, info.id, t_reap);
+                    if (first == 1) in->rx.matched++;
+                    else if (first == 0) in->rx.duplicate++;
+                    else in->rx.foreign++;
+                    const uint64_t sent_at = first >= 0 ? submit_ts[store.pos[info.id - 1]] : 0;
+                    const int measured = !sent_at || sent_at >= min_send_ts;
+                    if (first == 1) {
+                        flow_stats_record(ctx->flow_stats, info.id, sent_at, t_reap, min_send_ts);
+                        if (measured) seq_stats_arrival(&ctx->seq, info.id, sent_at, t_reap, ctx->late_after);
+                    } else if (first == 0 && measured) {
+                        seq_stats_duplicate(&ctx->seq);
+                        flow_stats_duplicate(ctx->flow_stats, info.id);
+                    }
+                }
+                if (ctx->recorder && cqe->res > 0) {
+                    const uint64_t sent_at = parsed == 0 && info.id >= 1 && info.id <= n
+                                                 ? submit_ts[store.pos[info.id - 1]] : 0;
+                    rx_record_push(ctx->recorder, rx_buf, (size_t)cqe->res, (size_t)cqe->res, t_reap,
+                                   sent_at && t_reap > sent_at ? t_reap - sent_at : 0,
+                                   parsed == 0 ? info.id : 0);
+                } else if (cqe->res < 0 && cqe->res != -EAGAIN && cqe->res != -EINTR &&
+                           cqe->res != -ENOBUFS && !rx_error_reported) {
+                    fprintf(stderr, "io_uring RX: %s\n", strerror(-cqe->res));
+                    rx_error_reported = 1;
+                }
+                if (cqe->res != -ECANCELED) rx_rearm[n_rearm++] = s;
+            } else {
+                uint32_t idx = (uint32_t)cqe->user_data;
+                inflight--;
+                reaped++;
+                if (cqe->res == (int)store.len[idx]) {
+                    // envio confirmado: o timestamp é o da submissão
+                    if (store.slot[idx] < n) ctx->send_timestamp[store.slot[idx]] = submit_ts[idx];
+                    in->tx.sent++;
+                } else {
+                    in->tx.failed++;
+                    if (cqe->res == -EAGAIN) in->tx.eagain++;
+                    if (cqe->res == -ENOBUFS) in->tx.enobufs++;
+                    if (tx_errors++ == 0) {
+                        fprintf(stderr, "TX[%u]: falha: %s\n", idx,
+                                cqe->res < 0 ? strerror(-cqe->res) : "envio parcial");
+                    }
+                }
+            }
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+
+        // 5) término: tudo recebido ou timeout após o último envio
+        if (reaped == n && !tx_end) {
+            tx_end = t_reap;
+            atomic_store(&ctx->tx_end, tx_end);
+            atomic_store(&ctx->tx_done, 1);
+        }
+        if (tx_end && (corr.received == ctx->expected_ids || t_reap - tx_end >= timeout)) {
+            done = 1;
+        }
+    }
+    if (tx_errors > 1) {
+        fprintf(stderr, "io_uring: %llu envios falharam\n", (unsigned long long)tx_errors);
+    }
+    rc = done ? 0 : -1;
+
+    // descartes do kernel no socket de captura
+    struct tpacket_stats ps;
+    socklen_t ps_len = sizeof(ps);
+    if (getsockopt(fds[FILE_RX], SOL_PACKET, PACKET_STATISTICS, &ps, &ps_len) == 0) {
+        in->rx.kernel_valid = 1;
+        in->rx.kernel_recv  = ps.tp_packets;
+        in->rx.kernel_drop  = ps.tp_drops;
+    }
+
+out:
+    if (!atomic_load(&ctx->tx_done)) {
+        atomic_store(&ctx->tx_end, clock_src_now(clk));
+        atomic_store(&ctx->tx_done, 1);
+    }
+    uring_close(&ring);     // fechar o anel cancela as leituras pendentes
+    if (fds[FILE_TX] >= 0) close(fds[FILE_TX]);
+    if (fds[FILE_RX] >= 0) close(fds[FILE_RX]);
+    tx_store_free(&store);
+    numa_region_free(&rx_mem);
+    numa_region_free(&ts_mem);
+    return rc;
+}
+
+#else // !NETWAGON_HAVE_IO_URING
+
+int txrx_uring_available(void) {
+    return 0;
+}
+
+int txrx_uring_run(txrx_ctx_t *ctx) {
+    (void)ctx;
+    fprintf(stderr, "io_uring: NetWagon compilado sem suporte (linux/io_uring.h ausente)\n");
+    return -1;
+}
+
+#endif // NETWAGON_HAVE_IO_URING
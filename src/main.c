@@ -2,23 +2,206 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <unistd.h>
 #include <getopt.h>
 #include <pcap.h>
 
-#include "../include/generator/reader.h"       // load_templates_from_json()
+#include "../include/generator/reader.h"       // load_template_set(), build_packets_from_templates()
 #include "../include/generator/pcap_writer.h"  // open_pcap_file(), write_packet_list_to_pcap(), close_pcap_file()
 #include "../include/generator/packet.h"       // packet_list_t, free_packet_list()
 #include "../include/injector/txrx.h"
+#include "../include/injector/rfc2544.h"
+#include "../include/injector/coord.h"
+
+#define MAX_FRAME_SIZES 32
+
+/* Tamanhos de quadro recomendados pela RFC 2544 para Ethernet */
+static const size_t DEFAULT_FRAME_SIZES[] = { 64, 128, 256, 512, 1024, 1280, 1518 };
+
+enum {
+    OPT_RATE = 256,
+    OPT_WARMUP,
+    OPT_FRAME_SIZES,
+    OPT_LINK_MBPS,
+    OPT_LOSS,
+    OPT_RESOLUTION,
+    OPT_MAX_TRIALS,
+    OPT_TRIAL_S,
+    OPT_REPORT,
+    OPT_RT,
+    OPT_MLOCK,
+    OPT_CPU_TX,
+    OPT_CPU_RX,
+    OPT_FIFO,
+    OPT_RX_LOSS,
+    OPT_RX_DELAY,
+    OPT_RX_JITTER,
+    OPT_RX_REORDER,
+    OPT_RX_SEED,
+    OPT_ENGINE,
+    OPT_SQPOLL,
+    OPT_FLOW_TOP,
+    OPT_FLOW_CSV,
+    OPT_STAMP,
+    OPT_LOOP,
+    OPT_CLOCK,
+    OPT_LATE_MS,
+    OPT_WORKER,
+    OPT_COORDINATE,
+    OPT_RX_RECORD,
+    OPT_RX_SNAPLEN,
+    OPT_RX_ROTATE_MB,
+    OPT_RX_ROTATE_S,
+    OPT_RX_RING_MB,
+    OPT_RX_TRIGGER_US,
+    OPT_RX_TRIGGER_GAP,
+    OPT_INSTRUMENT,
+    OPT_STATS_JSON,
+    OPT_NUMA,
+    OPT_HUGEPAGES,
+    OPT_PIPELINE,
+    OPT_RX_WORKERS
+};
+
+static const struct option long_options[] = {
+    { "file",           required_argument, NULL, 'f' },
+    { "rx",             required_argument, NULL, 'r' },
+    { "tx",             required_argument, NULL, 's' },
+    { "output",         required_argument, NULL, 'o' },
+    { "timeout",        required_argument, NULL, 't' },
+    { "throughput",     no_argument,       NULL, 'T' },
+    { "rate",           required_argument, NULL, OPT_RATE },
+    { "warmup-ms",      required_argument, NULL, OPT_WARMUP },
+    { "frame-sizes",    required_argument, NULL, OPT_FRAME_SIZES },
+    { "link-mbps",      required_argument, NULL, OPT_LINK_MBPS },
+    { "loss-threshold", required_argument, NULL, OPT_LOSS },
+    { "resolution",     required_argument, NULL, OPT_RESOLUTION },
+    { "max-trials",     required_argument, NULL, OPT_MAX_TRIALS },
+    { "trial-s",        required_argument, NULL, OPT_TRIAL_S },
+    { "report",         required_argument, NULL, OPT_REPORT },
+    { "rt",             no_argument,       NULL, OPT_RT },
+    { "mlock",          no_argument,       NULL, OPT_MLOCK },
+    { "cpu-tx",         required_argument, NULL, OPT_CPU_TX },
+    { "cpu-rx",         required_argument, NULL, OPT_CPU_RX },
+    { "fifo",           required_argument, NULL, OPT_FIFO },
+    { "rx-loss",        required_argument, NULL, OPT_RX_LOSS },
+    { "rx-delay-us",    required_argument, NULL, OPT_RX_DELAY },
+    { "rx-jitter-us",   required_argument, NULL, OPT_RX_JITTER },
+    { "rx-reorder",     required_argument, NULL, OPT_RX_REORDER },
+    { "rx-seed",        required_argument, NULL, OPT_RX_SEED },
+    { "engine",         required_argument, NULL, OPT_ENGINE },
+    { "sqpoll",         no_argument,       NULL, OPT_SQPOLL },
+    { "flow-top",       required_argument, NULL, OPT_FLOW_TOP },
+    { "flow-csv",       required_argument, NULL, OPT_FLOW_CSV },
+    { "stamp",          no_argument,       NULL, OPT_STAMP },
+    { "loop",           required_argument, NULL, OPT_LOOP },
+    { "clock",          required_argument, NULL, OPT_CLOCK },
+    { "late-ms",        required_argument, NULL, OPT_LATE_MS },
+    { "worker",         required_argument, NULL, OPT_WORKER },
+    { "coordinate",     required_argument, NULL, OPT_COORDINATE },
+    { "rx-record",      required_argument, NULL, OPT_RX_RECORD },
+    { "rx-snaplen",     required_argument, NULL, OPT_RX_SNAPLEN },
+    { "rx-rotate-mb",   required_argument, NULL, OPT_RX_ROTATE_MB },
+    { "rx-rotate-s",    required_argument, NULL, OPT_RX_ROTATE_S },
+    { "rx-ring-mb",     required_argument, NULL, OPT_RX_RING_MB },
+    { "rx-trigger-us",  required_argument, NULL, OPT_RX_TRIGGER_US },
+    { "rx-trigger-gap", required_argument, NULL, OPT_RX_TRIGGER_GAP },
+    { "instrument",     no_argument,       NULL, OPT_INSTRUMENT },
+    { "stats-json",     required_argument, NULL, OPT_STATS_JSON },
+    { "numa",           required_argument, NULL, OPT_NUMA },
+    { "hugepages",      no_argument,       NULL, OPT_HUGEPAGES },
+    { "pipeline",       required_argument, NULL, OPT_PIPELINE },
+    { "rx-workers",     required_argument, NULL, OPT_RX_WORKERS },
+    { "help",           no_argument,       NULL, 'h' },
+    { NULL, 0, NULL, 0 }
+};
 
 static void print_usage(const char *prog) {
-    printf("Usage: %s -f <templates.json> -r <iface_in> -s <iface_out> [-o <output.pcap>] [-t <timeout_ms>]\n", prog);
+    printf("Usage: %s -f <templates.json> -r <iface_in> -s <iface_out> [-o <output.pcap>] [-t <timeout_ms>] [opções]\n", prog);
     printf("  -f <file>   JSON template file (obrigatório)\n");
     printf("  -r <iface>  Interface de captura (RX) (obrigatório)\n");
     printf("  -s <iface>  Interface de envio (TX) (obrigatório)\n");
+    printf("              iface: eth0 | pcap:eth0 | file:arquivo.pcap | mem[:nome]\n");
+    printf("              vnet:eth0 = AF_PACKET com checksum e TSO/GSO pelo kernel/NIC (TX)\n");
     printf("  -o <file>   Opcional: filename para gravar pcap\n");
-    printf("  -t <ms>     Opcional: timeout RX em milissegundos (default=5000)\n");
+    printf("  -t <ms>     Opcional: timeout RX em milissegundos após o último envio (default=5000)\n");
+    printf("  --pipeline <n>        Gera os quadros em n threads enquanto o TX já envia (motor threads;\n");
+    printf("                        -o grava os quadros enviados, na ordem de envio)\n");
+    printf("  --rate <pps|max>      Taxa ofertada em pacotes/s (default: pausa de 1 ms; max = sem pausa)\n");
+    printf("  --warmup-ms <ms>      Pacotes enviados nesta janela inicial não entram nas métricas\n");
+    printf("  --engine <threads|uring|udp>  Motor de TX/RX (default=threads; uring = uma thread sobre io_uring;\n");
+    printf("                        udp = sockets UDP com GSO + sendmmsg, só templates UDP, implica --stamp)\n");
+    printf("  --sqpoll              io_uring: submissão por thread do kernel (SQPOLL, fixada em --cpu-rx)\n");
+    printf("  --flow-top <n>        Imprime os n piores fluxos por perda e p99 (default=5, 0 = desliga)\n");
+    printf("  --flow-csv <file>     Exporta perda e latência de todos os fluxos (template + 5-tupla)\n");
+    printf("  --stamp               Payload com tag de sonda binário; o TX grava seq e instante de envio\n");
+    printf("  --loop <n>            Reenvia a lista em ciclo até n quadros (exige --stamp)\n");
+    printf("  --clock <monotonic|tsc>  Relógio dos timestamps de TX/RX (default=monotonic;\n");
+    printf("                        tsc = rdtscp calibrado, exige TSC invariante)\n");
+    printf("  --instrument          Contadores de TX/RX, descartes do kernel e custo de cada estágio no resumo\n");
+    printf("  --stats-json <file>   Grava resumo e instrumentação em JSON (liga a medição dos estágios)\n");
+    printf("  --late-ms <ms>        Prazo de perda: chegadas com latência maior contam como tardias (default=-t)\n");
     printf("  -h          Exibe esta ajuda e sai\n");
+    printf("Modo de baixa variação:\n");
+    printf("  --rt                  Equivale a --mlock --fifo 50\n");
+    printf("  --mlock               Trava e pré-aloca a memória de pacotes e timestamps\n");
+    printf("  --cpu-tx <cpu>        Fixa a thread TX na CPU (de preferência isolada)\n");
+    printf("  --cpu-rx <cpu>        Fixa a thread RX na CPU (de preferência isolada)\n");
+    printf("  --fifo <prio>         Usa SCHED_FIFO com a prioridade dada nas threads TX/RX\n");
+    printf("  --rx-workers <n>      RX só carimba e enfileira; n threads analisam (parse, correlação e\n");
+    printf("                        estatísticas; 1 a %d, motores threads/udp)\n", TXRX_RX_WORKERS_MAX);
+    printf("  --numa <auto|off|n>   Nó NUMA de pacotes, buffers e timestamps (auto = nó da CPU fixada\n");
+    printf("                        ou da interface de cada lado; default=auto)\n");
+    printf("  --hugepages           Pacotes, buffers e timestamps em páginas de 2 MB (hugetlbfs ou THP)\n");
+    printf("Degradações no RX (reproduzíveis pela semente):\n");
+    printf("  --rx-loss <%%>         Descarta quadros com a probabilidade dada\n");
+    printf("  --rx-delay-us <us>    Soma um atraso fixo a cada chegada\n");
+    printf("  --rx-jitter-us <us>   Soma um atraso aleatório em [0, us]\n");
+    printf("  --rx-reorder <%%>      Entrega o quadro depois do seguinte com a probabilidade dada\n");
+    printf("  --rx-seed <n>         Semente do gerador (default=1)\n");
+    printf("Gravação dos quadros recebidos (thread própria, sem bloquear o RX):\n");
+    printf("  --rx-record <file>    Grava em pcap (ns) ou, com extensão .pcapng, em pcapng\n");
+    printf("  --rx-snaplen <n>      Bytes gravados por quadro (default=65535)\n");
+    printf("  --rx-rotate-mb <MB>   Novo arquivo a cada MB gravados (<nome>.1.pcap, <nome>.2.pcap, ...)\n");
+    printf("  --rx-rotate-s <s>     Novo arquivo a cada s de captura\n");
+    printf("  --rx-ring-mb <MB>     Anel em memória: grava só os últimos MB, no fim da execução\n");
+    printf("  --rx-trigger-us <us>  Anel: grava ao redor de cada latência acima de us\n");
+    printf("  --rx-trigger-gap <n>  Anel: grava ao redor de cada salto de n ou mais IDs (perda)\n");
+    printf("Teste de vazão RFC 2544:\n");
+    printf("  -T, --throughput      Busca binária da maior taxa com perda <= limite\n");
+    printf("  --frame-sizes <lista> Tamanhos de quadro com FCS (default: 64,128,256,512,1024,1280,1518;\n");
+    printf("                        0 = tamanho natural dos templates)\n");
+    printf("  --link-mbps <mbps>    Velocidade do enlace para a taxa de linha (default=1000)\n");
+    printf("  --loss-threshold <%%>  Perda aceita por tentativa (default=0)\n");
+    printf("  --resolution <%%>      Precisão da busca em %% da taxa de linha (default=0.5)\n");
+    printf("  --max-trials <n>      Tentativas por tamanho de quadro (default=20)\n");
+    printf("  --trial-s <s>         Duração de cada tentativa: a lista circula em loop (liga --stamp;\n");
+    printf("                        default=0, uma passagem da lista)\n");
+    printf("  --report <file.csv>   Grava o resultado de cada tentativa\n");
+    printf("Execução coordenada:\n");
+    printf("  --worker <addr>       Atende um coordenador em unix:/caminho ou [tcp:]host:porta\n");
+    printf("                        (TCP exige o token em NETWAGON_COORD_TOKEN)\n");
+    printf("  --coordinate <file>   Divide -f entre os workers do cluster JSON (sem -s/-r) e junta os resultados\n");
+}
+
+/* Converte "64,128,1518" em um array de tamanhos */
+static int parse_frame_sizes(const char *arg, size_t *out, size_t max) {
+    char *copy = strdup(arg);
+    if (!copy) return -1;
+    size_t n = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *end;
+        long v = strtol(tok, &end, 10);
+        if (*end != '\0' || v < 0 || n >= max) {
+            free(copy);
+            return -1;
+        }
+        out[n++] = (size_t)v;
+    }
+    free(copy);
+    return (int)n;
 }
 
 int main(int argc, char *argv[]) {
@@ -26,10 +209,31 @@ int main(int argc, char *argv[]) {
     char *iface_in = NULL;
     char *iface_out = NULL;
     char *output_pcap = NULL;
+    char *worker_addr = NULL;
+    char *cluster_file = NULL;
     uint32_t timeout_ms = 5000;
+    int throughput_mode = 0;
+    txrx_opts_t opts;
+    rfc2544_cfg_t rfc;
+    size_t frame_sizes[MAX_FRAME_SIZES];
     int opt;
 
-    while ((opt = getopt(argc, argv, "f:r:s:o:t:h")) != -1) {
+    memset(&opts, 0, sizeof(opts));
+    rt_opts_init(&opts.rt);
+    opts.save_csv = 1;
+    opts.impair.seed = 1;
+    opts.flow_top = 5;
+
+    memset(&rfc, 0, sizeof(rfc));
+    memcpy(frame_sizes, DEFAULT_FRAME_SIZES, sizeof(DEFAULT_FRAME_SIZES));
+    rfc.frame_sizes    = frame_sizes;
+    rfc.n_frame_sizes  = sizeof(DEFAULT_FRAME_SIZES) / sizeof(DEFAULT_FRAME_SIZES[0]);
+    rfc.link_mbps      = 1000;
+    rfc.loss_threshold = 0.0;
+    rfc.resolution     = 0.5;
+    rfc.max_trials     = 20;
+
+    while ((opt = getopt_long(argc, argv, "f:r:s:o:t:Th", long_options, NULL)) != -1) {
         switch (opt) {
             case 'f': json_file = optarg; break;
             case 'r': iface_in = optarg; break;
@@ -38,6 +242,104 @@ int main(int argc, char *argv[]) {
             case 't': timeout_ms = (uint32_t)atoi(optarg);
                       if (timeout_ms == 0) timeout_ms = 5000;
                       break;
+            case 'T': throughput_mode = 1; break;
+            case OPT_RATE: opts.rate_pps = strcmp(optarg, "max") == 0 ? TXRX_RATE_UNLIMITED
+                                                                       : strtoull(optarg, NULL, 10);
+                           break;
+            case OPT_WARMUP: opts.warmup_ms = (uint32_t)atoi(optarg); break;
+            case OPT_FRAME_SIZES: {
+                int n = parse_frame_sizes(optarg, frame_sizes, MAX_FRAME_SIZES);
+                if (n <= 0) {
+                    fprintf(stderr, "Erro: --frame-sizes inválido '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                rfc.n_frame_sizes = (size_t)n;
+                break;
+            }
+            case OPT_LINK_MBPS: rfc.link_mbps = strtoull(optarg, NULL, 10); break;
+            case OPT_LOSS: rfc.loss_threshold = atof(optarg); break;
+            case OPT_RESOLUTION: rfc.resolution = atof(optarg); break;
+            case OPT_MAX_TRIALS: rfc.max_trials = (uint32_t)atoi(optarg); break;
+            case OPT_TRIAL_S: rfc.trial_s = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case OPT_REPORT: rfc.report_csv = optarg; break;
+            case OPT_RT: opts.rt.lock_memory = 1;
+                         if (!opts.rt.fifo_prio) opts.rt.fifo_prio = 50;
+                         break;
+            case OPT_MLOCK: opts.rt.lock_memory = 1; break;
+            case OPT_CPU_TX: opts.rt.cpu_tx = atoi(optarg); break;
+            case OPT_CPU_RX: opts.rt.cpu_rx = atoi(optarg); break;
+            case OPT_FIFO: opts.rt.fifo_prio = atoi(optarg); break;
+            case OPT_NUMA:
+                if (strcmp(optarg, "auto") == 0) {
+                    opts.rt.numa_node = NUMA_MEM_AUTO;
+                } else if (strcmp(optarg, "off") == 0) {
+                    opts.rt.numa_node = NUMA_MEM_OFF;
+                } else if (isdigit((unsigned char)optarg[0])) {
+                    opts.rt.numa_node = atoi(optarg);
+                } else {
+                    fprintf(stderr, "Erro: --numa inválido '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_HUGEPAGES: opts.rt.hugepages = 1; break;
+            case OPT_PIPELINE:
+                opts.pipeline.builders = (uint32_t)strtoul(optarg, NULL, 10);
+                if (opts.pipeline.builders < 1 || opts.pipeline.builders > PIPELINE_MAX_BUILDERS) {
+                    fprintf(stderr, "Erro: --pipeline aceita de 1 a %d construtoras\n", PIPELINE_MAX_BUILDERS);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_RX_WORKERS:
+                opts.rx_workers = (uint32_t)strtoul(optarg, NULL, 10);
+                if (opts.rx_workers < 1 || opts.rx_workers > TXRX_RX_WORKERS_MAX) {
+                    fprintf(stderr, "Erro: --rx-workers aceita de 1 a %d analisadores\n", TXRX_RX_WORKERS_MAX);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_RX_LOSS: opts.impair.loss = atof(optarg) / 100.0; break;
+            case OPT_RX_DELAY: opts.impair.delay_us = (uint32_t)atoi(optarg); break;
+            case OPT_RX_JITTER: opts.impair.jitter_us = (uint32_t)atoi(optarg); break;
+            case OPT_RX_REORDER: opts.impair.reorder = atof(optarg) / 100.0; break;
+            case OPT_RX_SEED: opts.impair.seed = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case OPT_ENGINE:
+                if (strcmp(optarg, "threads") == 0) {
+                    opts.engine = TXRX_ENGINE_THREADS;
+                } else if (strcmp(optarg, "uring") == 0) {
+                    opts.engine = TXRX_ENGINE_URING;
+                } else if (strcmp(optarg, "udp") == 0) {
+                    opts.engine = TXRX_ENGINE_UDP;
+                } else {
+                    fprintf(stderr, "Erro: --engine inválido '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_SQPOLL: opts.sqpoll = 1; break;
+            case OPT_FLOW_TOP: opts.flow_top = (uint32_t)atoi(optarg); break;
+            case OPT_FLOW_CSV: opts.flow_csv = optarg; break;
+            case OPT_STAMP: opts.stamp = 1; break;
+            case OPT_LOOP: opts.loop_count = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case OPT_LATE_MS: opts.late_ms = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case OPT_WORKER: worker_addr = optarg; break;
+            case OPT_COORDINATE: cluster_file = optarg; break;
+            case OPT_RX_RECORD: opts.record.path = optarg; break;
+            case OPT_RX_SNAPLEN: opts.record.snaplen = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case OPT_RX_ROTATE_MB: opts.record.rotate_mb = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case OPT_RX_ROTATE_S: opts.record.rotate_s = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case OPT_RX_RING_MB: opts.record.ring_mb = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case OPT_RX_TRIGGER_US: opts.record.trigger_us = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case OPT_RX_TRIGGER_GAP: opts.record.trigger_gap = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case OPT_INSTRUMENT: opts.instrument = 1; break;
+            case OPT_STATS_JSON: opts.stats_json = optarg; break;
+            case OPT_CLOCK:
+                if (strcmp(optarg, "monotonic") == 0) {
+                    opts.clock = CLOCK_SOURCE_MONOTONIC;
+                } else if (strcmp(optarg, "tsc") == 0) {
+                    opts.clock = CLOCK_SOURCE_TSC;
+                } else {
+                    fprintf(stderr, "Erro: --clock inválido '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
             case 'h':
             default:
                 print_usage(argv[0]);
@@ -45,11 +347,116 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // Modo worker: templates e interfaces chegam do coordenador
+    if (worker_addr) {
+        return coord_worker_serve(worker_addr) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Modo coordenador: interfaces por worker no arquivo do cluster
+    if (cluster_file) {
+        if (!json_file) {
+            fprintf(stderr, "Erro: --coordinate exige -f\n");
+            return EXIT_FAILURE;
+        }
+        if (throughput_mode || opts.loop_count || output_pcap || opts.pipeline.builders) {
+            fprintf(stderr, "Erro: --coordinate não aceita -T, --loop, -o nem --pipeline\n");
+            return EXIT_FAILURE;
+        }
+        opts.timeout_ms = timeout_ms;
+        if (opts.engine == TXRX_ENGINE_UDP) opts.stamp = 1;
+        return coord_run(cluster_file, json_file, &opts) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     if (!json_file || !iface_in || !iface_out) {
         fprintf(stderr, "Erro: parâmetros obrigatórios faltando.\n");
         print_usage(argv[0]);
         return EXIT_FAILURE;
     }
+    opts.timeout_ms = timeout_ms;
+    if ((opts.record.trigger_us || opts.record.trigger_gap) && !opts.record.ring_mb) {
+        fprintf(stderr, "Erro: --rx-trigger-us/--rx-trigger-gap exigem --rx-ring-mb\n");
+        return EXIT_FAILURE;
+    }
+    if (opts.rx_workers && (opts.engine == TXRX_ENGINE_URING || opts.record.trigger_us || opts.record.trigger_gap)) {
+        fprintf(stderr, "Erro: --rx-workers não se aplica a --engine uring nem a --rx-trigger-us/--rx-trigger-gap\n");
+        return EXIT_FAILURE;
+    }
+    // o motor udp só envia payloads: a correlação depende do tag de sonda
+    if (opts.engine == TXRX_ENGINE_UDP) opts.stamp = 1;
+    // vnet: os quadros saem com checksum parcial, completado pelo kernel/NIC
+    const int csum_offload = (io_tx_spec_flags(iface_out) & IO_FLAG_VNET_HDR) != 0;
+    if (csum_offload && opts.engine != TXRX_ENGINE_THREADS) {
+        fprintf(stderr, "Erro: TX 'vnet:' exige --engine threads\n");
+        return EXIT_FAILURE;
+    }
+
+    if (opts.pipeline.builders &&
+        (throughput_mode || opts.loop_count || opts.engine != TXRX_ENGINE_THREADS)) {
+        fprintf(stderr, "Erro: --pipeline exige --engine threads e não aceita -T nem --loop\n");
+        return EXIT_FAILURE;
+    }
+
+    // Modo vazão: templates carregados uma vez e reaproveitados em todas as tentativas
+    if (throughput_mode) {
+        if (rfc.link_mbps == 0 || rfc.max_trials == 0 || !(rfc.resolution > 0)) {
+            fprintf(stderr, "Erro: --link-mbps, --max-trials e --resolution devem ser > 0\n");
+            return EXIT_FAILURE;
+        }
+        // a duração da tentativa vem de --trial-s; o loop da lista é da busca
+        if (opts.loop_count) {
+            fprintf(stderr, "Erro: -T não aceita --loop (use --trial-s)\n");
+            return EXIT_FAILURE;
+        }
+        if (rfc.trial_s && opts.engine == TXRX_ENGINE_URING) {
+            fprintf(stderr, "Erro: --trial-s não se aplica a --engine uring\n");
+            return EXIT_FAILURE;
+        }
+        // o ciclo da lista correlaciona pelo tag de sonda
+        if (rfc.trial_s) opts.stamp = 1;
+        template_set_t set;
+        if (load_template_set(json_file, &set) != 0) {
+            fprintf(stderr, "Erro ao carregar JSON '%s'\n", json_file);
+            return EXIT_FAILURE;
+        }
+        rfc.cooldown_ms = timeout_ms;
+        rfc.base        = opts;
+        rfc.base.save_csv = 0;      // sem CSVs por pacote de cada tentativa
+        set.probe_tag    = opts.stamp;
+        set.csum_offload = csum_offload;
+        int rc = rfc2544_run(&set, iface_out, iface_in, &rfc, NULL);
+        free_template_set(&set);
+        return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Início em fluxo: o TX começa enquanto as construtoras geram; -o sai do mesmo fluxo
+    if (opts.pipeline.builders) {
+        template_set_t set;
+        if (load_template_set(json_file, &set) != 0) {
+            fprintf(stderr, "Erro ao carregar JSON '%s'\n", json_file);
+            return EXIT_FAILURE;
+        }
+        set.probe_tag    = opts.stamp;
+        set.csum_offload = csum_offload;
+        set.rate_pps     = opts.rate_pps == TXRX_RATE_UNLIMITED ? 0 : opts.rate_pps;
+        packet_list_t *list = create_packet_list();
+        if (!list) {
+            fprintf(stderr, "Erro: não foi possível criar packet list\n");
+            free_template_set(&set);
+            return EXIT_FAILURE;
+        }
+        opts.pipeline.set  = &set;
+        opts.pipeline.pcap = output_pcap;
+        printf("Iniciando TX/RX: TX iface='%s', RX iface='%s', timeout=%ums, %u construtoras\n",
+               iface_out, iface_in, timeout_ms, opts.pipeline.builders);
+        int rc = txrx_run_ex(list, iface_out, iface_in, &opts, NULL);
+        free_packet_list(list);
+        free_template_set(&set);
+        if (rc != 0) {
+            fprintf(stderr, "Erro durante TX/RX (rc=%d)\n", rc);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
 
     // 1) Cria lista e carrega templates
     packet_list_t *list = create_packet_list();
@@ -57,11 +464,27 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "Erro: não foi possível criar packet list\n");
         return EXIT_FAILURE;
     }
-    if (load_templates_from_json(json_file, list) != 0) {
+    template_set_t set;
+    if (load_template_set(json_file, &set) != 0) {
         fprintf(stderr, "Erro ao carregar JSON '%s'\n", json_file);
         free_packet_list(list);
         return EXIT_FAILURE;
     }
+    set.probe_tag    = opts.stamp;
+    set.csum_offload = csum_offload;
+    set.rate_pps     = opts.rate_pps == TXRX_RATE_UNLIMITED ? 0 : opts.rate_pps;
+    int build_rc = build_packets_from_templates(&set, list, 0);
+    free_template_set(&set);
+    if (build_rc != 0) {
+        fprintf(stderr, "Erro ao gerar pacotes de '%s'\n", json_file);
+        free_packet_list(list);
+        return EXIT_FAILURE;
+    }
+    if (opts.loop_count && !opts.stamp) {
+        fprintf(stderr, "Erro: --loop exige --stamp\n");
+        free_packet_list(list);
+        return EXIT_FAILURE;
+    }
 
     // 2) PCAP opcional
     if (output_pcap) {
@@ -79,7 +502,7 @@ int main(int argc, char *argv[]) {
     // 3) Teste TX/RX
     printf("Iniciando TX/RX: TX iface='%s', RX iface='%s', timeout=%ums\n",
            iface_out, iface_in, timeout_ms);
-    int rc = txrx_run(list, iface_out, iface_in, timeout_ms);
+    int rc = txrx_run_ex(list, iface_out, iface_in, &opts, NULL);
     if (rc != 0) {
         fprintf(stderr, "Erro durante TX/RX (rc=%d)\n", rc);
         free_packet_list(list);
@@ -0,0 +1,373 @@
+// reflector.c
+// netwagon-reflector: devolve à origem os quadros de sonda do NetWagon
+#define _GNU_SOURCE
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "../../include/netwagon.h"
+#include "../../include/injector/rx_parse.h"
+#include "../../include/injector/rt.h"
+
+#define DEFAULT_BATCH   64
+#define MAX_BATCH       1024
+#define MAX_WORKERS     64
+#define SLOT_SIZE       NW_JUMBO_FRAME_LEN      // quadro jumbo
+#define RX_TIMEOUT_MS   100             // para checar o pedido de parada
+
+static volatile sig_atomic_t stop;
+
+typedef struct {
+    const char *iface_in;
+    const char *iface_out;          // NULL = devolve pela mesma interface
+    uint32_t   batch;
+    int        workers;
+    int        cpu_first;           // CPU do worker 0 (-1 = não fixa)
+    int        fifo_prio;
+    int        dwell;               // grava a permanência após o tag de sonda
+    int        qdisc_bypass;
+} reflector_opts_t;
+
+typedef struct {
+    int                  index;
+    const reflector_opts_t *opts;
+    int                  fd_rx;
+    int                  fd_tx;     // == fd_rx quando a saída é a mesma interface
+    pthread_t            thread;
+
+    atomic_uint_fast64_t received;
+    atomic_uint_fast64_t reflected;
+    atomic_uint_fast64_t ignored;   // sem ID do NetWagon, truncados ou de saída
+    atomic_uint_fast64_t tx_errors;
+} worker_t;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static uint64_t realtime_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int open_socket(const char *dev, int rx, int fanout_id, const reflector_opts_t *opts) {
+    int ifindex = (int)if_nametoindex(dev);
+    if (ifindex == 0) {
+        fprintf(stderr, "reflector: interface '%s' não encontrada\n", dev);
+        return -1;
+    }
+    // o socket só de envio usa protocolo 0 para não receber cópia do tráfego
+    const uint16_t proto = rx ? htons(ETH_P_ALL) : 0;
+    int fd = socket(AF_PACKET, SOCK_RAW, proto);
+    if (fd < 0) {
+        perror("reflector: socket AF_PACKET");
+        return -1;
+    }
+    struct sockaddr_ll sll;
+    memset(&sll, 0, sizeof(sll));
+    sll.sll_family   = AF_PACKET;
+    sll.sll_protocol = proto;
+    sll.sll_ifindex  = ifindex;
+    if (bind(fd, (struct sockaddr *)&sll, sizeof(sll)) != 0) {
+        perror("reflector: bind");
+        close(fd);
+        return -1;
+    }
+    if (opts->qdisc_bypass) {
+        int one = 1;
+        setsockopt(fd, SOL_PACKET, PACKET_QDISC_BYPASS, &one, sizeof(one));
+    }
+    if (!rx) return fd;
+
+    struct packet_mreq mr;
+    memset(&mr, 0, sizeof(mr));
+    mr.mr_ifindex = ifindex;
+    mr.mr_type    = PACKET_MR_PROMISC;
+    setsockopt(fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mr, sizeof(mr));
+#ifdef PACKET_IGNORE_OUTGOING
+    // os quadros devolvidos não voltam para o próprio RX
+    int one = 1;
+    setsockopt(fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &one, sizeof(one));
+#endif
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+    struct timeval tv = { .tv_sec = 0, .tv_usec = RX_TIMEOUT_MS * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    // mesmo grupo em todos os workers: o kernel reparte por hash da 5-tupla
+    // (a ordem de cada fluxo é preservada)
+    if (opts->workers > 1) {
+        int fanout = (fanout_id & 0xFFFF) | (PACKET_FANOUT_HASH << 16);
+        if (setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) != 0) {
+            perror("reflector: PACKET_FANOUT");
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+/* instante de chegada gravado pelo kernel (SO_TIMESTAMPNS) ou 0 */
+static uint64_t kernel_ts_ns(struct msghdr *mh) {
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(mh); c; c = CMSG_NXTHDR(mh, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+            return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+        }
+    }
+    return 0;
+}
+
+static void *worker_run(void *arg) {
+    worker_t *w = arg;
+    const reflector_opts_t *opts = w->opts;
+    const uint32_t batch = opts->batch;
+    char name[16];
+    snprintf(name, sizeof(name), "W%d", w->index);
+    rt_apply_thread(opts->cpu_first >= 0 ? opts->cpu_first + w->index : -1, opts->fifo_prio, name);
+
+    // buffers e cabeçalhos alocados uma vez; o laço não aloca
+    uint8_t *pool = malloc((size_t)batch * SLOT_SIZE);
+    struct mmsghdr *rx = calloc(batch, sizeof(struct mmsghdr));
+    struct mmsghdr *tx = calloc(batch, sizeof(struct mmsghdr));
+    struct iovec *rx_iov = calloc(batch, sizeof(struct iovec));
+    struct iovec *tx_iov = calloc(batch, sizeof(struct iovec));
+    struct sockaddr_ll *from = calloc(batch, sizeof(struct sockaddr_ll));
+    uint8_t (*ctrl)[CMSG_SPACE(sizeof(struct timespec))] =
+        calloc(batch, CMSG_SPACE(sizeof(struct timespec)));
+    uint64_t *arrival = calloc(batch, sizeof(uint64_t));
+    size_t *tag_off = calloc(batch, sizeof(size_t));
+    if (!pool || !rx || !tx || !rx_iov || !tx_iov || !from || !ctrl || !arrival || !tag_off) {
+        fprintf(stderr, "reflector[%d]: sem memória\n", w->index);
+        stop = 1;
+        goto out;
+    }
+    for (uint32_t i = 0; i < batch; i++) {
+        rx_iov[i].iov_base = pool + (size_t)i * SLOT_SIZE;
+        rx_iov[i].iov_len  = SLOT_SIZE;
+        rx[i].msg_hdr.msg_iov    = &rx_iov[i];
+        rx[i].msg_hdr.msg_iovlen = 1;
+        tx[i].msg_hdr.msg_iov    = &tx_iov[i];
+        tx[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (!stop) {
+        for (uint32_t i = 0; i < batch; i++) {
+            rx[i].msg_hdr.msg_name       = &from[i];
+            rx[i].msg_hdr.msg_namelen    = sizeof(struct sockaddr_ll);
+            rx[i].msg_hdr.msg_control    = ctrl[i];
+            rx[i].msg_hdr.msg_controllen = sizeof(ctrl[i]);
+            rx[i].msg_hdr.msg_flags      = 0;
+        }
+        int n = recvmmsg(w->fd_rx, rx, batch, MSG_WAITFORONE, NULL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) continue;
+            perror("reflector: recvmmsg");
+            stop = 1;
+            break;
+        }
+        const uint64_t t_batch = opts->dwell ? realtime_ns() : 0;
+
+        uint32_t out = 0, ignored = 0;
+        for (int i = 0; i < n; i++) {
+            uint8_t *frame = rx_iov[i].iov_base;
+            const size_t len = rx[i].msg_len;
+            rx_frame_info_t info;
+            if (from[i].sll_pkttype == PACKET_OUTGOING || (rx[i].msg_hdr.msg_flags & MSG_TRUNC) ||
+                rx_parse_frame(frame, len, &info) != 0 || nw_reflect(frame, len) != 0) {
+                ignored++;
+                continue;
+            }
+            if (opts->dwell) {
+                const uint64_t k = kernel_ts_ns(&rx[i].msg_hdr);
+                arrival[out] = k ? k : t_batch;
+                tag_off[out] = info.payload_offset;
+            }
+            tx_iov[out].iov_base = frame;
+            tx_iov[out].iov_len  = len;
+            out++;
+        }
+
+        // a permanência vai até o instante anterior ao envio do lote
+        if (opts->dwell && out) {
+            const uint64_t now = realtime_ns();
+            for (uint32_t i = 0; i < out; i++) {
+                nw_probe_stamp_dwell(tx_iov[i].iov_base, tx_iov[i].iov_len, tag_off[i],
+                                     now > arrival[i] ? now - arrival[i] : 0);
+            }
+        }
+
+        uint32_t sent = 0;
+        while (sent < out) {
+            int r = sendmmsg(w->fd_tx, tx + sent, out - sent, 0);
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                // fila cheia ou erro: descarta o restante do lote
+                atomic_fetch_add_explicit(&w->tx_errors, out - sent, memory_order_relaxed);
+                break;
+            }
+            sent += (uint32_t)r;
+        }
+
+        atomic_fetch_add_explicit(&w->received, (uint64_t)n, memory_order_relaxed);
+        atomic_fetch_add_explicit(&w->reflected, sent, memory_order_relaxed);
+        atomic_fetch_add_explicit(&w->ignored, ignored, memory_order_relaxed);
+    }
+
+out:
+    free(pool);
+    free(rx);
+    free(tx);
+    free(rx_iov);
+    free(tx_iov);
+    free(from);
+    free(ctrl);
+    free(arrival);
+    free(tag_off);
+    return NULL;
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s -i <iface> [-o <iface_out>] [opções]\n", prog);
+    printf("  -i <iface>       Interface de captura (obrigatório)\n");
+    printf("  -o <iface>       Interface de saída (default: a mesma de -i)\n");
+    printf("  -w <n>           Workers, cada um com seu socket no mesmo grupo PACKET_FANOUT (default=1)\n");
+    printf("  -b <n>           Quadros por recvmmsg/sendmmsg (default=%d, máx. %d)\n", DEFAULT_BATCH, MAX_BATCH);
+    printf("  --cpu <cpu>      Fixa o worker i na CPU cpu+i\n");
+    printf("  --fifo <prio>    Usa SCHED_FIFO com a prioridade dada nos workers\n");
+    printf("  --dwell          Grava a permanência no refletor (ns) nos 8 bytes após o tag de sonda\n");
+    printf("  --qdisc-bypass   Envia sem passar pela qdisc (PACKET_QDISC_BYPASS)\n");
+    printf("  -h               Exibe esta ajuda e sai\n");
+    printf("Devolve só quadros com ID do NetWagon (tag de sonda ou \"ID|\"), trocando MACs,\n");
+    printf("endereços IP e portas. Encerra com Ctrl+C.\n");
+}
+
+enum {
+    OPT_CPU = 256,
+    OPT_FIFO,
+    OPT_DWELL,
+    OPT_QDISC_BYPASS
+};
+
+static const struct option long_options[] = {
+    { "iface",        required_argument, NULL, 'i' },
+    { "out",          required_argument, NULL, 'o' },
+    { "workers",      required_argument, NULL, 'w' },
+    { "batch",        required_argument, NULL, 'b' },
+    { "cpu",          required_argument, NULL, OPT_CPU },
+    { "fifo",         required_argument, NULL, OPT_FIFO },
+    { "dwell",        no_argument,       NULL, OPT_DWELL },
+    { "qdisc-bypass", no_argument,       NULL, OPT_QDISC_BYPASS },
+    { "help",         no_argument,       NULL, 'h' },
+    { NULL, 0, NULL, 0 }
+};
+
+int main(int argc, char *argv[]) {
+    reflector_opts_t opts;
+    memset(&opts, 0, sizeof(opts));
+    opts.batch     = DEFAULT_BATCH;
+    opts.workers   = 1;
+    opts.cpu_first = -1;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "i:o:w:b:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'i': opts.iface_in = optarg; break;
+            case 'o': opts.iface_out = optarg; break;
+            case 'w': opts.workers = atoi(optarg); break;
+            case 'b': opts.batch = (uint32_t)atoi(optarg); break;
+            case OPT_CPU: opts.cpu_first = atoi(optarg); break;
+            case OPT_FIFO: opts.fifo_prio = atoi(optarg); break;
+            case OPT_DWELL: opts.dwell = 1; break;
+            case OPT_QDISC_BYPASS: opts.qdisc_bypass = 1; break;
+            case 'h':
+            default:
+                print_usage(argv[0]);
+                return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (!opts.iface_in) {
+        fprintf(stderr, "Erro: -i é obrigatório.\n");
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (opts.workers < 1 || opts.workers > MAX_WORKERS || opts.batch < 1 || opts.batch > MAX_BATCH) {
+        fprintf(stderr, "Erro: -w deve estar em 1..%d e -b em 1..%d\n", MAX_WORKERS, MAX_BATCH);
+        return EXIT_FAILURE;
+    }
+    const int same_iface = !opts.iface_out || strcmp(opts.iface_out, opts.iface_in) == 0;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    worker_t *workers = calloc((size_t)opts.workers, sizeof(worker_t));
+    if (!workers) {
+        fprintf(stderr, "Erro: sem memória\n");
+        return EXIT_FAILURE;
+    }
+    const int fanout_id = (int)getpid();
+    int started = 0, rc = EXIT_SUCCESS;
+    for (int i = 0; i < opts.workers; i++) {
+        worker_t *w = &workers[i];
+        w->index = i;
+        w->opts  = &opts;
+        w->fd_rx = open_socket(opts.iface_in, 1, fanout_id, &opts);
+        w->fd_tx = w->fd_rx;
+        if (w->fd_rx >= 0 && !same_iface) {
+            w->fd_tx = open_socket(opts.iface_out, 0, fanout_id, &opts);
+        }
+        if (w->fd_rx < 0 || w->fd_tx < 0 || pthread_create(&w->thread, NULL, worker_run, w) != 0) {
+            fprintf(stderr, "Erro: falha ao iniciar o worker %d\n", i);
+            if (w->fd_tx >= 0 && w->fd_tx != w->fd_rx) close(w->fd_tx);
+            if (w->fd_rx >= 0) close(w->fd_rx);
+            rc = EXIT_FAILURE;
+            stop = 1;
+            break;
+        }
+        started++;
+    }
+    if (started) {
+        printf("Refletindo %s -> %s com %d worker(s), lote de %u quadros%s\n",
+               opts.iface_in, same_iface ? opts.iface_in : opts.iface_out, started, opts.batch,
+               opts.dwell ? ", com permanência" : "");
+        fflush(stdout);
+    }
+
+    uint64_t received = 0, reflected = 0, ignored = 0, tx_errors = 0;
+    for (int i = 0; i < started; i++) {
+        worker_t *w = &workers[i];
+        pthread_join(w->thread, NULL);
+        received  += atomic_load(&w->received);
+        reflected += atomic_load(&w->reflected);
+        ignored   += atomic_load(&w->ignored);
+        tx_errors += atomic_load(&w->tx_errors);
+        if (w->fd_tx != w->fd_rx) close(w->fd_tx);
+        close(w->fd_rx);
+    }
+    if (started) {
+        printf("Refletor: recebidos=%llu, refletidos=%llu, ignorados=%llu, falhas de envio=%llu\n",
+               (unsigned long long)received, (unsigned long long)reflected,
+               (unsigned long long)ignored, (unsigned long long)tx_errors);
+    }
+    free(workers);
+    return rc;
+}